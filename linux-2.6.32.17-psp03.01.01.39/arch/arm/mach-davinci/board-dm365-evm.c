@@ -226,6 +226,9 @@ static struct at24_platform_data eeprom_info = {
 
 static struct snd_platform_data dm365_evm_snd_data = {
 	.eventq_no = EVENTQ_3,
+	.sram_size_playback = SZ_8K,
+	.sram_size_capture = SZ_8K,
+	.ram_chan_q = EVENTQ_1,
 };
 
 /*
@@ -949,6 +952,8 @@ static void __init dm365_init_tsc2004(void)
 
 static __init void dm365_evm_init(void)
 {
+	int ret;
+
 	evm_init_i2c();
 	davinci_serial_init(&uart_config);
 
@@ -968,6 +973,11 @@ static __init void dm365_evm_init(void)
 			ARRAY_SIZE(dm365_evm_spi_info));
 
 	dm365_init_tsc2004();
+
+	ret = dm365_register_cpufreq();
+	if (ret)
+		pr_warning("dm365_evm_init: cpufreq registration failed: %d\n",
+				ret);
 }
 
 static __init void dm365_evm_irq_init(void)
@@ -63,6 +63,9 @@
 
 static struct snd_platform_data dm368_leopard_snd_data = {
 	.eventq_no = EVENTQ_3,
+	.sram_size_playback = SZ_8K,
+	.sram_size_capture = SZ_8K,
+	.ram_chan_q = EVENTQ_1,
 };
 
 static struct i2c_board_info i2c_info[] = {
@@ -499,6 +502,8 @@ static void __init dm368_leopard_map_io(void)
 
 static __init void dm368_leopard_init(void)
 {
+	int ret;
+
 	leopard_init_i2c();
 	davinci_serial_init(&uart_config);
 
@@ -519,6 +524,11 @@ static __init void dm368_leopard_init(void)
 
 	platform_add_devices(dm368_leopard_devices,
 		ARRAY_SIZE(dm368_leopard_devices));
+
+	ret = dm365_register_cpufreq();
+	if (ret)
+		pr_warning("dm368_leopard_init: cpufreq registration failed: "
+				"%d\n", ret);
 }
 
 static __init void dm368_leopard_irq_init(void)
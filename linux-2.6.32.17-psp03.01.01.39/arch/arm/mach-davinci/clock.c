@@ -434,6 +434,110 @@ int davinci_set_pllrate(struct pll_data *pll, unsigned int prediv,
 }
 EXPORT_SYMBOL(davinci_set_pllrate);
 
+/* Divider ratio of a PLL-derived clock that comes closest to @rate */
+static unsigned davinci_sysclk_ratio(struct clk *clk, unsigned long rate)
+{
+	unsigned ratio;
+
+	if (!rate)
+		return PLLDIV_RATIO_MASK + 1;
+
+	ratio = DIV_ROUND_CLOSEST(clk->parent->rate, rate);
+	if (ratio < 1)
+		ratio = 1;
+	if (ratio > PLLDIV_RATIO_MASK + 1)
+		ratio = PLLDIV_RATIO_MASK + 1;
+
+	return ratio;
+}
+
+/**
+ * davinci_round_sysclk_rate - round_rate() for PLL-derived clocks
+ * @clk: clock with a divider after the PLL multiplier
+ * @rate: wanted rate
+ *
+ * Returns the rate closest to @rate that the divider can produce.
+ */
+int davinci_round_sysclk_rate(struct clk *clk, unsigned long rate)
+{
+	if (WARN_ON(!clk->parent || !clk->parent->pll_data || !clk->div_reg))
+		return clk->rate;
+
+	return clk->parent->rate / davinci_sysclk_ratio(clk, rate);
+}
+EXPORT_SYMBOL(davinci_round_sysclk_rate);
+
+/* a GO operation takes a few hundred PLL cycles, far below this */
+#define GOSTAT_TIMEOUT_US	1000
+
+/* wait for a GO operation to finish, called with interrupts disabled */
+static int davinci_wait_gostat(struct pll_data *pll)
+{
+	unsigned timeout = GOSTAT_TIMEOUT_US;
+
+	while (__raw_readl(pll->base + PLLSTAT) & PLLSTAT_GOSTAT) {
+		if (!timeout--)
+			return -EBUSY;
+		udelay(1);
+	}
+
+	return 0;
+}
+
+/**
+ * davinci_set_sysclk_rate - set_rate() for PLL-derived clocks
+ * @clk: clock with a divider after the PLL multiplier
+ * @rate: wanted rate, rounded as davinci_round_sysclk_rate() does
+ *
+ * Only the divider changes; the PLL keeps running and stays locked.  The
+ * new ratio takes effect through a GO operation, which the PLL controller
+ * aligns with the other dividers, so the switch is glitch free.  Returns
+ * -EBUSY if the PLL controller never finishes the GO operation.
+ */
+int davinci_set_sysclk_rate(struct clk *clk, unsigned long rate)
+{
+	struct pll_data *pll;
+	unsigned long flags;
+	unsigned ratio;
+	int ret;
+	u32 v;
+
+	if (WARN_ON(!clk->parent || !clk->parent->pll_data || !clk->div_reg))
+		return -EINVAL;
+
+	/* pre-PLL clocks aren't divided from the PLL output */
+	if (clk->flags & PRE_PLL)
+		return -EINVAL;
+
+	pll = clk->parent->pll_data;
+	ratio = davinci_sysclk_ratio(clk, rate);
+
+	spin_lock_irqsave(&clockfw_lock, flags);
+
+	/* a GO operation must not be pending when the divider changes */
+	ret = davinci_wait_gostat(pll);
+	if (ret)
+		goto out;
+
+	v = __raw_readl(pll->base + clk->div_reg);
+	v &= ~PLLDIV_RATIO_MASK;
+	v |= (ratio - 1) | PLLDIV_EN;
+	__raw_writel(v, pll->base + clk->div_reg);
+
+	v = __raw_readl(pll->base + PLLCMD);
+	__raw_writel(v | PLLCMD_GOSET, pll->base + PLLCMD);
+
+	ret = davinci_wait_gostat(pll);
+out:
+	spin_unlock_irqrestore(&clockfw_lock, flags);
+
+	if (ret)
+		pr_err("%s: PLL GO operation stuck while setting %s\n",
+				__func__, clk->name);
+	return ret;
+}
+EXPORT_SYMBOL(davinci_set_sysclk_rate);
+
 int __init davinci_clk_init(struct davinci_clk *clocks)
   {
 	struct davinci_clk *c;
@@ -38,7 +38,9 @@
 #define POSTDIV         0x128
 #define BPDIV           0x12c
 #define PLLCMD		0x138
+#define PLLCMD_GOSET	BIT(0)
 #define PLLSTAT		0x13c
+#define PLLSTAT_GOSTAT	BIT(0)
 #define PLLALNCTL	0x140
 #define PLLDCHANGE	0x144
 #define PLLCKEN		0x148
@@ -105,6 +107,8 @@ struct davinci_clk {
 int davinci_clk_init(struct davinci_clk *clocks);
 int davinci_set_pllrate(struct pll_data *pll, unsigned int prediv,
 				unsigned int mult, unsigned int postdiv);
+int davinci_round_sysclk_rate(struct clk *clk, unsigned long rate);
+int davinci_set_sysclk_rate(struct clk *clk, unsigned long rate);
 
 extern struct platform_device davinci_wdt_device;
 
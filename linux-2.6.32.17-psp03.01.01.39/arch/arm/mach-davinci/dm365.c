@@ -36,6 +36,7 @@
 #include <mach/asp.h>
 #include <mach/keyscan.h>
 #include <mach/spi.h>
+#include <mach/cpufreq.h>
 #include <video/davinci_osd.h>
 #include <video/davinci_vpbe.h>
 
@@ -181,6 +182,8 @@ static struct clk pll2_sysclk2 = {
 	.parent		= &pll2_clk,
 	.flags		= CLK_PLL,
 	.div_reg	= PLLDIV2,
+	.set_rate	= davinci_set_sysclk_rate,
+	.round_rate	= davinci_round_sysclk_rate,
 };
 
 static struct clk pll2_sysclk3 = {
@@ -246,11 +249,24 @@ static struct clk vpss_master_clk = {
 	.flags		= CLK_PSC,
 };
 
+/* The ARM runs at the rate of its divider; nothing else uses that one */
+static int dm365_arm_set_rate(struct clk *clk, unsigned long rate)
+{
+	return clk_set_rate(clk->parent, rate);
+}
+
+static int dm365_arm_round_rate(struct clk *clk, unsigned long rate)
+{
+	return clk_round_rate(clk->parent, rate);
+}
+
 static struct clk arm_clk = {
 	.name		= "arm_clk",
 	.parent		= &pll2_sysclk2,
 	.lpsc		= DAVINCI_LPSC_ARM,
 	.flags		= ALWAYS_ENABLED,
+	.set_rate	= dm365_arm_set_rate,
+	.round_rate	= dm365_arm_round_rate,
 };
 
 static struct clk uart0_clk = {
@@ -933,6 +949,17 @@ dm365_queue_priority_mapping[][2] = {
 	{-1, -1},
 };
 
+static const s8
+dm365_qos_queue_mapping[][2] = {
+	/* {client class, event queue no} */
+	{EDMA_QOS_AUDIO, 3},
+	{EDMA_QOS_VIDEO, 1},
+	{EDMA_QOS_STORAGE, 0},
+	/* shared with unclassed channels, see .default_queue */
+	{EDMA_QOS_BULK, 2},
+	{-1, -1},
+};
+
 static struct edma_soc_info dm365_edma_info[] = {
 	{
 		.n_channel		= 64,
@@ -942,6 +969,7 @@ static struct edma_soc_info dm365_edma_info[] = {
 		.n_cc			= 1,
 		.queue_tc_mapping	= dm365_queue_tc_mapping,
 		.queue_priority_mapping	= dm365_queue_priority_mapping,
+		.qos_queue_mapping	= dm365_qos_queue_mapping,
 		.default_queue		= EVENTQ_2,
 	},
 };
@@ -1229,6 +1257,55 @@ void __init dm365_init(void)
 	davinci_common_init(&davinci_soc_info_dm365);
 }
 
+#ifdef CONFIG_CPU_FREQ
+/*
+ * Operating points are the rate the boot loader left the ARM at, and the
+ * slower ones down to a quarter of it that the PLL2 divider for the ARM
+ * can make.  PLL2 itself, and with it DDR, and PLL1 with all peripheral
+ * clocks, are left alone.  Only the ARM clock changes.
+ */
+#define DM365_MAX_OPP		8
+
+static struct cpufreq_frequency_table dm365_freq_table[DM365_MAX_OPP + 1];
+
+static struct davinci_cpufreq_config cpufreq_info = {
+	.freq_table = dm365_freq_table,
+};
+
+static struct platform_device dm365_cpufreq_device = {
+	.name			= "cpufreq-davinci",
+	.dev			= {
+		.platform_data	= &cpufreq_info,
+	},
+	.id			= -1,
+};
+
+int __init dm365_register_cpufreq(void)
+{
+	unsigned long pll_rate = pll2_clk.rate;
+	unsigned ratio, boot_ratio;
+	int i = 0;
+
+	boot_ratio = DIV_ROUND_CLOSEST(pll_rate, pll2_sysclk2.rate);
+	for (ratio = boot_ratio; ratio <= 4 * boot_ratio &&
+			ratio <= PLLDIV_RATIO_MASK + 1 &&
+			i < DM365_MAX_OPP; ratio++) {
+		dm365_freq_table[i].index = i;
+		dm365_freq_table[i].frequency = pll_rate / ratio / 1000;
+		i++;
+	}
+	dm365_freq_table[i].index = i;
+	dm365_freq_table[i].frequency = CPUFREQ_TABLE_END;
+
+	return platform_device_register(&dm365_cpufreq_device);
+}
+#else
+int __init dm365_register_cpufreq(void)
+{
+	return 0;
+}
+#endif
+
 static struct resource dm365_vpss_resources[] = {
 	{
 		/* VPSS ISP5 Base address */
@@ -0,0 +1,333 @@
+/*
+ * EDMA3 2D/3D memory-to-memory copy service
+ *
+ * Built on the EDMA3 channel and PaRAM slot API of dma.c
+ *   Copyright (C) 2006-2009 Texas Instruments.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Image blits and plane copies map directly onto AB-synchronized PaRAM
+ * sets: ACNT is the line width, BCNT the line count and CCNT the plane
+ * count, with the B and C indexes carrying the pitches.  Each copy handle
+ * owns one software-triggered channel and a set of link slots, so that
+ * several rectangles can be chained into one transfer which raises a
+ * single completion interrupt.
+ */
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/completion.h>
+#include <linux/err.h>
+#include <linux/jiffies.h>
+
+#include <mach/edma.h>
+
+struct edma_copy {
+	spinlock_t		lock;
+	int			channel;
+	unsigned		max_sets;
+	/* slots[0] is the channel's own set, the rest are link slots */
+	unsigned		*slots;
+	struct edmacc_param	*params;
+	unsigned		nr_params;
+
+	bool			busy;
+	int			status;
+	struct completion	done;
+	void			(*callback)(void *data, int status);
+	void			*data;
+};
+
+/* default timeout used by edma_copy_rects(), in milliseconds */
+#define EDMA_COPY_TIMEOUT_MS	1000
+
+static inline bool edma_copy_fits_s16(int val)
+{
+	return val >= -32768 && val <= 32767;
+}
+
+static void edma_copy_callback(unsigned channel, u16 ch_status, void *data)
+{
+	struct edma_copy *copy = data;
+	void (*callback)(void *data, int status);
+	void *cb_data;
+	int status = 0;
+
+	if (ch_status != DMA_COMPLETE) {
+		pr_err("EDMA copy: channel %u error %u\n",
+				EDMA_CHAN_SLOT(channel), ch_status);
+		edma_clean_channel(copy->channel);
+		status = -EIO;
+	}
+
+	spin_lock(&copy->lock);
+	copy->status = status;
+	copy->busy = false;
+	callback = copy->callback;
+	cb_data = copy->data;
+	spin_unlock(&copy->lock);
+
+	complete(&copy->done);
+	if (callback)
+		callback(cb_data, status);
+}
+
+/*
+ * Append the PaRAM sets describing one rectangle.  Planes share a single
+ * set when both plane pitches fit the 16-bit C index, otherwise every
+ * plane gets its own set.
+ */
+static int edma_copy_build(struct edma_copy *copy,
+		const struct edma_copy_rect *rect)
+{
+	unsigned ccnt, nsets, i;
+	struct edmacc_param *p;
+
+	if (!rect->width || rect->width > 0xffff
+			|| !rect->height || rect->height > 0xffff
+			|| !rect->planes)
+		return -EINVAL;
+	if (!edma_copy_fits_s16(rect->src_pitch)
+			|| !edma_copy_fits_s16(rect->dst_pitch))
+		return -EINVAL;
+
+	if (rect->planes <= 0xffff
+			&& edma_copy_fits_s16(rect->src_plane_pitch)
+			&& edma_copy_fits_s16(rect->dst_plane_pitch)) {
+		ccnt = rect->planes;
+		nsets = 1;
+	} else {
+		ccnt = 1;
+		nsets = rect->planes;
+	}
+
+	if (copy->nr_params + nsets > copy->max_sets)
+		return -ENOSPC;
+
+	for (i = 0; i < nsets; i++) {
+		p = &copy->params[copy->nr_params++];
+
+		/* intermediate chaining triggers each following plane */
+		p->opt = EDMA_TCC(EDMA_CHAN_SLOT(copy->channel))
+				| SYNCDIM | ITCCHEN | TCCHEN;
+		p->src = rect->src + i * rect->src_plane_pitch;
+		p->dst = rect->dst + i * rect->dst_plane_pitch;
+		p->a_b_cnt = rect->height << 16 | rect->width;
+		p->src_dst_bidx = (rect->dst_pitch & 0xffff) << 16
+				| (rect->src_pitch & 0xffff);
+		p->link_bcntrld = 0xffff;
+		p->src_dst_cidx = (rect->dst_plane_pitch & 0xffff) << 16
+				| (rect->src_plane_pitch & 0xffff);
+		p->ccnt = ccnt;
+	}
+
+	return 0;
+}
+
+/**
+ * edma_copy_alloc - allocate a 2D/3D copy handle
+ * @max_sets: largest number of PaRAM sets one transfer may use; a
+ *	rectangle needs one set, or one per plane when its plane pitches
+ *	exceed 32 KiB
+ * @eventq: an EVENTQ_* constant selecting the transfer controller
+ *
+ * Returns the handle, else ERR_PTR(-errno).
+ */
+struct edma_copy *edma_copy_alloc(unsigned max_sets, enum dma_event_q eventq)
+{
+	struct edma_copy *copy;
+	int ret;
+
+	if (!max_sets)
+		return ERR_PTR(-EINVAL);
+
+	copy = kzalloc(sizeof(*copy), GFP_KERNEL);
+	if (!copy)
+		return ERR_PTR(-ENOMEM);
+
+	copy->params = kcalloc(max_sets, sizeof(*copy->params), GFP_KERNEL);
+	copy->slots = kcalloc(max_sets, sizeof(*copy->slots), GFP_KERNEL);
+	if (!copy->params || !copy->slots) {
+		ret = -ENOMEM;
+		goto err_mem;
+	}
+
+	spin_lock_init(&copy->lock);
+	init_completion(&copy->done);
+	copy->max_sets = max_sets;
+
+	copy->channel = edma_alloc_channel(EDMA_CHANNEL_ANY,
+			edma_copy_callback, copy, eventq);
+	if (copy->channel < 0) {
+		ret = copy->channel;
+		goto err_mem;
+	}
+
+	/* the channel's own set runs the first rectangle */
+	copy->slots[0] = copy->channel;
+	if (max_sets > 1) {
+		ret = edma_alloc_slot_chain(EDMA_CTLR(copy->channel),
+				&copy->slots[1], max_sets - 1, false);
+		if (ret < 0)
+			goto err_chan;
+	}
+
+	return copy;
+
+err_chan:
+	edma_free_channel(copy->channel);
+err_mem:
+	kfree(copy->slots);
+	kfree(copy->params);
+	kfree(copy);
+	return ERR_PTR(ret);
+}
+EXPORT_SYMBOL(edma_copy_alloc);
+
+/**
+ * edma_copy_free - release a copy handle
+ * @copy: handle from edma_copy_alloc(), with no transfer in flight
+ */
+void edma_copy_free(struct edma_copy *copy)
+{
+	edma_stop(copy->channel);
+	if (copy->max_sets > 1)
+		edma_free_slot_chain(&copy->slots[1], copy->max_sets - 1);
+	edma_free_channel(copy->channel);
+
+	kfree(copy->slots);
+	kfree(copy->params);
+	kfree(copy);
+}
+EXPORT_SYMBOL(edma_copy_free);
+
+/**
+ * edma_copy_set_class - place a copy handle under the event queue policy
+ * @copy: handle from edma_copy_alloc()
+ * @cls: client class of the copies, see edma_set_channel_class()
+ *
+ * Returns zero on success, else negative errno.
+ */
+int edma_copy_set_class(struct edma_copy *copy, enum edma_qos_class cls)
+{
+	return edma_set_channel_class(copy->channel, cls);
+}
+EXPORT_SYMBOL(edma_copy_set_class);
+
+/**
+ * edma_copy_submit - start copying a list of rectangles
+ * @copy: handle from edma_copy_alloc()
+ * @rects: rectangles to copy, in order; addresses must already be mapped
+ * @nr_rects: number of entries in @rects
+ * @callback: optional; issued from interrupt context with zero or
+ *	a negative errno once the whole list has been copied
+ * @data: passed to @callback
+ *
+ * All rectangles are written into linked PaRAM sets and run back to back
+ * as one transfer.  Returns zero once the transfer is started, else
+ * negative errno; -EBUSY means the handle still has a transfer in flight.
+ */
+int edma_copy_submit(struct edma_copy *copy,
+		const struct edma_copy_rect *rects, unsigned nr_rects,
+		void (*callback)(void *data, int status), void *data)
+{
+	unsigned long flags;
+	unsigned i;
+	int ret;
+
+	if (!nr_rects)
+		return -EINVAL;
+
+	spin_lock_irqsave(&copy->lock, flags);
+	if (copy->busy) {
+		spin_unlock_irqrestore(&copy->lock, flags);
+		return -EBUSY;
+	}
+	copy->busy = true;
+	spin_unlock_irqrestore(&copy->lock, flags);
+
+	copy->nr_params = 0;
+	for (i = 0; i < nr_rects; i++) {
+		ret = edma_copy_build(copy, &rects[i]);
+		if (ret < 0)
+			goto err;
+	}
+
+	/* the last set ends the chain and raises the only interrupt */
+	copy->params[copy->nr_params - 1].opt &= ~TCCHEN;
+	copy->params[copy->nr_params - 1].opt |= TCINTEN;
+
+	edma_write_slot_chain(copy->slots, copy->params, copy->nr_params,
+			false);
+
+	INIT_COMPLETION(copy->done);
+	copy->status = 0;
+	copy->callback = callback;
+	copy->data = data;
+
+	ret = edma_start(copy->channel);
+	if (ret < 0)
+		goto err;
+
+	return 0;
+
+err:
+	spin_lock_irqsave(&copy->lock, flags);
+	copy->busy = false;
+	spin_unlock_irqrestore(&copy->lock, flags);
+	return ret;
+}
+EXPORT_SYMBOL(edma_copy_submit);
+
+/**
+ * edma_copy_wait - wait for the transfer started by edma_copy_submit()
+ * @copy: handle with a transfer in flight
+ * @timeout: timeout in jiffies
+ *
+ * Returns the transfer status, or -ETIMEDOUT after stopping the channel.
+ */
+int edma_copy_wait(struct edma_copy *copy, unsigned long timeout)
+{
+	unsigned long flags;
+
+	if (!wait_for_completion_timeout(&copy->done, timeout)) {
+		edma_stop(copy->channel);
+		edma_clean_channel(copy->channel);
+
+		spin_lock_irqsave(&copy->lock, flags);
+		copy->busy = false;
+		copy->callback = NULL;
+		spin_unlock_irqrestore(&copy->lock, flags);
+		return -ETIMEDOUT;
+	}
+
+	return copy->status;
+}
+EXPORT_SYMBOL(edma_copy_wait);
+
+/**
+ * edma_copy_rects - copy a list of rectangles and wait for completion
+ * @copy: handle from edma_copy_alloc()
+ * @rects: rectangles to copy, in order; addresses must already be mapped
+ * @nr_rects: number of entries in @rects
+ *
+ * Synchronous form of edma_copy_submit(); may sleep.
+ */
+int edma_copy_rects(struct edma_copy *copy,
+		const struct edma_copy_rect *rects, unsigned nr_rects)
+{
+	int ret;
+
+	ret = edma_copy_submit(copy, rects, nr_rects, NULL, NULL);
+	if (ret < 0)
+		return ret;
+
+	return edma_copy_wait(copy,
+			msecs_to_jiffies(EDMA_COPY_TIMEOUT_MS));
+}
+EXPORT_SYMBOL(edma_copy_rects);
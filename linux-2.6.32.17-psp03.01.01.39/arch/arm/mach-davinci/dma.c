@@ -26,6 +26,11 @@
 #include <linux/spinlock.h>
 #include <linux/compiler.h>
 #include <linux/io.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/uaccess.h>
+
+#include <asm/div64.h>
 
 #include <mach/cputype.h>
 #include <mach/memory.h>
@@ -108,6 +113,11 @@
 #define EDMA_MAX_DMACH           64
 #define EDMA_MAX_PARAMENTRY     512
 #define EDMA_MAX_CC               2
+#define EDMA_MAX_EVQUE            8
+
+/* fields in EDMA_QSTAT */
+#define QSTAT_NUMVAL(x)		(((x) >> 8) & 0x1f)
+#define QSTAT_WM(x)		(((x) >> 16) & 0x1f)
 
 
 /*****************************************************************************/
@@ -247,6 +257,11 @@ struct edma {
 	 */
 	DECLARE_BITMAP(edma_inuse, EDMA_MAX_PARAMENTRY);
 
+	/* No slot below this one (and above the channel slots) is free;
+	 * edma_alloc_slot() starts searching here.
+	 */
+	unsigned	slot_hint;
+
 	/* The edma_unused bit for each channel is clear unless
 	 * it is not being used on this platform. It uses a bit
 	 * of SOC-specific initialization code.
@@ -256,6 +271,27 @@ struct edma {
 	unsigned	irq_res_start;
 	unsigned	irq_res_end;
 
+	/* event queue policy: queue used by each client class, and the
+	 * class each channel was assigned to (-1 if none)
+	 */
+	s8		qos_queue[EDMA_QOS_NR_CLASSES];
+	s8		chan_class[EDMA_MAX_DMACH];
+	u8		chan_queue[EDMA_MAX_DMACH];
+
+#ifdef CONFIG_DEBUG_FS
+	/* unlocked, so only approximately consistent with each other */
+	struct edma_chan_stats {
+		u64	bytes;
+		u32	starts;
+		u32	completions;
+		u32	errors;
+		u64	start_ns;
+		u64	latency_ns;
+		u32	latency_cnt;
+		u32	latency_max_ns;
+	} stats[EDMA_MAX_DMACH];
+#endif
+
 	struct dma_interrupt_data {
 		void (*callback)(unsigned channel, unsigned short ch_status,
 				void *data);
@@ -286,6 +322,7 @@ static void map_dmach_queue(unsigned ctlr, unsigned ch_no,
 	queue_no &= 7;
 	edma_modify_array(ctlr, EDMA_DMAQNUM, (ch_no >> 3),
 			~(0x7 << bit), queue_no << bit);
+	edma_info[ctlr]->chan_queue[ch_no] = queue_no;
 }
 
 static void __init map_queue_tc(unsigned ctlr, int queue_no, int tc_no)
@@ -294,7 +331,7 @@ static void __init map_queue_tc(unsigned ctlr, int queue_no, int tc_no)
 	edma_modify(ctlr, EDMA_QUETCMAP, ~(0x7 << bit), ((tc_no & 0x7) << bit));
 }
 
-static void __init assign_priority_to_queue(unsigned ctlr, int queue_no,
+static void assign_priority_to_queue(unsigned ctlr, int queue_no,
 		int priority)
 {
 	int bit = queue_no * 4;
@@ -358,6 +395,48 @@ static int irq2ctlr(int irq)
 	return -1;
 }
 
+#ifdef CONFIG_DEBUG_FS
+/*
+ * Account the transfer programmed into the channel's own PaRAM set.
+ * Sets reloaded through links later on are not included.
+ */
+static void edma_stats_start(unsigned ctlr, unsigned ch)
+{
+	struct edma_chan_stats *st = &edma_info[ctlr]->stats[ch];
+	unsigned abcnt = edma_parm_read(ctlr, PARM_A_B_CNT, ch);
+	unsigned ccnt = edma_parm_read(ctlr, PARM_CCNT, ch) & 0xffff;
+
+	st->bytes += (u64)(abcnt & 0xffff) * (abcnt >> 16) * ccnt;
+	st->starts++;
+	st->start_ns = sched_clock();
+}
+
+static void edma_stats_complete(unsigned ctlr, unsigned ch, bool error)
+{
+	struct edma_chan_stats *st = &edma_info[ctlr]->stats[ch];
+	u64 delta;
+
+	if (error) {
+		st->errors++;
+		return;
+	}
+
+	st->completions++;
+	if (st->start_ns) {
+		delta = sched_clock() - st->start_ns;
+		st->start_ns = 0;
+		st->latency_ns += delta;
+		st->latency_cnt++;
+		if (delta > st->latency_max_ns)
+			st->latency_max_ns = min_t(u64, delta, ~0u);
+	}
+}
+#else
+static inline void edma_stats_start(unsigned ctlr, unsigned ch) { }
+static inline void edma_stats_complete(unsigned ctlr, unsigned ch,
+		bool error) { }
+#endif
+
 /******************************************************************************
  *
  * DMA interrupt handler
@@ -397,6 +476,7 @@ static irqreturn_t dma_irq_handler(int irq, void *data)
 				/* Clear the corresponding IPR bits */
 				edma_shadow0_write_array(ctlr, SH_ICR, j,
 							(1 << i));
+				edma_stats_complete(ctlr, k, false);
 				if (edma_info[ctlr]->intr_data[k].callback) {
 					edma_info[ctlr]->intr_data[k].callback(
 						k, DMA_COMPLETE,
@@ -453,6 +533,7 @@ static irqreturn_t dma_ccerr_handler(int irq, void *data)
 					/* Clear any SER */
 					edma_shadow0_write_array(ctlr, SH_SECR,
 								j, (1 << i));
+					edma_stats_complete(ctlr, k, true);
 					if (edma_info[ctlr]->intr_data[k].
 								callback) {
 						edma_info[ctlr]->intr_data[k].
@@ -597,6 +678,44 @@ static int prepare_unused_channel_list(struct device *dev, void *data)
 	return 0;
 }
 
+/*
+ * Grab any free non-channel slot.  The search starts at slot_hint, which
+ * only moves back when a lower slot is freed, so allocation does not
+ * rescan the busy low end of parameter RAM each time.  The hint is not
+ * locked; if a racing free was missed, the full range is rescanned
+ * before giving up.
+ */
+static int alloc_any_slot(unsigned ctlr)
+{
+	struct edma *cc = edma_info[ctlr];
+	unsigned start = max(cc->slot_hint, cc->num_channels);
+	unsigned slot = start;
+
+	for (;;) {
+		slot = find_next_zero_bit(cc->edma_inuse, cc->num_slots, slot);
+		if (slot == cc->num_slots) {
+			if (start == cc->num_channels)
+				return -ENOMEM;
+			slot = start = cc->num_channels;
+			continue;
+		}
+		if (!test_and_set_bit(slot, cc->edma_inuse))
+			break;
+	}
+	cc->slot_hint = slot + 1;
+
+	return slot;
+}
+
+static void free_one_slot(unsigned ctlr, unsigned slot)
+{
+	struct edma *cc = edma_info[ctlr];
+
+	clear_bit(slot, cc->edma_inuse);
+	if (slot < cc->slot_hint)
+		cc->slot_hint = slot;
+}
+
 /*-----------------------------------------------------------------------*/
 
 static bool unused_chan_list_done;
@@ -691,6 +810,7 @@ int edma_alloc_channel(int channel,
 
 	/* ensure access through shadow region 0 */
 	edma_or_array2(ctlr, EDMA_DRAE, 0, channel >> 5, 1 << (channel & 0x1f));
+	edma_info[ctlr]->chan_class[channel] = -1;
 
 	/* ensure no events are pending */
 	edma_stop(EDMA_CTLR_CHAN(ctlr, channel));
@@ -734,10 +854,64 @@ void edma_free_channel(unsigned channel)
 
 	memcpy_toio(edmacc_regs_base[ctlr] + PARM_OFFSET(channel),
 			&dummy_paramset, PARM_SIZE);
+	edma_info[ctlr]->chan_class[channel] = -1;
 	clear_bit(channel, edma_info[ctlr]->edma_inuse);
 }
 EXPORT_SYMBOL(edma_free_channel);
 
+/*-----------------------------------------------------------------------*/
+
+/* Event queue policy */
+
+static const char *edma_qos_names[EDMA_QOS_NR_CLASSES] = {
+	[EDMA_QOS_AUDIO]	= "audio",
+	[EDMA_QOS_VIDEO]	= "video",
+	[EDMA_QOS_STORAGE]	= "storage",
+	[EDMA_QOS_BULK]		= "bulk",
+};
+
+/**
+ * edma_set_channel_class - place a channel under the event queue policy
+ * @channel: channel returned from edma_alloc_channel()
+ * @cls: client class the channel's transfers belong to
+ *
+ * The channel is moved to the event queue (and thus transfer controller
+ * and bus priority) configured for @cls, and follows it when the policy
+ * is changed later through debugfs.  Channels which are never assigned
+ * a class keep the queue passed to edma_alloc_channel().
+ *
+ * Returns zero on success, else negative errno.
+ */
+int edma_set_channel_class(unsigned channel, enum edma_qos_class cls)
+{
+	unsigned ctlr;
+
+	ctlr = EDMA_CTLR(channel);
+	channel = EDMA_CHAN_SLOT(channel);
+
+	if (channel >= edma_info[ctlr]->num_channels ||
+			cls >= EDMA_QOS_NR_CLASSES)
+		return -EINVAL;
+
+	edma_info[ctlr]->chan_class[channel] = cls;
+	map_dmach_queue(ctlr, channel, edma_info[ctlr]->qos_queue[cls]);
+
+	return 0;
+}
+EXPORT_SYMBOL(edma_set_channel_class);
+
+/* move a class, and every channel assigned to it, to another queue */
+static void edma_set_class_queue(unsigned ctlr, enum edma_qos_class cls,
+		enum dma_event_q queue_no)
+{
+	unsigned ch;
+
+	edma_info[ctlr]->qos_queue[cls] = queue_no;
+	for (ch = 0; ch < edma_info[ctlr]->num_channels; ch++)
+		if (edma_info[ctlr]->chan_class[ch] == cls)
+			map_dmach_queue(ctlr, ch, queue_no);
+}
+
 /**
  * edma_alloc_slot - allocate DMA parameter RAM
  * @slot: specific slot to allocate; negative for "any unused slot"
@@ -758,16 +932,9 @@ int edma_alloc_slot(unsigned ctlr, int slot)
 		slot = EDMA_CHAN_SLOT(slot);
 
 	if (slot < 0) {
-		slot = edma_info[ctlr]->num_channels;
-		for (;;) {
-			slot = find_next_zero_bit(edma_info[ctlr]->edma_inuse,
-					edma_info[ctlr]->num_slots, slot);
-			if (slot == edma_info[ctlr]->num_slots)
-				return -ENOMEM;
-			if (!test_and_set_bit(slot,
-						edma_info[ctlr]->edma_inuse))
-				break;
-		}
+		slot = alloc_any_slot(ctlr);
+		if (slot < 0)
+			return slot;
 	} else if (slot < edma_info[ctlr]->num_channels ||
 			slot >= edma_info[ctlr]->num_slots) {
 		return -EINVAL;
@@ -803,7 +970,7 @@ void edma_free_slot(unsigned slot)
 
 	memcpy_toio(edmacc_regs_base[ctlr] + PARM_OFFSET(slot),
 			&dummy_paramset, PARM_SIZE);
-	clear_bit(slot, edma_info[ctlr]->edma_inuse);
+	free_one_slot(ctlr, slot);
 }
 EXPORT_SYMBOL(edma_free_slot);
 
@@ -900,13 +1067,85 @@ int edma_free_cont_slots(unsigned slot, int count)
 
 		memcpy_toio(edmacc_regs_base[ctlr] + PARM_OFFSET(slot_to_free),
 			&dummy_paramset, PARM_SIZE);
-		clear_bit(slot_to_free, edma_info[ctlr]->edma_inuse);
+		free_one_slot(ctlr, slot_to_free);
 	}
 
 	return 0;
 }
 EXPORT_SYMBOL(edma_free_cont_slots);
 
+/**
+ * edma_alloc_slot_chain - allocate and pre-link parameter RAM slots
+ * @ctlr: controller to allocate from
+ * @slots: filled in with @count slot numbers, in link order
+ * @count: number of slots wanted
+ * @cyclic: link the last slot back to the first instead of ending
+ *	the chain
+ *
+ * The slots need not be contiguous.  Each one is initialized to hold
+ * a dummy transfer linking to the next, in a single write per slot,
+ * so callers only have to fill in transfer parameters afterwards; see
+ * edma_write_slot_chain().
+ *
+ * Returns zero on success, else negative errno; on failure no slots
+ * remain allocated.
+ */
+int edma_alloc_slot_chain(unsigned ctlr, unsigned *slots, unsigned count,
+		bool cyclic)
+{
+	struct edmacc_param param = dummy_paramset;
+	unsigned i;
+	int slot;
+
+	if (count < 1)
+		return -EINVAL;
+
+	for (i = 0; i < count; i++) {
+		slot = alloc_any_slot(ctlr);
+		if (slot < 0)
+			goto err;
+		slots[i] = EDMA_CTLR_CHAN(ctlr, slot);
+	}
+
+	for (i = 0; i < count; i++) {
+		if (i + 1 < count)
+			param.link_bcntrld = PARM_OFFSET(
+					EDMA_CHAN_SLOT(slots[i + 1])) & 0xffff;
+		else if (cyclic)
+			param.link_bcntrld = PARM_OFFSET(
+					EDMA_CHAN_SLOT(slots[0])) & 0xffff;
+		else
+			param.link_bcntrld = 0xffff;
+		memcpy_toio(edmacc_regs_base[ctlr] +
+				PARM_OFFSET(EDMA_CHAN_SLOT(slots[i])),
+				&param, PARM_SIZE);
+	}
+
+	return 0;
+
+err:
+	while (i--)
+		free_one_slot(ctlr, EDMA_CHAN_SLOT(slots[i]));
+	return slot;
+}
+EXPORT_SYMBOL(edma_alloc_slot_chain);
+
+/**
+ * edma_free_slot_chain - deallocate slots from edma_alloc_slot_chain()
+ * @slots: slot numbers as returned by edma_alloc_slot_chain()
+ * @count: number of entries in @slots
+ *
+ * Callers are responsible for ensuring the slots are inactive.
+ */
+void edma_free_slot_chain(const unsigned *slots, unsigned count)
+{
+	unsigned i;
+
+	for (i = 0; i < count; i++)
+		edma_free_slot(slots[i]);
+}
+EXPORT_SYMBOL(edma_free_slot_chain);
+
 /*-----------------------------------------------------------------------*/
 
 /* Parameter RAM operations (i) -- read/write partial slots */
@@ -1210,6 +1449,52 @@ void edma_read_slot(unsigned slot, struct edmacc_param *param)
 }
 EXPORT_SYMBOL(edma_read_slot);
 
+/**
+ * edma_write_slot_chain - write a linked list of parameter RAM sets
+ * @slots: slots to write, in transfer order; all on one controller
+ * @params: one parameter set per slot
+ * @count: number of entries in @slots and @params
+ * @cyclic: link the last slot back to the first instead of ending
+ *	the chain
+ *
+ * Each set is written in a single pass with its link field pointing at
+ * the following slot, replacing one edma_write_slot() plus one
+ * read-modify-write edma_link() per entry.  The BCNTRLD halves of the
+ * link words are taken from @params.  @slots[0] may be a channel's
+ * own slot.  None of the slots may be part of an active transfer.
+ */
+void edma_write_slot_chain(const unsigned *slots,
+		const struct edmacc_param *params, unsigned count, bool cyclic)
+{
+	struct edmacc_param param;
+	unsigned ctlr, slot, next;
+	unsigned i;
+
+	if (count < 1)
+		return;
+
+	ctlr = EDMA_CTLR(slots[0]);
+	for (i = 0; i < count; i++) {
+		slot = EDMA_CHAN_SLOT(slots[i]);
+		if (EDMA_CTLR(slots[i]) != ctlr ||
+				slot >= edma_info[ctlr]->num_slots)
+			return;
+
+		param = params[i];
+		param.link_bcntrld &= 0xffff0000;
+		if (i + 1 < count || cyclic) {
+			next = EDMA_CHAN_SLOT(slots[(i + 1) % count]);
+			param.link_bcntrld |= PARM_OFFSET(next) & 0xffff;
+		} else {
+			param.link_bcntrld |= 0xffff;
+		}
+
+		memcpy_toio(edmacc_regs_base[ctlr] + PARM_OFFSET(slot),
+				&param, PARM_SIZE);
+	}
+}
+EXPORT_SYMBOL(edma_write_slot_chain);
+
 /*-----------------------------------------------------------------------*/
 
 /* Various EDMA channel control operations */
@@ -1279,6 +1564,8 @@ int edma_start(unsigned channel)
 		int j = channel >> 5;
 		unsigned int mask = (1 << (channel & 0x1f));
 
+		edma_stats_start(ctlr, channel);
+
 		/* EDMA channels without event association */
 		if (test_bit(channel, edma_info[ctlr]->edma_unused)) {
 			pr_debug("EDMA: ESR%d %08x\n", j,
@@ -1396,6 +1683,198 @@ void edma_clear_event(unsigned channel)
 }
 EXPORT_SYMBOL(edma_clear_event);
 
+#ifdef CONFIG_DEBUG_FS
+
+static int edma_num_queues(unsigned ctlr)
+{
+	return clamp_t(int, edma_info[ctlr]->num_tc, 1, EDMA_MAX_EVQUE);
+}
+
+static int edma_stats_show(struct seq_file *s, void *unused)
+{
+	unsigned ctlr, ch;
+	int q;
+
+	for (ctlr = 0; ctlr < arch_num_cc; ctlr++) {
+		struct edma *cc = edma_info[ctlr];
+		struct edma_chan_stats qsum[EDMA_MAX_EVQUE];
+
+		memset(qsum, 0, sizeof(qsum));
+
+		seq_printf(s, "cc%u  ch queue class     starts    compl errors"
+				"          bytes  avg_us  max_us\n", ctlr);
+		for (ch = 0; ch < cc->num_channels; ch++) {
+			struct edma_chan_stats *st = &cc->stats[ch];
+			struct edma_chan_stats *qs = &qsum[cc->chan_queue[ch]];
+			u64 avg = 0;
+
+			if (!st->starts && !st->completions && !st->errors)
+				continue;
+
+			if (st->latency_cnt) {
+				avg = st->latency_ns;
+				do_div(avg, st->latency_cnt);
+			}
+			seq_printf(s, "    %3u %5u %-8s %8u %8u %6u %14llu %7u %7u\n",
+				ch, cc->chan_queue[ch],
+				cc->chan_class[ch] < 0 ? "-" :
+					edma_qos_names[(int)cc->chan_class[ch]],
+				st->starts, st->completions, st->errors,
+				(unsigned long long)st->bytes,
+				(unsigned)avg / 1000,
+				st->latency_max_ns / 1000);
+
+			qs->bytes += st->bytes;
+			qs->starts += st->starts;
+			qs->completions += st->completions;
+			qs->errors += st->errors;
+			qs->latency_ns += st->latency_ns;
+			qs->latency_cnt += st->latency_cnt;
+			qs->latency_max_ns = max(qs->latency_max_ns,
+					st->latency_max_ns);
+		}
+
+		seq_printf(s, "cc%u queue tc prio   starts    compl errors"
+				"          bytes  avg_us  max_us wm\n", ctlr);
+		for (q = 0; q < edma_num_queues(ctlr); q++) {
+			struct edma_chan_stats *qs = &qsum[q];
+			unsigned qstat = edma_read_array(ctlr, EDMA_QSTAT, q);
+			u64 avg = 0;
+
+			if (qs->latency_cnt) {
+				avg = qs->latency_ns;
+				do_div(avg, qs->latency_cnt);
+			}
+			seq_printf(s, "    %5d %2u %4u %8u %8u %6u %14llu "
+					"%7u %7u %2u\n", q,
+				(edma_read(ctlr, EDMA_QUETCMAP) >> (q * 4)) & 7,
+				(edma_read(ctlr, EDMA_QUEPRI) >> (q * 4)) & 7,
+				qs->starts, qs->completions, qs->errors,
+				(unsigned long long)qs->bytes,
+				(unsigned)avg / 1000,
+				qs->latency_max_ns / 1000,
+				QSTAT_WM(qstat));
+		}
+	}
+
+	return 0;
+}
+
+static int edma_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, edma_stats_show, inode->i_private);
+}
+
+/* any write clears the counters */
+static ssize_t edma_stats_write(struct file *file, const char __user *buf,
+		size_t count, loff_t *ppos)
+{
+	unsigned ctlr;
+
+	for (ctlr = 0; ctlr < arch_num_cc; ctlr++)
+		memset(edma_info[ctlr]->stats, 0,
+				sizeof(edma_info[ctlr]->stats));
+
+	return count;
+}
+
+static const struct file_operations edma_stats_fops = {
+	.owner		= THIS_MODULE,
+	.open		= edma_stats_open,
+	.read		= seq_read,
+	.write		= edma_stats_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int edma_qos_show(struct seq_file *s, void *unused)
+{
+	unsigned ctlr;
+	int i;
+
+	for (ctlr = 0; ctlr < arch_num_cc; ctlr++) {
+		for (i = 0; i < EDMA_QOS_NR_CLASSES; i++)
+			seq_printf(s, "%u class %s %d\n", ctlr,
+					edma_qos_names[i],
+					edma_info[ctlr]->qos_queue[i]);
+		for (i = 0; i < edma_num_queues(ctlr); i++)
+			seq_printf(s, "%u prio %d %u\n", ctlr, i,
+				(edma_read(ctlr, EDMA_QUEPRI) >> (i * 4)) & 7);
+	}
+
+	return 0;
+}
+
+static int edma_qos_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, edma_qos_show, inode->i_private);
+}
+
+/*
+ * Accepts the lines edma_qos_show() prints:
+ *	"<cc> class <name> <queue>"	move a client class to a queue
+ *	"<cc> prio <queue> <priority>"	set a queue's bus priority
+ */
+static ssize_t edma_qos_write(struct file *file, const char __user *ubuf,
+		size_t count, loff_t *ppos)
+{
+	char buf[48], name[16];
+	unsigned ctlr;
+	int a, b, i;
+
+	if (count >= sizeof(buf))
+		return -EINVAL;
+	if (copy_from_user(buf, ubuf, count))
+		return -EFAULT;
+	buf[count] = '\0';
+
+	if (sscanf(buf, "%u class %15s %d", &ctlr, name, &b) == 3) {
+		if (ctlr >= arch_num_cc || b < 0 || b >= edma_num_queues(ctlr))
+			return -EINVAL;
+		for (i = 0; i < EDMA_QOS_NR_CLASSES; i++)
+			if (!strcmp(name, edma_qos_names[i]))
+				break;
+		if (i == EDMA_QOS_NR_CLASSES)
+			return -EINVAL;
+		edma_set_class_queue(ctlr, i, b);
+	} else if (sscanf(buf, "%u prio %d %d", &ctlr, &a, &b) == 3) {
+		if (ctlr >= arch_num_cc || a < 0 || a >= edma_num_queues(ctlr)
+				|| b < 0 || b > 7)
+			return -EINVAL;
+		assign_priority_to_queue(ctlr, a, b);
+	} else {
+		return -EINVAL;
+	}
+
+	return count;
+}
+
+static const struct file_operations edma_qos_fops = {
+	.owner		= THIS_MODULE,
+	.open		= edma_qos_open,
+	.read		= seq_read,
+	.write		= edma_qos_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void __init edma_debugfs_init(void)
+{
+	struct dentry *dir;
+
+	dir = debugfs_create_dir("edma", NULL);
+	if (!dir || IS_ERR(dir))
+		return;
+
+	debugfs_create_file("stats", S_IRUGO | S_IWUSR, dir, NULL,
+			&edma_stats_fops);
+	debugfs_create_file("qos", S_IRUGO | S_IWUSR, dir, NULL,
+			&edma_qos_fops);
+}
+#else
+static inline void edma_debugfs_init(void) { }
+#endif
+
 /*-----------------------------------------------------------------------*/
 
 static int __init edma_probe(struct platform_device *pdev)
@@ -1403,6 +1882,7 @@ static int __init edma_probe(struct platform_device *pdev)
 	struct edma_soc_info	*info = pdev->dev.platform_data;
 	const s8		(*queue_priority_mapping)[2];
 	const s8		(*queue_tc_mapping)[2];
+	const s8		(*qos_queue_mapping)[2];
 	int			i, j, off, ln, found = 0;
 	int			status = -1;
 	const s8		(*rsv_chans)[2];
@@ -1458,10 +1938,25 @@ static int __init edma_probe(struct platform_device *pdev)
 		edma_info[j]->num_cc = min_t(unsigned, info[j].n_cc,
 							EDMA_MAX_CC);
 
+		edma_info[j]->num_tc = info[j].n_tc;
+
 		edma_info[j]->default_queue = info[j].default_queue;
 		if (!edma_info[j]->default_queue)
 			edma_info[j]->default_queue = EVENTQ_1;
 
+		/* Client classes start out on the default queue */
+		memset(edma_info[j]->chan_class, -1,
+			sizeof(edma_info[j]->chan_class));
+		for (i = 0; i < EDMA_QOS_NR_CLASSES; i++)
+			edma_info[j]->qos_queue[i] =
+					edma_info[j]->default_queue;
+		qos_queue_mapping = info[j].qos_queue_mapping;
+		if (qos_queue_mapping) {
+			for (i = 0; qos_queue_mapping[i][0] != -1; i++)
+				edma_info[j]->qos_queue[qos_queue_mapping[i][0]]
+					= qos_queue_mapping[i][1];
+		}
+
 		dev_dbg(&pdev->dev, "DMA REG BASE ADDR=%p\n",
 			edmacc_regs_base[j]);
 
@@ -1550,6 +2045,8 @@ static int __init edma_probe(struct platform_device *pdev)
 		arch_num_cc++;
 	}
 
+	edma_debugfs_init();
+
 	if (tc_errs_handled) {
 		status = request_irq(IRQ_TCERRINT0, dma_tc0err_handler, 0,
 					"edma_tc0", &pdev->dev);
@@ -1587,7 +2084,6 @@ fail1:
 	return status;
 }
 
-
 static struct platform_driver edma_driver = {
 	.driver.name	= "edma",
 };
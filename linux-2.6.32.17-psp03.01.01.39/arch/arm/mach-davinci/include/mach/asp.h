@@ -55,6 +55,15 @@ struct snd_platform_data {
 	enum dma_event_q eventq_no;	/* event queue number */
 	unsigned int codec_fmt;
 
+	/*
+	 * Bytes of on-chip SRAM to stage each direction through (ping and
+	 * pong together; 0 runs straight from DDR), and the event queue
+	 * for the SRAM <-> DDR copies.
+	 */
+	unsigned sram_size_playback;
+	unsigned sram_size_capture;
+	enum dma_event_q ram_chan_q;
+
 	/* McASP specific fields */
 	int tdm_slots;
 	u8 op_mode;
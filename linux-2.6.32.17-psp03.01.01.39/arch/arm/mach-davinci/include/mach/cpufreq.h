@@ -0,0 +1,30 @@
+/*
+ * TI DaVinci CPUFreq platform support.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation version 2.
+ *
+ * This program is distributed "as is" WITHOUT ANY WARRANTY of any
+ * kind, whether express or implied; without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#ifndef _MACH_DAVINCI_CPUFREQ_H
+#define _MACH_DAVINCI_CPUFREQ_H
+
+#include <linux/cpufreq.h>
+
+/*
+ * freq_table: operating points, fastest first; the "arm" clock must be
+ *	able to run at each of them.
+ * set_voltage: optional, sets the core supply for freq_table[index].  It
+ *	is called before a switch to a faster point and after a switch to
+ *	a slower one.
+ */
+struct davinci_cpufreq_config {
+	struct cpufreq_frequency_table *freq_table;
+	int (*set_voltage)(unsigned int index);
+};
+
+#endif /* _MACH_DAVINCI_CPUFREQ_H */
@@ -42,6 +42,7 @@ void __init dm365_init_vc(struct snd_platform_data *pdata);
 void __init dm365_init_rtc(void);
 void __init dm365_init_ks(struct davinci_ks_platform_data *pdata);
 void dm365_set_vpfe_config(struct vpfe_config *cfg);
+int __init dm365_register_cpufreq(void);
 
 struct spi_board_info;
 void dm365_init_spi0(unsigned chipselect_mask,
@@ -0,0 +1,65 @@
+/*
+ * dmaengine glue for the TI DaVinci EDMA3 channel controller
+ *
+ * Based on include/linux/dw_dmac.h
+ *   Copyright (C) 2007 Atmel Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#ifndef __ASM_ARCH_EDMA_DMAENGINE_H
+#define __ASM_ARCH_EDMA_DMAENGINE_H
+
+#include <linux/dmaengine.h>
+#include <linux/dma-mapping.h>
+
+#include <mach/edma.h>
+
+/**
+ * struct edma_dma_slave - Controller-specific information about a slave
+ *
+ * @dma_dev: required DMA master device, the "edma-dma-engine" device
+ * @dma_ch: hardware event channel, as passed to edma_alloc_channel()
+ * @eventq: event queue (and thus transfer controller) for the channel
+ * @tx_reg: physical address of data register used for
+ *	memory-to-peripheral transfers
+ * @rx_reg: physical address of data register used for
+ *	peripheral-to-memory transfers
+ * @reg_width: peripheral register width in bytes (the EDMA ACNT)
+ * @mem_stride: bytes between elements in memory; zero means @reg_width
+ * @maxburst: number of @reg_width elements moved per hardware event;
+ *	zero or one selects A-synchronized transfers
+ *
+ * Clients pass this through dma_chan->private from the filter function
+ * given to dma_request_channel(), normally edma_dma_filter().
+ */
+struct edma_dma_slave {
+	struct device		*dma_dev;
+	int			dma_ch;
+	enum dma_event_q	eventq;
+	dma_addr_t		tx_reg;
+	dma_addr_t		rx_reg;
+	u16			reg_width;
+	u16			mem_stride;
+	u16			maxburst;
+};
+
+bool edma_dma_filter(struct dma_chan *chan, void *param);
+
+/* DMA API extensions */
+struct edma_cyclic_desc {
+	unsigned long	periods;
+	void		(*period_callback)(void *param);
+	void		*period_callback_param;
+};
+
+struct edma_cyclic_desc *edma_dma_cyclic_prep(struct dma_chan *chan,
+		dma_addr_t buf_addr, size_t buf_len, size_t period_len,
+		enum dma_data_direction direction);
+void edma_dma_cyclic_free(struct dma_chan *chan);
+int edma_dma_cyclic_start(struct dma_chan *chan);
+void edma_dma_cyclic_stop(struct dma_chan *chan);
+size_t edma_dma_cyclic_position(struct dma_chan *chan);
+
+#endif /* __ASM_ARCH_EDMA_DMAENGINE_H */
@@ -220,6 +220,15 @@ enum sync_dimension {
 	ABSYNC = 1
 };
 
+/* client classes for the event queue policy, see edma_set_channel_class() */
+enum edma_qos_class {
+	EDMA_QOS_AUDIO,
+	EDMA_QOS_VIDEO,
+	EDMA_QOS_STORAGE,
+	EDMA_QOS_BULK,
+	EDMA_QOS_NR_CLASSES
+};
+
 #define EDMA_CTLR_CHAN(ctlr, chan)	(((ctlr) << 16) | (chan))
 #define EDMA_CTLR(i)			((i) >> 16)
 #define EDMA_CHAN_SLOT(i)		((i) & 0xffff)
@@ -235,6 +244,7 @@ int edma_alloc_channel(int channel,
 	void (*callback)(unsigned channel, u16 ch_status, void *data),
 	void *data, enum dma_event_q);
 void edma_free_channel(unsigned channel);
+int edma_set_channel_class(unsigned channel, enum edma_qos_class cls);
 
 /* alloc/free parameter RAM slots */
 int edma_alloc_slot(unsigned ctlr, int slot);
@@ -244,6 +254,11 @@ void edma_free_slot(unsigned slot);
 int edma_alloc_cont_slots(unsigned ctlr, unsigned int id, int slot, int count);
 int edma_free_cont_slots(unsigned slot, int count);
 
+/* alloc/free pre-linked chains of parameter RAM slots */
+int edma_alloc_slot_chain(unsigned ctlr, unsigned *slots, unsigned count,
+		bool cyclic);
+void edma_free_slot_chain(const unsigned *slots, unsigned count);
+
 /* calls that operate on part of a parameter RAM slot */
 void edma_set_src(unsigned slot, dma_addr_t src_port,
 				enum address_mode mode, enum fifo_width);
@@ -260,6 +275,8 @@ void edma_unlink(unsigned from);
 /* calls that operate on an entire parameter RAM slot */
 void edma_write_slot(unsigned slot, const struct edmacc_param *params);
 void edma_read_slot(unsigned slot, struct edmacc_param *params);
+void edma_write_slot_chain(const unsigned *slots,
+		const struct edmacc_param *params, unsigned count, bool cyclic);
 
 /* channel control operations */
 int edma_start(unsigned channel);
@@ -269,6 +286,35 @@ void edma_clear_event(unsigned channel);
 void edma_pause(unsigned channel);
 void edma_resume(unsigned channel);
 
+/*
+ * 2D/3D memory-to-memory copies.  A rectangle is @height lines of @width
+ * bytes, repeated for @planes planes; pitches are the byte distances
+ * between the starts of consecutive lines and planes.
+ */
+struct edma_copy_rect {
+	dma_addr_t	src;
+	dma_addr_t	dst;
+	unsigned	width;
+	unsigned	height;
+	unsigned	planes;
+	int		src_pitch;
+	int		dst_pitch;
+	int		src_plane_pitch;
+	int		dst_plane_pitch;
+};
+
+struct edma_copy;
+
+struct edma_copy *edma_copy_alloc(unsigned max_sets, enum dma_event_q eventq);
+void edma_copy_free(struct edma_copy *copy);
+int edma_copy_set_class(struct edma_copy *copy, enum edma_qos_class cls);
+int edma_copy_submit(struct edma_copy *copy,
+		const struct edma_copy_rect *rects, unsigned nr_rects,
+		void (*callback)(void *data, int status), void *data);
+int edma_copy_wait(struct edma_copy *copy, unsigned long timeout);
+int edma_copy_rects(struct edma_copy *copy,
+		const struct edma_copy_rect *rects, unsigned nr_rects);
+
 /* platform_data for EDMA driver */
 struct edma_soc_info {
 
@@ -284,6 +330,8 @@ struct edma_soc_info {
 	const s16	(*rsv_slots)[2];
 	const s8	(*queue_tc_mapping)[2];
 	const s8	(*queue_priority_mapping)[2];
+	/* {client class, event queue}, terminated by -1; optional */
+	const s8	(*qos_queue_mapping)[2];
 };
 
 #endif
@@ -33,11 +33,6 @@
 #include <linux/init.h>
 #include <asm/cacheflush.h>
 #include <mach/edma.h>
-#define TCINTEN_SHIFT               20
-#define ITCINTEN_SHIFT              21
-
-/* edma isr status tracking variable */
-volatile static int irqraised1 = 1;
 
 unsigned int vdce_counter = 0;
 unsigned int edma_counter = 0;
@@ -62,7 +57,7 @@ module_param(inter_bufsize, uint, S_IRUGO);
 
 channel_config_t *vdce_current_chan = NULL;
 
-static int dma_ch;
+static struct edma_copy *vdce_copy;
 
 /* default values for various modes */
 #define COMMON_DEFAULT_PARAMS {VDCE_PROGRESSIVE, VDCE_FRAME_MODE, \
@@ -429,131 +424,40 @@ int free_buff(channel_config_t * vdce_conf_chan)
 	return 0;
 }
 
-/*
-edma call back function.
-*/
-static void callback1(unsigned lch, u16 ch_status, void *data)
-{
-	switch(ch_status) {
-		case DMA_COMPLETE:
-			irqraised1 = 1;
-			break;
-		case DMA_CC_ERROR:
-			printk("Cannot Complete\n");
-			break;
-		default:
-			break;
-	}
-	if (unlikely(ch_status != DMA_COMPLETE)) {
-		printk("Cannot Complete\n");
-	}
-	irqraised1 = 1;
-	complete(&(device_config.edma_sem));
-}
-
 /* edma3 memcpy functiom which copies the luma data
 */
 static int edma3_memcpy(int acnt, int bcnt, int ccnt,
 			vdce_address_start_t * vdce_start)
 {
-	int result = 0;
-	int i, p = 0;
-	unsigned int Istestpassed = 0u;
-	unsigned int numenabled = 0;
-	unsigned int BRCnt = 0;
-	int srcbidx = 0;
-	int desbidx = 0;
-	int srccidx = 0;
-	int descidx = 0;
-	unsigned int numtimes = 0;
-	unsigned int src_inc = 0, dst_inc = 0;
-	struct edmacc_param param_set;
-
-	/* Setting up the SRC/DES Index */
-	srcbidx = vdce_start->src_horz_pitch;
-	desbidx = vdce_start->res_horz_pitch;
-
-	if (ccnt == 2 && (((bcnt != vdce_start->buffers[1].
-			    size / (vdce_start->res_horz_pitch * 4))) ||
-			  ((bcnt != vdce_start->buffers[0].
-			    size / (vdce_start->src_horz_pitch * 4))))) {
-
-		numtimes = 1;
-		srccidx = acnt;
-		descidx = acnt;
-		BRCnt = bcnt;
-		src_inc = 0;
-		dst_inc = 0;
-		ccnt = 1;
-	} else {
-		/* A Sync Transfer Mode */
-		srccidx = acnt;
-		descidx = acnt;
-		BRCnt = bcnt;
-		src_inc = 0;
-		dst_inc = 0;
-		numtimes = 0;
-	}
-	if (ccnt == 2 && ((bcnt == vdce_start->buffers[1].
-			   size / (vdce_start->res_horz_pitch * 4)))) {
-		bcnt = bcnt * 2;
-	}
-	src_inc = 0;
-	dst_inc = 0;
-
-	for (p = 0; p <= numtimes; p++) {
-		/* Set the Source EDMA Params */
-		edma_set_src(dma_ch, (unsigned long)(vdce_start->
-				buffers[0].offset + src_inc), INCR, W8BIT);
-		/* Set the Destination EDMA Params */
-		edma_set_dest(dma_ch, (unsigned long) (vdce_start->
-				buffers[1].offset + dst_inc), INCR, W8BIT);
-		/* Set the Source Index */
-		edma_set_src_index(dma_ch, srcbidx, srccidx);
-		/* Set the Destination Index */
-		edma_set_dest_index(dma_ch, desbidx, descidx);
-		/* Set the Transfer Params */
-		edma_set_transfer_params(dma_ch, acnt, bcnt, ccnt, BRCnt,
-								ABSYNC);
-		edma_read_slot(dma_ch, &param_set);
-		param_set.opt |= (1 << ITCINTEN_SHIFT);
-		param_set.opt |= (1 << TCINTEN_SHIFT);
-		param_set.opt |= EDMA_TCC(EDMA_CHAN_SLOT(dma_ch));
-		edma_write_slot(dma_ch, &param_set);
-
-		numenabled = 1;
-
-		for (i = 0; i < numenabled; i++) {
-			irqraised1 = 0;
-
-			/*
-			 * Now enable the transfer as calculated above.
-			 */
-			device_config.edma_sem.done = 0;
-			result = edma_start(dma_ch);
-			if (result != 0) {
-				dev_err(vdce_device, "dma start failed \n");
-				break;
-			}
-			result = wait_for_completion_interruptible(&(device_config.edma_sem));
-			if(result) {
-				wait_for_completion(&(device_config.edma_sem));
-			}
-
-			/* Check the status of the completed transfer */
-			if (irqraised1 < 0) {
-				/* Some error occured, break from the FOR loop. */
-				edma_stop(dma_ch);
-				result = -EAGAIN;
-				break;
-			}
-		}
-		Istestpassed = 1;
-
-		src_inc = vdce_start->buffers[0].size / 4;
-		dst_inc = vdce_start->buffers[1].size / 4;
-	}
-	return result;
+	struct edma_copy_rect rects[2];
+	unsigned int nr_rects = 1;
+
+	rects[0].src = vdce_start->buffers[0].offset;
+	rects[0].dst = vdce_start->buffers[1].offset;
+	rects[0].width = acnt;
+	rects[0].height = bcnt;
+	/* one frame per start, as the hardware was triggered only once */
+	rects[0].planes = 1;
+	rects[0].src_pitch = vdce_start->src_horz_pitch;
+	rects[0].dst_pitch = vdce_start->res_horz_pitch;
+	rects[0].src_plane_pitch = acnt;
+	rects[0].dst_plane_pitch = acnt;
+
+	if (ccnt == 2 && ((bcnt != vdce_start->buffers[1].
+			    size / (vdce_start->res_horz_pitch * 4)) ||
+			  (bcnt != vdce_start->buffers[0].
+			    size / (vdce_start->src_horz_pitch * 4)))) {
+		/* fields stored in separate halves: one rectangle each */
+		rects[1] = rects[0];
+		rects[1].src += vdce_start->buffers[0].size / 4;
+		rects[1].dst += vdce_start->buffers[1].size / 4;
+		nr_rects = 2;
+	} else if (ccnt == 2) {
+		/* interleaved fields */
+		rects[0].height = bcnt * 2;
+	}
+
+	return edma_copy_rects(vdce_copy, rects, nr_rects);
 }
 
 /*
@@ -1167,11 +1071,6 @@ int vdce_start(vdce_address_start_t * vdce_start,
 			schedule();
 		}
 	}
-	if(irqraised1 == 0) {
-		while(irqraised1 == 0) {
-			schedule();
-		}
-	}
 
 	/* Wait for getting access to the hardware */
 	wait_for_completion(&(device_config.device_access));
@@ -2689,11 +2588,9 @@ static int __init vdce_init(void)
 	}
 
 	init_completion(&(device_config.sem_isr));
-	init_completion(&(device_config.edma_sem));
 	init_completion(&(device_config.device_access));
 
 	device_config.sem_isr.done = 0;
-	device_config.edma_sem.done = 0;
 	device_config.device_access.done = 1;
 
 	/* initialize the device mutex */
@@ -2739,13 +2636,14 @@ static int __init vdce_init(void)
 
 	}
 
-	/* Allocate Any EDMA Channel*/
-	dma_ch = edma_alloc_channel(EDMA_CHANNEL_ANY, callback1, NULL,
-						EVENTQ_DEFAULT);
-	if (0 > dma_ch) {
-		printk(KERN_ERR "Cannot Allocate Channel:%d\n", dma_ch);
+	/* Allocate the EDMA copy handle, two rectangles at most */
+	vdce_copy = edma_copy_alloc(2, EVENTQ_DEFAULT);
+	if (IS_ERR(vdce_copy)) {
+		result = PTR_ERR(vdce_copy);
+		printk(KERN_ERR "Cannot Allocate Channel:%d\n", result);
 		goto label6;
 	}
+	edma_copy_set_class(vdce_copy, EDMA_QOS_VIDEO);
 
 	return 0;
 
@@ -2790,7 +2688,7 @@ void __exit vdce_cleanup(void)
 
 	cdev_del(&c_dev);
 
-	edma_free_channel(dma_ch);
+	edma_copy_free(vdce_copy);
 
 	unregister_chrdev_region(dev, 1);
 
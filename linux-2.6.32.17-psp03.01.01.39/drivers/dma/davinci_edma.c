@@ -0,0 +1,959 @@
+/*
+ * dmaengine driver for the TI DaVinci EDMA3 channel controller
+ *
+ * Based on drivers/dma/dw_dmac.c
+ *   Copyright (C) 2007-2008 Atmel Corporation
+ * and built on the EDMA3 API of arch/arm/mach-davinci/dma.c
+ *   Copyright (C) 2006-2009 Texas Instruments.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * The EDMA3 hardware itself is owned by arch/arm/mach-davinci/dma.c;
+ * this driver only sits on top of its channel and PaRAM slot API so
+ * that generic clients (async_tx, NET_DMA, slave drivers) can share one
+ * implementation of PaRAM programming.
+ *
+ * Every dmaengine channel allocates one EDMA channel plus a fixed set of
+ * link slots and a pool of descriptors when a client claims it.  The
+ * prep routines only fill in PaRAM images held in those descriptors, so
+ * they never allocate memory or PaRAM in the submission path.  Cyclic
+ * transfers, which are set up once per stream, allocate their ring of
+ * link slots when they are prepared.
+ */
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/interrupt.h>
+#include <linux/platform_device.h>
+#include <linux/dmaengine.h>
+#include <linux/dma-mapping.h>
+#include <linux/scatterlist.h>
+#include <linux/slab.h>
+
+#include <asm/sizes.h>
+
+#include <mach/edma.h>
+#include <mach/edma-dmaengine.h>
+
+/* number of dmaengine channels exported */
+#define EDMA_DMAC_NR_CHANS	8
+/* descriptors pre-allocated per channel */
+#define EDMA_DMAC_NR_DESCS	16
+/* link slots per channel, bounds sg_len - 1 */
+#define EDMA_DMAC_NR_SLOTS	16
+/* most periods in a cyclic transfer, one link slot each */
+#define EDMA_DMAC_MAX_PERIODS	32
+/* largest ACNT used to split up memcpy transfers */
+#define EDMA_DMAC_MEMCPY_ACNT	SZ_32K
+
+struct edma_dma_desc {
+	struct dma_async_tx_descriptor	txd;
+	struct list_head		node;
+	dma_addr_t			src;
+	dma_addr_t			dst;
+	size_t				len;
+	unsigned int			nr_params;
+	struct edmacc_param		params[EDMA_DMAC_NR_SLOTS + 1];
+};
+
+struct edma_dma_chan {
+	struct dma_chan			chan;
+	spinlock_t			lock;
+	int				ch_num;
+	/* slots[0] is the channel's own set, the rest are link slots */
+	unsigned			slots[EDMA_DMAC_NR_SLOTS + 1];
+	dma_cookie_t			completed;
+
+	struct edma_dma_desc		*descs;
+	struct list_head		free_list;
+	struct list_head		queue;
+	struct list_head		active_list;
+	struct list_head		done_list;
+	struct tasklet_struct		tasklet;
+	/* last descriptor which ended in a transfer controller error */
+	dma_cookie_t			failed;
+
+	/* ring of a prepared cyclic transfer, cyclic_nr == 0 if none */
+	unsigned			cyclic_slots[EDMA_DMAC_MAX_PERIODS];
+	unsigned			cyclic_nr;
+	dma_addr_t			cyclic_buf;
+	enum dma_data_direction		cyclic_dir;
+	struct edma_cyclic_desc		cyclic;
+	bool				cyclic_running;
+};
+
+struct edma_dma {
+	struct dma_device		dma;
+	struct edma_dma_chan		chan[EDMA_DMAC_NR_CHANS];
+};
+
+static inline struct edma_dma_chan *to_edma_chan(struct dma_chan *chan)
+{
+	return container_of(chan, struct edma_dma_chan, chan);
+}
+
+static inline struct edma_dma_desc *
+txd_to_edma_desc(struct dma_async_tx_descriptor *txd)
+{
+	return container_of(txd, struct edma_dma_desc, txd);
+}
+
+static inline struct device *chan2dev(struct dma_chan *chan)
+{
+	return &chan->dev->device;
+}
+
+static inline struct device *chan2parent(struct dma_chan *chan)
+{
+	return chan->device->dev;
+}
+
+/*----------------------------------------------------------------------*/
+
+/* called with echan->lock held */
+static struct edma_dma_desc *edma_dma_desc_get(struct edma_dma_chan *echan)
+{
+	struct edma_dma_desc *desc;
+
+	list_for_each_entry(desc, &echan->free_list, node) {
+		if (async_tx_test_ack(&desc->txd)) {
+			list_del(&desc->node);
+			desc->txd.flags = 0;
+			desc->txd.callback = NULL;
+			desc->txd.callback_param = NULL;
+			desc->nr_params = 0;
+			return desc;
+		}
+	}
+
+	dev_dbg(chan2dev(&echan->chan), "descriptor pool exhausted\n");
+	return NULL;
+}
+
+/* called with echan->lock held */
+static void edma_dma_desc_put(struct edma_dma_chan *echan,
+		struct edma_dma_desc *desc)
+{
+	list_add_tail(&desc->node, &echan->free_list);
+}
+
+/*
+ * Load a descriptor into the channel's PaRAM set and its link slots and
+ * trigger it.  Called with echan->lock held and the channel idle.
+ */
+static void edma_dma_start(struct edma_dma_chan *echan,
+		struct edma_dma_desc *desc)
+{
+	edma_write_slot_chain(echan->slots, desc->params, desc->nr_params,
+			false);
+	edma_start(echan->ch_num);
+}
+
+static void edma_dma_descriptor_complete(struct edma_dma_chan *echan,
+		struct edma_dma_desc *desc)
+{
+	struct dma_async_tx_descriptor *txd = &desc->txd;
+	dma_async_tx_callback callback = txd->callback;
+	void *param = txd->callback_param;
+	unsigned long flags;
+
+	dev_vdbg(chan2dev(&echan->chan), "descriptor %u complete\n",
+			txd->cookie);
+
+	if (!echan->chan.private) {
+		struct device *parent = chan2parent(&echan->chan);
+
+		if (!(txd->flags & DMA_COMPL_SKIP_DEST_UNMAP)) {
+			if (txd->flags & DMA_COMPL_DEST_UNMAP_SINGLE)
+				dma_unmap_single(parent, desc->dst,
+						desc->len, DMA_FROM_DEVICE);
+			else
+				dma_unmap_page(parent, desc->dst,
+						desc->len, DMA_FROM_DEVICE);
+		}
+		if (!(txd->flags & DMA_COMPL_SKIP_SRC_UNMAP)) {
+			if (txd->flags & DMA_COMPL_SRC_UNMAP_SINGLE)
+				dma_unmap_single(parent, desc->src,
+						desc->len, DMA_TO_DEVICE);
+			else
+				dma_unmap_page(parent, desc->src,
+						desc->len, DMA_TO_DEVICE);
+		}
+	}
+
+	spin_lock_irqsave(&echan->lock, flags);
+	echan->completed = txd->cookie;
+	edma_dma_desc_put(echan, desc);
+	spin_unlock_irqrestore(&echan->lock, flags);
+
+	if (callback)
+		callback(param);
+	dma_run_dependencies(txd);
+}
+
+static void edma_dma_tasklet(unsigned long data)
+{
+	struct edma_dma_chan *echan = (struct edma_dma_chan *)data;
+	struct edma_dma_desc *desc, *_desc;
+	unsigned long flags;
+	LIST_HEAD(list);
+
+	spin_lock_irqsave(&echan->lock, flags);
+	list_splice_init(&echan->done_list, &list);
+	spin_unlock_irqrestore(&echan->lock, flags);
+
+	list_for_each_entry_safe(desc, _desc, &list, node) {
+		list_del(&desc->node);
+		edma_dma_descriptor_complete(echan, desc);
+	}
+}
+
+/* EDMA completion/error callback, runs in hard interrupt context */
+static void edma_dma_callback(unsigned ch_num, u16 ch_status, void *data)
+{
+	struct edma_dma_chan *echan = data;
+	struct edma_dma_desc *desc;
+	void (*period_callback)(void *param);
+	void *param;
+	bool error = ch_status != DMA_COMPLETE;
+
+	spin_lock(&echan->lock);
+
+	if (error) {
+		dev_err(chan2dev(&echan->chan),
+			"EDMA channel %u error, status %u\n",
+			EDMA_CHAN_SLOT(ch_num), ch_status);
+		edma_clean_channel(echan->ch_num);
+	}
+
+	if (echan->cyclic_running) {
+		/* an event was lost; the ring keeps going on the next one */
+		period_callback = error ? NULL : echan->cyclic.period_callback;
+		param = echan->cyclic.period_callback_param;
+		spin_unlock(&echan->lock);
+
+		if (period_callback)
+			period_callback(param);
+		return;
+	}
+
+	if (list_empty(&echan->active_list)) {
+		spin_unlock(&echan->lock);
+		return;
+	}
+
+	/* slave channels would otherwise keep latching events, and a
+	 * failed transfer must not run on */
+	if (echan->chan.private || error)
+		edma_stop(echan->ch_num);
+
+	desc = list_first_entry(&echan->active_list, struct edma_dma_desc,
+			node);
+	list_move_tail(&desc->node, &echan->done_list);
+	/* reported by is_tx_complete; the callback still runs */
+	if (error)
+		echan->failed = desc->txd.cookie;
+
+	if (!list_empty(&echan->active_list))
+		edma_dma_start(echan, list_first_entry(&echan->active_list,
+					struct edma_dma_desc, node));
+
+	spin_unlock(&echan->lock);
+
+	tasklet_schedule(&echan->tasklet);
+}
+
+/*----------------------------------------------------------------------*/
+
+static dma_cookie_t edma_dma_tx_submit(struct dma_async_tx_descriptor *tx)
+{
+	struct edma_dma_desc *desc = txd_to_edma_desc(tx);
+	struct edma_dma_chan *echan = to_edma_chan(tx->chan);
+	dma_cookie_t cookie;
+	unsigned long flags;
+
+	spin_lock_irqsave(&echan->lock, flags);
+
+	cookie = echan->chan.cookie + 1;
+	if (cookie < 0)
+		cookie = 1;
+	echan->chan.cookie = cookie;
+	tx->cookie = cookie;
+
+	list_add_tail(&desc->node, &echan->queue);
+
+	spin_unlock_irqrestore(&echan->lock, flags);
+
+	return cookie;
+}
+
+static void edma_dma_issue_pending(struct dma_chan *chan)
+{
+	struct edma_dma_chan *echan = to_edma_chan(chan);
+	unsigned long flags;
+	bool idle;
+
+	spin_lock_irqsave(&echan->lock, flags);
+
+	idle = list_empty(&echan->active_list);
+	list_splice_tail_init(&echan->queue, &echan->active_list);
+	if (idle && !list_empty(&echan->active_list))
+		edma_dma_start(echan, list_first_entry(&echan->active_list,
+					struct edma_dma_desc, node));
+
+	spin_unlock_irqrestore(&echan->lock, flags);
+}
+
+static struct dma_async_tx_descriptor *
+edma_dma_prep_memcpy(struct dma_chan *chan, dma_addr_t dest, dma_addr_t src,
+		size_t len, unsigned long flags)
+{
+	struct edma_dma_chan *echan = to_edma_chan(chan);
+	struct edma_dma_desc *desc;
+	struct edmacc_param *p;
+	unsigned long iflags;
+	size_t acnt, bcnt, done = 0;
+
+	if (unlikely(!len)) {
+		dev_dbg(chan2dev(chan), "prep_dma_memcpy: length is zero!\n");
+		return NULL;
+	}
+
+	spin_lock_irqsave(&echan->lock, iflags);
+	desc = edma_dma_desc_get(echan);
+	spin_unlock_irqrestore(&echan->lock, iflags);
+	if (!desc)
+		return NULL;
+
+	/*
+	 * A memcpy is one AB-synchronized frame of EDMA_DMAC_MEMCPY_ACNT
+	 * sized arrays, plus a second frame for any remainder.  The first
+	 * set chains to its own channel so the reloaded remainder starts
+	 * without another software trigger.
+	 */
+	while (done < len) {
+		acnt = min_t(size_t, len - done, EDMA_DMAC_MEMCPY_ACNT);
+		bcnt = (len - done) / acnt;
+		if (bcnt > 0xffff)
+			bcnt = 0xffff;
+
+		p = &desc->params[desc->nr_params++];
+		p->opt = EDMA_TCC(EDMA_CHAN_SLOT(echan->ch_num)) | SYNCDIM;
+		p->src = src + done;
+		p->dst = dest + done;
+		p->a_b_cnt = bcnt << 16 | acnt;
+		p->src_dst_bidx = acnt << 16 | acnt;
+		p->link_bcntrld = 0xffff;
+		p->src_dst_cidx = 0;
+		p->ccnt = 1;
+
+		done += acnt * bcnt;
+		if (done < len) {
+			if (desc->nr_params > EDMA_DMAC_NR_SLOTS) {
+				spin_lock_irqsave(&echan->lock, iflags);
+				edma_dma_desc_put(echan, desc);
+				spin_unlock_irqrestore(&echan->lock, iflags);
+				return NULL;
+			}
+			p->opt |= TCCHEN;
+		}
+	}
+	p->opt |= TCINTEN;
+
+	desc->txd.flags = flags;
+	desc->src = src;
+	desc->dst = dest;
+	desc->len = len;
+
+	return &desc->txd;
+}
+
+/*
+ * Fill one PaRAM image for a slave transfer.  Bursts of maxburst
+ * elements are moved per event where the length allows it, otherwise
+ * one element per event.
+ */
+static int edma_dma_fill_slave(struct edma_dma_chan *echan,
+		struct edma_dma_slave *slave, struct edmacc_param *p,
+		dma_addr_t mem, size_t len, enum dma_data_direction direction)
+{
+	unsigned width = slave->reg_width;
+	unsigned stride = slave->mem_stride ? slave->mem_stride : width;
+	unsigned burst = slave->maxburst ? slave->maxburst : 1;
+	unsigned mem_bidx, mem_cidx;
+	unsigned bcnt, ccnt;
+
+	if (!width || len % stride)
+		return -EINVAL;
+
+	p->opt = EDMA_TCC(EDMA_CHAN_SLOT(echan->ch_num));
+	if (burst > 1 && !(len % (stride * burst))) {
+		p->opt |= SYNCDIM;
+		bcnt = burst;
+		ccnt = len / (stride * burst);
+		mem_cidx = stride * burst;
+	} else {
+		bcnt = len / stride;
+		ccnt = 1;
+		mem_cidx = 0;
+	}
+	if (bcnt > 0xffff || ccnt > 0xffff)
+		return -EINVAL;
+	mem_bidx = stride;
+
+	if (direction == DMA_TO_DEVICE) {
+		p->src = mem;
+		p->dst = slave->tx_reg;
+		p->src_dst_bidx = mem_bidx;
+		p->src_dst_cidx = mem_cidx;
+	} else {
+		p->src = slave->rx_reg;
+		p->dst = mem;
+		p->src_dst_bidx = mem_bidx << 16;
+		p->src_dst_cidx = mem_cidx << 16;
+	}
+	p->a_b_cnt = bcnt << 16 | width;
+	p->link_bcntrld = 0xffff;
+	p->ccnt = ccnt;
+
+	return 0;
+}
+
+static struct dma_async_tx_descriptor *
+edma_dma_prep_slave_sg(struct dma_chan *chan, struct scatterlist *sgl,
+		unsigned int sg_len, enum dma_data_direction direction,
+		unsigned long flags)
+{
+	struct edma_dma_chan *echan = to_edma_chan(chan);
+	struct edma_dma_slave *slave = chan->private;
+	struct edma_dma_desc *desc;
+	struct scatterlist *sg;
+	unsigned long iflags;
+	size_t total_len = 0;
+	unsigned int i;
+
+	if (unlikely(!slave || !sg_len))
+		return NULL;
+	if (sg_len > EDMA_DMAC_NR_SLOTS + 1) {
+		dev_dbg(chan2dev(chan), "prep_slave_sg: %u entries, max %u\n",
+				sg_len, EDMA_DMAC_NR_SLOTS + 1);
+		return NULL;
+	}
+
+	spin_lock_irqsave(&echan->lock, iflags);
+	desc = edma_dma_desc_get(echan);
+	spin_unlock_irqrestore(&echan->lock, iflags);
+	if (!desc)
+		return NULL;
+
+	for_each_sg(sgl, sg, sg_len, i) {
+		if (edma_dma_fill_slave(echan, slave, &desc->params[i],
+					sg_dma_address(sg), sg_dma_len(sg),
+					direction)) {
+			dev_dbg(chan2dev(chan),
+				"prep_slave_sg: bad geometry in entry %u\n", i);
+			spin_lock_irqsave(&echan->lock, iflags);
+			edma_dma_desc_put(echan, desc);
+			spin_unlock_irqrestore(&echan->lock, iflags);
+			return NULL;
+		}
+		total_len += sg_dma_len(sg);
+	}
+	desc->params[sg_len - 1].opt |= TCINTEN;
+	desc->nr_params = sg_len;
+
+	desc->txd.flags = flags;
+	desc->len = total_len;
+
+	return &desc->txd;
+}
+
+static void edma_dma_terminate_all(struct dma_chan *chan)
+{
+	struct edma_dma_chan *echan = to_edma_chan(chan);
+	struct edma_dma_desc *desc, *_desc;
+	unsigned long flags;
+	LIST_HEAD(list);
+
+	spin_lock_irqsave(&echan->lock, flags);
+
+	edma_stop(echan->ch_num);
+	edma_clean_channel(echan->ch_num);
+	echan->cyclic_running = false;
+
+	list_splice_init(&echan->done_list, &list);
+	list_splice_tail_init(&echan->active_list, &list);
+	list_splice_tail_init(&echan->queue, &list);
+
+	spin_unlock_irqrestore(&echan->lock, flags);
+
+	/* Flush all pending and queued descriptors */
+	list_for_each_entry_safe(desc, _desc, &list, node) {
+		list_del(&desc->node);
+		edma_dma_descriptor_complete(echan, desc);
+	}
+}
+
+static enum dma_status
+edma_dma_is_tx_complete(struct dma_chan *chan, dma_cookie_t cookie,
+		dma_cookie_t *done, dma_cookie_t *used)
+{
+	struct edma_dma_chan *echan = to_edma_chan(chan);
+	dma_cookie_t last_used;
+	dma_cookie_t last_complete;
+
+	last_complete = echan->completed;
+	last_used = chan->cookie;
+
+	if (done)
+		*done = last_complete;
+	if (used)
+		*used = last_used;
+
+	if (cookie == echan->failed)
+		return DMA_ERROR;
+
+	return dma_async_is_complete(cookie, last_complete, last_used);
+}
+
+static int edma_dma_alloc_chan_resources(struct dma_chan *chan)
+{
+	struct edma_dma_chan *echan = to_edma_chan(chan);
+	struct edma_dma_slave *slave = chan->private;
+	enum dma_event_q eventq = EVENTQ_DEFAULT;
+	int ch = EDMA_CHANNEL_ANY;
+	unsigned long flags;
+	int i, ret;
+
+	/* ASSERT:  channel is idle */
+	if (echan->ch_num >= 0) {
+		dev_dbg(chan2dev(chan), "DMA channel not idle?\n");
+		return -EIO;
+	}
+
+	if (slave) {
+		if (slave->dma_dev != chan->device->dev)
+			return -EINVAL;
+		ch = slave->dma_ch;
+		eventq = slave->eventq;
+	}
+
+	ret = edma_alloc_channel(ch, edma_dma_callback, echan, eventq);
+	if (ret < 0) {
+		dev_dbg(chan2dev(chan), "failed to allocate EDMA channel\n");
+		return ret;
+	}
+	echan->ch_num = ret;
+	echan->slots[0] = ret;
+	if (!slave)
+		edma_set_channel_class(echan->ch_num, EDMA_QOS_BULK);
+
+	ret = edma_alloc_slot_chain(EDMA_CTLR(echan->ch_num), &echan->slots[1],
+			EDMA_DMAC_NR_SLOTS, false);
+	if (ret < 0)
+		goto err_chan;
+
+	echan->descs = kcalloc(EDMA_DMAC_NR_DESCS, sizeof(*echan->descs),
+			GFP_KERNEL);
+	if (!echan->descs) {
+		ret = -ENOMEM;
+		goto err_slots;
+	}
+
+	spin_lock_irqsave(&echan->lock, flags);
+	for (i = 0; i < EDMA_DMAC_NR_DESCS; i++) {
+		struct edma_dma_desc *desc = &echan->descs[i];
+
+		dma_async_tx_descriptor_init(&desc->txd, chan);
+		desc->txd.tx_submit = edma_dma_tx_submit;
+		desc->txd.flags = DMA_CTRL_ACK;
+		list_add_tail(&desc->node, &echan->free_list);
+	}
+	echan->completed = chan->cookie = 1;
+	echan->failed = 0;
+	spin_unlock_irqrestore(&echan->lock, flags);
+
+	dev_dbg(chan2dev(chan), "EDMA channel %d, %d descriptors\n",
+			EDMA_CHAN_SLOT(echan->ch_num), EDMA_DMAC_NR_DESCS);
+
+	return EDMA_DMAC_NR_DESCS;
+
+err_slots:
+	edma_free_slot_chain(&echan->slots[1], EDMA_DMAC_NR_SLOTS);
+err_chan:
+	edma_free_channel(echan->ch_num);
+	echan->ch_num = -1;
+	return ret;
+}
+
+static void edma_dma_free_chan_resources(struct dma_chan *chan)
+{
+	struct edma_dma_chan *echan = to_edma_chan(chan);
+
+	/* ASSERT:  channel is idle */
+	BUG_ON(!list_empty(&echan->active_list));
+	BUG_ON(!list_empty(&echan->queue));
+	BUG_ON(echan->cyclic_running);
+
+	edma_dma_cyclic_free(chan);
+	edma_stop(echan->ch_num);
+	tasklet_kill(&echan->tasklet);
+
+	edma_free_slot_chain(&echan->slots[1], EDMA_DMAC_NR_SLOTS);
+	edma_free_channel(echan->ch_num);
+	echan->ch_num = -1;
+
+	INIT_LIST_HEAD(&echan->free_list);
+	INIT_LIST_HEAD(&echan->done_list);
+	kfree(echan->descs);
+	echan->descs = NULL;
+}
+
+/* --------------------- Cyclic DMA API extensions -------------------- */
+
+/**
+ * edma_dma_filter - dma_request_channel() filter for EDMA slave channels
+ * @chan: candidate channel
+ * @param: the client's struct edma_dma_slave
+ *
+ * Accepts channels of this driver and hands them @param as their slave
+ * description, filling in its @dma_dev.
+ */
+bool edma_dma_filter(struct dma_chan *chan, void *param)
+{
+	struct edma_dma_slave *slave = param;
+
+	if (chan->device->device_alloc_chan_resources !=
+			edma_dma_alloc_chan_resources)
+		return false;
+
+	slave->dma_dev = chan->device->dev;
+	chan->private = slave;
+	return true;
+}
+EXPORT_SYMBOL(edma_dma_filter);
+
+/**
+ * edma_dma_cyclic_prep - prepare the cyclic DMA transfer
+ * @chan: the DMA channel to prepare
+ * @buf_addr: physical DMA address where the buffer starts
+ * @buf_len: total number of bytes for the entire buffer
+ * @period_len: number of bytes for each period
+ * @direction: transfer direction, to or from device
+ *
+ * The buffer is split into one PaRAM set per period, linked into a ring
+ * that the hardware runs on its own.  Every period raises a completion
+ * interrupt which is reported through the period_callback of the
+ * returned descriptor, in interrupt context.  Periods whose transfer
+ * fails are logged and not reported.
+ *
+ * May sleep.  Must be called before trying to start the transfer.
+ * Returns a valid struct edma_cyclic_desc if successful or an
+ * ERR_PTR(-errno) if not.
+ */
+struct edma_cyclic_desc *edma_dma_cyclic_prep(struct dma_chan *chan,
+		dma_addr_t buf_addr, size_t buf_len, size_t period_len,
+		enum dma_data_direction direction)
+{
+	struct edma_dma_chan *echan = to_edma_chan(chan);
+	struct edma_dma_slave *slave = chan->private;
+	struct edmacc_param p;
+	unsigned long periods;
+	unsigned long flags;
+	unsigned long i;
+	int ret;
+
+	if (!slave || !period_len || buf_len % period_len)
+		return ERR_PTR(-EINVAL);
+
+	periods = buf_len / period_len;
+	if (periods < 1 || periods > EDMA_DMAC_MAX_PERIODS)
+		return ERR_PTR(-EINVAL);
+
+	spin_lock_irqsave(&echan->lock, flags);
+	if (echan->cyclic_nr || !list_empty(&echan->queue)
+			|| !list_empty(&echan->active_list)) {
+		spin_unlock_irqrestore(&echan->lock, flags);
+		return ERR_PTR(-EBUSY);
+	}
+	spin_unlock_irqrestore(&echan->lock, flags);
+
+	ret = edma_alloc_slot_chain(EDMA_CTLR(echan->ch_num),
+			echan->cyclic_slots, periods, true);
+	if (ret < 0)
+		return ERR_PTR(ret);
+
+	/*
+	 * The channel's own set runs the first period and links into the
+	 * ring at the second one; the ring then wraps around for ever.
+	 */
+	for (i = 0; i < periods; i++) {
+		ret = edma_dma_fill_slave(echan, slave, &p,
+				buf_addr + i * period_len, period_len,
+				direction);
+		if (ret) {
+			edma_free_slot_chain(echan->cyclic_slots, periods);
+			return ERR_PTR(ret);
+		}
+		p.opt |= TCINTEN;
+		edma_write_slot(echan->cyclic_slots[i], &p);
+		edma_link(echan->cyclic_slots[i],
+				echan->cyclic_slots[(i + 1) % periods]);
+		if (i == 0) {
+			edma_write_slot(echan->ch_num, &p);
+			edma_link(echan->ch_num,
+					echan->cyclic_slots[1 % periods]);
+		}
+	}
+
+	spin_lock_irqsave(&echan->lock, flags);
+	echan->cyclic_nr = periods;
+	echan->cyclic_buf = buf_addr;
+	echan->cyclic_dir = direction;
+	echan->cyclic.periods = periods;
+	echan->cyclic.period_callback = NULL;
+	echan->cyclic.period_callback_param = NULL;
+	spin_unlock_irqrestore(&echan->lock, flags);
+
+	dev_dbg(chan2dev(chan), "cyclic prepared buf 0x%08x len %zu "
+			"period %zu periods %lu\n", buf_addr, buf_len,
+			period_len, periods);
+
+	return &echan->cyclic;
+}
+EXPORT_SYMBOL(edma_dma_cyclic_prep);
+
+/**
+ * edma_dma_cyclic_start - start or resume the cyclic DMA transfer
+ * @chan: the DMA channel to start
+ *
+ * After edma_dma_cyclic_stop() the transfer resumes where it stopped;
+ * prepare it again to restart from the beginning of the buffer.  Can be
+ * called from atomic context.  Returns zero on success or -errno on
+ * failure.
+ */
+int edma_dma_cyclic_start(struct dma_chan *chan)
+{
+	struct edma_dma_chan *echan = to_edma_chan(chan);
+	unsigned long flags;
+	int ret;
+
+	spin_lock_irqsave(&echan->lock, flags);
+
+	if (!echan->cyclic_nr) {
+		spin_unlock_irqrestore(&echan->lock, flags);
+		dev_err(chan2dev(chan), "missing prep for cyclic DMA\n");
+		return -ENODEV;
+	}
+
+	echan->cyclic_running = true;
+	ret = edma_start(echan->ch_num);
+	if (ret)
+		echan->cyclic_running = false;
+
+	spin_unlock_irqrestore(&echan->lock, flags);
+
+	return ret;
+}
+EXPORT_SYMBOL(edma_dma_cyclic_start);
+
+/**
+ * edma_dma_cyclic_stop - stop the cyclic DMA transfer
+ * @chan: the DMA channel to stop
+ *
+ * Can be called from atomic context.
+ */
+void edma_dma_cyclic_stop(struct dma_chan *chan)
+{
+	struct edma_dma_chan *echan = to_edma_chan(chan);
+	unsigned long flags;
+
+	spin_lock_irqsave(&echan->lock, flags);
+
+	edma_stop(echan->ch_num);
+	echan->cyclic_running = false;
+
+	spin_unlock_irqrestore(&echan->lock, flags);
+}
+EXPORT_SYMBOL(edma_dma_cyclic_stop);
+
+/**
+ * edma_dma_cyclic_position - where the cyclic DMA transfer is
+ * @chan: the DMA channel to examine
+ *
+ * Returns the offset into the buffer, in bytes, of the next memory
+ * access.  It is read live from the parameter RAM, so it is accurate to
+ * the element.
+ */
+size_t edma_dma_cyclic_position(struct dma_chan *chan)
+{
+	struct edma_dma_chan *echan = to_edma_chan(chan);
+	dma_addr_t src, dst;
+
+	edma_get_position(echan->ch_num, &src, &dst);
+	if (echan->cyclic_dir == DMA_TO_DEVICE)
+		return src - echan->cyclic_buf;
+	return dst - echan->cyclic_buf;
+}
+EXPORT_SYMBOL(edma_dma_cyclic_position);
+
+/**
+ * edma_dma_cyclic_free - free a prepared cyclic DMA transfer
+ * @chan: the DMA channel to free
+ *
+ * Stops the transfer if it still runs.  May sleep.
+ */
+void edma_dma_cyclic_free(struct dma_chan *chan)
+{
+	struct edma_dma_chan *echan = to_edma_chan(chan);
+	unsigned long flags;
+	unsigned nr;
+
+	spin_lock_irqsave(&echan->lock, flags);
+
+	nr = echan->cyclic_nr;
+	if (nr) {
+		edma_stop(echan->ch_num);
+		edma_clean_channel(echan->ch_num);
+		echan->cyclic_running = false;
+		echan->cyclic_nr = 0;
+	}
+
+	spin_unlock_irqrestore(&echan->lock, flags);
+
+	if (nr)
+		edma_free_slot_chain(echan->cyclic_slots, nr);
+}
+EXPORT_SYMBOL(edma_dma_cyclic_free);
+
+/*----------------------------------------------------------------------*/
+
+static int __init edma_dma_probe(struct platform_device *pdev)
+{
+	struct edma_dma *edma;
+	int ret;
+	int i;
+
+	edma = kzalloc(sizeof(*edma), GFP_KERNEL);
+	if (!edma)
+		return -ENOMEM;
+
+	pdev->dev.coherent_dma_mask = DMA_BIT_MASK(32);
+	pdev->dev.dma_mask = &pdev->dev.coherent_dma_mask;
+
+	platform_set_drvdata(pdev, edma);
+
+	INIT_LIST_HEAD(&edma->dma.channels);
+	for (i = 0; i < EDMA_DMAC_NR_CHANS; i++, edma->dma.chancnt++) {
+		struct edma_dma_chan *echan = &edma->chan[i];
+
+		echan->chan.device = &edma->dma;
+		echan->chan.cookie = echan->completed = 1;
+		echan->chan.chan_id = i;
+		list_add_tail(&echan->chan.device_node, &edma->dma.channels);
+
+		spin_lock_init(&echan->lock);
+		echan->ch_num = -1;
+
+		INIT_LIST_HEAD(&echan->free_list);
+		INIT_LIST_HEAD(&echan->queue);
+		INIT_LIST_HEAD(&echan->active_list);
+		INIT_LIST_HEAD(&echan->done_list);
+
+		tasklet_init(&echan->tasklet, edma_dma_tasklet,
+				(unsigned long)echan);
+	}
+
+	dma_cap_set(DMA_MEMCPY, edma->dma.cap_mask);
+	dma_cap_set(DMA_SLAVE, edma->dma.cap_mask);
+	edma->dma.dev = &pdev->dev;
+	edma->dma.device_alloc_chan_resources = edma_dma_alloc_chan_resources;
+	edma->dma.device_free_chan_resources = edma_dma_free_chan_resources;
+
+	edma->dma.device_prep_dma_memcpy = edma_dma_prep_memcpy;
+
+	edma->dma.device_prep_slave_sg = edma_dma_prep_slave_sg;
+	edma->dma.device_terminate_all = edma_dma_terminate_all;
+
+	edma->dma.device_is_tx_complete = edma_dma_is_tx_complete;
+	edma->dma.device_issue_pending = edma_dma_issue_pending;
+
+	printk(KERN_INFO "%s: DaVinci EDMA3 dmaengine, %d channels\n",
+			dev_name(&pdev->dev), edma->dma.chancnt);
+
+	ret = dma_async_device_register(&edma->dma);
+	if (ret)
+		goto err_register;
+
+	return 0;
+
+err_register:
+	for (i = 0; i < EDMA_DMAC_NR_CHANS; i++) {
+		list_del(&edma->chan[i].chan.device_node);
+		tasklet_kill(&edma->chan[i].tasklet);
+	}
+	platform_set_drvdata(pdev, NULL);
+	kfree(edma);
+	return ret;
+}
+
+static int __exit edma_dma_remove(struct platform_device *pdev)
+{
+	struct edma_dma *edma = platform_get_drvdata(pdev);
+	int i;
+
+	dma_async_device_unregister(&edma->dma);
+
+	for (i = 0; i < EDMA_DMAC_NR_CHANS; i++) {
+		list_del(&edma->chan[i].chan.device_node);
+		tasklet_kill(&edma->chan[i].tasklet);
+	}
+
+	kfree(edma);
+
+	return 0;
+}
+
+static struct platform_driver edma_dma_driver = {
+	.remove		= __exit_p(edma_dma_remove),
+	.driver = {
+		.name	= "edma-dma-engine",
+		.owner	= THIS_MODULE,
+	},
+};
+
+static struct platform_device *edma_dma_pdev;
+
+static int __init edma_dma_init(void)
+{
+	int ret;
+
+	/*
+	 * The controller resources already belong to the EDMA core in
+	 * arch/arm/mach-davinci/dma.c, so this device carries none.
+	 */
+	edma_dma_pdev = platform_device_register_simple("edma-dma-engine",
+			-1, NULL, 0);
+	if (IS_ERR(edma_dma_pdev))
+		return PTR_ERR(edma_dma_pdev);
+
+	ret = platform_driver_probe(&edma_dma_driver, edma_dma_probe);
+	if (ret)
+		platform_device_unregister(edma_dma_pdev);
+
+	return ret;
+}
+subsys_initcall(edma_dma_init);
+
+static void __exit edma_dma_exit(void)
+{
+	platform_driver_unregister(&edma_dma_driver);
+	platform_device_unregister(edma_dma_pdev);
+}
+module_exit(edma_dma_exit);
+
+MODULE_LICENSE("GPL v2");
+MODULE_DESCRIPTION("TI DaVinci EDMA3 dmaengine driver");
+MODULE_ALIAS("platform:edma-dma-engine");
@@ -114,7 +114,7 @@ struct davinci_i2c_dev {
 	u8			terminate;
 	struct i2c_adapter	adapter;
 #ifdef CONFIG_CPU_FREQ
-	struct completion	xfr_complete;
+	u32			input_clock;	/* dividers computed for */
 	struct notifier_block	freq_transition;
 #endif
 };
@@ -241,6 +241,9 @@ static void i2c_davinci_calc_clk_dividers(struct davinci_i2c_dev *dev)
 	davinci_i2c_write_reg(dev, DAVINCI_I2C_PSC_REG, psc);
 	davinci_i2c_write_reg(dev, DAVINCI_I2C_CLKH_REG, clkh);
 	davinci_i2c_write_reg(dev, DAVINCI_I2C_CLKL_REG, clkl);
+#ifdef CONFIG_CPU_FREQ
+	dev->input_clock = input_clock;
+#endif
 
 	dev_dbg(dev->dev, "input_clock = %d, CLK = %d\n", input_clock, clk);
 }
@@ -469,10 +472,6 @@ i2c_davinci_xfer(struct i2c_adapter *adap, struct i2c_msg msgs[], int num)
 			return ret;
 	}
 
-#ifdef CONFIG_CPU_FREQ
-	complete(&dev->xfr_complete);
-#endif
-
 	return num;
 }
 
@@ -612,12 +611,21 @@ static int i2c_davinci_cpufreq_transition(struct notifier_block *nb,
 	struct davinci_i2c_dev *dev;
 
 	dev = container_of(nb, struct davinci_i2c_dev, freq_transition);
-	if (val == CPUFREQ_PRECHANGE) {
-		wait_for_completion(&dev->xfr_complete);
+	if (val != CPUFREQ_POSTCHANGE)
+		return 0;
+
+	/*
+	 * Most operating points only change the ARM clock.  If the module
+	 * clock did change, reprogram the dividers between two transfers.
+	 * The bus can't be locked across the whole transition:  the core
+	 * voltage may be set over this very bus in the middle of it.
+	 */
+	if (clk_get_rate(dev->clk) != dev->input_clock) {
+		i2c_lock_adapter(&dev->adapter);
 		davinci_i2c_reset_ctrl(dev, 0);
-	} else if (val == CPUFREQ_POSTCHANGE) {
 		i2c_davinci_calc_clk_dividers(dev);
 		davinci_i2c_reset_ctrl(dev, 1);
+		i2c_unlock_adapter(&dev->adapter);
 	}
 
 	return 0;
@@ -686,9 +694,6 @@ static int davinci_i2c_probe(struct platform_device *pdev)
 	}
 
 	init_completion(&dev->cmd_complete);
-#ifdef CONFIG_CPU_FREQ
-	init_completion(&dev->xfr_complete);
-#endif
 	dev->dev = get_device(&pdev->dev);
 	dev->irq = irq->start;
 	platform_set_drvdata(pdev, dev);
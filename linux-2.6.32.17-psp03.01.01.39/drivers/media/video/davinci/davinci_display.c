@@ -142,9 +142,18 @@ static int davinci_buffer_prepare(struct videobuf_queue *q,
 
 		addr = videobuf_to_dma_contig(vb);
 
-		if (q->streaming) {
+		/*
+		 * A USERPTR buffer is scanned out in place, e.g. straight
+		 * from a vpfe capture buffer mapped into the application.
+		 * videobuf_iolock() has checked that it is physically
+		 * contiguous, so only its alignment is left to check here.
+		 * The mapping is kept until the application queues a
+		 * different address in this slot.
+		 */
+		if (q->streaming || V4L2_MEMORY_USERPTR == vb->memory) {
 			if (!ISALIGNED(addr)) {
 				dev_err(davinci_display_dev, "buffer_prepare:offset is not aligned to 32 bytes\n");
+				videobuf_dma_contig_free(q, vb);
 				goto buf_align_exit;
 			}
 		}
@@ -181,6 +190,17 @@ static int davinci_buffer_setup(struct videobuf_queue *q, unsigned int *count,
 		if (*size > buf_size)
 			*size = buf_size;
 
+	/*
+	 * USERPTR buffers are imported, not allocated here, so neither the
+	 * memory limit nor the MMAP buffer count applies to them.
+	 */
+	if (V4L2_MEMORY_USERPTR == layer->memory) {
+		if (*count < display_buf_config_params.min_numbuffers)
+			*count = display_buf_config_params.min_numbuffers;
+		layer->numbuffers = *count;
+		return 0;
+	}
+
 	/* Checking if the buffer size exceeds the available buffer */
 	if (display_buf_config_params.video_limit[layer->device_id]) {
 		while (*size * *count > (display_buf_config_params.video_limit[layer->device_id]))
@@ -229,8 +249,8 @@ static void davinci_buffer_release(struct videobuf_queue *q,
 	unsigned int buf_size = 0;
 	dev_dbg(davinci_display_dev, "<davinci_buffer_release>\n");
 
-	if (V4L2_MEMORY_USERPTR != layer->memory)
-		videobuf_dma_contig_free(q, vb);
+	/* drops the reference to an imported USERPTR buffer */
+	videobuf_dma_contig_free(q, vb);
 
 	vb->state = VIDEOBUF_NEEDS_INIT;
 
@@ -294,7 +314,6 @@ static struct videobuf_queue_ops video_qops = {
 	.buf_release = davinci_buffer_release,
 };
 
-static u8 layer_first_int = 1;
 
 /* davinci_display_isr()
  * ISR function. It changes status of the displayed buffer, takes next buffer
@@ -312,6 +331,11 @@ static void davinci_display_isr(unsigned int event, void *dispObj)
 	/* Convert time represention from jiffies to timeval */
 	jiffies_to_timeval(jiffies_time, &timevalue);
 
+	if (event & DAVINCI_DISP_END_OF_FRAME) {
+		dispDevice->vsync_cnt++;
+		wake_up_interruptible(&dispDevice->vsync_wait);
+	}
+
 	for (i = 0; i < DAVINCI_DISPLAY_MAX_DEVICES; i++) {
 		layer = dispDevice->dev[i];
 		/* If streaming is started in this layer */
@@ -333,8 +357,8 @@ static void davinci_display_isr(unsigned int event, void *dispObj)
 		    (!list_empty(&layer->dma_queue)) &&
 		    (event & DAVINCI_DISP_END_OF_FRAME)) {
 			/* Progressive mode */
-			if (layer_first_int) {
-				layer_first_int = 0;
+			if (layer->first_int) {
+				layer->first_int = 0;
 				continue;
 			} else {
 				/* Mark status of the curFrm to
@@ -363,11 +387,13 @@ static void davinci_display_isr(unsigned int event, void *dispObj)
 						 &davinci_dm.fb_desc);
 		} else {
 			/* Interlaced mode
-			 * If it is first interrupt, ignore it
+			 * If it is first interrupt, ignore it.  The other
+			 * layer may still have a flip to latch, so move on
+			 * to it instead of returning.
 			 */
-			if (layer_first_int) {
-				layer_first_int = 0;
-				return;
+			if (layer->first_int) {
+				layer->first_int = 0;
+				continue;
 			}
 
 			layer->field_id ^= 1;
@@ -376,7 +402,7 @@ static void davinci_display_isr(unsigned int event, void *dispObj)
 			else if (event & DAVINCI_DISP_SECOND_FIELD)
 				fid = 1;
 			else
-				return;
+				continue;
 
 			/* If field id does not match with stored
 			 * field id
@@ -386,7 +412,7 @@ static void davinci_display_isr(unsigned int event, void *dispObj)
 				if (0 == fid) {
 					layer->field_id = fid;
 				}
-				return;
+				continue;
 			}
 			/* device field id and local field id are
 			 * in sync. If this is even field
@@ -1193,6 +1219,19 @@ static int vpbe_cropcap(struct file *file, void *priv,
 	return ret;
 }
 
+/*
+ * davinci_wait_for_vsync()
+ * Wait until the end of the frame currently being scanned out, so that
+ * buffers released afterwards are no longer read by the display.
+ */
+static void davinci_wait_for_vsync(void)
+{
+	u32 cnt = davinci_dm.vsync_cnt;
+
+	wait_event_interruptible_timeout(davinci_dm.vsync_wait,
+					 cnt != davinci_dm.vsync_cnt, HZ / 10);
+}
+
 static int vpbe_streamoff(struct file *file, void *priv,
 			  enum v4l2_buf_type buf_type)
 {
@@ -1221,6 +1260,12 @@ static int vpbe_streamoff(struct file *file, void *priv,
 	davinci_disp_disable_layer(layer->layer_info.id);
 	layer->started = 0;
 	mutex_unlock(&davinci_dm.lock);
+	/*
+	 * The window may still be fetching the last frame until the next
+	 * vsync; don't hand its buffer back (possibly to the capture driver
+	 * it was imported from) before then.
+	 */
+	davinci_wait_for_vsync();
 	ret = videobuf_streamoff(&layer->buffer_queue);
 
 	return ret;
@@ -1286,11 +1331,11 @@ static int vpbe_streamon(struct file *file, void *priv,
 	 * enable both video windows
 	 */
 
+	layer->first_int = 1;
 	layer->started = 1;
 	dev_dbg(davinci_display_dev, "Started streaming on layer id = %d,"
 		" ret = %d\n", layer->device_id, ret);
-			
-	layer_first_int = 1;
+
 	mutex_unlock(&davinci_dm.lock);
 
 	return ret;
@@ -2189,6 +2234,7 @@ static __init int davinci_display_init(void)
 
 	davinci_dm.event_callback.arg = &davinci_dm;
 	davinci_dm.event_callback.handler = davinci_display_isr;
+	init_waitqueue_head(&davinci_dm.vsync_wait);
 
 	err = davinci_disp_register_callback(&davinci_dm.event_callback);
 
@@ -14,6 +14,7 @@
 #include <linux/interrupt.h>
 #include <linux/platform_device.h>
 #include <linux/clk.h>
+#include <linux/wait.h>
 #include <video/davinci_vpbe.h>
 #include <video/davinci_osd.h>
 #include <mach/io.h>
@@ -80,6 +81,10 @@ struct davinci_osd_state {
 	struct davinci_cursor_state cursor;
 	struct davinci_window_state win[4];	/* OSD0, VID0, OSD1, VID1 */
 	struct davinci_osdwin_state osdwin[2];	/* OSD0, OSD1 */
+	int commit_pending;	/* the isr will apply pending_commit */
+	struct davinci_disp_commit pending_commit;
+	int *pending_status;	/* where a waiting committer wants the result */
+	wait_queue_head_t commit_wait;
 };
 
 static struct davinci_osd_state osd_state;
@@ -160,6 +165,8 @@ EXPORT_SYMBOL(osd_read_upper_margin);
 #define MAX_WIN_SIZE OSD_VIDWIN0XP_V0X
 #define MAX_LINE_LENGTH (OSD_VIDWIN0OFST_V0LO << 5)
 
+static void _davinci_disp_finish_commit(void);
+
 /* interrupt service routine */
 static irqreturn_t davinci_disp_isr(int irq, void *arg)
 {
@@ -220,6 +227,14 @@ static irqreturn_t davinci_disp_isr(int irq, void *arg)
 			osd_clear(OSD_MISCCTL_PPSW, OSD_MISCCTL);
 	}
 
+	if (osd->commit_pending && (event & DAVINCI_DISP_END_OF_FRAME)) {
+		spin_lock(&osd->lock);
+		if (osd->commit_pending)
+			_davinci_disp_finish_commit();
+		spin_unlock(&osd->lock);
+		wake_up(&osd->commit_wait);
+	}
+
 	while (callback) {
 		if (callback->mask & event)
 			callback->handler(event, callback->arg);
@@ -2068,20 +2083,14 @@ static void _davinci_disp_set_layer_config(enum davinci_disp_layer layer,
 	}
 }
 
-int davinci_disp_set_layer_config(enum davinci_disp_layer layer,
-				  struct davinci_layer_config *lconfig)
+/*
+ * Program a layer configuration that has already been validated by
+ * try_layer_config().  Must be called with osd->lock held.
+ */
+static void _davinci_disp_apply_layer_config(enum davinci_disp_layer layer,
+				const struct davinci_layer_config *lconfig)
 {
 	struct davinci_window_state *win = &osd->win[layer];
-	int reject_config;
-	unsigned long flags;
-
-	spin_lock_irqsave(&osd->lock, flags);
-
-	reject_config = try_layer_config(layer, lconfig);
-	if (reject_config) {
-		spin_unlock_irqrestore(&osd->lock, flags);
-		return reject_config;
-	}
 
 	/* update the current Cb/Cr order */
 	if (is_yc_pixfmt(lconfig->pixfmt))
@@ -2201,6 +2210,23 @@ int davinci_disp_set_layer_config(enum davinci_disp_layer layer,
 						       win->fb_base_phys,
 						       &win->lconfig);
 	}
+}
+
+int davinci_disp_set_layer_config(enum davinci_disp_layer layer,
+				  struct davinci_layer_config *lconfig)
+{
+	int reject_config;
+	unsigned long flags;
+
+	spin_lock_irqsave(&osd->lock, flags);
+
+	reject_config = try_layer_config(layer, lconfig);
+	if (reject_config) {
+		spin_unlock_irqrestore(&osd->lock, flags);
+		return reject_config;
+	}
+
+	_davinci_disp_apply_layer_config(layer, lconfig);
 
 	spin_unlock_irqrestore(&osd->lock, flags);
 
@@ -2311,6 +2337,258 @@ int davinci_disp_request_layer(enum davinci_disp_layer layer)
 }
 EXPORT_SYMBOL(davinci_disp_request_layer);
 
+#define to_osdwin(layer) (((layer) == WIN_OSD0) ? OSDWIN_OSD0 : OSDWIN_OSD1)
+
+/*
+ * Validate a commit against the current state.  The new layer configurations
+ * are installed in osd->win[] while the other layers are checked so that
+ * inter-layer constraints see the complete new layout, and are then restored.
+ * Must be called with osd->lock held.
+ */
+static int try_commit(struct davinci_disp_commit *commit)
+{
+	struct davinci_layer_config saved[ARRAY_SIZE(osd->win)];
+	struct davinci_disp_win_commit *wc;
+	struct davinci_window_state *win;
+	int layer;
+	int ret = 0;
+
+	for (layer = 0; layer < ARRAY_SIZE(osd->win); layer++)
+		saved[layer] = osd->win[layer].lconfig;
+
+	for (layer = 0; layer < ARRAY_SIZE(osd->win); layer++) {
+		wc = &commit->win[layer];
+		win = &osd->win[layer];
+
+		if (wc->flags && !win->is_allocated) {
+			ret = -EBUSY;
+			break;
+		}
+		if (wc->flags & DAVINCI_DISP_COMMIT_CONFIG) {
+			if (try_layer_config(layer, &wc->lconfig)) {
+				ret = -EINVAL;
+				break;
+			}
+			win->lconfig = wc->lconfig;
+		}
+		if ((wc->flags & DAVINCI_DISP_COMMIT_ZOOM) &&
+		    (wc->h_zoom > ZOOM_X4 || wc->v_zoom > ZOOM_X4)) {
+			ret = -EINVAL;
+			break;
+		}
+		if ((wc->flags & (DAVINCI_DISP_COMMIT_BLEND |
+				  DAVINCI_DISP_COMMIT_COLORKEY)) &&
+		    !is_osd_win(layer)) {
+			ret = -EINVAL;
+			break;
+		}
+		if ((wc->flags & DAVINCI_DISP_COMMIT_BLEND) &&
+		    wc->blend > OSD_8_VID_0) {
+			ret = -EINVAL;
+			break;
+		}
+		if ((wc->flags & DAVINCI_DISP_COMMIT_ENABLE) && wc->enable) {
+			unsigned long base = win->fb_base_phys;
+
+			if (wc->flags & DAVINCI_DISP_COMMIT_START)
+				base = wc->fb_base_phys;
+			if (!base || !win->lconfig.line_length ||
+			    !win->lconfig.xsize || !win->lconfig.ysize) {
+				ret = -EINVAL;
+				break;
+			}
+		}
+	}
+
+	for (layer = 0; layer < ARRAY_SIZE(osd->win); layer++)
+		osd->win[layer].lconfig = saved[layer];
+
+	return ret;
+}
+
+/*
+ * Program a validated commit into the OSD registers.  Layers are disabled
+ * first and enabled last so that no layer is shown with a mix of old and new
+ * settings.  Must be called with osd->lock held.
+ */
+static void _davinci_disp_apply_commit(struct davinci_disp_commit *commit)
+{
+	struct davinci_disp_win_commit *wc;
+	struct davinci_window_state *win;
+	struct davinci_osdwin_state *osdwin_state;
+	int layer;
+
+	for (layer = 0; layer < ARRAY_SIZE(osd->win); layer++) {
+		wc = &commit->win[layer];
+		win = &osd->win[layer];
+		if ((wc->flags & DAVINCI_DISP_COMMIT_ENABLE) && !wc->enable &&
+		    win->is_enabled) {
+			win->is_enabled = 0;
+			_davinci_disp_disable_layer(layer);
+		}
+	}
+
+	for (layer = 0; layer < ARRAY_SIZE(osd->win); layer++) {
+		wc = &commit->win[layer];
+		win = &osd->win[layer];
+
+		if (wc->flags & DAVINCI_DISP_COMMIT_CONFIG)
+			_davinci_disp_apply_layer_config(layer, &wc->lconfig);
+
+		if (wc->flags & DAVINCI_DISP_COMMIT_START) {
+			win->fb_base_phys = wc->fb_base_phys & ~0x1F;
+			_davinci_disp_start_layer(layer, wc->fb_base_phys,
+						  &wc->fb_desc);
+			if (layer == WIN_VID0) {
+				osd->pingpong =
+				    _davinci_disp_dm6446_vid0_pingpong(
+						field_inversion,
+						win->fb_base_phys,
+						&win->lconfig);
+			}
+		}
+
+		if (wc->flags & DAVINCI_DISP_COMMIT_ZOOM) {
+			win->h_zoom = wc->h_zoom;
+			win->v_zoom = wc->v_zoom;
+			_davinci_disp_set_zoom(layer, wc->h_zoom, wc->v_zoom);
+		}
+
+		if (!is_osd_win(layer))
+			continue;
+		osdwin_state = &osd->osdwin[to_osdwin(layer)];
+
+		if (wc->flags & DAVINCI_DISP_COMMIT_BLEND) {
+			osdwin_state->blend = wc->blend;
+			if (win->lconfig.pixfmt != PIXFMT_OSD_ATTR)
+				_davinci_disp_set_blending_factor(
+						to_osdwin(layer), wc->blend);
+		}
+
+		if (wc->flags & DAVINCI_DISP_COMMIT_COLORKEY) {
+			osdwin_state->colorkey_blending =
+			    (wc->colorkey_enable != 0);
+			osdwin_state->colorkey = wc->colorkey;
+			if (win->lconfig.pixfmt != PIXFMT_OSD_ATTR) {
+				if (wc->colorkey_enable)
+					_davinci_disp_enable_color_key(
+							to_osdwin(layer),
+							wc->colorkey,
+							win->lconfig.pixfmt);
+				else
+					_davinci_disp_disable_color_key(
+							to_osdwin(layer));
+			}
+		}
+	}
+
+	for (layer = 0; layer < ARRAY_SIZE(osd->win); layer++) {
+		wc = &commit->win[layer];
+		win = &osd->win[layer];
+		if (!(wc->flags & DAVINCI_DISP_COMMIT_ENABLE) || !wc->enable ||
+		    win->is_enabled)
+			continue;
+		win->is_enabled = 1;
+		if (win->lconfig.pixfmt != PIXFMT_OSD_ATTR)
+			_davinci_disp_enable_layer(layer);
+		else {
+			_davinci_disp_enable_attribute_mode();
+			_davinci_disp_set_blink_attribute(osd->is_blinking,
+							  osd->blink);
+		}
+	}
+}
+
+/*
+ * Apply the pending commit.  Other layer calls may have changed the state
+ * it was checked against since it was queued, so it is validated again;
+ * if it no longer fits it is dropped as a whole.  Must be called with
+ * osd->lock held.
+ */
+static void _davinci_disp_finish_commit(void)
+{
+	int ret;
+
+	ret = try_commit(&osd->pending_commit);
+	if (ret)
+		dev_dbg(osd->dev, "dropping commit, no longer valid\n");
+	else
+		_davinci_disp_apply_commit(&osd->pending_commit);
+
+	if (osd->pending_status)
+		*osd->pending_status = ret;
+	osd->pending_status = NULL;
+	osd->commit_pending = 0;
+}
+
+int davinci_disp_try_commit(struct davinci_disp_commit *commit)
+{
+	unsigned long flags;
+	int ret;
+
+	spin_lock_irqsave(&osd->lock, flags);
+	ret = try_commit(commit);
+	spin_unlock_irqrestore(&osd->lock, flags);
+
+	return ret;
+}
+EXPORT_SYMBOL(davinci_disp_try_commit);
+
+/*
+ * Apply a pending commit directly when no vsync interrupt has picked it up
+ * within the timeout.  The display is not running then, so nothing can tear.
+ */
+static void davinci_disp_flush_commit(void)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&osd->lock, flags);
+	if (osd->commit_pending)
+		_davinci_disp_finish_commit();
+	spin_unlock_irqrestore(&osd->lock, flags);
+	wake_up(&osd->commit_wait);
+}
+
+int davinci_disp_commit(struct davinci_disp_commit *commit, int wait)
+{
+	unsigned long flags;
+	int status = -EINPROGRESS;
+	int ret;
+
+	for (;;) {
+		spin_lock_irqsave(&osd->lock, flags);
+		if (!osd->commit_pending)
+			break;
+		spin_unlock_irqrestore(&osd->lock, flags);
+
+		if (!wait)
+			return -EBUSY;
+		if (!wait_event_timeout(osd->commit_wait,
+					!osd->commit_pending, HZ / 5))
+			davinci_disp_flush_commit();
+	}
+
+	ret = try_commit(commit);
+	if (ret) {
+		spin_unlock_irqrestore(&osd->lock, flags);
+		return ret;
+	}
+	osd->pending_commit = *commit;
+	osd->pending_status = wait ? &status : NULL;
+	osd->commit_pending = 1;
+	spin_unlock_irqrestore(&osd->lock, flags);
+
+	if (!wait)
+		return 0;
+
+	if (!wait_event_timeout(osd->commit_wait, status != -EINPROGRESS,
+				HZ / 5))
+		davinci_disp_flush_commit();
+
+	return status;
+}
+EXPORT_SYMBOL(davinci_disp_commit);
+
 static void _davinci_disp_init(void)
 {
 	osd_write(0, OSD_MODE);
@@ -2418,6 +2696,7 @@ static struct platform_driver davinci_osd_driver = {
 int davinci_osd_init(void)
 {
 	spin_lock_init(&osd->lock);
+	init_waitqueue_head(&osd->commit_wait);
 
 	/* Register the driver */
 	if (platform_driver_register(&davinci_osd_driver)) {
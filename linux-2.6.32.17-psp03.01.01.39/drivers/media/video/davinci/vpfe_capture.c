@@ -71,6 +71,8 @@
 #include <linux/io.h>
 
 #include <media/v4l2-common.h>
+#include <media/v4l2-event.h>
+#include <media/tvp514x.h>
 #include <media/davinci/videohd.h>
 #include <media/davinci/vpfe_capture.h>
 #include <media/davinci/imp_hw_if.h>
@@ -82,6 +84,8 @@
 #define HD_IMAGE_SIZE		(2176 * 2176 * 2)
 #define PAL_IMAGE_SIZE		(720 * 576 * 2)
 #define SECOND_IMAGE_SIZE_MAX	(640 * 480 * 2)
+/* events kept per file handle */
+#define VPFE_MAX_EVENTS		4
 
 static int debug;
 static u32 numbuffers = 3;
@@ -717,6 +721,11 @@ static int vpfe_open(struct file *file)
 			"unable to allocate memory for file handle object\n");
 		return -ENOMEM;
 	}
+	if (v4l2_fh_init(&fh->fh, vpfe_dev->video_dev)) {
+		kfree(fh);
+		return -ENOMEM;
+	}
+	v4l2_fh_add(&fh->fh);
 	/* store pointer to fh in private_data member of file */
 	file->private_data = fh;
 	fh->vpfe_dev = vpfe_dev;
@@ -1145,6 +1154,8 @@ static int vpfe_release(struct file *file)
 	}
 	mutex_unlock(&vpfe_dev->lock);
 	file->private_data = NULL;
+	v4l2_fh_del(&fh->fh);
+	v4l2_fh_exit(&fh->fh);
 	/* Free memory allocated to file handle object */
 	kfree(fh);
 	return 0;
@@ -1170,13 +1181,20 @@ static int vpfe_mmap(struct file *file, struct vm_area_struct *vma)
 static unsigned int vpfe_poll(struct file *file, poll_table *wait)
 {
 	struct vpfe_device *vpfe_dev = video_drvdata(file);
+	struct vpfe_fh *fh = file->private_data;
+	unsigned int mask = 0;
 
 	v4l2_dbg(1, debug, &vpfe_dev->v4l2_dev, "vpfe_poll\n");
 
+	/* pending events, e.g. a standard change, are reported as POLLPRI */
+	poll_wait(file, &fh->fh.events->wait, wait);
+	if (v4l2_event_pending(&fh->fh))
+		mask |= POLLPRI;
+
 	if (vpfe_dev->started)
-		return videobuf_poll_stream(file,
+		mask |= videobuf_poll_stream(file,
 					    &vpfe_dev->buffer_queue, wait);
-	return 0;
+	return mask;
 }
 
 static long vpfe_param_handler(struct file *file, void *priv,
@@ -2684,6 +2702,69 @@ static int vpfe_enum_frameintervals(struct file *file, void *priv,
 	return ret;
 }
 
+static int vpfe_subscribe_event(struct v4l2_fh *fh,
+				struct v4l2_event_subscription *sub)
+{
+	int ret;
+
+	if (sub->type != VPFE_EVENT_STD_CHANGE)
+		return -EINVAL;
+
+	ret = v4l2_event_alloc(fh, VPFE_MAX_EVENTS);
+	if (ret)
+		return ret;
+
+	return v4l2_event_subscribe(fh, sub);
+}
+
+static int vpfe_unsubscribe_event(struct v4l2_fh *fh,
+				struct v4l2_event_subscription *sub)
+{
+	return v4l2_event_unsubscribe(fh, sub);
+}
+
+/*
+ * vpfe_subdev_notify: turns decoder notifications into events.  Called
+ * from the decoder's work item with the decoder locked, so vpfe_dev->lock
+ * mustn't be taken here; s_input holds it while calling into the decoder.
+ */
+static void vpfe_subdev_notify(struct v4l2_subdev *sd,
+			       unsigned int notification, void *arg)
+{
+	struct vpfe_device *vpfe_dev = container_of(sd->v4l2_dev,
+					struct vpfe_device, v4l2_dev);
+	struct tvp514x_std_status *status = arg;
+	struct vpfe_subdev_info *sdinfo;
+	struct vpfe_std_event *data;
+	struct v4l2_event ev;
+	int i, j, index = 0;
+
+	if (notification != TVP514X_NOTIFY_STD_CHANGE)
+		return;
+
+	/* map the decoder input back to the application's input index */
+	for (i = 0; i < vpfe_dev->cfg->num_subdevs; i++) {
+		sdinfo = &vpfe_dev->cfg->sub_devs[i];
+		if (sdinfo->grp_id != sd->grp_id || !sdinfo->routes) {
+			index += sdinfo->num_inputs;
+			continue;
+		}
+		for (j = 0; j < sdinfo->num_inputs; j++)
+			if (sdinfo->routes[j].input == status->input)
+				break;
+		if (j == sdinfo->num_inputs)
+			return;
+
+		memset(&ev, 0, sizeof(ev));
+		ev.type = VPFE_EVENT_STD_CHANGE;
+		data = (struct vpfe_std_event *)ev.u.data;
+		data->input = index + j;
+		data->std_id = status->std_id;
+		v4l2_event_queue(vpfe_dev->video_dev, &ev);
+		return;
+	}
+}
+
 /* vpfe capture ioctl operations */
 static const struct v4l2_ioctl_ops vpfe_ioctl_ops = {
 	.vidioc_querycap	 = vpfe_querycap,
@@ -2713,6 +2794,8 @@ static const struct v4l2_ioctl_ops vpfe_ioctl_ops = {
 	.vidioc_g_parm		 = vpfe_g_parm,
 	.vidioc_enum_framesizes	 = vpfe_enum_framesizes,
 	.vidioc_enum_frameintervals = vpfe_enum_frameintervals,
+	.vidioc_subscribe_event	 = vpfe_subscribe_event,
+	.vidioc_unsubscribe_event = vpfe_unsubscribe_event,
 //	.vidioc_g_chip_ident = vpfe_g_chip_ident,
 };
 
@@ -2957,6 +3040,7 @@ static __init int vpfe_probe(struct platform_device *pdev)
 		goto probe_out_video_release;
 	}
 	v4l2_info(&vpfe_dev->v4l2_dev, "v4l2 device registered\n");
+	vpfe_dev->v4l2_dev.notify = vpfe_subdev_notify;
 	spin_lock_init(&vpfe_dev->irqlock);
 	spin_lock_init(&vpfe_dev->dma_queue_lock);
 	mutex_init(&vpfe_dev->lock);
@@ -27,6 +27,7 @@
 #include <media/v4l2-device.h>
 #include <media/v4l2-subdev.h>
 #include <media/v4l2-chip-ident.h>
+#include <media/v4l2-regcache.h>
 
 #include "ths7303.h"
 
@@ -42,16 +43,33 @@ MODULE_PARM_DESC(debug, "Debug level 0-1");
 #define THS7353_CHANNEL_2       (2)
 #define THS7353_CHANNEL_3       (3)
 
-static struct i2c_client *ths7303_client = NULL;
+struct ths7303_state {
+	struct v4l2_subdev sd;
+	struct v4l2_regcache *regs;
+};
 
-/* following function is used to set ths7303 */
-int ths7303_setval(enum ths7303_filter_mode mode)
+static const struct v4l2_regcache_config ths7303_regcache_config = {
+	.max_reg = THS7353_CHANNEL_3,
+	.val_bytes = 1,
+	.max_burst = 1,
+};
+
+static struct ths7303_state *ths7303_dev;
+
+static inline struct ths7303_state *to_state(struct v4l2_subdev *sd)
 {
-	u8 val = 0, input_bias_luma = 3, input_bias_chroma = 3, temp;
-	int err = 0, disable = 0;
+	return container_of(sd, struct ths7303_state, sd);
+}
 
-	if (ths7303_client == NULL)
-		return 0;
+/*
+ * Program the three channels for a filter mode.  The writes go out as one
+ * I2C transfer, and channels already set for the mode aren't rewritten.
+ */
+static int ths7303_write_mode(struct ths7303_state *state,
+			      enum ths7303_filter_mode mode)
+{
+	u8 val = 0, input_bias_luma = 3, input_bias_chroma = 3, temp;
+	int disable = 0;
 
 	switch (mode) {
 	case THS7303_FILTER_MODE_1080P:
@@ -72,30 +90,31 @@ int ths7303_setval(enum ths7303_filter_mode mode)
 		/* disable all channels */
 		disable = 1;
 	}
+
+	v4l2_regcache_batch_begin(state->regs);
+
 	/* Setup channel 2 - Luma - Green */
 	temp = val;
 	if (!disable)
 		val |= input_bias_luma;
-	err = i2c_smbus_write_byte_data(ths7303_client, THS7353_CHANNEL_2, val);
-	if (err)
-		goto out;
+	v4l2_regcache_write(state->regs, THS7353_CHANNEL_2, val);
 
 	/* setup two chroma channels */
 	if (!disable)
 		temp |= input_bias_chroma;
+	v4l2_regcache_write(state->regs, THS7353_CHANNEL_1, temp);
+	v4l2_regcache_write(state->regs, THS7353_CHANNEL_3, temp);
 
-	err = i2c_smbus_write_byte_data(ths7303_client, THS7353_CHANNEL_1, temp);
-	if (err)
-		goto out;
-
-	err = i2c_smbus_write_byte_data(ths7303_client, THS7353_CHANNEL_3, temp);
+	return v4l2_regcache_batch_end(state->regs);
+}
 
-	if (err)
-		goto out;
-	return 0;
+/* following function is used to set ths7303 */
+int ths7303_setval(enum ths7303_filter_mode mode)
+{
+	if (ths7303_dev == NULL)
+		return 0;
 
-out:
-	return err;
+	return ths7303_write_mode(ths7303_dev, mode);
 }
 EXPORT_SYMBOL(ths7303_setval);
 
@@ -103,55 +122,11 @@ EXPORT_SYMBOL(ths7303_setval);
 static int ths7303_setvalue(struct v4l2_subdev *sd,
 			    enum ths7303_filter_mode mode)
 {
-	u8 val = 0, input_bias_luma = 3, input_bias_chroma = 3, temp;
-	struct i2c_client *client;
-	int err = 0, disable = 0;
+	int err;
 
-	client = v4l2_get_subdevdata(sd);
-
-	switch (mode) {
-	case THS7303_FILTER_MODE_1080P:
-		val = (3 << 6);
-		val |= (3 << 3);
-		break;
-	case THS7303_FILTER_MODE_720P_1080I:
-		val = (2 << 6);
-		val |= (2 << 3);
-		break;
-	case THS7303_FILTER_MODE_480P_576P:
-		val = (1 << 6);
-		val |= (1 << 3);
-		break;
-	case THS7303_FILTER_MODE_480I_576I:
-		break;
-	default:
-		/* disable all channels */
-		disable = 1;
-	}
-	/* Setup channel 2 - Luma - Green */
-	temp = val;
-	if (!disable)
-		val |= input_bias_luma;
-	err = i2c_smbus_write_byte_data(client, THS7353_CHANNEL_2, val);
-	if (err)
-		goto out;
-
-	/* setup two chroma channels */
-	if (!disable)
-		temp |= input_bias_chroma;
-
-	err = i2c_smbus_write_byte_data(client, THS7353_CHANNEL_1, temp);
+	err = ths7303_write_mode(to_state(sd), mode);
 	if (err)
-		goto out;
-
-	err = i2c_smbus_write_byte_data(client, THS7353_CHANNEL_3, temp);
-
-	if (err)
-		goto out;
-	return 0;
-
-out:
-	v4l2_err(sd, "ths7303 write failed\n");
+		v4l2_err(sd, "ths7303 write failed\n");
 	return err;
 }
 
@@ -194,22 +169,30 @@ static const struct v4l2_subdev_ops ths7303_ops = {
 static int ths7303_probe(struct i2c_client *client,
 			const struct i2c_device_id *id)
 {
+	struct ths7303_state *state;
 	struct v4l2_subdev *sd;
 	v4l2_std_id std_id = V4L2_STD_NTSC;
 
-	if (!i2c_check_functionality(client->adapter, I2C_FUNC_SMBUS_BYTE_DATA))
+	if (!i2c_check_functionality(client->adapter, I2C_FUNC_I2C))
 		return -ENODEV;
 
 	v4l_info(client, "chip found @ 0x%x (%s)\n",
 			client->addr << 1, client->adapter->name);
 
-	sd = kzalloc(sizeof(struct v4l2_subdev), GFP_KERNEL);
-	if (sd == NULL)
+	state = kzalloc(sizeof(struct ths7303_state), GFP_KERNEL);
+	if (state == NULL)
+		return -ENOMEM;
+
+	state->regs = v4l2_regcache_init(client, &ths7303_regcache_config);
+	if (state->regs == NULL) {
+		kfree(state);
 		return -ENOMEM;
+	}
 
+	sd = &state->sd;
 	v4l2_i2c_subdev_init(sd, client, &ths7303_ops);
 
-	ths7303_client = client;
+	ths7303_dev = state;
 
 	return ths7303_s_std_output(sd, std_id);
 }
@@ -217,9 +200,13 @@ static int ths7303_probe(struct i2c_client *client,
 static int ths7303_remove(struct i2c_client *client)
 {
 	struct v4l2_subdev *sd = i2c_get_clientdata(client);
+	struct ths7303_state *state = to_state(sd);
 
+	if (ths7303_dev == state)
+		ths7303_dev = NULL;
 	v4l2_device_unregister_subdev(sd);
-	kfree(sd);
+	v4l2_regcache_exit(state->regs);
+	kfree(state);
 
 	return 0;
 }
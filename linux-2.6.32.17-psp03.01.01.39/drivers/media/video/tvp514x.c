@@ -30,11 +30,14 @@
 
 #include <linux/i2c.h>
 #include <linux/delay.h>
+#include <linux/mutex.h>
+#include <linux/workqueue.h>
 #include <linux/videodev2.h>
 
 #include <media/v4l2-device.h>
 #include <media/v4l2-common.h>
 #include <media/v4l2-chip-ident.h>
+#include <media/v4l2-regcache.h>
 #include <media/tvp514x.h>
 
 #include "tvp514x_regs.h"
@@ -46,12 +49,20 @@
 #define I2C_RETRY_COUNT                 (5)
 #define LOCK_RETRY_COUNT                (5)
 #define LOCK_RETRY_DELAY                (200)
+#define LOCK_POLL_DELAY                 (20)
+#define LOCK_FAST_TIMEOUT               (200)
+#define TVP514X_MAX_SNAPSHOTS           (8)
 
 /* Debug functions */
 static int debug;
 module_param(debug, bool, 0644);
 MODULE_PARM_DESC(debug, "Debug level (0-1)");
 
+static int detect_interval = 500;
+module_param(detect_interval, int, 0644);
+MODULE_PARM_DESC(detect_interval,
+	"Background standard detection period in ms, 0 to disable");
+
 MODULE_AUTHOR("Texas Instruments");
 MODULE_DESCRIPTION("TVP514X linux decoder driver");
 MODULE_LICENSE("GPL");
@@ -78,10 +89,26 @@ struct tvp514x_std_info {
 };
 
 static struct tvp514x_reg tvp514x_reg_list_default[0x40];
+
+/**
+ * struct tvp514x_snapshot - Saved state of an input
+ * @used: slot holds a snapshot
+ * @input: input routing the snapshot belongs to
+ * @std: standard last seen locked on the input, STD_INVALID if none
+ * @val: register values, indexed like tvp514x_decoder.tvp514x_regs
+ */
+struct tvp514x_snapshot {
+	int used;
+	u32 input;
+	enum tvp514x_std std;
+	u8 val[ARRAY_SIZE(tvp514x_reg_list_default)];
+};
+
 /**
  * struct tvp514x_decoder - TVP5146/47 decoder object
  * @sd: Subdevice Slave handle
  * @tvp514x_regs: copy of hw's regs with preset values.
+ * @regs: register cache the chip is accessed through
  * @pdata: Board specific
  * @ver: Chip version
  * @streaming: TVP5146/47 decoder streaming - enabled or disabled.
@@ -93,10 +120,17 @@ static struct tvp514x_reg tvp514x_reg_list_default[0x40];
  * @std_list: Standards list
  * @input: Input routing at chip level
  * @output: Output routing at chip level
+ * @lock: Serializes routing and standard detection
+ * @detect_work: Background standard and lock detection
+ * @routed: An input has been selected through s_routing
+ * @locked: Signal lock on the current input, as last detected
+ * @snapshots: Registers and standard of inputs switched away from
+ * @next_snapshot: Slot reused when all snapshots are taken
  */
 struct tvp514x_decoder {
 	struct v4l2_subdev sd;
 	struct tvp514x_reg tvp514x_regs[ARRAY_SIZE(tvp514x_reg_list_default)];
+	struct v4l2_regcache *regs;
 	const struct tvp514x_platform_data *pdata;
 
 	int ver;
@@ -112,6 +146,13 @@ struct tvp514x_decoder {
 	/* Input and Output Routing parameters */
 	u32 input;
 	u32 output;
+
+	struct mutex lock;
+	struct delayed_work detect_work;
+	int routed;
+	int locked;
+	struct tvp514x_snapshot snapshots[TVP514X_MAX_SNAPSHOTS];
+	int next_snapshot;
 };
 
 /* TVP514x default register values */
@@ -259,31 +300,58 @@ static inline struct tvp514x_decoder *to_decoder(struct v4l2_subdev *sd)
 }
 
 
+/*
+ * Status, lock and interrupt registers change on their own; the VBUS
+ * window (0xE0 and up) and the clear-lost-lock strobe act on every
+ * access.  Everything else is cached.
+ */
+static bool tvp514x_volatile_reg(unsigned int reg)
+{
+	switch (reg) {
+	case REG_CLEAR_LOST_LOCK:
+	case REG_STATUS1:
+	case REG_STATUS2:
+	case REG_AGC_GAIN_STATUS_LSB:
+	case REG_AGC_GAIN_STATUS_MSB:
+	case REG_VIDEO_STD_STATUS:
+	case REG_GPIO_INPUT1:
+	case REG_GPIO_INPUT2:
+	case REG_STATUS_REQUEST:
+	case REG_VERTICAL_LINE_COUNT_LSB:
+	case REG_VERTICAL_LINE_COUNT_MSB:
+	case REG_VDP_FIFO_WORD_COUNT:
+	case REG_VDP_FIFO_RESET:
+		return true;
+	}
+	return reg >= REG_VBUS_DATA_ACCESS_NO_VBUS_ADDR_INCR;
+}
+
+static const struct v4l2_regcache_config tvp514x_regcache_config = {
+	.max_reg = 0xff,
+	.val_bytes = 1,
+	.max_burst = 32,
+	.retries = I2C_RETRY_COUNT,
+	.volatile_reg = tvp514x_volatile_reg,
+};
+
 /**
  * tvp514x_read_reg() - Read a value from a register in an TVP5146/47.
  * @sd: ptr to v4l2_subdev struct
  * @reg: TVP5146/47 register address
  *
- * Returns value read if successful, or non-zero (-1) otherwise.
+ * Returns value read if successful, or negative error code otherwise.
  */
 static int tvp514x_read_reg(struct v4l2_subdev *sd, u8 reg)
 {
-	int err, retry = 0;
-	struct i2c_client *client = v4l2_get_subdevdata(sd);
-
-read_again:
+	struct tvp514x_decoder *decoder = to_decoder(sd);
+	unsigned int val;
+	int err;
 
-	err = i2c_smbus_read_byte_data(client, reg);
-	if (err == -1) {
-		if (retry <= I2C_RETRY_COUNT) {
-			v4l2_warn(sd, "Read: retry ... %d\n", retry);
-			retry++;
-			msleep_interruptible(10);
-			goto read_again;
-		}
-	}
+	err = v4l2_regcache_read(decoder->regs, reg, &val);
+	if (err)
+		return err;
 
-	return err;
+	return val;
 }
 
 /**
@@ -310,22 +378,9 @@ static void dump_reg(struct v4l2_subdev *sd, u8 reg)
  */
 static int tvp514x_write_reg(struct v4l2_subdev *sd, u8 reg, u8 val)
 {
-	int err, retry = 0;
-	struct i2c_client *client = v4l2_get_subdevdata(sd);
-
-write_again:
-
-	err = i2c_smbus_write_byte_data(client, reg, val);
-	if (err) {
-		if (retry <= I2C_RETRY_COUNT) {
-			v4l2_warn(sd, "Write: retry ... %d\n", retry);
-			retry++;
-			msleep_interruptible(10);
-			goto write_again;
-		}
-	}
+	struct tvp514x_decoder *decoder = to_decoder(sd);
 
-	return err;
+	return v4l2_regcache_write(decoder->regs, reg, val);
 }
 
 /**
@@ -338,17 +393,25 @@ write_again:
  *		if token is TOK_DELAY, then a delay of 'val' msec is introduced
  *		if token is TOK_SKIP, then the register write is skipped
  *		if token is TOK_WRITE, then the register write is performed
+ * The writes between delays go out as one I2C transfer, leaving out
+ * registers that already hold the value.
  * Returns zero if successful, or non-zero otherwise.
  */
 static int tvp514x_write_regs(struct v4l2_subdev *sd,
 			      const struct tvp514x_reg reglist[])
 {
-	int err;
+	struct tvp514x_decoder *decoder = to_decoder(sd);
+	int err = 0, ret;
 	const struct tvp514x_reg *next = reglist;
 
+	v4l2_regcache_batch_begin(decoder->regs);
 	for (; next->token != TOK_TERM; next++) {
 		if (next->token == TOK_DELAY) {
+			err = v4l2_regcache_batch_end(decoder->regs);
 			msleep(next->val);
+			v4l2_regcache_batch_begin(decoder->regs);
+			if (err)
+				break;
 			continue;
 		}
 
@@ -356,12 +419,16 @@ static int tvp514x_write_regs(struct v4l2_subdev *sd,
 			continue;
 
 		err = tvp514x_write_reg(sd, next->reg, (u8) next->val);
-		if (err) {
-			v4l2_err(sd, "Write failed. Err[%d]\n", err);
-			return err;
-		}
+		if (err)
+			break;
 	}
-	return 0;
+	ret = v4l2_regcache_batch_end(decoder->regs);
+	if (!err)
+		err = ret;
+
+	if (err)
+		v4l2_err(sd, "Write failed. Err[%d]\n", err);
+	return err;
 }
 
 /**
@@ -397,6 +464,202 @@ static enum tvp514x_std tvp514x_get_current_std(struct v4l2_subdev *sd)
 	return STD_INVALID;
 }
 
+/**
+ * tvp514x_lock_mask() : Status bits that must be set for an input to lock
+ * @input: input routing
+ *
+ * Returns zero for inputs that aren't supported.
+ */
+static u8 tvp514x_lock_mask(u32 input)
+{
+	switch (input) {
+	case INPUT_CVBS_VI1A:
+	case INPUT_CVBS_VI1B:
+	case INPUT_CVBS_VI1C:
+	case INPUT_CVBS_VI2A:
+	case INPUT_CVBS_VI2B:
+	case INPUT_CVBS_VI2C:
+	case INPUT_CVBS_VI3A:
+	case INPUT_CVBS_VI3B:
+	case INPUT_CVBS_VI3C:
+	case INPUT_CVBS_VI4A:
+		return STATUS_CLR_SUBCAR_LOCK_BIT |
+			STATUS_HORZ_SYNC_LOCK_BIT |
+			STATUS_VIRT_SYNC_LOCK_BIT;
+
+	case INPUT_SVIDEO_VI2A_VI1A:
+	case INPUT_SVIDEO_VI2B_VI1B:
+	case INPUT_SVIDEO_VI2C_VI1C:
+	case INPUT_SVIDEO_VI2A_VI3A:
+	case INPUT_SVIDEO_VI2B_VI3B:
+	case INPUT_SVIDEO_VI2C_VI3C:
+	case INPUT_SVIDEO_VI4A_VI1A:
+	case INPUT_SVIDEO_VI4A_VI1B:
+	case INPUT_SVIDEO_VI4A_VI1C:
+	case INPUT_SVIDEO_VI4A_VI3A:
+	case INPUT_SVIDEO_VI4A_VI3B:
+	case INPUT_SVIDEO_VI4A_VI3C:
+		return STATUS_HORZ_SYNC_LOCK_BIT |
+			STATUS_VIRT_SYNC_LOCK_BIT;
+
+	/* Need to add other interfaces */
+	default:
+		return 0;
+	}
+}
+
+/**
+ * tvp514x_locked_std() : Get the standard of a locked signal
+ * @sd: ptr to v4l2_subdev struct
+ * @lock_mask: status bits required for lock, see tvp514x_lock_mask()
+ *
+ * Returns STD_INVALID if no standard is detected or the decoder isn't locked.
+ */
+static enum tvp514x_std tvp514x_locked_std(struct v4l2_subdev *sd,
+		u8 lock_mask)
+{
+	enum tvp514x_std std;
+	int status;
+
+	std = tvp514x_get_current_std(sd);
+	if (std == STD_INVALID)
+		return STD_INVALID;
+
+	status = tvp514x_read_reg(sd, REG_STATUS1);
+	if (status < 0 || (status & lock_mask) != lock_mask)
+		return STD_INVALID;
+
+	return std;
+}
+
+/**
+ * tvp514x_wait_lock() : Wait for the decoder to lock
+ * @sd: ptr to v4l2_subdev struct
+ * @lock_mask: status bits required for lock, see tvp514x_lock_mask()
+ * @timeout: longest wait in msec
+ *
+ * The status is polled about once a field, so a signal that locks quickly
+ * doesn't cost a full LOCK_RETRY_DELAY.  Returns the standard, or
+ * STD_INVALID if the decoder didn't lock in time.
+ */
+static enum tvp514x_std tvp514x_wait_lock(struct v4l2_subdev *sd,
+		u8 lock_mask, unsigned int timeout)
+{
+	unsigned long end = jiffies + msecs_to_jiffies(timeout);
+	enum tvp514x_std std;
+
+	for (;;) {
+		msleep(LOCK_POLL_DELAY);
+		std = tvp514x_locked_std(sd, lock_mask);
+		if (std != STD_INVALID || time_after(jiffies, end))
+			return std;
+	}
+}
+
+static struct tvp514x_snapshot *
+tvp514x_find_snapshot(struct tvp514x_decoder *decoder, u32 input)
+{
+	int i;
+
+	for (i = 0; i < TVP514X_MAX_SNAPSHOTS; i++)
+		if (decoder->snapshots[i].used &&
+				decoder->snapshots[i].input == input)
+			return &decoder->snapshots[i];
+	return NULL;
+}
+
+/**
+ * tvp514x_save_snapshot() : Remember the state of the current input
+ * @decoder: ptr to tvp514x_decoder structure
+ *
+ * Called before switching away, so that switching back restores the
+ * controls of the input and starts from the standard it was locked to.
+ */
+static void tvp514x_save_snapshot(struct tvp514x_decoder *decoder)
+{
+	struct tvp514x_snapshot *snap;
+	int i;
+
+	if (!decoder->routed)
+		return;
+
+	snap = tvp514x_find_snapshot(decoder, decoder->input);
+	if (snap == NULL) {
+		snap = &decoder->snapshots[decoder->next_snapshot];
+		decoder->next_snapshot = (decoder->next_snapshot + 1) %
+			TVP514X_MAX_SNAPSHOTS;
+	}
+
+	snap->used = 1;
+	snap->input = decoder->input;
+	snap->std = decoder->locked ? decoder->current_std : STD_INVALID;
+	for (i = 0; i < ARRAY_SIZE(snap->val); i++)
+		snap->val[i] = decoder->tvp514x_regs[i].val;
+}
+
+static void tvp514x_start_detect(struct tvp514x_decoder *decoder)
+{
+	if (detect_interval > 0)
+		schedule_delayed_work(&decoder->detect_work,
+				msecs_to_jiffies(detect_interval));
+}
+
+/**
+ * tvp514x_detect_work() : Background standard and lock detection
+ * @work: detect_work of the decoder
+ *
+ * Watches the current input while the decoder is powered, and sends a
+ * TVP514X_NOTIFY_STD_CHANGE notification to the bridge driver when the
+ * signal locks, unlocks or changes standard.
+ */
+static void tvp514x_detect_work(struct work_struct *work)
+{
+	struct tvp514x_decoder *decoder = container_of(work,
+			struct tvp514x_decoder, detect_work.work);
+	struct v4l2_subdev *sd = &decoder->sd;
+	struct tvp514x_std_status status;
+	enum tvp514x_std std;
+	int locked, val;
+
+	mutex_lock(&decoder->lock);
+	if (!decoder->streaming || !decoder->routed)
+		goto out;
+
+	std = tvp514x_locked_std(sd, tvp514x_lock_mask(decoder->input));
+	locked = (std != STD_INVALID);
+
+	if (!locked) {
+		/*
+		 * s_routing may have forced the standard the input had last
+		 * time; if the source changed, go back to the configured
+		 * (usually auto switch) mode so it can be detected.
+		 */
+		val = tvp514x_read_reg(sd, REG_VIDEO_STD);
+		if (val >= 0 && val != decoder->tvp514x_regs[REG_VIDEO_STD].val)
+			tvp514x_write_reg(sd, REG_VIDEO_STD,
+				decoder->tvp514x_regs[REG_VIDEO_STD].val);
+	}
+
+	if (locked != decoder->locked ||
+			(locked && std != decoder->current_std)) {
+		decoder->locked = locked;
+		if (locked)
+			decoder->current_std = std;
+
+		status.input = decoder->input;
+		status.std_id = locked ?
+			decoder->std_list[std].standard.id : 0;
+		v4l2_dbg(1, debug, sd, "Input %d: %s\n", decoder->input,
+			locked ? (char *)decoder->std_list[std].standard.name :
+			"no signal");
+		v4l2_subdev_notify(sd, TVP514X_NOTIFY_STD_CHANGE, &status);
+	}
+
+	tvp514x_start_detect(decoder);
+out:
+	mutex_unlock(&decoder->lock);
+}
+
 /* TVP5146/47 register dump function */
 static void tvp514x_reg_dump(struct v4l2_subdev *sd)
 {
@@ -523,79 +786,51 @@ static int tvp514x_querystd(struct v4l2_subdev *sd, v4l2_std_id *std_id)
 {
 	struct tvp514x_decoder *decoder = to_decoder(sd);
 	enum tvp514x_std current_std;
-	enum tvp514x_input input_sel;
-	u8 sync_lock_status, lock_mask;
-	int err;
+	u8 lock_mask;
+	int err = 0;
 
 	if (std_id == NULL)
 		return -EINVAL;
 
+	lock_mask = tvp514x_lock_mask(decoder->input);
+	if (!lock_mask)
+		return -EINVAL;
+
+	mutex_lock(&decoder->lock);
+
+	/* While the background detection runs, it already knows */
+	if (decoder->locked && decoder->streaming && detect_interval > 0) {
+		current_std = decoder->current_std;
+		goto found;
+	}
+
 	err = tvp514x_write_reg(sd, REG_VIDEO_STD,
 			VIDEO_STD_AUTO_SWITCH_BIT);
 	if (err < 0)
-		return err;
+		goto out;
 
 	/* Setup the default input in case s_routing haven't been invoked yet */
 	err = tvp514x_write_reg(sd, REG_INPUT_SEL,
 		decoder->tvp514x_regs[REG_INPUT_SEL].val);
 	if (err < 0)
-		return err;
-
-	msleep(LOCK_RETRY_DELAY);
-
-	/* get the current standard */
-	current_std = tvp514x_get_current_std(sd);
-	if (current_std == STD_INVALID)
-		return -EINVAL;
+		goto out;
 
-	input_sel = decoder->input;
-
-	switch (input_sel) {
-	case INPUT_CVBS_VI1A:
-	case INPUT_CVBS_VI1B:
-	case INPUT_CVBS_VI1C:
-	case INPUT_CVBS_VI2A:
-	case INPUT_CVBS_VI2B:
-	case INPUT_CVBS_VI2C:
-	case INPUT_CVBS_VI3A:
-	case INPUT_CVBS_VI3B:
-	case INPUT_CVBS_VI3C:
-	case INPUT_CVBS_VI4A:
-		lock_mask = STATUS_CLR_SUBCAR_LOCK_BIT |
-			STATUS_HORZ_SYNC_LOCK_BIT |
-			STATUS_VIRT_SYNC_LOCK_BIT;
-		break;
-
-	case INPUT_SVIDEO_VI2A_VI1A:
-	case INPUT_SVIDEO_VI2B_VI1B:
-	case INPUT_SVIDEO_VI2C_VI1C:
-	case INPUT_SVIDEO_VI2A_VI3A:
-	case INPUT_SVIDEO_VI2B_VI3B:
-	case INPUT_SVIDEO_VI2C_VI3C:
-	case INPUT_SVIDEO_VI4A_VI1A:
-	case INPUT_SVIDEO_VI4A_VI1B:
-	case INPUT_SVIDEO_VI4A_VI1C:
-	case INPUT_SVIDEO_VI4A_VI3A:
-	case INPUT_SVIDEO_VI4A_VI3B:
-	case INPUT_SVIDEO_VI4A_VI3C:
-		lock_mask = STATUS_HORZ_SYNC_LOCK_BIT |
-			STATUS_VIRT_SYNC_LOCK_BIT;
-		break;
-		/*Need to add other interfaces*/
-	default:
-		return -EINVAL;
+	/* get the current standard, once the signal is locked */
+	current_std = tvp514x_wait_lock(sd, lock_mask, LOCK_RETRY_DELAY);
+	if (current_std == STD_INVALID) {
+		err = -EINVAL;	/* No input detected */
+		goto out;
 	}
-	/* check whether signal is locked */
-	sync_lock_status = tvp514x_read_reg(sd, REG_STATUS1);
-	if (lock_mask != (sync_lock_status & lock_mask))
-		return -EINVAL;	/* No input detected */
 
 	decoder->current_std = current_std;
+found:
 	*std_id = decoder->std_list[current_std].standard.id;
 
 	v4l2_dbg(1, debug, sd, "Current STD: %s",
 			decoder->std_list[current_std].standard.name);
-	return 0;
+out:
+	mutex_unlock(&decoder->lock);
+	return err;
 }
 
 /**
@@ -618,14 +853,18 @@ static int tvp514x_s_std(struct v4l2_subdev *sd, v4l2_std_id std_id)
 	if ((i == decoder->num_stds) || (i == STD_INVALID))
 		return -EINVAL;
 
+	mutex_lock(&decoder->lock);
 	err = tvp514x_write_reg(sd, REG_VIDEO_STD,
 				decoder->std_list[i].video_std);
-	if (err)
+	if (err) {
+		mutex_unlock(&decoder->lock);
 		return err;
+	}
 
 	decoder->current_std = i;
 	decoder->tvp514x_regs[REG_VIDEO_STD].val =
 		decoder->std_list[i].video_std;
+	mutex_unlock(&decoder->lock);
 
 	v4l2_dbg(1, debug, sd, "Standard set to: %s",
 			decoder->std_list[i].standard.name);
@@ -642,23 +881,34 @@ static int tvp514x_s_std(struct v4l2_subdev *sd, v4l2_std_id std_id)
  * If index is valid, selects the requested input. Otherwise, returns -EINVAL if
  * the input is not supported or there is no active signal present in the
  * selected input.
+ *
+ * The registers of the input being left are saved.  An input selected
+ * before gets its registers back, written in one burst along with the
+ * input selection, and its last standard is forced so the decoder
+ * doesn't have to search for it.  Only if that doesn't lock quickly is
+ * the standard auto-detected.
  */
 static int tvp514x_s_routing(struct v4l2_subdev *sd,
 				u32 input, u32 output, u32 config)
 {
 	struct tvp514x_decoder *decoder = to_decoder(sd);
-	int err;
-	enum tvp514x_input input_sel;
-	enum tvp514x_output output_sel;
+	struct tvp514x_snapshot *snap;
 	enum tvp514x_std current_std = STD_INVALID;
-	u8 sync_lock_status, lock_mask;
-	int try_count = LOCK_RETRY_COUNT;
+	u32 video_std;
+	u8 lock_mask;
+	int err, i;
 
 	if ((input >= INPUT_INVALID) ||
 			(output >= OUTPUT_INVALID))
 		/* Index out of bound */
 		return -EINVAL;
 
+	lock_mask = tvp514x_lock_mask(input);
+	if (!lock_mask)
+		return -EINVAL;
+
+	mutex_lock(&decoder->lock);
+
 	/*
 	 * For the sequence streamon -> streamoff and again s_input, most of
 	 * the time, it fails to lock the signal, since streamoff puts TVP514x
@@ -666,104 +916,64 @@ static int tvp514x_s_routing(struct v4l2_subdev *sd,
 	 */
 	tvp514x_s_stream(sd, 1);
 
-	/*
-	 * Since this api is goint to detect the input, it is required
-	 * to set the standard in the auto switch mode
-	 */
-	err = tvp514x_write_reg(sd, REG_VIDEO_STD,
-		VIDEO_STD_AUTO_SWITCH_BIT);
-	if (err < 0)
-		return err;
-
-	msleep(LOCK_RETRY_DELAY);
+	tvp514x_save_snapshot(decoder);
 
-	input_sel = input;
-	output_sel = output;
-
-	err = tvp514x_write_reg(sd, REG_INPUT_SEL, input_sel);
-	if (err)
-		return err;
-
-	output_sel |= tvp514x_read_reg(sd,
-			REG_OUTPUT_FORMATTER1) & 0x7;
-	err = tvp514x_write_reg(sd, REG_OUTPUT_FORMATTER1,
-			output_sel);
-	if (err)
-		return err;
-
-	decoder->tvp514x_regs[REG_INPUT_SEL].val = input_sel;
-	decoder->tvp514x_regs[REG_OUTPUT_FORMATTER1].val = output_sel;
-
-	/* Clear status */
-	msleep(LOCK_RETRY_DELAY);
-	err =
-	    tvp514x_write_reg(sd, REG_CLEAR_LOST_LOCK, 0x01);
-	if (err)
-		return err;
-
-	switch (input_sel) {
-	case INPUT_CVBS_VI1A:
-	case INPUT_CVBS_VI1B:
-	case INPUT_CVBS_VI1C:
-	case INPUT_CVBS_VI2A:
-	case INPUT_CVBS_VI2B:
-	case INPUT_CVBS_VI2C:
-	case INPUT_CVBS_VI3A:
-	case INPUT_CVBS_VI3B:
-	case INPUT_CVBS_VI3C:
-	case INPUT_CVBS_VI4A:
-		lock_mask = STATUS_CLR_SUBCAR_LOCK_BIT |
-			STATUS_HORZ_SYNC_LOCK_BIT |
-			STATUS_VIRT_SYNC_LOCK_BIT;
-		break;
-
-	case INPUT_SVIDEO_VI2A_VI1A:
-	case INPUT_SVIDEO_VI2B_VI1B:
-	case INPUT_SVIDEO_VI2C_VI1C:
-	case INPUT_SVIDEO_VI2A_VI3A:
-	case INPUT_SVIDEO_VI2B_VI3B:
-	case INPUT_SVIDEO_VI2C_VI3C:
-	case INPUT_SVIDEO_VI4A_VI1A:
-	case INPUT_SVIDEO_VI4A_VI1B:
-	case INPUT_SVIDEO_VI4A_VI1C:
-	case INPUT_SVIDEO_VI4A_VI3A:
-	case INPUT_SVIDEO_VI4A_VI3B:
-	case INPUT_SVIDEO_VI4A_VI3C:
-		lock_mask = STATUS_HORZ_SYNC_LOCK_BIT |
-			STATUS_VIRT_SYNC_LOCK_BIT;
-		break;
-	/* Need to add other interfaces*/
-	default:
-		return -EINVAL;
+	snap = tvp514x_find_snapshot(decoder, input);
+	if (snap != NULL) {
+		for (i = 0; i < ARRAY_SIZE(snap->val); i++)
+			decoder->tvp514x_regs[i].val = snap->val[i];
+	} else {
+		/*
+		 * Since this api is goint to detect the input, it is required
+		 * to set the standard in the auto switch mode
+		 */
+		decoder->tvp514x_regs[REG_VIDEO_STD].val =
+			VIDEO_STD_AUTO_SWITCH_BIT;
 	}
+	decoder->tvp514x_regs[REG_INPUT_SEL].val = input;
+	decoder->tvp514x_regs[REG_OUTPUT_FORMATTER1].val = output |
+		(decoder->tvp514x_regs[REG_OUTPUT_FORMATTER1].val & 0x7);
+
+	video_std = decoder->tvp514x_regs[REG_VIDEO_STD].val;
+	if (snap != NULL && snap->std != STD_INVALID)
+		decoder->tvp514x_regs[REG_VIDEO_STD].val =
+			decoder->std_list[snap->std].video_std;
+
+	/* one transfer, ending with the clear lost lock strobe */
+	err = tvp514x_write_regs(sd, decoder->tvp514x_regs);
+	decoder->tvp514x_regs[REG_VIDEO_STD].val = video_std;
+	if (err)
+		goto out;
 
-	while (try_count-- > 0) {
-		/* Allow decoder to sync up with new input */
-		msleep(LOCK_RETRY_DELAY);
+	decoder->input = input;
+	decoder->output = output;
+	decoder->routed = 1;
+	decoder->locked = 0;
 
-		/* get the current standard for future reference */
-		current_std = tvp514x_get_current_std(sd);
+	if (snap != NULL && snap->std != STD_INVALID) {
+		current_std = tvp514x_wait_lock(sd, lock_mask,
+				LOCK_FAST_TIMEOUT);
 		if (current_std == STD_INVALID)
-			continue;
-
-		sync_lock_status = tvp514x_read_reg(sd,
-				REG_STATUS1);
-		if (lock_mask == (sync_lock_status & lock_mask))
-			/* Input detected */
-			break;
+			/* the source changed, detect its standard again */
+			tvp514x_write_reg(sd, REG_VIDEO_STD, video_std);
+	}
+	if (current_std == STD_INVALID)
+		current_std = tvp514x_wait_lock(sd, lock_mask,
+				LOCK_RETRY_COUNT * LOCK_RETRY_DELAY);
+	if (current_std == STD_INVALID) {
+		err = -EINVAL;
+		goto out;
 	}
-
-	if ((current_std == STD_INVALID) || (try_count < 0))
-		return -EINVAL;
 
 	decoder->current_std = current_std;
-	decoder->input = input;
-	decoder->output = output;
+	decoder->locked = 1;
 
 	v4l2_dbg(1, debug, sd, "Input set to: %d, std : %d",
-			input_sel, current_std);
-
-	return 0;
+			input, current_std);
+out:
+	tvp514x_start_detect(decoder);
+	mutex_unlock(&decoder->lock);
+	return err;
 }
 
 /**
@@ -1226,6 +1436,8 @@ static int tvp514x_s_stream(struct v4l2_subdev *sd, int enable)
 	switch (enable) {
 	case 0:
 	{
+		cancel_delayed_work_sync(&decoder->detect_work);
+
 		/* Power Down Sequence */
 		err = tvp514x_write_reg(sd, REG_OPERATION_MODE, 0x01);
 		if (err) {
@@ -1246,6 +1458,11 @@ static int tvp514x_s_stream(struct v4l2_subdev *sd, int enable)
 			v4l2_err(sd, "Unable to turn on decoder\n");
 			return err;
 		}
+		/*
+		 * Don't trust what was cached before the decoder was powered
+		 * down:  re-detect and rewrite every register.
+		 */
+		v4l2_regcache_invalidate(decoder->regs);
 		/* Detect if not already detected */
 		err = tvp514x_detect(sd, decoder);
 		if (err) {
@@ -1258,6 +1475,7 @@ static int tvp514x_s_stream(struct v4l2_subdev *sd, int enable)
 			return err;
 		}
 		decoder->streaming = enable;
+		tvp514x_start_detect(decoder);
 		break;
 	}
 	default:
@@ -1332,7 +1550,7 @@ tvp514x_probe(struct i2c_client *client, const struct i2c_device_id *id)
 	u8 chip_id_msb, chip_id_lsb, rom_ver;
 
 	/* Check if the adapter supports the needed features */
-	if (!i2c_check_functionality(client->adapter, I2C_FUNC_SMBUS_BYTE_DATA))
+	if (!i2c_check_functionality(client->adapter, I2C_FUNC_I2C))
 		return -EIO;
 
 	if (!client->dev.platform_data) {
@@ -1366,6 +1584,14 @@ tvp514x_probe(struct i2c_client *client, const struct i2c_device_id *id)
 
 	/* Initialize the tvp514x_decoder with default configuration */
 	*decoder = tvp514x_dev;
+
+	decoder->regs = v4l2_regcache_init(client, &tvp514x_regcache_config);
+	if (!decoder->regs) {
+		kfree(decoder);
+		return -ENOMEM;
+	}
+	mutex_init(&decoder->lock);
+	INIT_DELAYED_WORK(&decoder->detect_work, tvp514x_detect_work);
 	/* Copy default register configuration */
 	memcpy(decoder->tvp514x_regs, tvp514x_reg_list_default,
 			sizeof(tvp514x_reg_list_default));
@@ -1409,7 +1635,9 @@ static int tvp514x_remove(struct i2c_client *client)
 	struct v4l2_subdev *sd = i2c_get_clientdata(client);
 	struct tvp514x_decoder *decoder = to_decoder(sd);
 
+	cancel_delayed_work_sync(&decoder->detect_work);
 	v4l2_device_unregister_subdev(sd);
+	v4l2_regcache_exit(decoder->regs);
 	kfree(decoder);
 	return 0;
 }
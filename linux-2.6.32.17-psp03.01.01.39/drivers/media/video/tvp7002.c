@@ -21,6 +21,7 @@
 
 #include <media/v4l2-device.h>
 #include <media/v4l2-chip-ident.h>
+#include <media/v4l2-regcache.h>
 #include <media/davinci/videohd.h>
 #include <media/tvp7002.h>
 
@@ -55,6 +56,7 @@ struct i2c_reg_value {
 
 struct tvp7002_decoder {
 	struct v4l2_subdev sd;
+	struct v4l2_regcache *regs;
 	const struct tvp7002_platform_data *pdata;
 
 	int ver;
@@ -453,24 +455,32 @@ static inline struct tvp7002_decoder *to_decoder(struct v4l2_subdev *sd)
 	return container_of(sd, struct tvp7002_decoder, sd);
 }
 
+/* only the sync detection status registers change on their own */
+static bool tvp7002_volatile_reg(unsigned int reg)
+{
+	return reg >= TVP7002_LINES_PER_FRAME_STATUS_LOW &&
+		reg <= TVP7002_CLOCK_PER_LINE_STATUS_MSB;
+}
+
+static const struct v4l2_regcache_config tvp7002_regcache_config = {
+	.max_reg = 0xff,
+	.val_bytes = 1,
+	.max_burst = 32,
+	.retries = I2C_RETRY_COUNT,
+	.volatile_reg = tvp7002_volatile_reg,
+};
+
 static int tvp7002_read_reg(struct v4l2_subdev *sd, u8 reg)
 {
-	int err, retry = 0;
-	struct i2c_client *client = v4l2_get_subdevdata(sd);
-
-read_again:
-
-	err = i2c_smbus_read_byte_data(client, reg);
-	if (err == -1) {
-		if (retry <= I2C_RETRY_COUNT) {
-			v4l2_warn(sd, "Read: retry ... %d\n", retry);
-			retry++;
-			msleep_interruptible(10);
-			goto read_again;
-		}
-	}
+	struct tvp7002_decoder *decoder = to_decoder(sd);
+	unsigned int val;
+	int err;
 
-	return err;
+	err = v4l2_regcache_read(decoder->regs, reg, &val);
+	if (err)
+		return err;
+
+	return val;
 }
 
 #if 0
@@ -485,22 +495,9 @@ static void dump_reg(struct v4l2_subdev *sd, u8 reg)
 
 static int tvp7002_write_reg(struct v4l2_subdev *sd, u8 reg, u8 val)
 {
-	int err, retry = 0;
-	struct i2c_client *client = v4l2_get_subdevdata(sd);
-
-write_again:
-
-	err = i2c_smbus_write_byte_data(client, reg, val);
-	if (err) {
-		if (retry <= I2C_RETRY_COUNT) {
-			v4l2_warn(sd, "Write: retry ... %d\n", retry);
-			retry++;
-			msleep_interruptible(10);
-			goto write_again;
-		}
-	}
+	struct tvp7002_decoder *decoder = to_decoder(sd);
 
-	return err;
+	return v4l2_regcache_write(decoder->regs, reg, val);
 }
 
 #if 0
@@ -534,6 +531,7 @@ static int tvp7002_write_regs(struct v4l2_subdev *sd,
  */
 static int tvp7002_initialize(struct v4l2_subdev *sd)
 {
+	struct tvp7002_decoder *decoder = to_decoder(sd);
 	int err = 0;
 	v4l2_std_id std;
 
@@ -546,6 +544,9 @@ static int tvp7002_initialize(struct v4l2_subdev *sd)
 				     0x00);
 
 	msleep(20);
+
+	/* the defaults go out as one transfer, minus what's already set */
+	v4l2_regcache_batch_begin(decoder->regs);
 	err |= tvp7002_write_reg(sd, TVP7002_HPLL_DIVIDER_MSB,
 				     TVP7002_HPLL_MSB_DEFAULT);
 	err |= tvp7002_write_reg(sd, TVP7002_HPLL_DIVIDER_LSB,
@@ -619,6 +620,7 @@ static int tvp7002_initialize(struct v4l2_subdev *sd)
 	err |=
 	    tvp7002_write_reg(sd, TVP7002_AVID_START_PIXEL_HIGH,
 				  TVP7002_AVID_START_PIXEL_DEFAULT);
+	err |= v4l2_regcache_batch_end(decoder->regs);
 
 	if (err < 0) {
 		err = -EINVAL;
@@ -1030,7 +1032,8 @@ static int tvp7002_enuminput(struct v4l2_input *input, void *dec)
 static int tvp7002_set_format_params(struct v4l2_subdev *sd,
 				struct tvp7002_format_params *tvpformats)
 {
-	int err = 0;
+	struct tvp7002_decoder *decoder = to_decoder(sd);
+	int err = 0, ret;
 	unsigned char val;
 	
 	v4l2_dbg(1, debug, sd,
@@ -1040,13 +1043,15 @@ static int tvp7002_set_format_params(struct v4l2_subdev *sd,
 		return -EINVAL;
 	}
 
+	v4l2_regcache_batch_begin(decoder->regs);
+
 	/* Write the HPLL related registers */
 	err = tvp7002_write_reg(sd, TVP7002_HPLL_DIVIDER_MSB,
 				    tvpformats->hpll_divider_msb);
 	if (err < 0) {
 		v4l2_err(sd,
 			"I2C write fails...Divider MSB\n");
-		return err;
+		goto out;
 	}
 
 	val = ((tvpformats->
@@ -1057,7 +1062,7 @@ static int tvp7002_set_format_params(struct v4l2_subdev *sd,
 	if (err < 0) {
 		v4l2_err(sd,
 			"I2C write fails...Divider LSB.\n");
-		return err;
+		goto out;
 	}
 	err = tvp7002_write_reg(sd, TVP7002_HPLL_CONTROL,
 				    tvpformats->hpll_control);
@@ -1095,7 +1100,9 @@ static int tvp7002_set_format_params(struct v4l2_subdev *sd,
 
 	v4l2_dbg(1, debug, sd,
 		"End of tvp7002 set format params...\n");
-	return err;
+out:
+	ret = v4l2_regcache_batch_end(decoder->regs);
+	return err ? err : ret;
 }
 
 static int
@@ -1419,7 +1426,7 @@ tvp7002_probe(struct i2c_client *client, const struct i2c_device_id *id)
 	int err;
 
 	/* Check if the adapter supports the needed features */
-	if (!i2c_check_functionality(client->adapter, I2C_FUNC_SMBUS_BYTE_DATA))
+	if (!i2c_check_functionality(client->adapter, I2C_FUNC_I2C))
 		return -EIO;
 
 	if (!client->dev.platform_data) {
@@ -1441,6 +1448,12 @@ tvp7002_probe(struct i2c_client *client, const struct i2c_device_id *id)
 	/* Initialize the tvp7002_decoder with default configuration */
 	*decoder = tvp7002_dev;
 
+	decoder->regs = v4l2_regcache_init(client, &tvp7002_regcache_config);
+	if (!decoder->regs) {
+		kfree(decoder);
+		return -ENOMEM;
+	}
+
 	/* Copy board specific information here */
 	decoder->pdata = client->dev.platform_data;
 
@@ -1459,8 +1472,11 @@ tvp7002_probe(struct i2c_client *client, const struct i2c_device_id *id)
 	v4l2_i2c_subdev_init(sd, client, &tvp7002_ops);
 
 	err = tvp7002_initialize(sd);
-	if (err < 0)
+	if (err < 0) {
+		v4l2_regcache_exit(decoder->regs);
+		kfree(decoder);
 		return err;
+	}
 
 	v4l2_info(sd, "%s decoder driver registered !!\n", sd->name);
 
@@ -1473,6 +1489,7 @@ static int tvp7002_remove(struct i2c_client *client)
 	struct tvp7002_decoder *decoder = to_decoder(sd);
 
 	v4l2_device_unregister_subdev(sd);
+	v4l2_regcache_exit(decoder->regs);
 	kfree(decoder);
 	return 0;
 }
@@ -0,0 +1,487 @@
+/*
+ * v4l2-regcache.c
+ *
+ * Cached, batched register access for I2C video subdevices.
+ *
+ * Decoders, amplifiers and sensors are programmed with long lists of
+ * single register writes, most of which don't change anything after
+ * the first time.  This keeps a copy of every non-volatile register,
+ * drops writes of unchanged values, answers reads from the copy, and
+ * sends queued writes as one I2C transfer in which runs of consecutive
+ * registers become single auto-incrementing messages.
+ *
+ * Register addresses are one byte (at most 0xff); values are 8 or 16
+ * bits.  Chips with 16-bit register addresses are not supported.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/slab.h>
+#include <linux/i2c.h>
+#include <linux/mutex.h>
+#include <linux/bitops.h>
+#include <linux/delay.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+
+#include <media/v4l2-regcache.h>
+
+/* writes queued before they are flushed regardless of batching */
+#define V4L2_REGCACHE_QUEUE	64
+
+struct v4l2_regcache {
+	struct i2c_client *client;
+	const struct v4l2_regcache_config *config;
+	struct mutex lock;
+
+	u16 *vals;
+	unsigned long *valid;		/* vals[] matches the chip */
+
+	unsigned int batch;		/* batch_begin() nesting */
+	unsigned int nr_queued;
+	u8 queue_reg[V4L2_REGCACHE_QUEUE];
+	u16 queue_val[V4L2_REGCACHE_QUEUE];
+	struct i2c_msg msgs[V4L2_REGCACHE_QUEUE];
+	u8 buf[V4L2_REGCACHE_QUEUE * 3];
+
+	/* statistics */
+	unsigned long writes;
+	unsigned long skipped;
+	unsigned long transfers;
+	unsigned long messages;
+	unsigned long reads;
+	unsigned long hits;
+
+#ifdef CONFIG_DEBUG_FS
+	struct dentry *dir;
+#endif
+};
+
+static inline bool v4l2_regcache_volatile(struct v4l2_regcache *rc,
+		unsigned int reg)
+{
+	return rc->config->volatile_reg && rc->config->volatile_reg(reg);
+}
+
+static int v4l2_regcache_transfer(struct v4l2_regcache *rc,
+		struct i2c_msg *msgs, int num)
+{
+	int retry = 0;
+	int ret;
+
+	for (;;) {
+		ret = i2c_transfer(rc->client->adapter, msgs, num);
+		rc->transfers++;
+		if (ret == num)
+			return 0;
+		if (retry++ >= rc->config->retries)
+			return ret < 0 ? ret : -EIO;
+		dev_warn(&rc->client->dev, "transfer failed (%d), retry %d\n",
+				ret, retry);
+		msleep(10);
+	}
+}
+
+/*
+ * Send everything queued.  Queue order is kept, so strobes and indirect
+ * accesses written twice in a row stay separate; only a write to the
+ * register following the previous one joins that message.
+ */
+static int v4l2_regcache_flush(struct v4l2_regcache *rc)
+{
+	const struct v4l2_regcache_config *config = rc->config;
+	struct i2c_msg *msg = NULL;
+	unsigned int burst = 0;
+	unsigned int i;
+	u8 *p = rc->buf;
+	int num = 0;
+	int ret;
+
+	if (!rc->nr_queued)
+		return 0;
+
+	for (i = 0; i < rc->nr_queued; i++) {
+		unsigned int reg = rc->queue_reg[i];
+		unsigned int val = rc->queue_val[i];
+
+		if (!msg || burst >= config->max_burst ||
+				reg != rc->queue_reg[i - 1] + 1) {
+			msg = &rc->msgs[num++];
+			msg->addr = rc->client->addr;
+			msg->flags = rc->client->flags & I2C_M_TEN;
+			msg->buf = p;
+			msg->len = 1;
+			*p++ = reg;
+			burst = 0;
+		}
+		if (config->val_bytes == 2)
+			*p++ = val >> 8;
+		*p++ = val;
+		msg->len += config->val_bytes;
+		burst++;
+	}
+
+	rc->messages += num;
+	ret = v4l2_regcache_transfer(rc, rc->msgs, num);
+	if (ret) {
+		/* don't know what made it; read back or rewrite next time */
+		for (i = 0; i < rc->nr_queued; i++)
+			clear_bit(rc->queue_reg[i], rc->valid);
+		dev_err(&rc->client->dev, "write of %u registers failed (%d)\n",
+				rc->nr_queued, ret);
+	}
+	rc->nr_queued = 0;
+	return ret;
+}
+
+/**
+ * v4l2_regcache_write - write a register through the cache
+ * @rc: register cache
+ * @reg: register address
+ * @val: new value
+ *
+ * Writes of the value a non-volatile register already holds are
+ * dropped.  Outside a batch the write is sent before returning;
+ * inside one, errors show up when the batch ends.
+ */
+int v4l2_regcache_write(struct v4l2_regcache *rc, unsigned int reg,
+		unsigned int val)
+{
+	int ret = 0;
+
+	if (reg > rc->config->max_reg)
+		return -EINVAL;
+
+	mutex_lock(&rc->lock);
+	rc->writes++;
+
+	if (!v4l2_regcache_volatile(rc, reg)) {
+		if (test_bit(reg, rc->valid) && rc->vals[reg] == val) {
+			rc->skipped++;
+			goto out;
+		}
+		rc->vals[reg] = val;
+		set_bit(reg, rc->valid);
+	}
+
+	if (rc->nr_queued == V4L2_REGCACHE_QUEUE) {
+		ret = v4l2_regcache_flush(rc);
+		if (ret) {
+			clear_bit(reg, rc->valid);
+			goto out;
+		}
+	}
+	rc->queue_reg[rc->nr_queued] = reg;
+	rc->queue_val[rc->nr_queued] = val;
+	rc->nr_queued++;
+
+	if (!rc->batch)
+		ret = v4l2_regcache_flush(rc);
+out:
+	mutex_unlock(&rc->lock);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(v4l2_regcache_write);
+
+static int v4l2_regcache_hw_read(struct v4l2_regcache *rc, unsigned int reg,
+		unsigned int *val)
+{
+	struct i2c_msg msgs[2];
+	u8 *buf = rc->buf;
+	int ret;
+
+	buf[0] = reg;
+	msgs[0].addr = rc->client->addr;
+	msgs[0].flags = rc->client->flags & I2C_M_TEN;
+	msgs[0].len = 1;
+	msgs[0].buf = buf;
+	msgs[1].addr = rc->client->addr;
+	msgs[1].flags = (rc->client->flags & I2C_M_TEN) | I2C_M_RD;
+	msgs[1].len = rc->config->val_bytes;
+	msgs[1].buf = buf + 1;
+
+	ret = v4l2_regcache_transfer(rc, msgs, 2);
+	if (ret)
+		return ret;
+
+	if (rc->config->val_bytes == 2)
+		*val = buf[1] << 8 | buf[2];
+	else
+		*val = buf[1];
+	return 0;
+}
+
+/**
+ * v4l2_regcache_read - read a register through the cache
+ * @rc: register cache
+ * @reg: register address
+ * @val: where to store the value
+ *
+ * Non-volatile registers are read from the chip only the first time.
+ * Pending batched writes are sent before the chip is read.
+ */
+int v4l2_regcache_read(struct v4l2_regcache *rc, unsigned int reg,
+		unsigned int *val)
+{
+	bool cacheable;
+	int ret;
+
+	if (reg > rc->config->max_reg)
+		return -EINVAL;
+
+	mutex_lock(&rc->lock);
+	rc->reads++;
+
+	cacheable = !v4l2_regcache_volatile(rc, reg);
+	if (cacheable && test_bit(reg, rc->valid)) {
+		*val = rc->vals[reg];
+		rc->hits++;
+		ret = 0;
+		goto out;
+	}
+
+	ret = v4l2_regcache_flush(rc);
+	if (ret)
+		goto out;
+
+	ret = v4l2_regcache_hw_read(rc, reg, val);
+	if (!ret && cacheable) {
+		rc->vals[reg] = *val;
+		set_bit(reg, rc->valid);
+	}
+out:
+	mutex_unlock(&rc->lock);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(v4l2_regcache_read);
+
+/**
+ * v4l2_regcache_update_bits - read-modify-write a register
+ * @rc: register cache
+ * @reg: register address
+ * @mask: bits to change
+ * @val: new value of those bits
+ */
+int v4l2_regcache_update_bits(struct v4l2_regcache *rc, unsigned int reg,
+		unsigned int mask, unsigned int val)
+{
+	unsigned int old;
+	int ret;
+
+	ret = v4l2_regcache_read(rc, reg, &old);
+	if (ret)
+		return ret;
+
+	return v4l2_regcache_write(rc, reg, (old & ~mask) | (val & mask));
+}
+EXPORT_SYMBOL_GPL(v4l2_regcache_update_bits);
+
+void v4l2_regcache_batch_begin(struct v4l2_regcache *rc)
+{
+	mutex_lock(&rc->lock);
+	rc->batch++;
+	mutex_unlock(&rc->lock);
+}
+EXPORT_SYMBOL_GPL(v4l2_regcache_batch_begin);
+
+int v4l2_regcache_batch_end(struct v4l2_regcache *rc)
+{
+	int ret = 0;
+
+	mutex_lock(&rc->lock);
+	if (!WARN_ON(!rc->batch) && !--rc->batch)
+		ret = v4l2_regcache_flush(rc);
+	mutex_unlock(&rc->lock);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(v4l2_regcache_batch_end);
+
+void v4l2_regcache_invalidate(struct v4l2_regcache *rc)
+{
+	mutex_lock(&rc->lock);
+	bitmap_zero(rc->valid, rc->config->max_reg + 1);
+	mutex_unlock(&rc->lock);
+}
+EXPORT_SYMBOL_GPL(v4l2_regcache_invalidate);
+
+#ifdef CONFIG_DEBUG_FS
+
+static struct dentry *v4l2_regcache_root;
+
+static int v4l2_regcache_regs_show(struct seq_file *s, void *unused)
+{
+	struct v4l2_regcache *rc = s->private;
+	unsigned int reg;
+
+	mutex_lock(&rc->lock);
+	for (reg = 0; reg <= rc->config->max_reg; reg++) {
+		if (!test_bit(reg, rc->valid))
+			continue;
+		seq_printf(s, "%02x: %0*x\n", reg, rc->config->val_bytes * 2,
+				rc->vals[reg]);
+	}
+	mutex_unlock(&rc->lock);
+	return 0;
+}
+
+static int v4l2_regcache_regs_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, v4l2_regcache_regs_show, inode->i_private);
+}
+
+static const struct file_operations v4l2_regcache_regs_fops = {
+	.owner		= THIS_MODULE,
+	.open		= v4l2_regcache_regs_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int v4l2_regcache_stats_show(struct seq_file *s, void *unused)
+{
+	struct v4l2_regcache *rc = s->private;
+
+	mutex_lock(&rc->lock);
+	seq_printf(s, "writes:    %lu\n", rc->writes);
+	seq_printf(s, "skipped:   %lu\n", rc->skipped);
+	seq_printf(s, "reads:     %lu\n", rc->reads);
+	seq_printf(s, "hits:      %lu\n", rc->hits);
+	seq_printf(s, "transfers: %lu\n", rc->transfers);
+	seq_printf(s, "messages:  %lu\n", rc->messages);
+	mutex_unlock(&rc->lock);
+	return 0;
+}
+
+static int v4l2_regcache_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, v4l2_regcache_stats_show, inode->i_private);
+}
+
+static const struct file_operations v4l2_regcache_stats_fops = {
+	.owner		= THIS_MODULE,
+	.open		= v4l2_regcache_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void v4l2_regcache_debugfs_init(struct v4l2_regcache *rc)
+{
+	if (!v4l2_regcache_root)
+		return;
+
+	/* <debugfs>/v4l2-regcache/<bus>-<addr>/{registers,stats} */
+	rc->dir = debugfs_create_dir(dev_name(&rc->client->dev),
+			v4l2_regcache_root);
+	if (!rc->dir)
+		return;
+	debugfs_create_file("registers", S_IRUGO, rc->dir, rc,
+			&v4l2_regcache_regs_fops);
+	debugfs_create_file("stats", S_IRUGO, rc->dir, rc,
+			&v4l2_regcache_stats_fops);
+}
+
+static void v4l2_regcache_debugfs_exit(struct v4l2_regcache *rc)
+{
+	debugfs_remove_recursive(rc->dir);
+}
+
+#else
+
+static inline void v4l2_regcache_debugfs_init(struct v4l2_regcache *rc)
+{
+}
+
+static inline void v4l2_regcache_debugfs_exit(struct v4l2_regcache *rc)
+{
+}
+
+#endif /* CONFIG_DEBUG_FS */
+
+/**
+ * v4l2_regcache_init - set up a register cache for an I2C client
+ * @client: the chip
+ * @config: register map description; must outlive the cache
+ *
+ * The cache starts out empty:  registers are read from the chip on
+ * first use, and every register's first write goes out.
+ *
+ * Returns the cache, or NULL if out of memory.
+ */
+struct v4l2_regcache *v4l2_regcache_init(struct i2c_client *client,
+		const struct v4l2_regcache_config *config)
+{
+	struct v4l2_regcache *rc;
+	unsigned int nregs = config->max_reg + 1;
+
+	if (WARN_ON(config->max_reg > 0xff ||
+			config->val_bytes < 1 || config->val_bytes > 2))
+		return NULL;
+
+	rc = kzalloc(sizeof(*rc), GFP_KERNEL);
+	if (!rc)
+		return NULL;
+
+	rc->vals = kcalloc(nregs, sizeof(*rc->vals), GFP_KERNEL);
+	rc->valid = kcalloc(BITS_TO_LONGS(nregs), sizeof(long), GFP_KERNEL);
+	if (!rc->vals || !rc->valid) {
+		kfree(rc->valid);
+		kfree(rc->vals);
+		kfree(rc);
+		return NULL;
+	}
+
+	rc->client = client;
+	rc->config = config;
+	mutex_init(&rc->lock);
+
+	v4l2_regcache_debugfs_init(rc);
+
+	return rc;
+}
+EXPORT_SYMBOL_GPL(v4l2_regcache_init);
+
+void v4l2_regcache_exit(struct v4l2_regcache *rc)
+{
+	if (!rc)
+		return;
+
+	WARN_ON(rc->batch);
+	v4l2_regcache_debugfs_exit(rc);
+	kfree(rc->valid);
+	kfree(rc->vals);
+	kfree(rc);
+}
+EXPORT_SYMBOL_GPL(v4l2_regcache_exit);
+
+static int __init v4l2_regcache_module_init(void)
+{
+#ifdef CONFIG_DEBUG_FS
+	v4l2_regcache_root = debugfs_create_dir("v4l2-regcache", NULL);
+	if (IS_ERR(v4l2_regcache_root))
+		v4l2_regcache_root = NULL;
+#endif
+	return 0;
+}
+
+static void __exit v4l2_regcache_module_exit(void)
+{
+#ifdef CONFIG_DEBUG_FS
+	debugfs_remove_recursive(v4l2_regcache_root);
+#endif
+}
+
+module_init(v4l2_regcache_module_init);
+module_exit(v4l2_regcache_module_exit);
+
+MODULE_DESCRIPTION("Cached, batched register access for V4L2 I2C subdevices");
+MODULE_LICENSE("GPL");
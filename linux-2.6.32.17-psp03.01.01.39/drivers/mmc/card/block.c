@@ -51,6 +51,15 @@ MODULE_ALIAS("mmc:block");
 
 static DECLARE_BITMAP(dev_use, MMC_NUM_MINORS);
 
+struct mmc_blk_request {
+	struct mmc_request	mrq;
+	struct mmc_command	sbc;		/* CMD23, before cmd */
+	struct mmc_command	pre_erase;	/* ACMD23, before cmd */
+	struct mmc_command	cmd;
+	struct mmc_command	stop;
+	struct mmc_data		data;
+};
+
 /*
  * There is one mmc_blk_data per slot.
  */
@@ -61,6 +70,11 @@ struct mmc_blk_data {
 
 	unsigned int	usage;
 	unsigned int	read_only;
+	unsigned int	block_count_hints;	/* use CMD23/ACMD23 */
+
+	/* request prepared while the previous one was transferred */
+	struct request		*prep_req;
+	struct mmc_blk_request	prep_brq;
 };
 
 static DEFINE_MUTEX(open_lock);
@@ -144,13 +158,6 @@ static const struct block_device_operations mmc_bdops = {
 	.owner			= THIS_MODULE,
 };
 
-struct mmc_blk_request {
-	struct mmc_request	mrq;
-	struct mmc_command	cmd;
-	struct mmc_command	stop;
-	struct mmc_data		data;
-};
-
 static u32 mmc_sd_num_wr_blocks(struct mmc_card *card)
 {
 	int err;
@@ -241,102 +248,199 @@ static u32 get_card_status(struct mmc_card *card, struct request *req)
 	return cmd.resp[0];
 }
 
+/*
+ * Closed-ended transfers need CMD23 support from both the card (MMC 3.1,
+ * or SD cards announcing it in the SCR) and the host.
+ */
+static int mmc_blk_cmd23_supported(struct mmc_card *card)
+{
+	if (!(card->host->caps & MMC_CAP_CMD23) || mmc_host_is_spi(card->host))
+		return 0;
+
+	if (mmc_card_mmc(card))
+		return card->csd.mmca_vsn >= CSD_SPEC_VER_3;
+	if (mmc_card_sd(card))
+		return card->scr.cmds & SD_SCR_CMD23_SUPPORT;
+
+	return 0;
+}
+
+/*
+ * Build the read/write request for (the first part of) @req.  With
+ * @ahead set, @req is the request fetched by mmc_queue_fetch_next() and
+ * its data is mapped into the queue's second sg list.
+ */
+static void mmc_blk_prep_brq(struct mmc_queue *mq, struct request *req,
+	struct mmc_blk_request *brq, int disable_multi, int ahead)
+{
+	struct mmc_blk_data *md = mq->data;
+	struct mmc_card *card = mq->card;
+	u32 readcmd, writecmd;
+
+	memset(brq, 0, sizeof(struct mmc_blk_request));
+	brq->mrq.cmd = &brq->cmd;
+	brq->mrq.data = &brq->data;
+
+	brq->cmd.arg = blk_rq_pos(req);
+	if (!mmc_card_blockaddr(card))
+		brq->cmd.arg <<= 9;
+	brq->cmd.flags = MMC_RSP_SPI_R1 | MMC_RSP_R1 | MMC_CMD_ADTC;
+	brq->data.blksz = 512;
+	brq->stop.opcode = MMC_STOP_TRANSMISSION;
+	brq->stop.arg = 0;
+	brq->stop.flags = MMC_RSP_SPI_R1B | MMC_RSP_R1B | MMC_CMD_AC;
+	brq->data.blocks = blk_rq_sectors(req);
+
+	/*
+	 * The block layer doesn't support all sector count
+	 * restrictions, so we need to be prepared for too big
+	 * requests.
+	 */
+	if (brq->data.blocks > card->host->max_blk_count)
+		brq->data.blocks = card->host->max_blk_count;
+
+	/*
+	 * After a read error, we redo the request one sector at a time
+	 * in order to accurately determine which sectors can be read
+	 * successfully.
+	 */
+	if (disable_multi && brq->data.blocks > 1)
+		brq->data.blocks = 1;
+
+	if (brq->data.blocks > 1) {
+		/* SPI multiblock writes terminate using a special
+		 * token, not a STOP_TRANSMISSION request.
+		 */
+		if (!mmc_host_is_spi(card->host)
+				|| rq_data_dir(req) == READ)
+			brq->mrq.stop = &brq->stop;
+		readcmd = MMC_READ_MULTIPLE_BLOCK;
+		writecmd = MMC_WRITE_MULTIPLE_BLOCK;
+	} else {
+		brq->mrq.stop = NULL;
+		readcmd = MMC_READ_SINGLE_BLOCK;
+		writecmd = MMC_WRITE_BLOCK;
+	}
+
+	if (rq_data_dir(req) == READ) {
+		brq->cmd.opcode = readcmd;
+		brq->data.flags |= MMC_DATA_READ;
+	} else {
+		brq->cmd.opcode = writecmd;
+		brq->data.flags |= MMC_DATA_WRITE;
+	}
+
+	/*
+	 * Tell the card how many blocks follow: CMD23 makes the transfer
+	 * closed-ended (no STOP_TRANSMISSION), while SD cards without it
+	 * still accept ACMD23 to pre-erase before a multiblock write.
+	 */
+	if (brq->mrq.stop && md->block_count_hints) {
+		if (mmc_blk_cmd23_supported(card)) {
+			brq->sbc.opcode = MMC_SET_BLOCK_COUNT;
+			brq->sbc.arg = brq->data.blocks;
+			brq->sbc.flags = MMC_RSP_R1 | MMC_CMD_AC;
+			brq->mrq.stop = NULL;
+		} else if (mmc_card_sd(card) && rq_data_dir(req) != READ) {
+			brq->pre_erase.opcode = SD_APP_SET_WR_BLK_ERASE_COUNT;
+			brq->pre_erase.arg = brq->data.blocks;
+			brq->pre_erase.flags = MMC_RSP_R1 | MMC_CMD_AC;
+		}
+	}
+
+	mmc_set_data_timeout(&brq->data, card);
+
+	if (ahead) {
+		brq->data.sg = mq->next_sg;
+		brq->data.sg_len = mmc_queue_map_next_sg(mq);
+	} else {
+		brq->data.sg = mq->sg;
+		brq->data.sg_len = mmc_queue_map_sg(mq);
+	}
+
+	/*
+	 * Adjust the sg list so it is the same size as the
+	 * request.
+	 */
+	if (brq->data.blocks != blk_rq_sectors(req)) {
+		int i, data_size = brq->data.blocks << 9;
+		struct scatterlist *sg;
+
+		for_each_sg(brq->data.sg, sg, brq->data.sg_len, i) {
+			data_size -= sg->length;
+			if (data_size <= 0) {
+				sg->length += data_size;
+				i++;
+				break;
+			}
+		}
+		brq->data.sg_len = i;
+	}
+}
+
 static int mmc_blk_issue_rq(struct mmc_queue *mq, struct request *req)
 {
 	struct mmc_blk_data *md = mq->data;
 	struct mmc_card *card = md->queue.card;
 	struct mmc_blk_request brq;
 	int ret = 1, disable_multi = 0;
+	struct completion done;
 
 	mmc_claim_host(card->host);
 
 	do {
 		struct mmc_command cmd;
-		u32 readcmd, writecmd, status = 0;
-
-		memset(&brq, 0, sizeof(struct mmc_blk_request));
-		brq.mrq.cmd = &brq.cmd;
-		brq.mrq.data = &brq.data;
-
-		brq.cmd.arg = blk_rq_pos(req);
-		if (!mmc_card_blockaddr(card))
-			brq.cmd.arg <<= 9;
-		brq.cmd.flags = MMC_RSP_SPI_R1 | MMC_RSP_R1 | MMC_CMD_ADTC;
-		brq.data.blksz = 512;
-		brq.stop.opcode = MMC_STOP_TRANSMISSION;
-		brq.stop.arg = 0;
-		brq.stop.flags = MMC_RSP_SPI_R1B | MMC_RSP_R1B | MMC_CMD_AC;
-		brq.data.blocks = blk_rq_sectors(req);
-
-		/*
-		 * The block layer doesn't support all sector count
-		 * restrictions, so we need to be prepared for too big
-		 * requests.
-		 */
-		if (brq.data.blocks > card->host->max_blk_count)
-			brq.data.blocks = card->host->max_blk_count;
-
-		/*
-		 * After a read error, we redo the request one sector at a time
-		 * in order to accurately determine which sectors can be read
-		 * successfully.
-		 */
-		if (disable_multi && brq.data.blocks > 1)
-			brq.data.blocks = 1;
-
-		if (brq.data.blocks > 1) {
-			/* SPI multiblock writes terminate using a special
-			 * token, not a STOP_TRANSMISSION request.
-			 */
-			if (!mmc_host_is_spi(card->host)
-					|| rq_data_dir(req) == READ)
+		u32 status = 0;
+
+		if (req == md->prep_req) {
+			/* mapped while the previous request was running */
+			brq = md->prep_brq;
+			brq.mrq.cmd = &brq.cmd;
+			brq.mrq.data = &brq.data;
+			if (brq.mrq.stop)
 				brq.mrq.stop = &brq.stop;
-			readcmd = MMC_READ_MULTIPLE_BLOCK;
-			writecmd = MMC_WRITE_MULTIPLE_BLOCK;
-		} else {
-			brq.mrq.stop = NULL;
-			readcmd = MMC_READ_SINGLE_BLOCK;
-			writecmd = MMC_WRITE_BLOCK;
+			md->prep_req = NULL;
+		} else
+			mmc_blk_prep_brq(mq, req, &brq, disable_multi, 0);
+
+		if (brq.sbc.opcode &&
+				mmc_wait_for_cmd(card->host, &brq.sbc, 0)) {
+			/* fall back to an open-ended transfer */
+			brq.sbc.opcode = 0;
+			brq.mrq.stop = &brq.stop;
 		}
 
-		if (rq_data_dir(req) == READ) {
-			brq.cmd.opcode = readcmd;
-			brq.data.flags |= MMC_DATA_READ;
-		} else {
-			brq.cmd.opcode = writecmd;
-			brq.data.flags |= MMC_DATA_WRITE;
-		}
+		/* only a hint, the write works without it */
+		if (brq.pre_erase.opcode)
+			mmc_wait_for_app_cmd(card->host, card, &brq.pre_erase, 0);
 
-		mmc_set_data_timeout(&brq.data, card);
+		mmc_queue_bounce_pre(mq);
 
-		brq.data.sg = mq->sg;
-		brq.data.sg_len = mmc_queue_map_sg(mq);
+		init_completion(&done);
+		mmc_start_req(card->host, &brq.mrq, &done);
 
 		/*
-		 * Adjust the sg list so it is the same size as the
-		 * request.
+		 * Keep the card busy: map the next request and let the
+		 * host build its DMA descriptors while this one runs.
 		 */
-		if (brq.data.blocks != blk_rq_sectors(req)) {
-			int i, data_size = brq.data.blocks << 9;
-			struct scatterlist *sg;
-
-			for_each_sg(brq.data.sg, sg, brq.data.sg_len, i) {
-				data_size -= sg->length;
-				if (data_size <= 0) {
-					sg->length += data_size;
-					i++;
-					break;
-				}
-			}
-			brq.data.sg_len = i;
+		if (!md->prep_req && !disable_multi &&
+				mmc_queue_fetch_next(mq)) {
+			mmc_blk_prep_brq(mq, mq->next_req, &md->prep_brq, 0, 1);
+			md->prep_req = mq->next_req;
+			mmc_pre_req(card->host, &md->prep_brq.mrq);
 		}
 
-		mmc_queue_bounce_pre(mq);
-
-		mmc_wait_for_req(card->host, &brq.mrq);
+		wait_for_completion(&done);
 
 		mmc_queue_bounce_post(mq);
 
+		/*
+		 * A closed-ended transfer that failed part way leaves the
+		 * card in the data state; stop it explicitly.
+		 */
+		if (brq.sbc.opcode && (brq.cmd.error || brq.data.error))
+			mmc_wait_for_cmd(card->host, &brq.stop, 0);
+
 		/*
 		 * Check for errors here, but don't jump to cmd_err
 		 * until later as we need to wait for the card to leave
@@ -588,6 +692,47 @@ mmc_blk_set_blksize(struct mmc_blk_data *md, struct mmc_card *card)
 	return 0;
 }
 
+static ssize_t mmc_blk_hints_show(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	struct mmc_blk_data *md = mmc_blk_get(dev_to_disk(dev));
+	ssize_t ret;
+
+	if (!md)
+		return -ENODEV;
+
+	ret = sprintf(buf, "%u\n", md->block_count_hints);
+	mmc_blk_put(md);
+
+	return ret;
+}
+
+static ssize_t mmc_blk_hints_store(struct device *dev,
+	struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct mmc_blk_data *md;
+	unsigned long val;
+
+	if (strict_strtoul(buf, 0, &val))
+		return -EINVAL;
+
+	md = mmc_blk_get(dev_to_disk(dev));
+	if (!md)
+		return -ENODEV;
+
+	md->block_count_hints = !!val;
+	mmc_blk_put(md);
+
+	return count;
+}
+
+/*
+ * block_count_hints: announce the length of multiblock transfers to the
+ * card (CMD23, or ACMD23 pre-erase on SD writes).  On by default.
+ */
+static DEVICE_ATTR(block_count_hints, S_IRUGO | S_IWUSR,
+	mmc_blk_hints_show, mmc_blk_hints_store);
+
 static int mmc_blk_probe(struct mmc_card *card)
 {
 	struct mmc_blk_data *md;
@@ -615,8 +760,16 @@ static int mmc_blk_probe(struct mmc_card *card)
 		md->disk->disk_name, mmc_card_id(card), mmc_card_name(card),
 		cap_str, md->read_only ? "(ro)" : "");
 
+	md->block_count_hints = 1;
+
 	mmc_set_drvdata(card, md);
 	add_disk(md->disk);
+
+	if (device_create_file(disk_to_dev(md->disk),
+			&dev_attr_block_count_hints))
+		printk(KERN_WARNING "%s: unable to create block_count_hints\n",
+			md->disk->disk_name);
+
 	return 0;
 
  out:
@@ -631,6 +784,9 @@ static void mmc_blk_remove(struct mmc_card *card)
 	struct mmc_blk_data *md = mmc_get_drvdata(card);
 
 	if (md) {
+		device_remove_file(disk_to_dev(md->disk),
+			&dev_attr_block_count_hints);
+
 		/* Stop new requests from getting into the queue */
 		del_gendisk(md->disk);
 
@@ -54,7 +54,12 @@ static int mmc_queue_thread(void *d)
 
 		spin_lock_irq(q->queue_lock);
 		set_current_state(TASK_INTERRUPTIBLE);
-		if (!blk_queue_plugged(q))
+		if (mq->next_req) {
+			/* fetched and mapped while the last request ran */
+			req = mq->next_req;
+			mq->next_req = NULL;
+			swap(mq->sg, mq->next_sg);
+		} else if (!blk_queue_plugged(q))
 			req = blk_fetch_request(q);
 		mq->req = req;
 		spin_unlock_irq(q->queue_lock);
@@ -125,6 +130,7 @@ int mmc_init_queue(struct mmc_queue *mq, struct mmc_card *card, spinlock_t *lock
 
 	mq->queue->queuedata = mq;
 	mq->req = NULL;
+	mq->next_req = NULL;
 
 	blk_queue_prep_rq(mq->queue, mmc_prep_request);
 	blk_queue_ordered(mq->queue, QUEUE_ORDERED_DRAIN, NULL);
@@ -193,6 +199,21 @@ int mmc_init_queue(struct mmc_queue *mq, struct mmc_card *card, spinlock_t *lock
 			goto cleanup_queue;
 		}
 		sg_init_table(mq->sg, host->max_phys_segs);
+
+		/*
+		 * Hosts that can prepare a request ahead of time get a
+		 * second sg list, so the next request can be mapped while
+		 * the current one is being transferred.
+		 */
+		if (host->ops->pre_req) {
+			mq->next_sg = kmalloc(sizeof(struct scatterlist) *
+				host->max_phys_segs, GFP_KERNEL);
+			if (!mq->next_sg) {
+				ret = -ENOMEM;
+				goto cleanup_queue;
+			}
+			sg_init_table(mq->next_sg, host->max_phys_segs);
+		}
 	}
 
 	init_MUTEX(&mq->thread_sem);
@@ -212,6 +233,8 @@ int mmc_init_queue(struct mmc_queue *mq, struct mmc_card *card, spinlock_t *lock
  	if (mq->sg)
 		kfree(mq->sg);
 	mq->sg = NULL;
+	kfree(mq->next_sg);
+	mq->next_sg = NULL;
 	if (mq->bounce_buf)
 		kfree(mq->bounce_buf);
 	mq->bounce_buf = NULL;
@@ -243,6 +266,9 @@ void mmc_cleanup_queue(struct mmc_queue *mq)
 	kfree(mq->sg);
 	mq->sg = NULL;
 
+	kfree(mq->next_sg);
+	mq->next_sg = NULL;
+
 	if (mq->bounce_buf)
 		kfree(mq->bounce_buf);
 	mq->bounce_buf = NULL;
@@ -295,6 +321,36 @@ void mmc_queue_resume(struct mmc_queue *mq)
 	}
 }
 
+/*
+ * Take the request following mq->req off the queue while mq->req is
+ * still being processed, so that it can be prepared ahead of time.  The
+ * queue thread issues it next.  Only hosts with a next_sg list qualify.
+ */
+struct request *mmc_queue_fetch_next(struct mmc_queue *mq)
+{
+	struct request_queue *q = mq->queue;
+	struct request *req = NULL;
+
+	if (!mq->next_sg || mq->next_req)
+		return NULL;
+
+	spin_lock_irq(q->queue_lock);
+	if (!blk_queue_plugged(q))
+		req = blk_fetch_request(q);
+	mq->next_req = req;
+	spin_unlock_irq(q->queue_lock);
+
+	return req;
+}
+
+/*
+ * Prepare the sg list of the request fetched by mmc_queue_fetch_next()
+ */
+unsigned int mmc_queue_map_next_sg(struct mmc_queue *mq)
+{
+	return blk_rq_map_sg(mq->queue, mq->next_req, mq->next_sg);
+}
+
 /*
  * Prepare the sg list(s) to be handed of to the host driver
  */
@@ -194,15 +194,54 @@ void mmc_wait_for_req(struct mmc_host *host, struct mmc_request *mrq)
 {
 	DECLARE_COMPLETION_ONSTACK(complete);
 
-	mrq->done_data = &complete;
+	mmc_start_req(host, mrq, &complete);
+
+	wait_for_completion(&complete);
+}
+
+EXPORT_SYMBOL(mmc_wait_for_req);
+
+/**
+ *	mmc_start_req - start a request without waiting for it
+ *	@host: MMC host to start command
+ *	@mrq: MMC request to start
+ *	@complete: completion signalled when the request is done
+ *
+ *	Start a new MMC custom command request for a host and return
+ *	at once, leaving the caller free to prepare further work while
+ *	the request runs.  The caller must wait on @complete before
+ *	looking at the results or starting another request.
+ */
+void mmc_start_req(struct mmc_host *host, struct mmc_request *mrq,
+	struct completion *complete)
+{
+	mrq->done_data = complete;
 	mrq->done = mmc_wait_done;
 
 	mmc_start_request(host, mrq);
+}
 
-	wait_for_completion(&complete);
+EXPORT_SYMBOL(mmc_start_req);
+
+/**
+ *	mmc_pre_req - prepare a request ahead of starting it
+ *	@host: MMC host the request will be started on
+ *	@mrq: MMC request to prepare
+ *
+ *	Give the host driver a chance to map the data and build the DMA
+ *	descriptors of @mrq while the current request is still running,
+ *	so that @mrq can be started as soon as the current one is done.
+ *	@mrq must be the next request started on @host.
+ */
+void mmc_pre_req(struct mmc_host *host, struct mmc_request *mrq)
+{
+	WARN_ON(!host->claimed);
+
+	if (host->ops->pre_req && mrq->data)
+		host->ops->pre_req(host, mrq);
 }
 
-EXPORT_SYMBOL(mmc_wait_for_req);
+EXPORT_SYMBOL(mmc_pre_req);
 
 /**
  *	mmc_wait_for_cmd - start a command and wait for completion
@@ -32,6 +32,7 @@
 #include <linux/dma-mapping.h>
 #include <linux/mmc/mmc.h>
 #include <linux/mmc/card.h>
+#include <linux/cpufreq.h>
 
 #include <mach/mmc.h>
 #include <mach/edma.h>
@@ -177,6 +178,11 @@ static unsigned __initdata use_dma = 1;
 module_param(use_dma, uint, 0);
 MODULE_PARM_DESC(use_dma, "Whether to use DMA or not. Default = 1");
 
+static unsigned pio_threshold = 512;
+module_param(pio_threshold, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(pio_threshold,
+		"Transfers of up to this many bytes use PIO. Default = 512");
+
 struct mmc_davinci_host {
 	struct mmc_command *cmd;
 	struct mmc_data *data;
@@ -206,6 +212,13 @@ struct mmc_davinci_host {
 	bool do_dma;
 	u32 sdio_int;
 
+	/* PIO transfers run in the IRQ thread, with MMCIM cleared by the
+	 * hard IRQ handler and restored to im_val once the thread is done.
+	 * irq_status holds the (clear-on-read) MMCST0 bits for the thread.
+	 */
+	u32 im_val;
+	u32 irq_status;
+
 	/* Scatterlist DMA uses one or more parameter RAM entries:
 	 * the main one (associated with rxdma or txdma) plus zero or
 	 * more links.  The entries for a given transfer differ only
@@ -214,7 +227,20 @@ struct mmc_davinci_host {
 	struct edmacc_param	tx_template;
 	struct edmacc_param	rx_template;
 	unsigned		n_link;
-	u32			links[MAX_NR_SG - 1];
+	u32			links[2][MAX_NR_SG - 1];
+
+	/* Requests alternate between the two sets of links, so the next
+	 * request can be mapped and its PaRAM entries written (pre_req)
+	 * while the current transfer still runs from the other set.  The
+	 * first entry of a prepared chain is kept in next_head and copied
+	 * to the channel when the request is started.
+	 */
+	unsigned		cur_set;
+	unsigned		next_set;
+	unsigned		next_cookie;	/* 0: nothing prepared */
+	unsigned		cookie_seq;
+	unsigned		next_sg_len;
+	struct edmacc_param	next_head;
 
 	/* For PIO we walk scatterlists one segment at a time. */
 	unsigned int		sg_len;
@@ -226,6 +252,9 @@ struct mmc_davinci_host {
 	unsigned ns_in_one_cycle;
 	/* Number of sg segments */
 	u8 nr_sg;
+#ifdef CONFIG_CPU_FREQ
+	struct notifier_block	freq_transition;
+#endif
 };
 
 
@@ -385,6 +414,7 @@ static void mmc_davinci_start_command(struct mmc_davinci_host *host,
 
 	writel(cmd->arg, host->base + DAVINCI_MMCARGHL);
 	writel(cmd_reg,  host->base + DAVINCI_MMCCMD);
+	host->im_val = im_val;
 	writel(im_val, host->base + DAVINCI_MMCIM);
 }
 
@@ -499,24 +529,43 @@ static void __init mmc_davinci_dma_setup(struct mmc_davinci_host *host,
 	template->opt |= EDMA_CHAN_SLOT(sync_dev) << 12;
 }
 
-static void mmc_davinci_send_dma_request(struct mmc_davinci_host *host,
+/* DMA pays off for transfers longer than pio_threshold, and only when no
+ * partial FIFO reads or writes are needed; the rest goes through PIO.
+ */
+static bool mmc_davinci_want_dma(struct mmc_davinci_host *host,
+		struct mmc_data *data)
+{
+	unsigned bytes = data->blocks * data->blksz;
+
+	return host->use_dma && bytes > pio_threshold
+		&& (bytes & (rw_threshold - 1)) == 0;
+}
+
+/* Whether mmc_davinci_pre_req() already mapped @data and built its chain */
+static inline bool mmc_davinci_prepared(struct mmc_davinci_host *host,
 		struct mmc_data *data)
 {
-	struct edmacc_param	*template;
-	int			channel, slot;
+	return data->host_cookie && data->host_cookie == host->next_cookie;
+}
+
+/* Write the PaRAM entries for a mapped scatterlist into one set of
+ * links; the first entry is returned in head, to be copied into the
+ * channel's own PaRAM entry by mmc_davinci_start_dma().
+ */
+static void mmc_davinci_build_dma_chain(struct mmc_davinci_host *host,
+		struct mmc_data *data, unsigned sg_len, unsigned set,
+		struct edmacc_param *head)
+{
+	struct edmacc_param	param;
 	unsigned		link;
 	struct scatterlist	*sg;
-	unsigned		sg_len;
-	unsigned		bytes_left = host->bytes_left;
-	const unsigned		shift = ffs(rw_threshold) - 1;;
+	unsigned		bytes_left = data->blocks * data->blksz;
+	const unsigned		shift = ffs(rw_threshold) - 1;
 
-	if (host->data_dir == DAVINCI_MMC_DATADIR_WRITE) {
-		template = &host->tx_template;
-		channel = host->txdma;
-	} else {
-		template = &host->rx_template;
-		channel = host->rxdma;
-	}
+	if (data->flags & MMC_DATA_WRITE)
+		param = host->tx_template;
+	else
+		param = host->rx_template;
 
 	/* We know sg_len and ccnt will never be out of range because
 	 * we told the mmc layer which in turn tells the block layer
@@ -524,28 +573,44 @@ static void mmc_davinci_send_dma_request(struct mmc_davinci_host *host,
 	 * per EDMA PARAM entry.  Update the PARAM
 	 * entries needed for each segment of this scatterlist.
 	 */
-	for (slot = channel, link = 0, sg = data->sg, sg_len = host->sg_len;
+	for (link = 0, sg = data->sg;
 			sg_len-- != 0 && bytes_left;
-			sg = sg_next(sg), slot = host->links[link++]) {
+			sg = sg_next(sg), link++) {
 		u32		buf = sg_dma_address(sg);
 		unsigned	count = sg_dma_len(sg);
 
-		template->link_bcntrld = sg_len
-				? (EDMA_CHAN_SLOT(host->links[link]) << 5)
+		param.link_bcntrld = sg_len
+				? (EDMA_CHAN_SLOT(host->links[set][link]) << 5)
 				: 0xffff;
 
 		if (count > bytes_left)
 			count = bytes_left;
 		bytes_left -= count;
 
-		if (host->data_dir == DAVINCI_MMC_DATADIR_WRITE)
-			template->src = buf;
+		if (data->flags & MMC_DATA_WRITE)
+			param.src = buf;
 		else
-			template->dst = buf;
-		template->ccnt = count >> shift;
+			param.dst = buf;
+		param.ccnt = count >> shift;
 
-		edma_write_slot(slot, template);
+		if (link == 0)
+			*head = param;
+		else
+			edma_write_slot(host->links[set][link - 1], &param);
 	}
+}
+
+static void mmc_davinci_start_dma(struct mmc_davinci_host *host,
+		struct edmacc_param *head)
+{
+	int channel;
+
+	if (host->data_dir == DAVINCI_MMC_DATADIR_WRITE)
+		channel = host->txdma;
+	else
+		channel = host->rxdma;
+
+	edma_write_slot(channel, head);
 
 	if (host->version == MMC_CTLR_VERSION_2)
 		edma_clear_event(channel);
@@ -553,35 +618,91 @@ static void mmc_davinci_send_dma_request(struct mmc_davinci_host *host,
 	edma_start(channel);
 }
 
-static int mmc_davinci_start_dma_transfer(struct mmc_davinci_host *host,
+/* Returns the number of mapped segments, or -EINVAL if one of them would
+ * need a partial FIFO access.
+ */
+static int mmc_davinci_map_data(struct mmc_davinci_host *host,
 		struct mmc_data *data)
 {
-	int i;
+	int i, sg_len;
 	int mask = rw_threshold - 1;
 
-	host->sg_len = dma_map_sg(mmc_dev(host->mmc), data->sg, data->sg_len,
+	sg_len = dma_map_sg(mmc_dev(host->mmc), data->sg, data->sg_len,
 				((data->flags & MMC_DATA_WRITE)
 				? DMA_TO_DEVICE
 				: DMA_FROM_DEVICE));
 
 	/* no individual DMA segment should need a partial FIFO */
-	for (i = 0; i < host->sg_len; i++) {
+	for (i = 0; i < sg_len; i++) {
 		if (sg_dma_len(data->sg + i) & mask) {
 			dma_unmap_sg(mmc_dev(host->mmc),
 					data->sg, data->sg_len,
 					(data->flags & MMC_DATA_WRITE)
 					? DMA_TO_DEVICE
 					: DMA_FROM_DEVICE);
-			return -1;
+			return -EINVAL;
 		}
 	}
 
+	return sg_len;
+}
+
+static int mmc_davinci_start_dma_transfer(struct mmc_davinci_host *host,
+		struct mmc_data *data)
+{
+	struct edmacc_param head;
+	int sg_len;
+
+	/* mapped and built by mmc_davinci_pre_req() */
+	if (mmc_davinci_prepared(host, data)) {
+		host->next_cookie = 0;
+		host->sg_len = host->next_sg_len;
+		host->cur_set = host->next_set;
+		host->do_dma = 1;
+		mmc_davinci_start_dma(host, &host->next_head);
+		return 0;
+	}
+
+	sg_len = mmc_davinci_map_data(host, data);
+	if (sg_len < 0)
+		return sg_len;
+
+	host->sg_len = sg_len;
 	host->do_dma = 1;
-	mmc_davinci_send_dma_request(host, data);
+	mmc_davinci_build_dma_chain(host, data, sg_len, host->cur_set, &head);
+	mmc_davinci_start_dma(host, &head);
 
 	return 0;
 }
 
+static void mmc_davinci_pre_req(struct mmc_host *mmc, struct mmc_request *req)
+{
+	struct mmc_davinci_host *host = mmc_priv(mmc);
+	struct mmc_data *data = req->data;
+	int sg_len;
+
+	data->host_cookie = 0;
+
+	/* only one request is prepared ahead, and only for DMA */
+	if (host->next_cookie || !mmc_davinci_want_dma(host, data))
+		return;
+
+	sg_len = mmc_davinci_map_data(host, data);
+	if (sg_len < 0)
+		return;
+
+	/* the running transfer, if any, uses cur_set */
+	host->next_set = !host->cur_set;
+	host->next_sg_len = sg_len;
+	mmc_davinci_build_dma_chain(host, data, sg_len, host->next_set,
+			&host->next_head);
+
+	host->next_cookie = ++host->cookie_seq;
+	if (!host->next_cookie)
+		host->next_cookie = host->cookie_seq = 1;
+	data->host_cookie = host->next_cookie;
+}
+
 static void __init_or_module
 davinci_release_dma_channels(struct mmc_davinci_host *host)
 {
@@ -590,8 +711,10 @@ davinci_release_dma_channels(struct mmc_davinci_host *host)
 	if (!host->use_dma)
 		return;
 
-	for (i = 0; i < host->n_link; i++)
-		edma_free_slot(host->links[i]);
+	for (i = 0; i < host->n_link; i++) {
+		edma_free_slot(host->links[0][i]);
+		edma_free_slot(host->links[1][i]);
+	}
 
 	edma_free_channel(host->txdma);
 	edma_free_channel(host->rxdma);
@@ -610,6 +733,7 @@ static int __init davinci_acquire_dma_channels(struct mmc_davinci_host *host)
 				"tx", r);
 		return r;
 	}
+	edma_set_channel_class(r, EDMA_QOS_STORAGE);
 	mmc_davinci_dma_setup(host, true, &host->tx_template);
 
 	/* Acquire master DMA read channel */
@@ -620,12 +744,14 @@ static int __init davinci_acquire_dma_channels(struct mmc_davinci_host *host)
 				"rx", r);
 		goto free_master_write;
 	}
+	edma_set_channel_class(r, EDMA_QOS_STORAGE);
 	mmc_davinci_dma_setup(host, false, &host->rx_template);
 
 	/* Allocate parameter RAM slots, which will later be bound to a
-	 * channel as needed to handle a scatterlist.
+	 * channel as needed to handle a scatterlist.  Slots come in pairs,
+	 * one for each set of links.
 	 */
-	link_size = min_t(unsigned, host->nr_sg, ARRAY_SIZE(host->links));
+	link_size = min_t(unsigned, host->nr_sg, ARRAY_SIZE(host->links[0]));
 	for (i = 0; i < link_size; i++) {
 		r = edma_alloc_slot(EDMA_CTLR(host->txdma), EDMA_SLOT_ANY);
 		if (r < 0) {
@@ -633,7 +759,16 @@ static int __init davinci_acquire_dma_channels(struct mmc_davinci_host *host)
 				r);
 			break;
 		}
-		host->links[i] = r;
+		host->links[0][i] = r;
+
+		r = edma_alloc_slot(EDMA_CTLR(host->txdma), EDMA_SLOT_ANY);
+		if (r < 0) {
+			dev_dbg(mmc_dev(host->mmc), "dma PaRAM alloc --> %d\n",
+				r);
+			edma_free_slot(host->links[0][i]);
+			break;
+		}
+		host->links[1][i] = r;
 	}
 	host->n_link = i;
 
@@ -710,15 +845,17 @@ mmc_davinci_prepare_data(struct mmc_davinci_host *host, struct mmc_request *req)
 		}
 	}
 
-	/* For now we try to use DMA whenever we won't need partial FIFO
-	 * reads or writes, either for the whole transfer (as tested here)
-	 * or for any individual scatterlist segment (tested when we call
-	 * start_dma_transfer).
-	 *
-	 * While we *could* change that, unusual block sizes are rarely
-	 * used.  The occasional fallback to PIO should't hurt.
+	/* Use DMA for transfers above pio_threshold that won't need partial
+	 * FIFO reads or writes, either for the whole transfer (as tested
+	 * here) or for any individual scatterlist segment (tested when we
+	 * call start_dma_transfer).  Short transfers are cheaper in PIO
+	 * than mapping the buffers, and unusual block sizes are rarely
+	 * used.  PIO runs in the IRQ thread.  A request pre_req() prepared
+	 * goes by DMA regardless:  its buffers are mapped already, and
+	 * pio_threshold may have changed since.
 	 */
-	if (host->use_dma && (host->bytes_left & (rw_threshold - 1)) == 0
+	if ((mmc_davinci_prepared(host, data)
+				|| mmc_davinci_want_dma(host, data))
 			&& mmc_davinci_start_dma_transfer(host, data) == 0) {
 		/* zero this to ensure we take no PIO paths */
 		host->bytes_left = 0;
@@ -747,6 +884,14 @@ static void mmc_davinci_request(struct mmc_host *mmc, struct mmc_request *req)
 	}
 	if (mmcst1 & MMCST1_BUSY) {
 		dev_err(mmc_dev(host->mmc), "still BUSY? bad ... \n");
+		if (req->data && mmc_davinci_prepared(host, req->data)) {
+			dma_unmap_sg(mmc_dev(host->mmc), req->data->sg,
+				     req->data->sg_len,
+				     (req->data->flags & MMC_DATA_WRITE)
+				     ? DMA_TO_DEVICE
+				     : DMA_FROM_DEVICE);
+			host->next_cookie = 0;
+		}
 		req->cmd->error = -ETIMEDOUT;
 		mmc_request_done(mmc, req);
 		return;
@@ -958,24 +1103,14 @@ static irqreturn_t mmc_davinci_sdio_irq(int irq, void *dev_id)
 	return IRQ_HANDLED;
 }
 
-static irqreturn_t mmc_davinci_irq(int irq, void *dev_id)
+static void mmc_davinci_handle_status(struct mmc_davinci_host *host,
+		unsigned int status)
 {
-	struct mmc_davinci_host *host = (struct mmc_davinci_host *)dev_id;
-	unsigned int status, qstatus;
+	unsigned int qstatus;
 	int end_command = 0;
 	int end_transfer = 0;
 	struct mmc_data *data = host->data;
 
-	if (host->cmd == NULL && host->data == NULL) {
-		status = readl(host->base + DAVINCI_MMCST0);
-		dev_dbg(mmc_dev(host->mmc),
-			"Spurious interrupt 0x%04x\n", status);
-		/* Disable the interrupt from mmcsd */
-		writel(0, host->base + DAVINCI_MMCIM);
-		return IRQ_NONE;
-	}
-
-	status = readl(host->base + DAVINCI_MMCST0);
 	qstatus = status;
 
 	if (qstatus & MMCST0_ERR_MASK) {
@@ -1088,6 +1223,51 @@ end_cmd:
 end_data:
 	if (end_transfer)
 		mmc_davinci_xfer_done(host, data);
+}
+
+static irqreturn_t mmc_davinci_irq(int irq, void *dev_id)
+{
+	struct mmc_davinci_host *host = (struct mmc_davinci_host *)dev_id;
+	unsigned int status;
+
+	if (host->cmd == NULL && host->data == NULL) {
+		status = readl(host->base + DAVINCI_MMCST0);
+		dev_dbg(mmc_dev(host->mmc),
+			"Spurious interrupt 0x%04x\n", status);
+		/* Disable the interrupt from mmcsd */
+		writel(0, host->base + DAVINCI_MMCIM);
+		return IRQ_NONE;
+	}
+
+	status = readl(host->base + DAVINCI_MMCST0);
+
+	/* Leave PIO to the IRQ thread.  The AINTC is edge triggered, so
+	 * IRQF_ONESHOT can't hold the line off; mask at the controller.
+	 */
+	if (host->data && !host->do_dma) {
+		host->irq_status |= status;
+		writel(0, host->base + DAVINCI_MMCIM);
+		return IRQ_WAKE_THREAD;
+	}
+
+	mmc_davinci_handle_status(host, status);
+	return IRQ_HANDLED;
+}
+
+static irqreturn_t mmc_davinci_irq_thread(int irq, void *dev_id)
+{
+	struct mmc_davinci_host *host = (struct mmc_davinci_host *)dev_id;
+	unsigned int status;
+
+	status = host->irq_status;
+	host->irq_status = 0;
+
+	mmc_davinci_handle_status(host, status);
+
+	/* unmask again, unless the request is over */
+	if (host->cmd || host->data)
+		writel(host->im_val, host->base + DAVINCI_MMCIM);
+
 	return IRQ_HANDLED;
 }
 
@@ -1135,6 +1315,7 @@ static void mmc_davinci_enable_sdio_irq(struct mmc_host *mmc, int enable)
 }
 static struct mmc_host_ops mmc_davinci_ops = {
 	.request	= mmc_davinci_request,
+	.pre_req	= mmc_davinci_pre_req,
 	.set_ios	= mmc_davinci_set_ios,
 	.get_cd		= mmc_davinci_get_cd,
 	.get_ro		= mmc_davinci_get_ro,
@@ -1143,6 +1324,56 @@ static struct mmc_host_ops mmc_davinci_ops = {
 
 /*----------------------------------------------------------------------*/
 
+#ifdef CONFIG_CPU_FREQ
+static int mmc_davinci_cpufreq_transition(struct notifier_block *nb,
+				     unsigned long val, void *data)
+{
+	struct mmc_davinci_host *host;
+	struct mmc_host *mmc;
+	unsigned long rate;
+
+	host = container_of(nb, struct mmc_davinci_host, freq_transition);
+	mmc = host->mmc;
+	if (val != CPUFREQ_POSTCHANGE)
+		return 0;
+
+	/* only redo the clock divider if the module clock really moved */
+	rate = clk_get_rate(host->clk);
+	if (rate == host->mmc_input_clk)
+		return 0;
+
+	mmc_claim_host(mmc);
+	host->mmc_input_clk = rate;
+	mmc_davinci_set_ios(mmc, &mmc->ios);
+	mmc_release_host(mmc);
+
+	return 0;
+}
+
+static inline int mmc_davinci_cpufreq_register(struct mmc_davinci_host *host)
+{
+	host->freq_transition.notifier_call = mmc_davinci_cpufreq_transition;
+
+	return cpufreq_register_notifier(&host->freq_transition,
+					 CPUFREQ_TRANSITION_NOTIFIER);
+}
+
+static inline void mmc_davinci_cpufreq_deregister(struct mmc_davinci_host *host)
+{
+	cpufreq_unregister_notifier(&host->freq_transition,
+				    CPUFREQ_TRANSITION_NOTIFIER);
+}
+#else
+static inline int mmc_davinci_cpufreq_register(struct mmc_davinci_host *host)
+{
+	return 0;
+}
+
+static inline void mmc_davinci_cpufreq_deregister(struct mmc_davinci_host *host)
+{
+}
+#endif
+
 static void __init init_mmcsd_host(struct mmc_davinci_host *host)
 {
 	/* DAT line portion is diabled and in reset state */
@@ -1249,6 +1480,9 @@ static int __init davinci_mmcsd_probe(struct platform_device *pdev)
 	/* REVISIT:  someday, support IRQ-driven card detection.  */
 	mmc->caps |= MMC_CAP_NEEDS_POLL;
 
+	/* transfers without a stop command complete on DATDNE */
+	mmc->caps |= MMC_CAP_CMD23;
+
 	if (!pdata || pdata->wires == 4 || pdata->wires == 0)
 		mmc->caps |= MMC_CAP_4_BIT_DATA;
 
@@ -1286,14 +1520,20 @@ static int __init davinci_mmcsd_probe(struct platform_device *pdev)
 
 	platform_set_drvdata(pdev, host);
 
+	ret = mmc_davinci_cpufreq_register(host);
+	if (ret) {
+		dev_err(&pdev->dev, "failed to register cpufreq\n");
+		goto out;
+	}
+
 	ret = mmc_add_host(mmc);
 	if (ret < 0)
-		goto out;
+		goto out_cpufreq;
 
-	ret = request_irq(host->mmc_irq, mmc_davinci_irq, 0,
-		mmc_hostname(mmc), host);
+	ret = request_threaded_irq(host->mmc_irq, mmc_davinci_irq,
+		mmc_davinci_irq_thread, 0, mmc_hostname(mmc), host);
 	if (ret)
-		goto out;
+		goto out_remove_host;
 
 	if (host->sdio_irq > 0) {
 		ret = request_irq(host->sdio_irq,
@@ -1303,7 +1543,7 @@ static int __init davinci_mmcsd_probe(struct platform_device *pdev)
 			mmc->caps |= MMC_CAP_SDIO_IRQ;
 			host->sdio_int = 0;
 		} else
-			goto out;
+			goto out_free_irq;
 	}
 
 	rename_region(mem, mmc_hostname(mmc));
@@ -1314,6 +1554,12 @@ static int __init davinci_mmcsd_probe(struct platform_device *pdev)
 
 	return 0;
 
+out_free_irq:
+	free_irq(host->mmc_irq, host);
+out_remove_host:
+	mmc_remove_host(mmc);
+out_cpufreq:
+	mmc_davinci_cpufreq_deregister(host);
 out:
 	if (host) {
 		davinci_release_dma_channels(host);
@@ -1348,6 +1594,8 @@ static int __exit davinci_mmcsd_remove(struct platform_device *pdev)
 		writel((readl(host->base + DAVINCI_MMCCLK) & ~MMCCLK_CLKEN),
 				host->base + DAVINCI_MMCCLK);
 
+		mmc_davinci_cpufreq_deregister(host);
+
 		mmc_remove_host(host->mmc);
 
 		free_irq(host->mmc_irq, host);
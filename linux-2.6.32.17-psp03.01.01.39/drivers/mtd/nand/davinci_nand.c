@@ -30,11 +30,20 @@
 #include <linux/err.h>
 #include <linux/clk.h>
 #include <linux/io.h>
+#include <linux/mm.h>
+#include <linux/delay.h>
+#include <linux/hardirq.h>
+#include <linux/dma-mapping.h>
+#include <linux/completion.h>
+#include <linux/jiffies.h>
+#include <linux/mutex.h>
+#include <linux/sched.h>
 #include <linux/mtd/nand.h>
 #include <linux/mtd/partitions.h>
 
 #include <mach/nand.h>
 #include <mach/aemif.h>
+#include <mach/edma.h>
 
 #include <asm/mach-types.h>
 
@@ -62,12 +71,34 @@ struct davinci_nand_info {
 	bool			partitioned;
 
 	bool			is_readmode;
+	bool			ecc4_locked;	/* holds davinci_ecc4_lock */
+	bool			ecc4_stolen;	/* uses the engine without it */
+	int			ecc_mode;	/* of the running chunk, or -1 */
 
 	void __iomem		*base;
 	void __iomem		*vaddr;
 
+	/* EDMA for page data; dma_ch < 0 means PIO only */
+	uint32_t		phys_addr;
+	int			dma_ch;
+	bool			dma_err;
+	struct completion	dma_done;
+
 	uint32_t		ioaddr;
 	uint32_t		current_cs;
+	int			current_chip;
+
+	/* Large page chips:  which page sits in the page register, and
+	 * whether READ CACHE SEQUENTIAL is loading the one after it.
+	 */
+	void			(*cmdfunc)(struct mtd_info *mtd,
+					unsigned command, int column,
+					int page_addr);
+	bool			cache_read;
+	bool			cache_seq;
+	int			cache_chip;
+	int			cache_page;
+	int			column;		/* of the next data access */
 
 	uint32_t		mask_chipsel;
 	uint32_t		mask_ale;
@@ -78,8 +109,28 @@ struct davinci_nand_info {
 	struct davinci_aemif_timing	*timing;
 };
 
+/* davinci_nand_lock covers read-modify-write of the shared NANDFCR;
+ * davinci_ecc4_lock hands the single 4-bit ECC engine to one chipselect
+ * at a time, for one ECC chunk.  Everything else (erase, status, 1-bit
+ * ECC, raw and OOB access) runs concurrently on different chipselects.
+ */
 static DEFINE_SPINLOCK(davinci_nand_lock);
-static bool ecc4_busy;
+static DEFINE_MUTEX(davinci_ecc4_lock);
+
+static unsigned __initdata use_dma = 1;
+module_param(use_dma, uint, 0);
+MODULE_PARM_DESC(use_dma, "Whether to use DMA for page data. Default = 1");
+
+static unsigned __initdata cache_read = 1;
+module_param(cache_read, uint, 0);
+MODULE_PARM_DESC(cache_read,
+	"Use READ CACHE SEQUENTIAL where the chip supports it. Default = 1");
+
+/* Shorter transfers (spare area, status bytes) stay with PIO */
+#define NAND_DAVINCI_DMA_MIN	512
+
+/* Generous: a 4 KB page moves in well under a millisecond */
+#define NAND_DAVINCI_DMA_TIMEOUT	msecs_to_jiffies(100)
 
 #define to_davinci_nand(m) container_of(m, struct davinci_nand_info, mtd)
 
@@ -96,6 +147,16 @@ static inline void davinci_nand_writel(struct davinci_nand_info *info,
 	__raw_writel(value, info->base + offset);
 }
 
+/*
+ * Forget which page the page register holds, so the next READ0 really
+ * loads it from the array.  A read-ahead still running is closed by that
+ * READ0.
+ */
+static inline void nand_davinci_cache_invalidate(struct davinci_nand_info *info)
+{
+	info->cache_page = -1;
+}
+
 /*----------------------------------------------------------------------*/
 
 /*
@@ -123,11 +184,28 @@ static void nand_davinci_hwcontrol(struct mtd_info *mtd, int cmd,
 		iowrite8(cmd, nand->IO_ADDR_W);
 }
 
+static void nand_davinci_ecc4_unlock(struct davinci_nand_info *info);
+static void nand_davinci_cache_end(struct mtd_info *mtd);
+
 static void nand_davinci_select_chip(struct mtd_info *mtd, int chip)
 {
 	struct davinci_nand_info	*info = to_davinci_nand(mtd);
 	uint32_t			addr = info->ioaddr;
 
+	/* operation done; never keep the 4-bit ECC engine past it */
+	if (chip < 0)
+		nand_davinci_ecc4_unlock(info);
+
+	/* a cache read may stay open between operations, but only while
+	 * its chip is the one being used
+	 */
+	if (chip >= 0 && info->cache_seq && chip != info->cache_chip) {
+		nand_davinci_select_chip(mtd, info->cache_chip);
+		nand_davinci_cache_end(mtd);
+	}
+	if (chip >= 0)
+		info->current_chip = chip;
+
 	/* maybe kick in a second chipselect */
 	if (chip > 0)
 		addr |= info->mask_chipsel;
@@ -158,6 +236,7 @@ static void nand_davinci_hwctl_1bit(struct mtd_info *mtd, int mode)
 	unsigned long flags;
 
 	info = to_davinci_nand(mtd);
+	info->ecc_mode = mode;
 
 	/* Reset ECC hardware */
 	nand_davinci_readecc_1bit(mtd);
@@ -181,6 +260,8 @@ static int nand_davinci_calculate_1bit(struct mtd_info *mtd,
 	unsigned int ecc_val = nand_davinci_readecc_1bit(mtd);
 	unsigned int ecc24 = (ecc_val & 0x0fff) | ((ecc_val & 0x0fff0000) >> 4);
 
+	to_davinci_nand(mtd)->ecc_mode = -1;
+
 	/* invert so that erased block ecc is correct */
 	ecc24 = ~ecc24;
 	ecc_code[0] = (u_char)(ecc24);
@@ -190,7 +271,7 @@ static int nand_davinci_calculate_1bit(struct mtd_info *mtd,
 	return 0;
 }
 
-static int nand_davinci_correct_1bit(struct mtd_info *mtd, u_char *dat,
+static int __nand_davinci_correct_1bit(struct mtd_info *mtd, u_char *dat,
 				     u_char *read_ecc, u_char *calc_ecc)
 {
 	struct nand_chip *chip = mtd->priv;
@@ -222,6 +303,19 @@ static int nand_davinci_correct_1bit(struct mtd_info *mtd, u_char *dat,
 	return 0;
 }
 
+/* After an uncorrectable error the page must be read again from the array */
+static int nand_davinci_correct_1bit(struct mtd_info *mtd, u_char *dat,
+				     u_char *read_ecc, u_char *calc_ecc)
+{
+	int ret;
+
+	ret = __nand_davinci_correct_1bit(mtd, dat, read_ecc, calc_ecc);
+	if (ret < 0)
+		nand_davinci_cache_invalidate(to_davinci_nand(mtd));
+
+	return ret;
+}
+
 /*----------------------------------------------------------------------*/
 
 /*
@@ -236,12 +330,50 @@ static int nand_davinci_correct_1bit(struct mtd_info *mtd, u_char *dat,
  * OOB without recomputing ECC.
  */
 
+/*
+ * The engine is claimed when an ECC chunk starts (hwctl) and released once
+ * its result has been used:  after calculate() for writes, after correct()
+ * for reads, since correction works from the hardware state.
+ */
+static void nand_davinci_ecc4_lock(struct davinci_nand_info *info)
+{
+	if (info->ecc4_locked || info->ecc4_stolen)
+		return;
+
+	/*
+	 * Panic writes (mtdoops) can't sleep.  If the engine is busy then,
+	 * its owner is never going to run again, so just take it over.
+	 */
+	if (oops_in_progress) {
+		if (mutex_trylock(&davinci_ecc4_lock))
+			info->ecc4_locked = true;
+		else
+			info->ecc4_stolen = true;
+		return;
+	}
+
+	mutex_lock(&davinci_ecc4_lock);
+	info->ecc4_locked = true;
+}
+
+static void nand_davinci_ecc4_unlock(struct davinci_nand_info *info)
+{
+	info->ecc4_stolen = false;
+	if (info->ecc4_locked) {
+		info->ecc4_locked = false;
+		mutex_unlock(&davinci_ecc4_lock);
+	}
+}
+
 static void nand_davinci_hwctl_4bit(struct mtd_info *mtd, int mode)
 {
 	struct davinci_nand_info *info = to_davinci_nand(mtd);
 	unsigned long flags;
 	u32 val;
 
+	nand_davinci_ecc4_lock(info);
+	info->ecc_mode = mode;
+
 	spin_lock_irqsave(&davinci_nand_lock, flags);
 
 	/* Start 4-bit ECC calculation for read/write */
@@ -278,6 +410,8 @@ static int nand_davinci_calculate_4bit(struct mtd_info *mtd,
 	unsigned int ff_ecc_code[10] = {0x3f, 0x27, 0x56, 0xf5, 0x29, 0xd8, 0x61, 0xd9, 0x9d, 0x14};
 	unsigned i,j;
 
+	info->ecc_mode = -1;
+
 	/* After a read, terminate ECC calculation by a dummy read
 	 * of some 4-bit ECC register.  ECC covers everything that
 	 * was read; correct() just uses the hardware state, so
@@ -294,6 +428,8 @@ static int nand_davinci_calculate_4bit(struct mtd_info *mtd,
 	 * ROM boot loader uses this same packing scheme.
 	 */
 	nand_davinci_readecc_4bit(info, raw_ecc);
+	nand_davinci_ecc4_unlock(info);
+
 	for (i = 0, j = 0, p = raw_ecc; i < 2; i++, p += 2) {
 		buffer_ecc[j++] =   p[0]        & 0xff;
 		buffer_ecc[j++] = ((p[0] >>  8) & 0x03) | ((p[0] >> 14) & 0xfc);
@@ -332,7 +468,7 @@ finish:
 /* Correct up to 4 bits in data we just read, using state left in the
  * hardware plus the ecc_code computed when it was first written.
  */
-static int nand_davinci_correct_4bit(struct mtd_info *mtd,
+static int __nand_davinci_correct_4bit(struct mtd_info *mtd,
 		u_char *data, u_char *ecc_code, u_char *null)
 {
 	int i;
@@ -459,6 +595,19 @@ correct:
 	return corrected;
 }
 
+static int nand_davinci_correct_4bit(struct mtd_info *mtd,
+		u_char *data, u_char *ecc_code, u_char *null)
+{
+	int ret;
+
+	ret = __nand_davinci_correct_4bit(mtd, data, ecc_code, null);
+	nand_davinci_ecc4_unlock(to_davinci_nand(mtd));
+	if (ret < 0)
+		nand_davinci_cache_invalidate(to_davinci_nand(mtd));
+
+	return ret;
+}
+
 /*----------------------------------------------------------------------*/
 
 /*
@@ -470,10 +619,91 @@ correct:
  * the two LSBs for NAND access ... so we can issue 32-bit reads/writes
  * and have that transparently morphed into multiple NAND operations.
  */
-static void nand_davinci_read_buf(struct mtd_info *mtd, uint8_t *buf, int len)
+static void nand_davinci_dma_cb(unsigned channel, u16 ch_status, void *data)
 {
-	struct nand_chip *chip = mtd->priv;
+	struct davinci_nand_info *info = data;
+
+	info->dma_err = (ch_status != DMA_COMPLETE);
+	complete(&info->dma_done);
+}
+
+/*
+ * Page data (ECC chunks and whole pages) goes through EDMA.  The buffer
+ * must be directly mapped, since MTD users may hand us vmalloc memory,
+ * and word aligned for the 32-bit accesses described above.  Only large
+ * page chips qualify:  a failed transfer is repeated by PIO from its
+ * starting column, which takes RNDOUT or RNDIN.  Panic writes can't wait
+ * for the completion, so they use PIO too.
+ */
+static bool nand_davinci_can_dma(struct davinci_nand_info *info,
+		const uint8_t *buf, int len)
+{
+	return info->dma_ch >= 0 && info->cmdfunc && !oops_in_progress
+		&& len >= NAND_DAVINCI_DMA_MIN
+		&& (0x03 & ((unsigned)buf)) == 0 && (0x03 & len) == 0
+		&& virt_addr_valid(buf) && virt_addr_valid(buf + len - 1);
+}
+
+/*
+ * One AB-synchronized transfer of len/4 words.  The NAND data port is a
+ * fixed address (ALE and CLE are address lines), so only the memory side
+ * advances.
+ */
+static int nand_davinci_dma_xfer(struct davinci_nand_info *info,
+		void *buf, int len, bool is_write)
+{
+	struct nand_chip	*chip = &info->chip;
+	enum dma_data_direction	dir = is_write ? DMA_TO_DEVICE
+					       : DMA_FROM_DEVICE;
+	struct edmacc_param	param;
+	dma_addr_t		addr;
+	uint32_t		port;
+	int			ret = 0;
+
+	port = info->phys_addr
+		+ ((uint32_t __force)chip->IO_ADDR_R - info->ioaddr);
+	addr = dma_map_single(info->dev, buf, len, dir);
+
+	param.opt = TCINTEN | EDMA_TCC(EDMA_CHAN_SLOT(info->dma_ch)) | SYNCDIM;
+	if (is_write) {
+		param.src = addr;
+		param.dst = port;
+		param.src_dst_bidx = 4;
+	} else {
+		param.src = port;
+		param.dst = addr;
+		param.src_dst_bidx = 4 << 16;
+	}
+	param.a_b_cnt = (len >> 2) << 16 | 4;
+	param.link_bcntrld = 0xffff;
+	param.src_dst_cidx = 0;
+	param.ccnt = 1;
+	edma_write_slot(info->dma_ch, &param);
+
+	INIT_COMPLETION(info->dma_done);
+	edma_start(info->dma_ch);
+
+	if (!wait_for_completion_timeout(&info->dma_done,
+				NAND_DAVINCI_DMA_TIMEOUT)) {
+		edma_stop(info->dma_ch);
+		edma_clean_channel(info->dma_ch);
+		ret = -ETIMEDOUT;
+	} else if (info->dma_err) {
+		edma_clean_channel(info->dma_ch);
+		ret = -EIO;
+	}
+
+	dma_unmap_single(info->dev, addr, len, dir);
+
+	if (ret < 0)
+		dev_err(info->dev, "DMA %s of %d bytes failed, err %d\n",
+				is_write ? "write" : "read", len, ret);
+	return ret;
+}
 
+static void nand_davinci_pio_read(struct nand_chip *chip, uint8_t *buf,
+		int len)
+{
 	if ((0x03 & ((unsigned)buf)) == 0 && (0x03 & len) == 0)
 		ioread32_rep(chip->IO_ADDR_R, buf, len >> 2);
 	else if ((0x01 & ((unsigned)buf)) == 0 && (0x01 & len) == 0)
@@ -482,11 +712,9 @@ static void nand_davinci_read_buf(struct mtd_info *mtd, uint8_t *buf, int len)
 		ioread8_rep(chip->IO_ADDR_R, buf, len);
 }
 
-static void nand_davinci_write_buf(struct mtd_info *mtd,
+static void nand_davinci_pio_write(struct nand_chip *chip,
 		const uint8_t *buf, int len)
 {
-	struct nand_chip *chip = mtd->priv;
-
 	if ((0x03 & ((unsigned)buf)) == 0 && (0x03 & len) == 0)
 		iowrite32_rep(chip->IO_ADDR_R, buf, len >> 2);
 	else if ((0x01 & ((unsigned)buf)) == 0 && (0x01 & len) == 0)
@@ -495,6 +723,52 @@ static void nand_davinci_write_buf(struct mtd_info *mtd,
 		iowrite8_rep(chip->IO_ADDR_R, buf, len);
 }
 
+/*
+ * After a failed DMA the chip's column and the ECC engine have moved by
+ * an unknown amount.  Point the chip back at the start of the buffer and
+ * restart the ECC chunk, if one is running, so the PIO retry sees what
+ * the DMA should have.
+ */
+static void nand_davinci_dma_rewind(struct mtd_info *mtd, bool is_write)
+{
+	struct davinci_nand_info *info = to_davinci_nand(mtd);
+	struct nand_chip *chip = mtd->priv;
+
+	info->cmdfunc(mtd, is_write ? NAND_CMD_RNDIN : NAND_CMD_RNDOUT,
+			info->column, -1);
+	if (info->ecc_mode >= 0)
+		chip->ecc.hwctl(mtd, info->ecc_mode);
+}
+
+static void nand_davinci_read_buf(struct mtd_info *mtd, uint8_t *buf, int len)
+{
+	struct davinci_nand_info *info = to_davinci_nand(mtd);
+	struct nand_chip *chip = mtd->priv;
+
+	if (!nand_davinci_can_dma(info, buf, len))
+		nand_davinci_pio_read(chip, buf, len);
+	else if (nand_davinci_dma_xfer(info, buf, len, false) < 0) {
+		nand_davinci_dma_rewind(mtd, false);
+		nand_davinci_pio_read(chip, buf, len);
+	}
+	info->column += len;
+}
+
+static void nand_davinci_write_buf(struct mtd_info *mtd,
+		const uint8_t *buf, int len)
+{
+	struct davinci_nand_info *info = to_davinci_nand(mtd);
+	struct nand_chip *chip = mtd->priv;
+
+	if (!nand_davinci_can_dma(info, buf, len))
+		nand_davinci_pio_write(chip, buf, len);
+	else if (nand_davinci_dma_xfer(info, (void *)buf, len, true) < 0) {
+		nand_davinci_dma_rewind(mtd, true);
+		nand_davinci_pio_write(chip, buf, len);
+	}
+	info->column += len;
+}
+
 /*
  * Check hardware register for wait status. Returns 1 if device is ready,
  * 0 if it is still busy.
@@ -506,6 +780,248 @@ static int nand_davinci_dev_ready(struct mtd_info *mtd)
 	return davinci_nand_readl(info, NANDFSR_OFFSET) & BIT(0);
 }
 
+/*
+ * Wait for erase/program completion.  Unlike nand_wait(), this polls the
+ * chip's own status register instead of EM_WAIT: since that is shared by
+ * all chipselects, it would also report another chip's erase or program
+ * as busy and serialize them.
+ */
+static int nand_davinci_waitfunc(struct mtd_info *mtd, struct nand_chip *chip)
+{
+	unsigned long timeo = jiffies;
+	unsigned ms = chip->state == FL_ERASING ? 400 : 20;
+
+	timeo += (HZ * ms) / 1000;
+
+	/* wait tWB before reading status */
+	ndelay(100);
+
+	chip->cmdfunc(mtd, NAND_CMD_STATUS, -1, -1);
+
+	/* panic writes (mtdoops) can neither sleep nor count on jiffies */
+	if (in_interrupt() || oops_in_progress) {
+		while (ms--) {
+			if (chip->read_byte(mtd) & NAND_STATUS_READY)
+				break;
+			mdelay(1);
+		}
+		return (int)chip->read_byte(mtd);
+	}
+
+	while (time_before(jiffies, timeo)) {
+		if (chip->read_byte(mtd) & NAND_STATUS_READY)
+			break;
+		cond_resched();
+	}
+
+	return (int)chip->read_byte(mtd);
+}
+
+/*----------------------------------------------------------------------*/
+
+/*
+ * Page reads on large page chips.  The default nand_command_lp() issues a
+ * full READ0/READSTART and waits tR for every READ0 or READOOB, even when
+ * the page is already in the chip's page register; with OOB-first 4-bit
+ * ECC that costs three array reads per page.  This wrapper remembers the
+ * loaded page and turns such repeats into a column change.
+ *
+ * Chips advertising the ONFI read cache commands also get sequential
+ * read-ahead:  once two consecutive pages are read, READ CACHE SEQUENTIAL
+ * moves the current page to the cache register and starts loading the
+ * next one, so its tR overlaps the transfer (and ECC) of this one.  The
+ * sequence stays open across operations, which is what UBI and mtdblock
+ * readers walking a block page by page want.  It never crosses a block
+ * boundary, and anything other than a read closes it with READ CACHE END.
+ */
+
+static void nand_davinci_command(struct mtd_info *mtd, unsigned command)
+{
+	struct nand_chip *chip = mtd->priv;
+
+	chip->cmd_ctrl(mtd, command, NAND_NCE | NAND_CLE | NAND_CTRL_CHANGE);
+	chip->cmd_ctrl(mtd, NAND_CMD_NONE, NAND_NCE | NAND_CTRL_CHANGE);
+}
+
+static void nand_davinci_cache_wait(struct mtd_info *mtd)
+{
+	/* tWB, then tRCBSY */
+	ndelay(100);
+	nand_wait_ready(mtd);
+}
+
+/* Finish a READ CACHE SEQUENTIAL run, dropping the prefetched page */
+static void nand_davinci_cache_end(struct mtd_info *mtd)
+{
+	struct davinci_nand_info *info = to_davinci_nand(mtd);
+
+	if (!info->cache_seq)
+		return;
+
+	nand_davinci_command(mtd, NAND_CMD_READCACHEEND);
+	nand_davinci_cache_wait(mtd);
+
+	info->cache_seq = false;
+	info->cache_page = -1;
+}
+
+/* Can the page after this one be fetched without crossing a block? */
+static inline bool nand_davinci_cache_ahead(struct nand_chip *chip, int page)
+{
+	int blockmask;
+
+	blockmask = (1 << (chip->phys_erase_shift - chip->page_shift)) - 1;
+	return ((page + 1) & blockmask) != 0;
+}
+
+/* Move the page being loaded to the cache register, maybe fetching the
+ * next one behind it
+ */
+static void nand_davinci_cache_next(struct mtd_info *mtd, int page)
+{
+	struct davinci_nand_info *info = to_davinci_nand(mtd);
+
+	info->cache_seq = nand_davinci_cache_ahead(mtd->priv, page);
+
+	nand_davinci_command(mtd, info->cache_seq
+			? NAND_CMD_READCACHESEQ : NAND_CMD_READCACHEEND);
+	nand_davinci_cache_wait(mtd);
+
+	info->cache_page = page;
+}
+
+static void nand_davinci_cmdfunc(struct mtd_info *mtd, unsigned command,
+		int column, int page_addr)
+{
+	struct davinci_nand_info *info = to_davinci_nand(mtd);
+	int last;
+
+	if (column >= 0)
+		info->column = column;
+
+	switch (command) {
+	case NAND_CMD_READOOB:
+		column += mtd->writesize;
+		info->column = column;
+		/* FALLTHROUGH */
+	case NAND_CMD_READ0:
+		/* select_chip() closed any read-ahead on another chip */
+		if (info->current_chip != info->cache_chip)
+			nand_davinci_cache_invalidate(info);
+		last = info->cache_page;
+
+		/* page register hit */
+		if (page_addr == last)
+			break;
+
+		/* the page READ CACHE SEQUENTIAL has been loading */
+		if (info->cache_seq && last >= 0 && page_addr == last + 1) {
+			nand_davinci_cache_next(mtd, page_addr);
+			if (column == 0)
+				return;
+			break;
+		}
+
+		nand_davinci_cache_end(mtd);
+		info->cmdfunc(mtd, NAND_CMD_READ0, column, page_addr);
+		info->cache_chip = info->current_chip;
+		info->cache_page = page_addr;
+
+		/* second page in a row:  start reading ahead */
+		if (info->cache_read && last >= 0 && page_addr == last + 1
+				&& nand_davinci_cache_ahead(mtd->priv, page_addr)) {
+			nand_davinci_cache_next(mtd, page_addr);
+			if (column != 0)
+				break;
+		}
+		return;
+
+	case NAND_CMD_RNDOUT:
+		info->cmdfunc(mtd, command, column, page_addr);
+		return;
+
+	case NAND_CMD_RESET:
+		info->cache_seq = false;
+		/* FALLTHROUGH */
+	default:
+		/* program, erase and the rest change or reuse the page
+		 * register; whatever it held is gone
+		 */
+		nand_davinci_cache_end(mtd);
+		nand_davinci_cache_invalidate(info);
+		info->cmdfunc(mtd, command, column, page_addr);
+		return;
+	}
+
+	info->cmdfunc(mtd, NAND_CMD_RNDOUT, column, -1);
+}
+
+static u16 __init onfi_crc16(u16 crc, const u8 *p, size_t len)
+{
+	int i;
+
+	while (len--) {
+		crc ^= *p++ << 8;
+		for (i = 0; i < 8; i++)
+			crc = (crc << 1) ^ ((crc & 0x8000) ? 0x8005 : 0);
+	}
+	return crc;
+}
+
+/* Does this chip carry a valid ONFI parameter page listing the read cache
+ * commands?  Non-ONFI chips get no read-ahead; the probe-time ID read
+ * can't tell reliably whether they implement it.
+ */
+static bool __init nand_davinci_chip_cache_read(struct mtd_info *mtd,
+		int chipnr)
+{
+	struct nand_chip *chip = mtd->priv;
+	u8 *p = chip->buffers->databuf;
+	int i;
+
+	chip->select_chip(mtd, chipnr);
+
+	nand_davinci_command(mtd, NAND_CMD_READID);
+	chip->cmd_ctrl(mtd, 0x20, NAND_NCE | NAND_ALE | NAND_CTRL_CHANGE);
+	chip->cmd_ctrl(mtd, NAND_CMD_NONE, NAND_NCE | NAND_CTRL_CHANGE);
+	for (i = 0; i < 4; i++)
+		p[i] = chip->read_byte(mtd);
+	if (memcmp(p, "ONFI", 4))
+		goto no;
+
+	nand_davinci_command(mtd, NAND_CMD_PARAM);
+	chip->cmd_ctrl(mtd, 0, NAND_NCE | NAND_ALE | NAND_CTRL_CHANGE);
+	chip->cmd_ctrl(mtd, NAND_CMD_NONE, NAND_NCE | NAND_CTRL_CHANGE);
+	nand_davinci_cache_wait(mtd);
+	for (i = 0; i < 256; i++)
+		p[i] = chip->read_byte(mtd);
+
+	if (memcmp(p, "ONFI", 4)
+			|| onfi_crc16(0x4f4e, p, 254) != (p[254] | p[255] << 8))
+		goto no;
+
+	chip->select_chip(mtd, -1);
+
+	/* optional commands:  bit 1 is READ CACHE SEQUENTIAL/END */
+	return (p[8] & BIT(1)) != 0;
+no:
+	chip->select_chip(mtd, -1);
+	return false;
+}
+
+/* Read-ahead is switched on for all chips or none */
+static bool __init nand_davinci_has_cache_read(struct mtd_info *mtd)
+{
+	struct nand_chip *chip = mtd->priv;
+	int i;
+
+	for (i = 0; i < chip->numchips; i++)
+		if (!nand_davinci_chip_cache_read(mtd, i))
+			return false;
+
+	return true;
+}
+
 /*----------------------------------------------------------------------*/
 
 /* An ECC layout for using 4-bit ECC with small-page flash, storing
@@ -618,6 +1134,10 @@ static int __init nand_davinci_probe(struct platform_device *pdev)
 	info->dev		= &pdev->dev;
 	info->base		= base;
 	info->vaddr		= vaddr;
+	info->phys_addr		= res1->start;
+	info->dma_ch		= -1;
+	init_completion(&info->dma_done);
+	info->ecc_mode		= -1;
 
 	info->mtd.priv		= &info->chip;
 	info->mtd.name		= dev_name(&pdev->dev);
@@ -639,6 +1159,7 @@ static int __init nand_davinci_probe(struct platform_device *pdev)
 	info->ioaddr		= (uint32_t __force) vaddr;
 
 	info->current_cs	= info->ioaddr;
+	info->cache_page	= -1;
 	info->core_chipsel	= pdev->id;
 	info->mask_chipsel	= pdata->mask_chipsel;
 
@@ -649,6 +1170,7 @@ static int __init nand_davinci_probe(struct platform_device *pdev)
 	/* Set address of hardware control function */
 	info->chip.cmd_ctrl	= nand_davinci_hwcontrol;
 	info->chip.dev_ready	= nand_davinci_dev_ready;
+	info->chip.waitfunc	= nand_davinci_waitfunc;
 
 	/* Speed up buffer I/O */
 	info->chip.read_buf     = nand_davinci_read_buf;
@@ -667,19 +1189,8 @@ static int __init nand_davinci_probe(struct platform_device *pdev)
 		if (pdata->ecc_bits == 4) {
 			/* No sanity checks:  CPUs must support this,
 			 * and the chips may not use NAND_BUSWIDTH_16.
+			 * Chipselects share the engine via davinci_ecc4_lock.
 			 */
-
-			/* No sharing 4-bit hardware between chipselects yet */
-			spin_lock_irq(&davinci_nand_lock);
-			if (ecc4_busy)
-				ret = -EBUSY;
-			else
-				ecc4_busy = true;
-			spin_unlock_irq(&davinci_nand_lock);
-
-			if (ret == -EBUSY)
-				goto err_ecc;
-
 			info->chip.ecc.calculate = nand_davinci_calculate_4bit;
 			info->chip.ecc.correct = nand_davinci_correct_4bit;
 			info->chip.ecc.hwctl = nand_davinci_hwctl_4bit;
@@ -730,6 +1241,19 @@ static int __init nand_davinci_probe(struct platform_device *pdev)
 		goto err_timing;
 	}
 
+	/* Any channel will do, transfers are triggered manually */
+	if (use_dma) {
+		ret = edma_alloc_channel(EDMA_CHANNEL_ANY, nand_davinci_dma_cb,
+				info, EVENTQ_DEFAULT);
+		if (ret < 0) {
+			dev_warn(&pdev->dev, "no DMA channel (%d), using PIO\n",
+					ret);
+		} else {
+			info->dma_ch = ret;
+			edma_set_channel_class(ret, EDMA_QOS_STORAGE);
+		}
+	}
+
 	spin_lock_irq(&davinci_nand_lock);
 
 	/* put CSxNAND into NAND mode */
@@ -795,6 +1319,17 @@ syndrome_done:
 	if (ret < 0)
 		goto err_scan;
 
+	/* nand_scan_ident() picked the default command function; large
+	 * page chips get page register tracking and maybe cache reads.
+	 */
+	if (info->mtd.writesize > 512) {
+		if (cache_read)
+			info->cache_read =
+				nand_davinci_has_cache_read(&info->mtd);
+		info->cmdfunc = info->chip.cmdfunc;
+		info->chip.cmdfunc = nand_davinci_cmdfunc;
+	}
+
 	if (mtd_has_partitions()) {
 		struct mtd_partition	*mtd_parts = NULL;
 		int			mtd_parts_nb = 0;
@@ -835,23 +1370,23 @@ syndrome_done:
 		goto err_scan;
 
 	val = davinci_nand_readl(info, NRCSR_OFFSET);
-	dev_info(&pdev->dev, "controller rev. %d.%d\n",
-	       (val >> 8) & 0xff, val & 0xff);
+	dev_info(&pdev->dev, "controller rev. %d.%d, %s%s\n",
+	       (val >> 8) & 0xff, val & 0xff,
+	       info->dma_ch >= 0 ? "DMA" : "PIO",
+	       info->cache_read ? ", cache read" : "");
 
 	return 0;
 
 err_scan:
+	if (info->dma_ch >= 0)
+		edma_free_channel(info->dma_ch);
+
 err_timing:
 	clk_disable(info->clk);
 
 err_clk_enable:
 	clk_put(info->clk);
 
-	spin_lock_irq(&davinci_nand_lock);
-	if (ecc_mode == NAND_ECC_HW_SYNDROME)
-		ecc4_busy = false;
-	spin_unlock_irq(&davinci_nand_lock);
-
 err_ecc:
 err_clk:
 err_ioremap:
@@ -875,16 +1410,14 @@ static int __exit nand_davinci_remove(struct platform_device *pdev)
 	else
 		status = del_mtd_device(&info->mtd);
 
-	spin_lock_irq(&davinci_nand_lock);
-	if (info->chip.ecc.mode == NAND_ECC_HW_SYNDROME)
-		ecc4_busy = false;
-	spin_unlock_irq(&davinci_nand_lock);
-
 	iounmap(info->base);
 	iounmap(info->vaddr);
 
 	nand_release(&info->mtd);
 
+	if (info->dma_ch >= 0)
+		edma_free_channel(info->dma_ch);
+
 	clk_disable(info->clk);
 	clk_put(info->clk);
 
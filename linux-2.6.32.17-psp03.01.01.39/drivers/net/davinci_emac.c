@@ -62,6 +62,7 @@
 #include <linux/bitops.h>
 #include <linux/io.h>
 #include <linux/uaccess.h>
+#include <linux/pkt_sched.h>
 
 #include <asm/irq.h>
 #include <asm/page.h>
@@ -87,6 +88,30 @@ static char *ethaddr;
 module_param(ethaddr, charp, 0);
 MODULE_PARM_DESC(ethaddr, "DaVinci EMAC kernel ethaddr");
 
+/* Received frames up to this size are copied into a fresh small skb and
+ * the DMA buffer is handed straight back to the hardware */
+static int rx_copybreak = 256;
+module_param(rx_copybreak, int, 0644);
+MODULE_PARM_DESC(rx_copybreak, "Copy RX frames up to this size (bytes)");
+
+/* Number of TX channels to open. Every channel gets an equal share of the
+ * TX half of the BD memory, so the default single channel gets the deepest
+ * ring; priority channels are only worth their BDs for mixed traffic */
+static int tx_channels = 1;
+module_param(tx_channels, int, 0);
+MODULE_PARM_DESC(tx_channels, "DaVinci EMAC TX priority channels (1-3)");
+
+/* skb->priority to TX channel. The TX arbiter runs in fixed priority mode
+ * (EMAC_DEF_TXPRIO_FIXED) where the highest channel is always served first:
+ * best effort and bulk go to channel 0, video (TC_PRIO_INTERACTIVE_BULK and
+ * up, e.g. SO_PRIORITY 4/5) to channel 1 and interactive/control traffic
+ * to channel 2. Priorities of channels not opened (tx_channels) fall back
+ * to the highest one that is */
+static const u8 emac_prio_to_txch[TC_PRIO_MAX + 1] = {
+	0, 0, 0, 0, 1, 1, 2, 2,
+	0, 0, 0, 0, 0, 0, 0, 0,
+};
+
 /* Netif debug messages possible */
 #define DAVINCI_EMAC_DEBUG	(NETIF_MSG_DRV | \
 				NETIF_MSG_PROBE | \
@@ -123,7 +148,7 @@ static const char emac_version_string[] = "TI DaVinci EMAC Linux v6.1";
 #define EMAC_DEF_BCAST_EN		(1) /* Broadcast enabled */
 #define EMAC_DEF_BCAST_CH		(0) /* Broadcast channel is 0 */
 #define EMAC_DEF_MCAST_EN		(1) /* Multicast enabled */
-#define EMAC_DEF_MCAST_CH		(0) /* Multicast channel is 0 */
+#define EMAC_DEF_MCAST_CH		(1) /* Multicast to its own channel */
 
 #define EMAC_DEF_TXPRIO_FIXED		(1) /* TX Priority is fixed */
 #define EMAC_DEF_TXPACING_EN		(0) /* TX pacing NOT supported*/
@@ -134,13 +159,24 @@ static const char emac_version_string[] = "TI DaVinci EMAC Linux v6.1";
 #define EMAC_DEF_TX_CH			(0) /* Default 0th channel */
 #define EMAC_DEF_RX_CH			(0) /* Default 0th channel */
 #define EMAC_DEF_MDIO_TICK_MS		(10) /* typically 1 tick=1 ms) */
-#define EMAC_DEF_MAX_TX_CH		(1) /* Max TX channels configured */
-#define EMAC_DEF_MAX_RX_CH		(1) /* Max RX channels configured */
+#define EMAC_DEF_MAX_TX_CH		(3) /* Max TX channels supported */
+#define EMAC_DEF_MAX_RX_CH		(2) /* Max RX channels configured */
 #define EMAC_POLL_WEIGHT		(64) /* Default NAPI poll weight */
 
 /* Buffer descriptor parameters */
-#define EMAC_DEF_TX_MAX_SERVICE		(32) /* TX max service BD's */
+#define EMAC_DEF_TX_MAX_SERVICE		(32) /* TX max service packets */
+#define EMAC_TX_STOP_THRESH		(MAX_SKB_FRAGS + 1) /* BDs/packet */
 #define EMAC_DEF_RX_MAX_SERVICE		(64) /* should = netdev->weight */
+#define EMAC_DEF_RX_RECYCLE_MAX		(64) /* TX skbs kept for RX reuse */
+
+/* Interrupt pacing defaults, in usecs between interrupts (0 = unpaced) */
+#define EMAC_DEF_RX_COAL_USECS		(125)
+#define EMAC_DEF_TX_COAL_USECS		(250)
+#define EMAC_DEF_RX_COAL_USECS_LOW	(0)   /* below pkt_rate_low */
+#define EMAC_DEF_RX_COAL_USECS_HIGH	(250) /* above pkt_rate_high */
+#define EMAC_DEF_COAL_PKT_RATE_LOW	(2000)  /* RX pkts/sec */
+#define EMAC_DEF_COAL_PKT_RATE_HIGH	(20000) /* RX pkts/sec */
+#define EMAC_DEF_COAL_SAMPLE_INTVL	(1) /* adaptive sample period, secs */
 
 /* EMAC register related defines */
 #define EMAC_ALL_MULTI_REG_VALUE	(0xFFFFFFFF)
@@ -207,12 +243,12 @@ static const char emac_version_string[] = "TI DaVinci EMAC Linux v6.1";
 /* MAC_IN_VECTOR (0x180) register bit fields */
 #define EMAC_DM644X_MAC_IN_VECTOR_HOST_INT	BIT(17)
 #define EMAC_DM644X_MAC_IN_VECTOR_STATPEND_INT	BIT(16)
-#define EMAC_DM644X_MAC_IN_VECTOR_RX_INT_VEC	BIT(8)
-#define EMAC_DM644X_MAC_IN_VECTOR_TX_INT_VEC	BIT(0)
+#define EMAC_DM644X_MAC_IN_VECTOR_RX_INT_VEC(ch)	BIT(8 + (ch))
+#define EMAC_DM644X_MAC_IN_VECTOR_TX_INT_VEC(ch)	BIT(ch)
 
 /** NOTE:: For DM646x the IN_VECTOR has changed */
-#define EMAC_DM646X_MAC_IN_VECTOR_RX_INT_VEC	BIT(EMAC_DEF_RX_CH)
-#define EMAC_DM646X_MAC_IN_VECTOR_TX_INT_VEC	BIT(16 + EMAC_DEF_TX_CH)
+#define EMAC_DM646X_MAC_IN_VECTOR_RX_INT_VEC(ch)	BIT(ch)
+#define EMAC_DM646X_MAC_IN_VECTOR_TX_INT_VEC(ch)	BIT(16 + (ch))
 #define EMAC_DM646X_MAC_IN_VECTOR_HOST_INT	BIT(26)
 #define EMAC_DM646X_MAC_IN_VECTOR_STATPEND_INT	BIT(27)
 
@@ -224,6 +260,7 @@ static const char emac_version_string[] = "TI DaVinci EMAC Linux v6.1";
 #define EMAC_CPPI_TEARDOWN_COMPLETE_BIT BIT(27)
 #define EMAC_CPPI_PASS_CRC_BIT		BIT(26)
 #define EMAC_RX_BD_BUF_SIZE		(0xFFFF)
+#define EMAC_TX_BD_BUF_SIZE		(0xFFFF)
 #define EMAC_BD_LENGTH_FOR_CACHE	(16) /* only CPPI bytes */
 #define EMAC_RX_BD_PKT_LENGTH_MASK	(0xFFFF)
 
@@ -309,6 +346,12 @@ static const char emac_version_string[] = "TI DaVinci EMAC Linux v6.1";
 #define EMAC_TXUNDERRUN		0x25C
 #define EMAC_TXCARRIERSENSE	0x260
 #define EMAC_TXOCTETS		0x264
+#define EMAC_FRAME64		0x268
+#define EMAC_FRAME65T127	0x26C
+#define EMAC_FRAME128T255	0x270
+#define EMAC_FRAME256T511	0x274
+#define EMAC_FRAME512T1023	0x278
+#define EMAC_FRAME1024TUP	0x27C
 #define EMAC_NETOCTETS		0x280
 #define EMAC_RXSOFOVERRUNS	0x284
 #define EMAC_RXMOFOVERRUNS	0x288
@@ -318,6 +361,9 @@ static const char emac_version_string[] = "TI DaVinci EMAC Linux v6.1";
 #define EMAC_CTRL_EWCTL		(0x4)
 #define EMAC_CTRL_EWINTTCNT	(0x8)
 
+/* EMAC DM644x control module masks */
+#define EMAC_DM644X_EWINTCNT_MASK	(0x1FFFF)
+
 /* EMAC MDIO related */
 /* Mask & Control defines */
 #define MDIO_CONTROL_CLKDIV	(0xFF)
@@ -338,8 +384,20 @@ static const char emac_version_string[] = "TI DaVinci EMAC Linux v6.1";
 #define MDIO_CONTROL		(0x04)
 
 /* EMAC DM646X control module registers */
+#define EMAC_DM646X_CMINTCTRL	(0x0C)
 #define EMAC_DM646X_CMRXINTEN	(0x14)
 #define EMAC_DM646X_CMTXINTEN	(0x18)
+#define EMAC_DM646X_CMRXINTMAX	(0x70)
+#define EMAC_DM646X_CMTXINTMAX	(0x74)
+
+/* EMAC DM646X control module masks */
+#define EMAC_DM646X_C0_RXPACEEN		BIT(16)
+#define EMAC_DM646X_C0_TXPACEEN		BIT(17)
+#define EMAC_DM646X_INTPRESCALE_MASK	(0x7FF)
+#define EMAC_DM646X_CMINTMAX_CNT	(63) /* max interrupts per msec */
+#define EMAC_DM646X_CMINTMIN_CNT	(2)  /* min interrupts per msec */
+#define EMAC_DM646X_CMINTMIN_INTVL	(1000 / EMAC_DM646X_CMINTMAX_CNT + 1)
+#define EMAC_DM646X_CMINTMAX_INTVL	(1000 / EMAC_DM646X_CMINTMIN_CNT)
 
 /* EMAC EOI codes for C0 */
 #define EMAC_DM646X_MAC_EOI_C0_RXEN	(0x01)
@@ -348,6 +406,14 @@ static const char emac_version_string[] = "TI DaVinci EMAC Linux v6.1";
 /* EMAC Stats Clear Mask */
 #define EMAC_STATS_CLR_MASK    (0xFFFFFFFF)
 
+/* EMAC statistics registers are contiguous from EMAC_RXGOODFRAMES */
+#define EMAC_NUM_HW_STATS	((EMAC_RXDMAOVERRUNS - EMAC_RXGOODFRAMES) / 4 + 1)
+#define EMAC_HW_STAT_REG(i)	(EMAC_RXGOODFRAMES + ((i) * 4))
+#define EMAC_HW_STAT_IDX(reg)	(((reg) - EMAC_RXGOODFRAMES) / 4)
+
+/* power of two buckets (0, 1, 2-3, ... 64-up) for the ethtool histograms */
+#define EMAC_HIST_BUCKETS	(8)
+
 /** net_buf_obj: EMAC network bufferdata structure
  *
  * EMAC network buffer data structure
@@ -355,12 +421,14 @@ static const char emac_version_string[] = "TI DaVinci EMAC Linux v6.1";
 struct emac_netbufobj {
 	void *buf_token;
 	char *data_ptr;
+	dma_addr_t dma_addr; /* TX only: mapped address of the buffer */
 	int length;
 };
 
 /** net_pkt_obj: EMAC network packet data structure
  *
- * EMAC network packet data structure - supports buffer list (for future)
+ * EMAC network packet data structure - supports buffer list, one entry
+ * per TX buffer descriptor (skb head followed by its page fragments)
  */
 struct emac_netpktobj {
 	void *pkt_token; /* data token may hold tx/rx chan id */
@@ -390,15 +458,21 @@ struct emac_txch {
 	/* Config related */
 	u32 num_bd;
 	u32 service_max;
+	u32 wake_thresh; /* free BDs needed to restart a stopped queue */
+	spinlock_t lock; /* queue tail / restart, shared by xmit and EOQ */
 
-	/* CPPI specific */
+	/* CPPI specific - the BDs form a fixed ring through ->next. xmit
+	 * alone fills at fill_bd and counts queued_bd, completion alone
+	 * reclaims at reclaim_bd and counts reclaimed_bd */
 	u32 alloc_size;
 	void __iomem *bd_mem;
-	struct emac_tx_bd __iomem *bd_pool_head;
-	struct emac_tx_bd __iomem *active_queue_head;
-	struct emac_tx_bd __iomem *active_queue_tail;
+	struct emac_tx_bd __iomem *fill_bd;
+	struct emac_tx_bd __iomem *reclaim_bd;
+	u32 queued_bd;
+	u32 reclaimed_bd;
+	struct emac_tx_bd __iomem *active_queue_tail; /* under lock */
 	struct emac_tx_bd __iomem *last_hw_bdprocessed;
-	u32 queue_active;
+	u32 queue_active; /* under lock */
 	u32 teardown_pending;
 	u32 *tx_complete;
 
@@ -409,7 +483,6 @@ struct emac_txch {
 	u32 end_of_queue_add;
 	u32 out_of_tx_bd;
 	u32 no_active_pkts; /* IRQ when there were no packets to process */
-	u32 active_queue_count;
 };
 
 /** emac_rx_bd: EMAC RX Buffer descriptor data structure
@@ -472,7 +545,6 @@ struct emac_priv {
 	struct platform_device *pdev;
 	struct napi_struct napi;
 	char mac_addr[6];
-	spinlock_t tx_lock;
 	spinlock_t rx_lock;
 	void __iomem *remap_addr;
 	u32 emac_base_phys;
@@ -480,12 +552,14 @@ struct emac_priv {
 	void __iomem *ctrl_base;
 	void __iomem *emac_ctrl_ram;
 	u32 ctrl_ram_size;
+	u32 num_tx_ch; /* TX channels in use, see tx_channels */
 	struct emac_txch *txch[EMAC_DEF_MAX_TX_CH];
 	struct emac_rxch *rxch[EMAC_DEF_MAX_RX_CH];
 	u32 link; /* 1=link on, 0=link off */
 	u32 speed; /* 0=Auto Neg, 1=No PHY, 10,100, 1000 - mbps */
 	u32 duplex; /* Link duplex: 0=Half, 1=Full */
 	u32 rx_buf_size;
+	struct sk_buff_head rx_recycle; /* sent skbs reusable as RX buffers */
 	u32 isr_count;
 	u8 rmii_en;
 	u8 version;
@@ -503,6 +577,23 @@ struct emac_priv {
 	struct mii_bus *mii_bus;
 	struct phy_device *phydev;
 	spinlock_t lock;
+	/* interrupt pacing (ethtool -C), intervals in usecs */
+	u32 bus_freq_mhz;
+	u32 coal_rx_usecs;
+	u32 coal_tx_usecs;
+	u32 coal_rx_usecs_low;
+	u32 coal_rx_usecs_high;
+	u32 coal_pkt_rate_low;
+	u32 coal_pkt_rate_high;
+	u32 coal_sample_intvl;
+	u32 coal_adaptive_rx;
+	u32 coal_cur_rx_usecs; /* RX interval currently programmed */
+	u32 coal_rx_pkts;      /* RX packets in the current sample period */
+	unsigned long coal_stamp;
+	/* statistics (ethtool -S), hardware counters accumulated under lock */
+	u64 hw_stats[EMAC_NUM_HW_STATS];
+	u32 rx_poll_hist[EMAC_HIST_BUCKETS]; /* RX packets per NAPI poll */
+	u32 tx_ring_hist[EMAC_HIST_BUCKETS]; /* TX BDs in use after xmit */
 };
 
 /* clock frequency for EMAC */
@@ -715,6 +806,370 @@ static int emac_set_settings(struct net_device *ndev, struct ethtool_cmd *ecmd)
 
 }
 
+/**
+ * emac_set_pacing: Program the EMAC control module interrupt pacing
+ * @priv: The DaVinci EMAC private adapter structure
+ * @rx_usecs: minimum interval between RX interrupts, 0 to disable pacing
+ * @tx_usecs: minimum interval between TX interrupts, 0 to disable pacing
+ *
+ * DM646x style modules pace RX and TX separately in interrupts per msec,
+ * counted off a 4us pulse derived from the bus clock. DM644x only has a
+ * single interrupt timer in bus clock cycles, which gets the RX interval.
+ *
+ */
+static void emac_set_pacing(struct emac_priv *priv, u32 rx_usecs,
+			    u32 tx_usecs)
+{
+	u32 int_ctrl;
+
+	priv->coal_cur_rx_usecs = rx_usecs;
+	if (priv->version == EMAC_VERSION_2) {
+		int_ctrl = emac_ctrl_read(EMAC_DM646X_CMINTCTRL);
+		int_ctrl &= ~(EMAC_DM646X_C0_RXPACEEN | EMAC_DM646X_C0_TXPACEEN |
+			      EMAC_DM646X_INTPRESCALE_MASK);
+		int_ctrl |= (priv->bus_freq_mhz * 4) &
+			    EMAC_DM646X_INTPRESCALE_MASK;
+
+		if (rx_usecs) {
+			rx_usecs = clamp_t(u32, rx_usecs,
+					   EMAC_DM646X_CMINTMIN_INTVL,
+					   EMAC_DM646X_CMINTMAX_INTVL);
+			emac_ctrl_write(EMAC_DM646X_CMRXINTMAX,
+					1000 / rx_usecs);
+			int_ctrl |= EMAC_DM646X_C0_RXPACEEN;
+		}
+		if (tx_usecs) {
+			tx_usecs = clamp_t(u32, tx_usecs,
+					   EMAC_DM646X_CMINTMIN_INTVL,
+					   EMAC_DM646X_CMINTMAX_INTVL);
+			emac_ctrl_write(EMAC_DM646X_CMTXINTMAX,
+					1000 / tx_usecs);
+			int_ctrl |= EMAC_DM646X_C0_TXPACEEN;
+		}
+		emac_ctrl_write(EMAC_DM646X_CMINTCTRL, int_ctrl);
+	} else {
+		u32 count = rx_usecs * priv->bus_freq_mhz;
+
+		if (count > EMAC_DM644X_EWINTCNT_MASK)
+			count = EMAC_DM644X_EWINTCNT_MASK;
+		int_ctrl = emac_ctrl_read(EMAC_CTRL_EWINTTCNT);
+		int_ctrl &= ~EMAC_DM644X_EWINTCNT_MASK;
+		emac_ctrl_write(EMAC_CTRL_EWINTTCNT, int_ctrl | count);
+	}
+}
+
+/**
+ * emac_adapt_pacing: Adaptive RX interrupt pacing
+ * @priv: The DaVinci EMAC private adapter structure
+ * @rx_pkts: packets received by the current NAPI poll
+ *
+ * Called from NAPI poll. Once per sample interval the RX packet rate picks
+ * rx_usecs_low (quiet link, lowest latency), rx_usecs_high (flood) or the
+ * plain rx_usecs in between, and the pacer is reprogrammed on a change.
+ *
+ */
+static void emac_adapt_pacing(struct emac_priv *priv, u32 rx_pkts)
+{
+	unsigned long flags;
+	unsigned long elapsed;
+	u32 rate, usecs;
+
+	if (!priv->coal_adaptive_rx)
+		return;
+
+	priv->coal_rx_pkts += rx_pkts;
+	elapsed = jiffies - priv->coal_stamp;
+	if (elapsed < priv->coal_sample_intvl * HZ)
+		return;
+
+	rate = priv->coal_rx_pkts * HZ / elapsed;
+	priv->coal_rx_pkts = 0;
+	priv->coal_stamp = jiffies;
+
+	if (rate < priv->coal_pkt_rate_low)
+		usecs = priv->coal_rx_usecs_low;
+	else if (rate > priv->coal_pkt_rate_high)
+		usecs = priv->coal_rx_usecs_high;
+	else
+		usecs = priv->coal_rx_usecs;
+
+	if (usecs != priv->coal_cur_rx_usecs) {
+		spin_lock_irqsave(&priv->lock, flags);
+		emac_set_pacing(priv, usecs, priv->coal_tx_usecs);
+		spin_unlock_irqrestore(&priv->lock, flags);
+	}
+}
+
+/**
+ * emac_get_coalesce: Get interrupt pacing parameters
+ * @ndev: The DaVinci EMAC network adapter
+ * @coal: ethtool coalesce structure
+ *
+ * Executes ethtool get coalesce command
+ *
+ */
+static int emac_get_coalesce(struct net_device *ndev,
+			     struct ethtool_coalesce *coal)
+{
+	struct emac_priv *priv = netdev_priv(ndev);
+
+	coal->rx_coalesce_usecs = priv->coal_rx_usecs;
+	coal->tx_coalesce_usecs = priv->coal_tx_usecs;
+	coal->use_adaptive_rx_coalesce = priv->coal_adaptive_rx;
+	coal->rx_coalesce_usecs_low = priv->coal_rx_usecs_low;
+	coal->rx_coalesce_usecs_high = priv->coal_rx_usecs_high;
+	coal->pkt_rate_low = priv->coal_pkt_rate_low;
+	coal->pkt_rate_high = priv->coal_pkt_rate_high;
+	coal->rate_sample_interval = priv->coal_sample_intvl;
+	return 0;
+}
+
+/**
+ * emac_set_coalesce: Set interrupt pacing parameters
+ * @ndev: The DaVinci EMAC network adapter
+ * @coal: ethtool coalesce structure
+ *
+ * Executes ethtool set coalesce command. The EMAC paces interrupts by time
+ * only, so frame count limits are rejected.
+ *
+ */
+static int emac_set_coalesce(struct net_device *ndev,
+			     struct ethtool_coalesce *coal)
+{
+	struct emac_priv *priv = netdev_priv(ndev);
+	unsigned long flags;
+
+	if (coal->rx_max_coalesced_frames || coal->tx_max_coalesced_frames ||
+	    coal->use_adaptive_tx_coalesce)
+		return -EINVAL;
+	if (coal->use_adaptive_rx_coalesce &&
+	    (!coal->rate_sample_interval ||
+	     coal->pkt_rate_low > coal->pkt_rate_high))
+		return -EINVAL;
+
+	spin_lock_irqsave(&priv->lock, flags);
+	priv->coal_rx_usecs = coal->rx_coalesce_usecs;
+	priv->coal_tx_usecs = coal->tx_coalesce_usecs;
+	priv->coal_adaptive_rx = coal->use_adaptive_rx_coalesce;
+	priv->coal_rx_usecs_low = coal->rx_coalesce_usecs_low;
+	priv->coal_rx_usecs_high = coal->rx_coalesce_usecs_high;
+	priv->coal_pkt_rate_low = coal->pkt_rate_low;
+	priv->coal_pkt_rate_high = coal->pkt_rate_high;
+	priv->coal_sample_intvl = coal->rate_sample_interval;
+	priv->coal_rx_pkts = 0;
+	priv->coal_stamp = jiffies;
+	if (netif_running(ndev))
+		emac_set_pacing(priv, priv->coal_rx_usecs,
+				priv->coal_tx_usecs);
+	spin_unlock_irqrestore(&priv->lock, flags);
+
+	return 0;
+}
+
+/* ethtool statistics: hardware counters, in register order */
+static const char emac_hw_stats_str[][ETH_GSTRING_LEN] = {
+	"rx_good_frames", "rx_broadcast_frames", "rx_multicast_frames",
+	"rx_pause_frames", "rx_crc_errors", "rx_align_code_errors",
+	"rx_oversized_frames", "rx_jabber_frames", "rx_undersized_frames",
+	"rx_fragments", "rx_filtered_frames", "rx_qos_filtered_frames",
+	"rx_octets", "tx_good_frames", "tx_broadcast_frames",
+	"tx_multicast_frames", "tx_pause_frames", "tx_deferred_frames",
+	"tx_collision_frames", "tx_single_coll_frames", "tx_mult_coll_frames",
+	"tx_excessive_collisions", "tx_late_collisions", "tx_underrun",
+	"tx_carrier_sense_errors", "tx_octets", "frames_64",
+	"frames_65_127", "frames_128_255", "frames_256_511",
+	"frames_512_1023", "frames_1024_up", "net_octets",
+	"rx_sof_overruns", "rx_mof_overruns", "rx_dma_overruns",
+};
+
+/* ethtool statistics: driver counters, reported per channel */
+struct emac_drv_stat {
+	char name[ETH_GSTRING_LEN];
+	int offset;
+};
+
+#define EMAC_TXCH_STAT(m)	{ #m, offsetof(struct emac_txch, m) }
+#define EMAC_RXCH_STAT(m)	{ #m, offsetof(struct emac_rxch, m) }
+
+static const struct emac_drv_stat emac_txch_stats[] = {
+	EMAC_TXCH_STAT(proc_count),
+	EMAC_TXCH_STAT(mis_queued_packets),
+	EMAC_TXCH_STAT(queue_reinit),
+	EMAC_TXCH_STAT(end_of_queue_add),
+	EMAC_TXCH_STAT(out_of_tx_bd),
+	EMAC_TXCH_STAT(no_active_pkts),
+};
+
+static const struct emac_drv_stat emac_rxch_stats[] = {
+	EMAC_RXCH_STAT(proc_count),
+	EMAC_RXCH_STAT(processed_bd),
+	EMAC_RXCH_STAT(recycled_bd),
+	EMAC_RXCH_STAT(out_of_rx_bd),
+	EMAC_RXCH_STAT(out_of_rx_buffers),
+	EMAC_RXCH_STAT(queue_reinit),
+	EMAC_RXCH_STAT(end_of_queue_add),
+	EMAC_RXCH_STAT(end_of_queue),
+	EMAC_RXCH_STAT(mis_queued_packets),
+};
+
+/* ethtool statistics: histogram bucket suffixes */
+static const char emac_hist_str[EMAC_HIST_BUCKETS][ETH_GSTRING_LEN] = {
+	"0", "1", "2_3", "4_7", "8_15", "16_31", "32_63", "64_up",
+};
+
+#define EMAC_STATS_LEN	(EMAC_NUM_HW_STATS + \
+			 EMAC_DEF_MAX_TX_CH * ARRAY_SIZE(emac_txch_stats) + \
+			 EMAC_DEF_MAX_RX_CH * ARRAY_SIZE(emac_rxch_stats) + \
+			 2 * EMAC_HIST_BUCKETS)
+
+static inline int emac_hist_bucket(u32 val)
+{
+	return min_t(int, fls(val), EMAC_HIST_BUCKETS - 1);
+}
+
+/**
+ * emac_update_hw_stats: Accumulate the EMAC hardware statistics
+ * @priv: The DaVinci EMAC private adapter structure
+ *
+ * The statistics registers are write-to-decrement while the MII is
+ * enabled: every value read is written back and added to hw_stats, so no
+ * count is lost between reads. Called with priv->lock held.
+ *
+ */
+static void emac_update_hw_stats(struct emac_priv *priv)
+{
+	u32 i, val;
+
+	if (!(emac_read(EMAC_MACCONTROL) & EMAC_MACCONTROL_GMIIEN))
+		return;
+
+	for (i = 0; i < EMAC_NUM_HW_STATS; i++) {
+		val = emac_read(EMAC_HW_STAT_REG(i));
+		if (val) {
+			emac_write(EMAC_HW_STAT_REG(i), val);
+			priv->hw_stats[i] += val;
+		}
+	}
+}
+
+/**
+ * emac_get_sset_count: Get number of ethtool strings/statistics
+ * @ndev: The DaVinci EMAC network adapter
+ * @sset: string set
+ *
+ */
+static int emac_get_sset_count(struct net_device *ndev, int sset)
+{
+	switch (sset) {
+	case ETH_SS_STATS:
+		return EMAC_STATS_LEN;
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
+/**
+ * emac_get_strings: Get ethtool statistics names
+ * @ndev: The DaVinci EMAC network adapter
+ * @stringset: string set
+ * @data: buffer for EMAC_STATS_LEN names
+ *
+ */
+static void emac_get_strings(struct net_device *ndev, u32 stringset, u8 *data)
+{
+	u32 ch, i;
+
+	if (stringset != ETH_SS_STATS)
+		return;
+
+	memcpy(data, emac_hw_stats_str, sizeof(emac_hw_stats_str));
+	data += sizeof(emac_hw_stats_str);
+
+	for (ch = 0; ch < EMAC_DEF_MAX_TX_CH; ch++) {
+		for (i = 0; i < ARRAY_SIZE(emac_txch_stats); i++) {
+			snprintf(data, ETH_GSTRING_LEN, "tx%u_%s", ch,
+				 emac_txch_stats[i].name);
+			data += ETH_GSTRING_LEN;
+		}
+	}
+	for (ch = 0; ch < EMAC_DEF_MAX_RX_CH; ch++) {
+		for (i = 0; i < ARRAY_SIZE(emac_rxch_stats); i++) {
+			snprintf(data, ETH_GSTRING_LEN, "rx%u_%s", ch,
+				 emac_rxch_stats[i].name);
+			data += ETH_GSTRING_LEN;
+		}
+	}
+	for (i = 0; i < EMAC_HIST_BUCKETS; i++) {
+		snprintf(data, ETH_GSTRING_LEN, "rx_poll_pkts_%s",
+			 emac_hist_str[i]);
+		data += ETH_GSTRING_LEN;
+	}
+	for (i = 0; i < EMAC_HIST_BUCKETS; i++) {
+		snprintf(data, ETH_GSTRING_LEN, "tx_ring_used_%s",
+			 emac_hist_str[i]);
+		data += ETH_GSTRING_LEN;
+	}
+}
+
+/**
+ * emac_get_ethtool_stats: Get ethtool statistics
+ * @ndev: The DaVinci EMAC network adapter
+ * @stats: ethtool statistics request
+ * @data: buffer for EMAC_STATS_LEN values
+ *
+ * Driver channel counters only exist while the interface is up and read
+ * as zero otherwise
+ *
+ */
+static void emac_get_ethtool_stats(struct net_device *ndev,
+				   struct ethtool_stats *stats, u64 *data)
+{
+	struct emac_priv *priv = netdev_priv(ndev);
+	unsigned long flags;
+	u32 ch, i;
+
+	spin_lock_irqsave(&priv->lock, flags);
+	if (netif_running(ndev))
+		emac_update_hw_stats(priv);
+	for (i = 0; i < EMAC_NUM_HW_STATS; i++)
+		*data++ = priv->hw_stats[i];
+	spin_unlock_irqrestore(&priv->lock, flags);
+
+	for (ch = 0; ch < EMAC_DEF_MAX_TX_CH; ch++) {
+		struct emac_txch *txch = priv->txch[ch];
+
+		for (i = 0; i < ARRAY_SIZE(emac_txch_stats); i++)
+			*data++ = txch ? *(u32 *)((char *)txch +
+					emac_txch_stats[i].offset) : 0;
+	}
+	for (ch = 0; ch < EMAC_DEF_MAX_RX_CH; ch++) {
+		struct emac_rxch *rxch = priv->rxch[ch];
+
+		for (i = 0; i < ARRAY_SIZE(emac_rxch_stats); i++)
+			*data++ = rxch ? *(u32 *)((char *)rxch +
+					emac_rxch_stats[i].offset) : 0;
+	}
+	for (i = 0; i < EMAC_HIST_BUCKETS; i++)
+		*data++ = priv->rx_poll_hist[i];
+	for (i = 0; i < EMAC_HIST_BUCKETS; i++)
+		*data++ = priv->tx_ring_hist[i];
+}
+
+/**
+ * emac_get_rx_csum: Get receive checksum state
+ * @ndev: The DaVinci EMAC network adapter
+ *
+ * The EMAC does not check receive checksums, but GRO verifies them in
+ * software before merging, as the protocols do for everything else.
+ * The ethtool core only lets GRO be switched on for devices reporting
+ * receive checksumming, so report it as available.
+ *
+ */
+static u32 emac_get_rx_csum(struct net_device *ndev)
+{
+	return 1;
+}
+
 /**
  * ethtool_ops: DaVinci EMAC Ethtool structure
  *
@@ -726,6 +1181,16 @@ static const struct ethtool_ops ethtool_ops = {
 	.get_settings = emac_get_settings,
 	.set_settings = emac_set_settings,
 	.get_link = ethtool_op_get_link,
+	.get_tx_csum = ethtool_op_get_tx_csum,
+	.set_tx_csum = ethtool_op_set_tx_hw_csum,
+	.get_sg = ethtool_op_get_sg,
+	.set_sg = ethtool_op_set_sg,
+	.get_rx_csum = emac_get_rx_csum,
+	.get_coalesce = emac_get_coalesce,
+	.set_coalesce = emac_set_coalesce,
+	.get_sset_count = emac_get_sset_count,
+	.get_strings = emac_get_strings,
+	.get_ethtool_stats = emac_get_ethtool_stats,
 };
 
 /**
@@ -783,14 +1248,13 @@ static void emac_update_phystatus(struct emac_priv *priv)
 		if (!netif_carrier_ok(ndev))
 			netif_carrier_on(ndev);
 	/* reactivate the transmit queue if it is stopped */
-		if (netif_running(ndev) && netif_queue_stopped(ndev))
-			netif_wake_queue(ndev);
+		if (netif_running(ndev))
+			netif_tx_wake_all_queues(ndev);
 	} else {
 		/* link OFF */
 		if (netif_carrier_ok(ndev))
 			netif_carrier_off(ndev);
-		if (!netif_queue_stopped(ndev))
-			netif_stop_queue(ndev);
+		netif_tx_stop_all_queues(ndev);
 	}
 }
 
@@ -1088,14 +1552,36 @@ static irqreturn_t emac_irq(int irq, void *dev_id)
  *
  * WARNING: Please note that the on chip memory is used for both TX and RX
  * buffer descriptor queues and is equally divided between TX and RX desc's
- * If the number of TX or RX descriptors change this memory pointers need
- * to be adjusted. If external memory is allocated then these pointers can
- * pointer to the memory
+ * Each half is then split equally between the opened TX (resp. RX)
+ * channels. If the number of TX or RX descriptors change this memory
+ * pointers need to be adjusted. If external memory is allocated then these
+ * pointers can pointer to the memory
+ *
+ */
+#define EMAC_TX_BD_MEM_SIZE(priv) \
+	((((priv)->ctrl_ram_size >> 1) / (priv)->num_tx_ch) & ~0xF)
+#define EMAC_RX_BD_MEM_SIZE(priv) \
+	((((priv)->ctrl_ram_size >> 1) / EMAC_DEF_MAX_RX_CH) & ~0xF)
+#define EMAC_TX_BD_MEM(priv, ch)	((priv)->emac_ctrl_ram + \
+				(ch) * EMAC_TX_BD_MEM_SIZE(priv))
+#define EMAC_RX_BD_MEM(priv, ch)	((priv)->emac_ctrl_ram + \
+				(((priv)->ctrl_ram_size) >> 1) + \
+				(ch) * EMAC_RX_BD_MEM_SIZE(priv))
+
+/**
+ * emac_tx_free_bd: Number of free TX buffer descriptors
+ * @txch: TX channel
+ *
+ * queued_bd and reclaimed_bd each have a single writer (xmit resp. TX
+ * completion) and only ever grow, so their difference is the number of
+ * BDs owned by the hardware without any lock
  *
  */
-#define EMAC_TX_BD_MEM(priv)	((priv)->emac_ctrl_ram)
-#define EMAC_RX_BD_MEM(priv)	((priv)->emac_ctrl_ram + \
-				(((priv)->ctrl_ram_size) >> 1))
+static inline u32 emac_tx_free_bd(struct emac_txch *txch)
+{
+	return txch->num_bd -
+		(ACCESS_ONCE(txch->queued_bd) - ACCESS_ONCE(txch->reclaimed_bd));
+}
 
 /**
  * emac_init_txch: TX channel initialization
@@ -1103,7 +1589,7 @@ static irqreturn_t emac_irq(int irq, void *dev_id)
  * @ch: RX channel number
  *
  * Called during device init to setup a TX channel (allocate buffer desc
- * create free pool and keep ready for transmission
+ * ring and keep ready for transmission
  *
  * Returns success(0) or mem alloc failures error code
  */
@@ -1121,8 +1607,8 @@ static int emac_init_txch(struct emac_priv *priv, u32 ch)
 		return -ENOMEM;
 	}
 	priv->txch[ch] = txch;
+	spin_lock_init(&txch->lock);
 	txch->service_max = EMAC_DEF_TX_MAX_SERVICE;
-	txch->active_queue_head = NULL;
 	txch->active_queue_tail = NULL;
 	txch->queue_active = 0;
 	txch->teardown_pending = 0;
@@ -1139,27 +1625,30 @@ static int emac_init_txch(struct emac_priv *priv, u32 ch)
 	/* allocate buffer descriptor pool align every BD on four word
 	 * boundry for future requirements */
 	bd_size = (sizeof(struct emac_tx_bd) + 0xF) & ~0xF;
-	txch->num_bd = (priv->ctrl_ram_size >> 1) / bd_size;
+	txch->num_bd = EMAC_TX_BD_MEM_SIZE(priv) / bd_size;
 	txch->alloc_size = (((bd_size * txch->num_bd) + 0xF) & ~0xF);
+	txch->wake_thresh = min_t(u32, txch->num_bd,
+				  EMAC_TX_STOP_THRESH + txch->num_bd / 4);
 
 	/* alloc TX BD memory */
-	txch->bd_mem = EMAC_TX_BD_MEM(priv);
+	txch->bd_mem = EMAC_TX_BD_MEM(priv, ch);
 	__memzero((void __force *)txch->bd_mem, txch->alloc_size);
 
-	/* initialize the BD linked list */
+	/* initialize the BD ring */
 	mem = (void __force __iomem *)
 			(((u32 __force) txch->bd_mem + 0xF) & ~0xF);
-	txch->bd_pool_head = NULL;
 	for (cnt = 0; cnt < txch->num_bd; cnt++) {
 		curr_bd = mem + (cnt * bd_size);
-		curr_bd->next = txch->bd_pool_head;
-		txch->bd_pool_head = curr_bd;
+		curr_bd->next = mem + (((cnt + 1) % txch->num_bd) * bd_size);
 	}
+	txch->fill_bd = mem;
+	txch->reclaim_bd = mem;
+	txch->queued_bd = 0;
+	txch->reclaimed_bd = 0;
 
 	/* reset statistics counters */
 	txch->out_of_tx_bd = 0;
 	txch->no_active_pkts = 0;
-	txch->active_queue_count = 0;
 
 	return 0;
 }
@@ -1201,19 +1690,41 @@ static int emac_net_tx_complete(struct emac_priv *priv,
 {
 	u32 cnt;
 
-	if (unlikely(num_tokens && netif_queue_stopped(priv->ndev)))
-		netif_start_queue(priv->ndev);
 	for (cnt = 0; cnt < num_tokens; cnt++) {
 		struct sk_buff *skb = (struct sk_buff *)net_data_tokens[cnt];
 		if (skb == NULL)
 			continue;
 		priv->net_dev_stats.tx_packets++;
 		priv->net_dev_stats.tx_bytes += skb->len;
-		dev_kfree_skb_any(skb);
+		/* keep linear, unshared skbs around as future RX buffers */
+		if (skb_queue_len(&priv->rx_recycle) < EMAC_DEF_RX_RECYCLE_MAX &&
+		    skb_recycle_check(skb, priv->rx_buf_size))
+			skb_queue_head(&priv->rx_recycle, skb);
+		else
+			dev_kfree_skb_any(skb);
 	}
 	return 0;
 }
 
+/**
+ * emac_tx_unmap_bd: Release the DMA mapping of a TX buffer descriptor
+ * @priv: The DaVinci EMAC private adapter structure
+ * @bd: TX buffer descriptor, SOP descriptors map the skb head and the
+ * others map page fragments
+ *
+ */
+static void emac_tx_unmap_bd(struct emac_priv *priv,
+			     struct emac_tx_bd __iomem *bd)
+{
+	struct device *dma_dev = &priv->pdev->dev;
+	u32 len = bd->off_b_len & EMAC_TX_BD_BUF_SIZE;
+
+	if (bd->mode & EMAC_CPPI_SOP_BIT)
+		dma_unmap_single(dma_dev, bd->buff_ptr, len, DMA_TO_DEVICE);
+	else
+		dma_unmap_page(dma_dev, bd->buff_ptr, len, DMA_TO_DEVICE);
+}
+
 /**
  * emac_txch_teardown: TX channel teardown
  * @priv: The DaVinci EMAC private adapter structure
@@ -1242,20 +1753,17 @@ static void emac_txch_teardown(struct emac_priv *priv, u32 ch)
 	emac_write(EMAC_TXCP(ch), EMAC_TEARDOWN_VALUE);
 
 	/* process sent packets and return skb's to upper layer */
-	if (1 == txch->queue_active) {
-		curr_bd = txch->active_queue_head;
-		while (curr_bd != NULL) {
-			emac_net_tx_complete(priv, (void __force *)
-					&curr_bd->buf_token, 1, ch);
-			if (curr_bd != txch->active_queue_tail)
-				curr_bd = curr_bd->next;
-			else
-				break;
-		}
-		txch->bd_pool_head = txch->active_queue_head;
-		txch->active_queue_head =
-		txch->active_queue_tail = NULL;
+	curr_bd = txch->reclaim_bd;
+	while (txch->reclaimed_bd != txch->queued_bd) {
+		emac_tx_unmap_bd(priv, curr_bd);
+		emac_net_tx_complete(priv, (void __force *)
+				&curr_bd->buf_token, 1, ch);
+		curr_bd = curr_bd->next;
+		txch->reclaimed_bd++;
 	}
+	txch->reclaim_bd = curr_bd;
+	txch->active_queue_tail = NULL;
+	txch->queue_active = 0;
 }
 
 /**
@@ -1272,13 +1780,46 @@ static void emac_stop_txch(struct emac_priv *priv, u32 ch)
 
 	if (txch) {
 		txch->teardown_pending = 1;
-		emac_write(EMAC_TXTEARDOWN, 0);
+		emac_write(EMAC_TXTEARDOWN, ch);
 		emac_txch_teardown(priv, ch);
 		txch->teardown_pending = 0;
 		emac_write(EMAC_TXINTMASKCLEAR, BIT(ch));
 	}
 }
 
+/**
+ * emac_tx_eoq: Handle end of queue on a completed TX packet
+ * @priv: The DaVinci EMAC private adapter structure
+ * @txch: TX channel
+ * @ch: TX channel number
+ * @eop_bd: EOP buffer descriptor flagged with EOQ by the hardware
+ *
+ * The only place where TX completion synchronizes with xmit. If xmit has
+ * linked more packets behind @eop_bd without noticing the stop (and
+ * clearing EOQ), the channel is restarted here; otherwise it is idle and
+ * the next xmit restarts it.
+ *
+ */
+static void emac_tx_eoq(struct emac_priv *priv, struct emac_txch *txch,
+			u32 ch, struct emac_tx_bd __iomem *eop_bd)
+{
+	unsigned long flags;
+	u32 frame_status;
+
+	spin_lock_irqsave(&txch->lock, flags);
+	frame_status = eop_bd->mode;
+	if (frame_status & EMAC_CPPI_EOQ_BIT) {
+		if (eop_bd != txch->active_queue_tail) { /* misqueued */
+			emac_write(EMAC_TXHDP(ch), eop_bd->h_next);
+			eop_bd->mode = frame_status & ~EMAC_CPPI_EOQ_BIT;
+			++txch->mis_queued_packets;
+		} else {
+			txch->queue_active = 0; /* end of queue */
+		}
+	}
+	spin_unlock_irqrestore(&txch->lock, flags);
+}
+
 /**
  * emac_tx_bdproc: TX buffer descriptor (packet) processing
  * @priv: The DaVinci EMAC private adapter structure
@@ -1287,20 +1828,25 @@ static void emac_stop_txch(struct emac_priv *priv, u32 ch)
  * @pending: indication to caller that packets are pending to process
  *
  * Processes TX buffer descriptors after packets are transmitted - checks
- * ownership bit on the TX * descriptor and requeues it to free pool & frees
- * the SKB buffer. Only "budget" number of packets are processed and
- * indication of pending packets provided to the caller
+ * ownership bit on the SOP descriptor of each packet and reclaims all of
+ * the packet's descriptors. Reclaim runs without any lock shared with
+ * xmit; the completion pointer is written once for the whole batch, the
+ * SKBs are freed together and a stopped queue is woken only once enough
+ * descriptors are free again. Only "budget" number of packets are
+ * processed and indication of pending packets provided to the caller
  *
  * Returns number of packets processed
  */
 static int emac_tx_bdproc(struct emac_priv *priv, u32 ch, u32 budget)
 {
 	struct device *emac_dev = &priv->ndev->dev;
-	unsigned long flags;
+	struct netdev_queue *txq = netdev_get_tx_queue(priv->ndev, ch);
 	u32 frame_status;
 	u32 pkts_processed = 0;
 	u32 tx_complete_cnt = 0;
+	u32 reclaimed = 0;
 	struct emac_tx_bd __iomem *curr_bd;
+	struct emac_tx_bd __iomem *eop_bd = NULL;
 	struct emac_txch *txch = priv->txch[ch];
 	u32 *tx_complete_ptr = txch->tx_complete;
 
@@ -1313,49 +1859,70 @@ static int emac_tx_bdproc(struct emac_priv *priv, u32 ch, u32 budget)
 	}
 
 	++txch->proc_count;
-	spin_lock_irqsave(&priv->tx_lock, flags);
-	curr_bd = txch->active_queue_head;
-	if (NULL == curr_bd) {
-		emac_write(EMAC_TXCP(ch),
-			   emac_virt_to_phys(txch->last_hw_bdprocessed));
-		txch->no_active_pkts++;
-		spin_unlock_irqrestore(&priv->tx_lock, flags);
-		return 0;
-	}
-	BD_CACHE_INVALIDATE(curr_bd, EMAC_BD_LENGTH_FOR_CACHE);
-	frame_status = curr_bd->mode;
-	while ((curr_bd) &&
-	      ((frame_status & EMAC_CPPI_OWNERSHIP_BIT) == 0) &&
-	      (pkts_processed < budget)) {
-		emac_write(EMAC_TXCP(ch), emac_virt_to_phys(curr_bd));
-		txch->active_queue_head = curr_bd->next;
-		if (frame_status & EMAC_CPPI_EOQ_BIT) {
-			if (curr_bd->next) {	/* misqueued packet */
-				emac_write(EMAC_TXHDP(ch), curr_bd->h_next);
-				++txch->mis_queued_packets;
-			} else {
-				txch->queue_active = 0; /* end of queue */
-			}
+	curr_bd = txch->reclaim_bd;
+	while ((txch->reclaimed_bd + reclaimed !=
+		ACCESS_ONCE(txch->queued_bd)) &&
+	       (pkts_processed < budget)) {
+		smp_rmb(); /* BDs were written before queued_bd moved */
+		BD_CACHE_INVALIDATE(curr_bd, EMAC_BD_LENGTH_FOR_CACHE);
+		if (curr_bd->mode & EMAC_CPPI_OWNERSHIP_BIT)
+			break;
+
+		/* hardware releases the SOP descriptor and flags end of
+		 * queue on the EOP descriptor of the packet */
+		eop_bd = curr_bd;
+		while (!(eop_bd->mode & EMAC_CPPI_EOP_BIT)) {
+			eop_bd = eop_bd->next;
+			BD_CACHE_INVALIDATE(eop_bd, EMAC_BD_LENGTH_FOR_CACHE);
 		}
-		*tx_complete_ptr = (u32) curr_bd->buf_token;
+		frame_status = eop_bd->mode;
+		if (frame_status & EMAC_CPPI_EOQ_BIT)
+			emac_tx_eoq(priv, txch, ch, eop_bd);
+
+		*tx_complete_ptr = (u32) eop_bd->buf_token;
 		++tx_complete_ptr;
 		++tx_complete_cnt;
-		curr_bd->next = txch->bd_pool_head;
-		txch->bd_pool_head = curr_bd;
-		--txch->active_queue_count;
-		pkts_processed++;
-		txch->last_hw_bdprocessed = curr_bd;
-		curr_bd = txch->active_queue_head;
-		if (curr_bd) {
-			BD_CACHE_INVALIDATE(curr_bd, EMAC_BD_LENGTH_FOR_CACHE);
-			frame_status = curr_bd->mode;
+
+		/* reclaim every descriptor of the packet */
+		for (;;) {
+			emac_tx_unmap_bd(priv, curr_bd);
+			++reclaimed;
+			if (curr_bd == eop_bd)
+				break;
+			curr_bd = curr_bd->next;
 		}
-	} /* end of pkt processing loop */
+		curr_bd = curr_bd->next;
+		pkts_processed++;
+	}
+
+	if (eop_bd) {
+		/* one completion pointer write acknowledges the batch */
+		emac_write(EMAC_TXCP(ch), emac_virt_to_phys(eop_bd));
+		txch->last_hw_bdprocessed = eop_bd;
+		txch->reclaim_bd = curr_bd;
+		smp_mb(); /* BDs are reclaimed before xmit may reuse them */
+		txch->reclaimed_bd += reclaimed;
+	} else if (txch->reclaimed_bd == txch->queued_bd) {
+		emac_write(EMAC_TXCP(ch),
+			   emac_virt_to_phys(txch->last_hw_bdprocessed));
+		txch->no_active_pkts++;
+	}
 
 	emac_net_tx_complete(priv,
 			     (void *)&txch->tx_complete[0],
 			     tx_complete_cnt, ch);
-	spin_unlock_irqrestore(&priv->tx_lock, flags);
+
+	/* pairs with the stop/recheck in emac_dev_xmit() */
+	smp_mb();
+	if (unlikely(netif_tx_queue_stopped(txq) &&
+		     emac_tx_free_bd(txch) >= txch->wake_thresh &&
+		     netif_carrier_ok(priv->ndev))) {
+		__netif_tx_lock(txq, smp_processor_id());
+		if (netif_tx_queue_stopped(txq) &&
+		    emac_tx_free_bd(txch) >= txch->wake_thresh)
+			netif_tx_wake_queue(txq);
+		__netif_tx_unlock(txq);
+	}
 	return pkts_processed;
 }
 
@@ -1367,7 +1934,15 @@ static int emac_tx_bdproc(struct emac_priv *priv, u32 ch, u32 budget)
  * @pkt: packet pointer (contains skb ptr)
  * @ch: TX channel number
  *
- * Called by the transmit function to queue the packet in EMAC hardware queue
+ * Called by the transmit function to queue the packet in EMAC hardware queue.
+ * Every buffer of the packet gets its own descriptor; the packet length and
+ * ownership go in the SOP descriptor and the skb token in the EOP one. The
+ * buffers must already be padded to the minimum frame size and mapped.
+ *
+ * The descriptors are filled without a lock, xmit being the only user of
+ * the ring's free end. The channel lock is only held to append the packet
+ * to the hardware queue, and the head descriptor pointer is written only
+ * when the channel is idle or has stopped at end of queue.
  *
  * Returns success(0) or error code (typically out of desc's)
  */
@@ -1375,68 +1950,71 @@ static int emac_send(struct emac_priv *priv, struct emac_netpktobj *pkt, u32 ch)
 {
 	unsigned long flags;
 	struct emac_tx_bd __iomem *curr_bd;
+	struct emac_tx_bd __iomem *first_bd;
+	struct emac_tx_bd __iomem *last_bd = NULL;
+	struct emac_tx_bd __iomem *tail_bd;
 	struct emac_txch *txch;
 	struct emac_netbufobj *buf_list;
+	u32 frame_status;
+	int cnt;
 
 	txch = priv->txch[ch];
 	buf_list = pkt->buf_list;   /* get handle to the buffer array */
 
-	/* check packet size and pad if short */
-	if (pkt->pkt_length < EMAC_DEF_MIN_ETHPKTSIZE) {
-		buf_list->length += (EMAC_DEF_MIN_ETHPKTSIZE - pkt->pkt_length);
-		pkt->pkt_length = EMAC_DEF_MIN_ETHPKTSIZE;
-	}
-
-	spin_lock_irqsave(&priv->tx_lock, flags);
-	curr_bd = txch->bd_pool_head;
-	if (curr_bd == NULL) {
+	if (unlikely(emac_tx_free_bd(txch) < pkt->num_bufs)) {
 		txch->out_of_tx_bd++;
-		spin_unlock_irqrestore(&priv->tx_lock, flags);
 		return EMAC_ERR_TX_OUT_OF_BD;
 	}
 
-	txch->bd_pool_head = curr_bd->next;
-	curr_bd->buf_token = buf_list->buf_token;
-	/* FIXME buff_ptr = dma_map_single(... data_ptr ...) */
-	curr_bd->buff_ptr = virt_to_phys(buf_list->data_ptr);
-	curr_bd->off_b_len = buf_list->length;
-	curr_bd->h_next = 0;
-	curr_bd->next = NULL;
-	curr_bd->mode = (EMAC_CPPI_SOP_BIT | EMAC_CPPI_OWNERSHIP_BIT |
-			 EMAC_CPPI_EOP_BIT | pkt->pkt_length);
-
-	/* flush the packet from cache if write back cache is present */
-	BD_CACHE_WRITEBACK_INVALIDATE(curr_bd, EMAC_BD_LENGTH_FOR_CACHE);
+	first_bd = curr_bd = txch->fill_bd;
+	for (cnt = 0; cnt < pkt->num_bufs; cnt++) {
+		last_bd = curr_bd;
+		curr_bd->buf_token = NULL;
+		curr_bd->buff_ptr = buf_list[cnt].dma_addr;
+		curr_bd->off_b_len = buf_list[cnt].length;
+		curr_bd->mode = 0;
+		curr_bd->h_next = (cnt + 1 < pkt->num_bufs) ?
+			(int)emac_virt_to_phys(curr_bd->next) : 0;
+		curr_bd = curr_bd->next;
+	}
+	first_bd->mode = (EMAC_CPPI_SOP_BIT | EMAC_CPPI_OWNERSHIP_BIT |
+			  pkt->pkt_length);
+	last_bd->mode |= EMAC_CPPI_EOP_BIT;
+	last_bd->buf_token = pkt->pkt_token;
+	txch->fill_bd = curr_bd;
+
+	/* flush the descriptors from cache if write back cache is present */
+	for (curr_bd = first_bd; ; curr_bd = curr_bd->next) {
+		BD_CACHE_WRITEBACK_INVALIDATE(curr_bd,
+					      EMAC_BD_LENGTH_FOR_CACHE);
+		if (curr_bd == last_bd)
+			break;
+	}
+	wmb();
 
 	/* send the packet */
-	if (txch->active_queue_head == NULL) {
-		txch->active_queue_head = curr_bd;
-		txch->active_queue_tail = curr_bd;
-		if (1 != txch->queue_active) {
-			emac_write(EMAC_TXHDP(ch),
-					emac_virt_to_phys(curr_bd));
-			txch->queue_active = 1;
-		}
+	spin_lock_irqsave(&txch->lock, flags);
+	tail_bd = txch->active_queue_tail;
+	txch->active_queue_tail = last_bd;
+	if (1 != txch->queue_active) {
+		emac_write(EMAC_TXHDP(ch), emac_virt_to_phys(first_bd));
+		txch->queue_active = 1;
 		++txch->queue_reinit;
 	} else {
-		register struct emac_tx_bd __iomem *tail_bd;
-		register u32 frame_status;
-
-		tail_bd = txch->active_queue_tail;
-		tail_bd->next = curr_bd;
-		txch->active_queue_tail = curr_bd;
 		tail_bd = EMAC_VIRT_NOCACHE(tail_bd);
-		tail_bd->h_next = (int)emac_virt_to_phys(curr_bd);
+		tail_bd->h_next = (int)emac_virt_to_phys(first_bd);
 		frame_status = tail_bd->mode;
 		if (frame_status & EMAC_CPPI_EOQ_BIT) {
-			emac_write(EMAC_TXHDP(ch), emac_virt_to_phys(curr_bd));
+			emac_write(EMAC_TXHDP(ch), emac_virt_to_phys(first_bd));
 			frame_status &= ~(EMAC_CPPI_EOQ_BIT);
 			tail_bd->mode = frame_status;
 			++txch->end_of_queue_add;
 		}
 	}
-	txch->active_queue_count++;
-	spin_unlock_irqrestore(&priv->tx_lock, flags);
+	spin_unlock_irqrestore(&txch->lock, flags);
+
+	smp_wmb(); /* BDs are complete before completion may look at them */
+	txch->queued_bd += pkt->num_bufs;
 	return 0;
 }
 
@@ -1454,9 +2032,14 @@ static int emac_dev_xmit(struct sk_buff *skb, struct net_device *ndev)
 {
 	struct device *emac_dev = &ndev->dev;
 	int ret_code;
-	struct emac_netbufobj tx_buf; /* buffer obj-only single frame support */
+	struct emac_netbufobj tx_buf[MAX_SKB_FRAGS + 1]; /* head + fragments */
 	struct emac_netpktobj tx_packet;  /* packet object */
 	struct emac_priv *priv = netdev_priv(ndev);
+	struct device *dma_dev = &priv->pdev->dev;
+	struct emac_txch *txch;
+	skb_frag_t *frag;
+	int cnt, pad;
+	u16 ch = skb_get_queue_mapping(skb);
 
 	/* If no link, return */
 	if (unlikely(!priv->link)) {
@@ -1465,60 +2048,127 @@ static int emac_dev_xmit(struct sk_buff *skb, struct net_device *ndev)
 		return NETDEV_TX_BUSY;
 	}
 
-	/* Build the buffer and packet objects - Since only single fragment is
-	 * supported, need not set length and token in both packet & object.
-	 * Doing so for completeness sake & to show that this needs to be done
-	 * in multifragment case
+	/* The EMAC has no checksum engine. NETIF_F_HW_CSUM is off by default,
+	 * so the stack checksums while it copies the data. It can be switched
+	 * on (ethtool -K tx on sg on) to let sendfile hand over page fragments
+	 * without that copy, the checksum is then folded in here instead */
+	if (skb->ip_summed == CHECKSUM_PARTIAL && skb_checksum_help(skb))
+		goto drop;
+
+	/* pad short frames in place - this also linearizes them, so the
+	 * padding always lands in the head buffer */
+	if (skb_padto(skb, EMAC_DEF_MIN_ETHPKTSIZE)) {
+		priv->net_dev_stats.tx_dropped++;
+		return NETDEV_TX_OK;
+	}
+	pad = max_t(int, EMAC_DEF_MIN_ETHPKTSIZE - (int)skb->len, 0);
+
+	/* Build the buffer and packet objects - one buffer for the skb head
+	 * and one per page fragment, each one mapped for the hardware
 	 */
-	tx_packet.buf_list = &tx_buf;
-	tx_packet.num_bufs = 1; /* only single fragment supported */
-	tx_packet.pkt_length = skb->len;
+	tx_packet.buf_list = tx_buf;
+	tx_packet.num_bufs = skb_shinfo(skb)->nr_frags + 1;
+	tx_packet.pkt_length = skb->len + pad;
 	tx_packet.pkt_token = (void *)skb;
-	tx_buf.length = skb->len;
-	tx_buf.buf_token = (void *)skb;
-	tx_buf.data_ptr = skb->data;
-	EMAC_CACHE_WRITEBACK((unsigned long)skb->data, skb->len);
+	tx_buf[0].length = skb_headlen(skb) + pad;
+	tx_buf[0].buf_token = (void *)skb;
+	tx_buf[0].data_ptr = skb->data;
+	tx_buf[0].dma_addr = dma_map_single(dma_dev, skb->data,
+					    tx_buf[0].length, DMA_TO_DEVICE);
+	for (cnt = 1; cnt < tx_packet.num_bufs; cnt++) {
+		frag = &skb_shinfo(skb)->frags[cnt - 1];
+		tx_buf[cnt].length = frag->size;
+		tx_buf[cnt].buf_token = (void *)skb;
+		tx_buf[cnt].data_ptr = NULL;
+		tx_buf[cnt].dma_addr = dma_map_page(dma_dev, frag->page,
+						    frag->page_offset,
+						    frag->size, DMA_TO_DEVICE);
+	}
+
 	ndev->trans_start = jiffies;
-	ret_code = emac_send(priv, &tx_packet, EMAC_DEF_TX_CH);
+	ret_code = emac_send(priv, &tx_packet, ch);
 	if (unlikely(ret_code != 0)) {
+		dma_unmap_single(dma_dev, tx_buf[0].dma_addr, tx_buf[0].length,
+				 DMA_TO_DEVICE);
+		for (cnt = 1; cnt < tx_packet.num_bufs; cnt++)
+			dma_unmap_page(dma_dev, tx_buf[cnt].dma_addr,
+				       tx_buf[cnt].length, DMA_TO_DEVICE);
 		if (ret_code == EMAC_ERR_TX_OUT_OF_BD) {
 			if (netif_msg_tx_err(priv) && net_ratelimit())
 				dev_err(emac_dev, "DaVinci EMAC: xmit() fatal"\
 					" err. Out of TX BD's");
-			netif_stop_queue(priv->ndev);
+			netif_stop_subqueue(priv->ndev, ch);
 		}
 		priv->net_dev_stats.tx_dropped++;
 		return NETDEV_TX_BUSY;
 	}
 
+	/* stop while a worst case packet may no longer fit, completion
+	 * wakes the queue once wake_thresh descriptors are free again */
+	txch = priv->txch[ch];
+	priv->tx_ring_hist[emac_hist_bucket(txch->num_bd -
+					    emac_tx_free_bd(txch))]++;
+	if (unlikely(emac_tx_free_bd(txch) < EMAC_TX_STOP_THRESH)) {
+		netif_stop_subqueue(ndev, ch);
+		smp_mb(); /* pairs with emac_tx_bdproc() */
+		if (emac_tx_free_bd(txch) >= txch->wake_thresh)
+			netif_start_subqueue(ndev, ch);
+	}
+
+	return NETDEV_TX_OK;
+
+drop:
+	priv->net_dev_stats.tx_dropped++;
+	dev_kfree_skb_any(skb);
 	return NETDEV_TX_OK;
 }
 
+/**
+ * emac_dev_select_queue: Pick the TX channel for a packet
+ * @ndev: The DaVinci EMAC network adapter
+ * @skb: SKB pointer
+ *
+ * TX queues map one to one onto EMAC TX channels, chosen from the skb
+ * priority through emac_prio_to_txch[]
+ *
+ * Returns the TX queue index
+ */
+static u16 emac_dev_select_queue(struct net_device *ndev, struct sk_buff *skb)
+{
+	struct emac_priv *priv = netdev_priv(ndev);
+
+	return min_t(u16, emac_prio_to_txch[skb->priority & TC_PRIO_MAX],
+		     priv->num_tx_ch - 1);
+}
+
 /**
  * emac_dev_tx_timeout: EMAC Transmit timeout function
  * @ndev: The DaVinci EMAC network adapter
  *
  * Called when system detects that a skb timeout period has expired
  * potentially due to a fault in the adapter in not being able to send
- * it out on the wire. We teardown the TX channel assuming a hardware
- * error and re-initialize the TX channel for hardware operation
+ * it out on the wire. We teardown the TX channels assuming a hardware
+ * error and re-initialize the TX channels for hardware operation
  *
  */
 static void emac_dev_tx_timeout(struct net_device *ndev)
 {
 	struct emac_priv *priv = netdev_priv(ndev);
 	struct device *emac_dev = &ndev->dev;
+	u32 ch;
 
 	if (netif_msg_tx_err(priv))
 		dev_err(emac_dev, "DaVinci EMAC: xmit timeout, restarting TX");
 
 	priv->net_dev_stats.tx_errors++;
 	emac_int_disable(priv);
-	emac_stop_txch(priv, EMAC_DEF_TX_CH);
-	emac_cleanup_txch(priv, EMAC_DEF_TX_CH);
-	emac_init_txch(priv, EMAC_DEF_TX_CH);
-	emac_write(EMAC_TXHDP(0), 0);
-	emac_write(EMAC_TXINTMASKSET, BIT(EMAC_DEF_TX_CH));
+	for (ch = 0; ch < priv->num_tx_ch; ch++) {
+		emac_stop_txch(priv, ch);
+		emac_cleanup_txch(priv, ch);
+		emac_init_txch(priv, ch);
+		emac_write(EMAC_TXHDP(ch), 0);
+		emac_write(EMAC_TXINTMASKSET, BIT(ch));
+	}
 	emac_int_enable(priv);
 }
 
@@ -1529,8 +2179,9 @@ static void emac_dev_tx_timeout(struct net_device *ndev)
  * @data_token: data token returned (skb handle for storing in buffer desc)
  * @ch: RX channel number
  *
- * Called during RX channel setup - allocates skb buffer of required size
- * and provides the skb handle and allocated buffer data pointer to caller
+ * Called during RX channel setup and refill - takes a skb recycled from TX
+ * completion, or allocates one of required size, and provides the skb
+ * handle and buffer data pointer to caller
  *
  * Returns skb data pointer or 0 on failure to alloc skb
  */
@@ -1541,7 +2192,9 @@ static void *emac_net_alloc_rx_buf(struct emac_priv *priv, int buf_size,
 	struct device *emac_dev = &ndev->dev;
 	struct sk_buff *p_skb;
 
-	p_skb = dev_alloc_skb(buf_size);
+	p_skb = skb_dequeue(&priv->rx_recycle);
+	if (p_skb == NULL)
+		p_skb = dev_alloc_skb(buf_size);
 	if (unlikely(NULL == p_skb)) {
 		if (netif_msg_rx_err(priv) && net_ratelimit())
 			dev_err(emac_dev, "DaVinci EMAC: failed to alloc skb");
@@ -1552,10 +2205,38 @@ static void *emac_net_alloc_rx_buf(struct emac_priv *priv, int buf_size,
 	p_skb->dev = ndev;
 	skb_reserve(p_skb, NET_IP_ALIGN);
 	*data_token = (void *) p_skb;
-	EMAC_CACHE_WRITEBACK_INVALIDATE((unsigned long)p_skb->data, buf_size);
+	/* the whole buffer is overwritten by DMA, so dirty lines need not be
+	 * written back - invalidate only cleans partial lines at the ends */
+	EMAC_CACHE_INVALIDATE((unsigned long)p_skb->data, buf_size);
 	return p_skb->data;
 }
 
+/**
+ * emac_rx_copybreak: Copy a small received frame out of its DMA buffer
+ * @priv: The DaVinci EMAC private adapter structure
+ * @data: DMA buffer holding the frame, already invalidated
+ * @len: frame length
+ *
+ * Returns a new skb holding the frame (data not yet "put"), or NULL if the
+ * frame is too big to copy or no memory is available
+ */
+static struct sk_buff *emac_rx_copybreak(struct emac_priv *priv,
+					 void *data, u32 len)
+{
+	struct sk_buff *p_skb;
+
+	if ((int)len > rx_copybreak)
+		return NULL;
+
+	p_skb = netdev_alloc_skb(priv->ndev, len + NET_IP_ALIGN);
+	if (unlikely(NULL == p_skb))
+		return NULL;
+
+	skb_reserve(p_skb, NET_IP_ALIGN);
+	skb_copy_to_linear_data(p_skb, data, len);
+	return p_skb;
+}
+
 /**
  * emac_init_rxch: RX channel initialization
  * @priv: The DaVinci EMAC private adapter structure
@@ -1593,9 +2274,9 @@ static int emac_init_rxch(struct emac_priv *priv, u32 ch, char *param)
 	/* allocate buffer descriptor pool align every BD on four word
 	 * boundry for future requirements */
 	bd_size = (sizeof(struct emac_rx_bd) + 0xF) & ~0xF;
-	rxch->num_bd = (priv->ctrl_ram_size >> 1) / bd_size;
+	rxch->num_bd = EMAC_RX_BD_MEM_SIZE(priv) / bd_size;
 	rxch->alloc_size = (((bd_size * rxch->num_bd) + 0xF) & ~0xF);
-	rxch->bd_mem = EMAC_RX_BD_MEM(priv);
+	rxch->bd_mem = EMAC_RX_BD_MEM(priv, ch);
 	__memzero((void __force *)rxch->bd_mem, rxch->alloc_size);
 	rxch->pkt_queue.buf_list = &rxch->buf_queue;
 
@@ -1610,7 +2291,7 @@ static int emac_init_rxch(struct emac_priv *priv, u32 ch, char *param)
 		curr_bd->data_ptr = emac_net_alloc_rx_buf(priv,
 				    rxch->buf_size,
 				    (void __force **)&curr_bd->buf_token,
-				    EMAC_DEF_RX_CH);
+				    ch);
 		if (curr_bd->data_ptr == NULL) {
 			dev_err(emac_dev, "DaVinci EMAC: RX buf mem alloc " \
 				"failed for ch %d\n", ch);
@@ -1923,8 +2604,8 @@ static void emac_addbd_to_rx_queue(struct emac_priv *priv, u32 ch,
  * @priv: The DaVinci EMAC private adapter structure
  * @net_pkt_list: Network packet list (received packets)
  *
- * Invalidates packet buffer memory and sends the received packet to upper
- * layer
+ * Sends the received packet to upper layer through GRO. The packet buffer
+ * has already been invalidated by emac_rx_bdproc()
  *
  * Returns success or appropriate error code (none as of now)
  */
@@ -1935,9 +2616,8 @@ static int emac_net_rx_cb(struct emac_priv *priv,
 	p_skb = (struct sk_buff *)net_pkt_list->pkt_token;
 	/* set length of packet */
 	skb_put(p_skb, net_pkt_list->pkt_length);
-	EMAC_CACHE_INVALIDATE((unsigned long)p_skb->data, p_skb->len);
 	p_skb->protocol = eth_type_trans(p_skb, priv->ndev);
-	netif_receive_skb(p_skb);
+	napi_gro_receive(&priv->napi, p_skb);
 	priv->net_dev_stats.rx_bytes += net_pkt_list->pkt_length;
 	priv->net_dev_stats.rx_packets++;
 	return 0;
@@ -1953,6 +2633,7 @@ static int emac_net_rx_cb(struct emac_priv *priv,
  * Processes RX buffer descriptors - checks ownership bit on the RX buffer
  * descriptor, sends the receive packet to upper layer, allocates a new SKB
  * and recycles the buffer descriptor (requeues it in hardware RX queue).
+ * Small packets are copied instead and their buffer is requeued as is.
  * Only "budget" number of packets are processed and indication of pending
  * packets provided to the caller.
  *
@@ -1964,6 +2645,8 @@ static int emac_rx_bdproc(struct emac_priv *priv, u32 ch, u32 budget)
 	u32 frame_status;
 	u32 pkts_processed = 0;
 	char *new_buffer;
+	struct sk_buff *copy_skb;
+	u32 pkt_length;
 	struct emac_rx_bd __iomem *curr_bd;
 	struct emac_rx_bd __iomem *last_bd;
 	struct emac_netpktobj *curr_pkt, pkt_obj;
@@ -1986,22 +2669,34 @@ static int emac_rx_bdproc(struct emac_priv *priv, u32 ch, u32 budget)
 	       ((frame_status & EMAC_CPPI_OWNERSHIP_BIT) == 0) &&
 	       (pkts_processed < budget)) {
 
-		new_buffer = emac_net_alloc_rx_buf(priv, rxch->buf_size,
-					&new_buf_token, EMAC_DEF_RX_CH);
-		if (unlikely(NULL == new_buffer)) {
-			++rxch->out_of_rx_buffers;
-			goto end_emac_rx_bdproc;
+		/* only the received bytes need to come from memory */
+		pkt_length = frame_status & EMAC_RX_BD_PKT_LENGTH_MASK;
+		EMAC_CACHE_INVALIDATE((unsigned long)curr_bd->data_ptr,
+				      pkt_length);
+
+		copy_skb = emac_rx_copybreak(priv, curr_bd->data_ptr,
+					     pkt_length);
+		if (copy_skb) {
+			/* DMA buffer goes straight back to the hardware */
+			new_buffer = curr_bd->data_ptr;
+			new_buf_token = curr_bd->buf_token;
+		} else {
+			new_buffer = emac_net_alloc_rx_buf(priv,
+					rxch->buf_size, &new_buf_token, ch);
+			if (unlikely(NULL == new_buffer)) {
+				++rxch->out_of_rx_buffers;
+				goto end_emac_rx_bdproc;
+			}
 		}
 
 		/* populate received packet data structure */
 		rx_buf_obj = &curr_pkt->buf_list[0];
 		rx_buf_obj->data_ptr = (char *)curr_bd->data_ptr;
 		rx_buf_obj->length = curr_bd->off_b_len & EMAC_RX_BD_BUF_SIZE;
-		rx_buf_obj->buf_token = curr_bd->buf_token;
+		rx_buf_obj->buf_token = copy_skb ? copy_skb : curr_bd->buf_token;
 		curr_pkt->pkt_token = curr_pkt->buf_list->buf_token;
 		curr_pkt->num_bufs = 1;
-		curr_pkt->pkt_length =
-			(frame_status & EMAC_RX_BD_PKT_LENGTH_MASK);
+		curr_pkt->pkt_length = pkt_length;
 		emac_write(EMAC_RXCP(ch), emac_virt_to_phys(curr_bd));
 		++rxch->processed_bd;
 		last_bd = curr_bd;
@@ -2062,6 +2757,9 @@ static int emac_hw_enable(struct emac_priv *priv)
 
 	/* Disable interrupt & Set pacing for more interrupts initially */
 	emac_int_disable(priv);
+	priv->coal_rx_pkts = 0;
+	priv->coal_stamp = jiffies;
+	emac_set_pacing(priv, priv->coal_rx_usecs, priv->coal_tx_usecs);
 
 	/* Full duplex enable bit set when auto negotiation happens */
 	mac_control =
@@ -2104,13 +2802,16 @@ static int emac_hw_enable(struct emac_priv *priv)
 	emac_write(EMAC_RXCONTROL, val);
 	emac_write(EMAC_MACINTMASKSET, EMAC_MAC_HOST_ERR_INTMASK_VAL);
 
-	for (ch = 0; ch < EMAC_DEF_MAX_TX_CH; ch++) {
+	for (ch = 0; ch < priv->num_tx_ch; ch++) {
 		emac_write(EMAC_TXHDP(ch), 0);
 		emac_write(EMAC_TXINTMASKSET, BIT(ch));
 	}
 	for (ch = 0; ch < EMAC_DEF_MAX_RX_CH; ch++) {
 		struct emac_rxch *rxch = priv->rxch[ch];
-		emac_setmac(priv, ch, rxch->mac_addr);
+		/* unicast frames only match on the default channel, the
+		 * others are fed by the multicast/broadcast channel masks */
+		if (ch == EMAC_DEF_RX_CH)
+			emac_setmac(priv, ch, rxch->mac_addr);
 		emac_write(EMAC_RXINTMASKSET, BIT(ch));
 		rxch->queue_active = 1;
 		emac_write(EMAC_RXHDP(ch),
@@ -2150,32 +2851,42 @@ static int emac_poll(struct napi_struct *napi, int budget)
 	struct device *emac_dev = &ndev->dev;
 	u32 status = 0;
 	u32 num_pkts = 0;
+	int ch;
 
 	/* Check interrupt vectors and call packet processing */
 	status = emac_read(EMAC_MACINVECTOR);
 
-	mask = EMAC_DM644X_MAC_IN_VECTOR_TX_INT_VEC;
+	/* highest priority channels first, as the hardware arbiter does */
+	for (ch = priv->num_tx_ch - 1; ch >= 0; ch--) {
+		mask = EMAC_DM644X_MAC_IN_VECTOR_TX_INT_VEC(ch);
 
-	if (priv->version == EMAC_VERSION_2)
-		mask = EMAC_DM646X_MAC_IN_VECTOR_TX_INT_VEC;
+		if (priv->version == EMAC_VERSION_2)
+			mask = EMAC_DM646X_MAC_IN_VECTOR_TX_INT_VEC(ch);
 
-	if (status & mask) {
-		num_pkts = emac_tx_bdproc(priv, EMAC_DEF_TX_CH,
-					  EMAC_DEF_TX_MAX_SERVICE);
+		if (status & mask) {
+			num_pkts += emac_tx_bdproc(priv, ch,
+						   EMAC_DEF_TX_MAX_SERVICE);
+		}
 	} /* TX processing */
 
 	if (num_pkts)
 		return budget;
 
-	mask = EMAC_DM644X_MAC_IN_VECTOR_RX_INT_VEC;
+	for (ch = EMAC_DEF_MAX_RX_CH - 1; ch >= 0 && num_pkts < budget; ch--) {
+		mask = EMAC_DM644X_MAC_IN_VECTOR_RX_INT_VEC(ch);
 
-	if (priv->version == EMAC_VERSION_2)
-		mask = EMAC_DM646X_MAC_IN_VECTOR_RX_INT_VEC;
+		if (priv->version == EMAC_VERSION_2)
+			mask = EMAC_DM646X_MAC_IN_VECTOR_RX_INT_VEC(ch);
 
-	if (status & mask) {
-		num_pkts = emac_rx_bdproc(priv, EMAC_DEF_RX_CH, budget);
+		if (status & mask) {
+			num_pkts += emac_rx_bdproc(priv, ch,
+						   budget - num_pkts);
+		}
 	} /* RX processing */
 
+	priv->rx_poll_hist[emac_hist_bucket(num_pkts)]++;
+	emac_adapt_pacing(priv, num_pkts);
+
 	if (num_pkts < budget) {
 		napi_complete(napi);
 		emac_int_enable(priv);
@@ -2188,7 +2899,7 @@ static int emac_poll(struct napi_struct *napi, int budget)
 	if (unlikely(status & mask)) {
 		u32 ch, cause;
 		dev_err(emac_dev, "DaVinci EMAC: Fatal Hardware Error\n");
-		netif_stop_queue(ndev);
+		netif_tx_stop_all_queues(ndev);
 		napi_disable(&priv->napi);
 
 		status = emac_read(EMAC_MACSTATUS);
@@ -2412,16 +3123,22 @@ static int emac_dev_open(struct net_device *ndev)
 	emac_write(EMAC_MACHASH1, 0);
 	emac_write(EMAC_MACHASH2, 0);
 
-	/* multi ch not supported - open 1 TX, 1RX ch by default */
-	rc = emac_init_txch(priv, EMAC_DEF_TX_CH);
-	if (0 != rc) {
-		dev_err(emac_dev, "DaVinci EMAC: emac_init_txch() failed");
-		return rc;
+	/* open all TX/RX channels, each with its share of BD memory */
+	for (ch = 0; ch < priv->num_tx_ch; ch++) {
+		rc = emac_init_txch(priv, ch);
+		if (0 != rc) {
+			dev_err(emac_dev, "DaVinci EMAC: emac_init_txch() "\
+				"failed");
+			return rc;
+		}
 	}
-	rc = emac_init_rxch(priv, EMAC_DEF_RX_CH, priv->mac_addr);
-	if (0 != rc) {
-		dev_err(emac_dev, "DaVinci EMAC: emac_init_rxch() failed");
-		return rc;
+	for (ch = 0; ch < EMAC_DEF_MAX_RX_CH; ch++) {
+		rc = emac_init_rxch(priv, ch, priv->mac_addr);
+		if (0 != rc) {
+			dev_err(emac_dev, "DaVinci EMAC: emac_init_rxch() "\
+				"failed");
+			return rc;
+		}
 	}
 
 	/* Request IRQ */
@@ -2517,19 +3234,31 @@ static int emac_dev_stop(struct net_device *ndev)
 	struct resource *res;
 	int i = 0;
 	int irq_num;
+	u32 ch;
+	unsigned long flags;
 	struct emac_priv *priv = netdev_priv(ndev);
 	struct device *emac_dev = &ndev->dev;
 
 	/* inform the upper layers. */
-	netif_stop_queue(ndev);
+	netif_tx_stop_all_queues(ndev);
 	napi_disable(&priv->napi);
 
 	netif_carrier_off(ndev);
 	emac_int_disable(priv);
-	emac_stop_txch(priv, EMAC_DEF_TX_CH);
-	emac_stop_rxch(priv, EMAC_DEF_RX_CH);
-	emac_cleanup_txch(priv, EMAC_DEF_TX_CH);
-	emac_cleanup_rxch(priv, EMAC_DEF_RX_CH);
+	for (ch = 0; ch < priv->num_tx_ch; ch++)
+		emac_stop_txch(priv, ch);
+	for (ch = 0; ch < EMAC_DEF_MAX_RX_CH; ch++)
+		emac_stop_rxch(priv, ch);
+	for (ch = 0; ch < priv->num_tx_ch; ch++)
+		emac_cleanup_txch(priv, ch);
+	for (ch = 0; ch < EMAC_DEF_MAX_RX_CH; ch++)
+		emac_cleanup_rxch(priv, ch);
+	skb_queue_purge(&priv->rx_recycle);
+
+	/* collect the hardware counters before the reset clears them */
+	spin_lock_irqsave(&priv->lock, flags);
+	emac_update_hw_stats(priv);
+	spin_unlock_irqrestore(&priv->lock, flags);
 	emac_write(EMAC_SOFTRESET, 1);
 
 	if (priv->phydev)
@@ -2559,49 +3288,37 @@ static int emac_dev_stop(struct net_device *ndev)
 static struct net_device_stats *emac_dev_getnetstats(struct net_device *ndev)
 {
 	struct emac_priv *priv = netdev_priv(ndev);
-	u32 mac_control;
-	u32 stats_clear_mask;
+	unsigned long flags;
 
-	/* update emac hardware stats and reset the registers*/
+#define EMAC_HW_STAT(reg)	(priv->hw_stats[EMAC_HW_STAT_IDX(reg)])
 
-	mac_control = emac_read(EMAC_MACCONTROL);
+	/* update emac hardware stats, the registers are cleared as read */
+	spin_lock_irqsave(&priv->lock, flags);
+	if (netif_running(ndev))
+		emac_update_hw_stats(priv);
 
-	if (mac_control & EMAC_MACCONTROL_GMIIEN)
-		stats_clear_mask = EMAC_STATS_CLR_MASK;
-	else
-		stats_clear_mask = 0;
+	priv->net_dev_stats.multicast = EMAC_HW_STAT(EMAC_RXMCASTFRAMES);
 
-	priv->net_dev_stats.multicast += emac_read(EMAC_RXMCASTFRAMES);
-	emac_write(EMAC_RXMCASTFRAMES, stats_clear_mask);
+	priv->net_dev_stats.collisions = EMAC_HW_STAT(EMAC_TXCOLLISION) +
+					 EMAC_HW_STAT(EMAC_TXSINGLECOLL) +
+					 EMAC_HW_STAT(EMAC_TXMULTICOLL);
 
-	priv->net_dev_stats.collisions += (emac_read(EMAC_TXCOLLISION) +
-					   emac_read(EMAC_TXSINGLECOLL) +
-					   emac_read(EMAC_TXMULTICOLL));
-	emac_write(EMAC_TXCOLLISION, stats_clear_mask);
-	emac_write(EMAC_TXSINGLECOLL, stats_clear_mask);
-	emac_write(EMAC_TXMULTICOLL, stats_clear_mask);
+	priv->net_dev_stats.rx_length_errors = EMAC_HW_STAT(EMAC_RXOVERSIZED) +
+					       EMAC_HW_STAT(EMAC_RXJABBER) +
+					       EMAC_HW_STAT(EMAC_RXUNDERSIZED);
 
-	priv->net_dev_stats.rx_length_errors += (emac_read(EMAC_RXOVERSIZED) +
-						emac_read(EMAC_RXJABBER) +
-						emac_read(EMAC_RXUNDERSIZED));
-	emac_write(EMAC_RXOVERSIZED, stats_clear_mask);
-	emac_write(EMAC_RXJABBER, stats_clear_mask);
-	emac_write(EMAC_RXUNDERSIZED, stats_clear_mask);
+	priv->net_dev_stats.rx_over_errors = EMAC_HW_STAT(EMAC_RXSOFOVERRUNS) +
+					     EMAC_HW_STAT(EMAC_RXMOFOVERRUNS);
 
-	priv->net_dev_stats.rx_over_errors += (emac_read(EMAC_RXSOFOVERRUNS) +
-					       emac_read(EMAC_RXMOFOVERRUNS));
-	emac_write(EMAC_RXSOFOVERRUNS, stats_clear_mask);
-	emac_write(EMAC_RXMOFOVERRUNS, stats_clear_mask);
+	priv->net_dev_stats.rx_fifo_errors = EMAC_HW_STAT(EMAC_RXDMAOVERRUNS);
 
-	priv->net_dev_stats.rx_fifo_errors += emac_read(EMAC_RXDMAOVERRUNS);
-	emac_write(EMAC_RXDMAOVERRUNS, stats_clear_mask);
+	priv->net_dev_stats.tx_carrier_errors =
+		EMAC_HW_STAT(EMAC_TXCARRIERSENSE);
 
-	priv->net_dev_stats.tx_carrier_errors +=
-		emac_read(EMAC_TXCARRIERSENSE);
-	emac_write(EMAC_TXCARRIERSENSE, stats_clear_mask);
+	priv->net_dev_stats.tx_fifo_errors = EMAC_HW_STAT(EMAC_TXUNDERRUN);
+	spin_unlock_irqrestore(&priv->lock, flags);
 
-	priv->net_dev_stats.tx_fifo_errors = emac_read(EMAC_TXUNDERRUN);
-	emac_write(EMAC_TXUNDERRUN, stats_clear_mask);
+#undef EMAC_HW_STAT
 
 	return &priv->net_dev_stats;
 }
@@ -2610,6 +3327,7 @@ static const struct net_device_ops emac_netdev_ops = {
 	.ndo_open		= emac_dev_open,
 	.ndo_stop		= emac_dev_stop,
 	.ndo_start_xmit		= emac_dev_xmit,
+	.ndo_select_queue	= emac_dev_select_queue,
 	.ndo_set_multicast_list	= emac_dev_mcast_set,
 	.ndo_set_mac_address	= emac_dev_setmac_addr,
 	.ndo_do_ioctl		= emac_devioctl,
@@ -2638,6 +3356,7 @@ static int __devinit davinci_emac_probe(struct platform_device *pdev)
 	struct emac_platform_data *pdata;
 	struct device *emac_dev;
 	int i = 0, mac_addr[6], macaddr_hi, macaddr_lo;
+	u32 num_tx_ch = clamp(tx_channels, 1, EMAC_DEF_MAX_TX_CH);
 
 	/* obtain emac clock from kernel */
 	emac_clk = clk_get(&pdev->dev, NULL);
@@ -2648,7 +3367,7 @@ static int __devinit davinci_emac_probe(struct platform_device *pdev)
 	emac_bus_frequency = clk_get_rate(emac_clk);
 	/* TODO: Probe PHY here if possible */
 
-	ndev = alloc_etherdev(sizeof(struct emac_priv));
+	ndev = alloc_etherdev_mq(sizeof(struct emac_priv), num_tx_ch);
 	if (!ndev) {
 		printk(KERN_ERR "DaVinci EMAC: Error allocating net_device\n");
 		clk_put(emac_clk);
@@ -2659,11 +3378,12 @@ static int __devinit davinci_emac_probe(struct platform_device *pdev)
 	priv = netdev_priv(ndev);
 	priv->pdev = pdev;
 	priv->ndev = ndev;
+	priv->num_tx_ch = num_tx_ch;
 	priv->msg_enable = netif_msg_init(debug_level, DAVINCI_EMAC_DEBUG);
 
-	spin_lock_init(&priv->tx_lock);
 	spin_lock_init(&priv->rx_lock);
 	spin_lock_init(&priv->lock);
+	skb_queue_head_init(&priv->rx_recycle);
 
 	pdata = pdev->dev.platform_data;
 	if (!pdata) {
@@ -2679,6 +3399,17 @@ static int __devinit davinci_emac_probe(struct platform_device *pdev)
 	priv->rmii_en = pdata->rmii_en;
 	priv->version = pdata->version;
 	emac_dev = &ndev->dev;
+
+	/* interrupt pacing defaults, adjustable through ethtool -C */
+	priv->bus_freq_mhz = emac_bus_frequency / 1000000;
+	priv->coal_rx_usecs = EMAC_DEF_RX_COAL_USECS;
+	priv->coal_tx_usecs = EMAC_DEF_TX_COAL_USECS;
+	priv->coal_adaptive_rx = 1;
+	priv->coal_rx_usecs_low = EMAC_DEF_RX_COAL_USECS_LOW;
+	priv->coal_rx_usecs_high = EMAC_DEF_RX_COAL_USECS_HIGH;
+	priv->coal_pkt_rate_low = EMAC_DEF_COAL_PKT_RATE_LOW;
+	priv->coal_pkt_rate_high = EMAC_DEF_COAL_PKT_RATE_HIGH;
+	priv->coal_sample_intvl = EMAC_DEF_COAL_SAMPLE_INTVL;
 	/* Get EMAC platform data */
 	res = platform_get_resource(pdev, IORESOURCE_MEM, 0);
 	if (!res) {
@@ -2755,6 +3486,8 @@ static int __devinit davinci_emac_probe(struct platform_device *pdev)
 
 	ndev->netdev_ops = &emac_netdev_ops;
 	SET_ETHTOOL_OPS(ndev, &ethtool_ops);
+	/* no TX checksum offload by default, see emac_dev_xmit() */
+	ndev->features |= NETIF_F_GRO;
 	netif_napi_add(ndev, &priv->napi, emac_poll, EMAC_POLL_WEIGHT);
 
 	/* register the network device */
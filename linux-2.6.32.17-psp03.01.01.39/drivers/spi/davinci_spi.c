@@ -25,15 +25,25 @@
 #include <linux/err.h>
 #include <linux/clk.h>
 #include <linux/dma-mapping.h>
+#include <linux/workqueue.h>
+#include <linux/completion.h>
 #include <linux/spi/spi.h>
-#include <linux/spi/spi_bitbang.h>
 
 #include <mach/spi.h>
 #include <mach/edma.h>
 
 #include "davinci_spi.h"
 
-static unsigned use_dma;
+/* Messages moving at most this many bytes are shifted by PIO; setting up
+ * a DMA chain costs more than polling a few words.
+ */
+static unsigned pio_threshold = 32;
+module_param(pio_threshold, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(pio_threshold,
+		"Messages of up to this many bytes use PIO. Default = 32");
+
+/* Slack on top of a message's shift time before its DMA is given up */
+#define SPI_DMA_TIMEOUT_MS	1000
 
 #define	DAVINCI_SPI_NO_RESOURCE		((resource_size_t)-1)
 
@@ -99,10 +109,8 @@ static inline void clear_fmt_bits(void __iomem *addr, u32 bits, int cs_num)
 	clear_io_bits(addr + SPIFMT0 + (0x4 * cs_num), bits);
 }
 
-static void davinci_spi_set_dma_req(const struct spi_device *spi, int enable)
+static void davinci_spi_set_dma_req(struct davinci_spi *davinci_spi, int enable)
 {
-	struct davinci_spi *davinci_spi = spi_master_get_devdata(spi->master);
-
 	if (enable)
 		set_io_bits(davinci_spi->base + SPIINT, SPIINT_DMA_REQ_EN);
 	else
@@ -110,31 +118,35 @@ static void davinci_spi_set_dma_req(const struct spi_device *spi, int enable)
 }
 
 /*
- * Interface to control the chip select signal
+ * Interface to control the chip select signal.  Only the upper half of
+ * SPIDAT1 is written:  that updates CSNR and CSHOLD without shifting a
+ * word, and the data writes that follow, by CPU or EDMA, keep the chip
+ * selected until it is released.
  */
-static void davinci_spi_chipselect(struct spi_device *spi, int value)
+static void davinci_spi_cs_assert(struct davinci_spi *davinci_spi,
+		struct spi_device *spi)
 {
-	struct davinci_spi *davinci_spi;
-	struct davinci_spi_platform_data *pdata;
-	u32 data1_reg_val = 0;
+	u8 tmp = ~(0x1 << spi->chip_select);
 
-	davinci_spi = spi_master_get_devdata(spi->master);
-	pdata = davinci_spi->pdata;
+	clear_io_bits(davinci_spi->base + SPIDEF, ~tmp);
+
+	davinci_spi->data1_reg_val = SPIDAT1_CSHOLD_MASK
+		| (tmp << SPIDAT1_CSNR_SHIFT);
+	iowrite16(davinci_spi->data1_reg_val >> 16,
+			davinci_spi->base + SPIDAT1 + 2);
+}
 
+static void davinci_spi_cs_release(struct davinci_spi *davinci_spi)
+{
 	/*
 	 * Board specific chip select logic decides the polarity and cs
 	 * line for the controller
 	 */
-	if (value == BITBANG_CS_INACTIVE) {
-		set_io_bits(davinci_spi->base + SPIDEF, CS_DEFAULT);
-
-		data1_reg_val |= CS_DEFAULT << SPIDAT1_CSNR_SHIFT;
-		iowrite32(data1_reg_val, davinci_spi->base + SPIDAT1);
+	set_io_bits(davinci_spi->base + SPIDEF, CS_DEFAULT);
 
-		while ((ioread32(davinci_spi->base + SPIBUF)
-					& SPIBUF_RXEMPTY_MASK) == 0)
-			cpu_relax();
-	}
+	davinci_spi->data1_reg_val = CS_DEFAULT << SPIDAT1_CSNR_SHIFT;
+	iowrite16(davinci_spi->data1_reg_val >> 16,
+			davinci_spi->base + SPIDAT1 + 2);
 }
 
 /*
@@ -198,85 +210,6 @@ static int davinci_spi_setup_transfer(struct spi_device *spi,
 	return 0;
 }
 
-static void davinci_spi_dma_rx_callback(unsigned lch, u16 ch_status, void *data)
-{
-	struct spi_device *spi = (struct spi_device *)data;
-	struct davinci_spi *davinci_spi;
-	struct davinci_spi_dma *davinci_spi_dma;
-	struct davinci_spi_platform_data *pdata;
-
-	davinci_spi = spi_master_get_devdata(spi->master);
-	davinci_spi_dma = &(davinci_spi->dma_channels[spi->chip_select]);
-	pdata = davinci_spi->pdata;
-
-	if (ch_status == DMA_COMPLETE)
-		edma_stop(davinci_spi_dma->dma_rx_channel);
-	else
-		edma_clean_channel(davinci_spi_dma->dma_rx_channel);
-
-	complete(&davinci_spi_dma->dma_rx_completion);
-	/* We must disable the DMA RX request */
-	davinci_spi_set_dma_req(spi, 0);
-
-}
-
-static void davinci_spi_dma_tx_callback(unsigned lch, u16 ch_status, void *data)
-{
-	struct spi_device *spi = (struct spi_device *)data;
-	struct davinci_spi *davinci_spi;
-	struct davinci_spi_dma *davinci_spi_dma;
-	struct davinci_spi_platform_data *pdata;
-
-	davinci_spi = spi_master_get_devdata(spi->master);
-	davinci_spi_dma = &(davinci_spi->dma_channels[spi->chip_select]);
-	pdata = davinci_spi->pdata;
-
-	if (ch_status == DMA_COMPLETE)
-		edma_stop(davinci_spi_dma->dma_tx_channel);
-	else
-		edma_clean_channel(davinci_spi_dma->dma_tx_channel);
-
-	complete(&davinci_spi_dma->dma_tx_completion);
-	/* We must disable the DMA TX request */
-	davinci_spi_set_dma_req(spi, 0);
-
-}
-
-static int davinci_spi_request_dma(struct spi_device *spi)
-{
-	struct davinci_spi *davinci_spi;
-	struct davinci_spi_dma *davinci_spi_dma;
-	struct davinci_spi_platform_data *pdata;
-	struct device *sdev;
-	int r;
-
-	davinci_spi = spi_master_get_devdata(spi->master);
-	davinci_spi_dma = &davinci_spi->dma_channels[spi->chip_select];
-	pdata = davinci_spi->pdata;
-	sdev = davinci_spi->bitbang.master->dev.parent;
-
-	r = edma_alloc_channel(davinci_spi_dma->dma_rx_sync_dev,
-				davinci_spi_dma_rx_callback, spi,
-				davinci_spi_dma->eventq);
-	if (r < 0) {
-		dev_dbg(sdev, "Unable to request DMA channel for MibSPI RX\n");
-		return -EAGAIN;
-	}
-	davinci_spi_dma->dma_rx_channel = r;
-	r = edma_alloc_channel(davinci_spi_dma->dma_tx_sync_dev,
-				davinci_spi_dma_tx_callback, spi,
-				davinci_spi_dma->eventq);
-	if (r < 0) {
-		edma_free_channel(davinci_spi_dma->dma_rx_channel);
-		davinci_spi_dma->dma_rx_channel = -1;
-		dev_dbg(sdev, "Unable to request DMA channel for MibSPI TX\n");
-		return -EAGAIN;
-	}
-	davinci_spi_dma->dma_tx_channel = r;
-
-	return 0;
-}
-
 /*
  * davinci_spi_setup - This functions will set default transfer method
  * @spi: spi device on which data transfer to be done
@@ -288,7 +221,6 @@ static int davinci_spi_setup(struct spi_device *spi)
 {
 	int retval;
 	struct davinci_spi *davinci_spi;
-	struct davinci_spi_dma *davinci_spi_dma;
 
 	davinci_spi = spi_master_get_devdata(spi->master);
 
@@ -298,17 +230,6 @@ static int davinci_spi_setup(struct spi_device *spi)
 
 	davinci_spi->slave[spi->chip_select].cmd_to_write = 0;
 
-	if (use_dma && davinci_spi->dma_channels) {
-		davinci_spi_dma = &davinci_spi->dma_channels[spi->chip_select];
-
-		if ((davinci_spi_dma->dma_rx_channel == -1)
-				|| (davinci_spi_dma->dma_tx_channel == -1)) {
-			retval = davinci_spi_request_dma(spi);
-			if (retval < 0)
-				return retval;
-		}
-	}
-
 	/*
 	 * SPI in DaVinci and DA8xx operate between
 	 * 600 KHz and 50 MHz
@@ -404,28 +325,11 @@ static int davinci_spi_setup(struct spi_device *spi)
 	}
 
 	retval = davinci_spi_setup_transfer(spi, NULL);
+	davinci_spi->fmt_spi = NULL;
 
 	return retval;
 }
 
-static void davinci_spi_cleanup(struct spi_device *spi)
-{
-	struct davinci_spi *davinci_spi = spi_master_get_devdata(spi->master);
-	struct davinci_spi_dma *davinci_spi_dma;
-
-	davinci_spi_dma = &davinci_spi->dma_channels[spi->chip_select];
-
-	if (use_dma && davinci_spi->dma_channels) {
-		davinci_spi_dma = &davinci_spi->dma_channels[spi->chip_select];
-
-		if ((davinci_spi_dma->dma_rx_channel != -1)
-				&& (davinci_spi_dma->dma_tx_channel != -1)) {
-			edma_free_channel(davinci_spi_dma->dma_tx_channel);
-			edma_free_channel(davinci_spi_dma->dma_rx_channel);
-		}
-	}
-}
-
 static int davinci_spi_bufs_prep(struct spi_device *spi,
 				 struct davinci_spi *davinci_spi)
 {
@@ -461,7 +365,7 @@ static int davinci_spi_bufs_prep(struct spi_device *spi,
 static int davinci_spi_check_error(struct davinci_spi *davinci_spi,
 				   int int_status)
 {
-	struct device *sdev = davinci_spi->bitbang.master->dev.parent;
+	struct device *sdev = davinci_spi->master->dev.parent;
 
 	if (int_status & SPIFLG_TIMEOUT_MASK) {
 		dev_dbg(sdev, "SPI Time-out Error\n");
@@ -503,369 +407,614 @@ static int davinci_spi_check_error(struct davinci_spi *davinci_spi,
 }
 
 /*
- * davinci_spi_bufs - functions which will handle transfer data
- * @spi: spi device on which data transfer to be done
- * @t: spi transfer in which transfer info is filled
- *
- * This function will put data to be transferred into data register
- * of SPI controller and then wait until the completion will be marked
- * by the IRQ Handler.
+ * Message queue.  davinci_spi_transfer() only queues; a worker takes each
+ * message, selects the chip once and keeps it selected (CSHOLD) across
+ * its transfers, then either shifts the whole message by polling, when
+ * it is short or there is no DMA, or runs it as EDMA chains.  A chain
+ * covers as many consecutive transfers as it can, so for the usual
+ * command + address + data message only one DMA setup and one interrupt
+ * are needed.  Chains of a message follow each other straight from the
+ * DMA callback unless a delay is to be spent; the worker waits, with a
+ * timeout, until then or until the message is through, and completes it.
  */
-static int davinci_spi_bufs_pio(struct spi_device *spi, struct spi_transfer *t)
-{
-	struct davinci_spi *davinci_spi;
-	int int_status, count, ret;
-	u8 conv, tmp;
-	u32 tx_data, data1_reg_val;
-	u32 buf_val, flg_val;
-	struct davinci_spi_platform_data *pdata;
 
-	davinci_spi = spi_master_get_devdata(spi->master);
-	pdata = davinci_spi->pdata;
+static inline unsigned davinci_spi_xfer_bits(struct spi_device *spi,
+		struct spi_transfer *t)
+{
+	return t->bits_per_word ? : spi->bits_per_word;
+}
 
-	davinci_spi->tx = t->tx_buf;
-	davinci_spi->rx = t->rx_buf;
+static inline u32 davinci_spi_xfer_hz(struct spi_device *spi,
+		struct spi_transfer *t)
+{
+	return t->speed_hz ? : spi->max_speed_hz;
+}
 
-	/* convert len to words bbased on bits_per_word */
-	conv = davinci_spi->slave[spi->chip_select].bytes_per_word;
-	davinci_spi->count = t->len / conv;
+/* Reprogram SPIFMTn only when a transfer needs other settings */
+static int davinci_spi_prep_transfer(struct spi_device *spi,
+		struct spi_transfer *t)
+{
+	struct davinci_spi *davinci_spi = spi_master_get_devdata(spi->master);
+	unsigned bits = davinci_spi_xfer_bits(spi, t);
+	u32 hz = davinci_spi_xfer_hz(spi, t);
+	int ret;
 
-	INIT_COMPLETION(davinci_spi->done);
+	if (davinci_spi->fmt_spi == spi && davinci_spi->fmt_bits == bits
+			&& davinci_spi->fmt_hz == hz)
+		return 0;
 
-	ret = davinci_spi_bufs_prep(spi, davinci_spi);
-	if (ret)
+	ret = davinci_spi_setup_transfer(spi, t);
+	if (ret) {
+		davinci_spi->fmt_spi = NULL;
 		return ret;
+	}
 
-	/* Enable SPI */
-	set_io_bits(davinci_spi->base + SPIGCR1, SPIGCR1_SPIENA_MASK);
+	davinci_spi->fmt_spi = spi;
+	davinci_spi->fmt_bits = bits;
+	davinci_spi->fmt_hz = hz;
 
-	iowrite32(0 | (pdata->c2tdelay << SPI_C2TDELAY_SHIFT) |
-			(pdata->t2cdelay << SPI_T2CDELAY_SHIFT),
-			davinci_spi->base + SPIDELAY);
+	return 0;
+}
 
-	count = davinci_spi->count;
-	data1_reg_val = pdata->cs_hold << SPIDAT1_CSHOLD_SHIFT;
-	tmp = ~(0x1 << spi->chip_select);
+static struct spi_transfer *davinci_spi_next_xfer(struct spi_message *msg,
+		struct spi_transfer *t)
+{
+	if (t->transfer_list.next == &msg->transfers)
+		return NULL;
+	return list_entry(t->transfer_list.next, struct spi_transfer,
+			transfer_list);
+}
 
-	clear_io_bits(davinci_spi->base + SPIDEF, ~tmp);
+/* Honour delay_usecs and cs_change of the transfer before @t, if any */
+static void davinci_spi_xfer_gap(struct davinci_spi *davinci_spi,
+		struct spi_transfer *t)
+{
+	struct spi_message *msg = davinci_spi->cur_msg;
+	struct spi_transfer *prev;
+
+	if (t->transfer_list.prev == &msg->transfers)
+		return;
+	prev = list_entry(t->transfer_list.prev, struct spi_transfer,
+			transfer_list);
+
+	if (prev->delay_usecs)
+		udelay(prev->delay_usecs);
+
+	if (prev->cs_change) {
+		davinci_spi_cs_release(davinci_spi);
+		/* give the device a visible deselect */
+		udelay(1);
+		davinci_spi_cs_assert(davinci_spi, msg->spi);
+	}
+}
 
-	data1_reg_val |= tmp << SPIDAT1_CSNR_SHIFT;
+/* Called from the worker to hand the current message back */
+static void davinci_spi_msg_done(struct davinci_spi *davinci_spi, int status)
+{
+	struct spi_message *msg = davinci_spi->cur_msg;
+	struct spi_transfer *last;
+	unsigned long flags;
 
-	while ((ioread32(davinci_spi->base + SPIBUF)
-				& SPIBUF_RXEMPTY_MASK) == 0)
-		cpu_relax();
+	last = list_entry(msg->transfers.prev, struct spi_transfer,
+			transfer_list);
 
-	/* Determine the command to execute READ or WRITE */
-	if (t->tx_buf) {
-		clear_io_bits(davinci_spi->base + SPIINT, SPIINT_MASKALL);
+	/* cs_change on the last transfer asks to leave the chip selected */
+	if (!status && last->cs_change)
+		davinci_spi->cs_held = msg->spi;
+	else
+		davinci_spi_cs_release(davinci_spi);
 
-		while (1) {
-			tx_data = davinci_spi->get_tx(davinci_spi);
+	spin_lock_irqsave(&davinci_spi->lock, flags);
+	davinci_spi->cur_msg = NULL;
+	spin_unlock_irqrestore(&davinci_spi->lock, flags);
 
-			data1_reg_val &= ~(0xFFFF);
-			data1_reg_val |= (0xFFFF & tx_data);
+	msg->status = status;
+	if (msg->complete)
+		msg->complete(msg->context);
+}
 
-			buf_val = ioread32(davinci_spi->base + SPIBUF);
-			if ((buf_val & SPIBUF_TXFULL_MASK) == 0) {
-				iowrite32(data1_reg_val,
-						davinci_spi->base + SPIDAT1);
+static void davinci_spi_msg_start(struct davinci_spi *davinci_spi)
+{
+	struct spi_message *msg = davinci_spi->cur_msg;
+	struct spi_device *spi = msg->spi;
+	struct davinci_spi_platform_data *pdata = davinci_spi->pdata;
+	struct spi_transfer *t;
+	unsigned len = 0, ms = SPI_DMA_TIMEOUT_MS;
 
-				count--;
-			}
-			while (ioread32(davinci_spi->base + SPIBUF)
-					& SPIBUF_RXEMPTY_MASK)
-				cpu_relax();
-
-			/* getting the returned byte */
-			if (t->rx_buf) {
-				buf_val = ioread32(davinci_spi->base + SPIBUF);
-				davinci_spi->get_rx(buf_val, davinci_spi);
-			}
-			if (count <= 0)
-				break;
-		}
-	} else {
-		if (pdata->poll_mode) {
-			while (1) {
-				/* keeps the serial clock going */
-				if ((ioread32(davinci_spi->base + SPIBUF)
-						& SPIBUF_TXFULL_MASK) == 0)
-					iowrite32(data1_reg_val,
-						davinci_spi->base + SPIDAT1);
-
-				while (ioread32(davinci_spi->base + SPIBUF) &
-						SPIBUF_RXEMPTY_MASK)
-					cpu_relax();
-
-				flg_val = ioread32(davinci_spi->base + SPIFLG);
-				buf_val = ioread32(davinci_spi->base + SPIBUF);
-
-				davinci_spi->get_rx(buf_val, davinci_spi);
-
-				count--;
-				if (count <= 0)
-					break;
-			}
-		} else {	/* Receive in Interrupt mode */
-			int i;
+	if (davinci_spi->cs_held && davinci_spi->cs_held != spi)
+		davinci_spi_cs_release(davinci_spi);
+	davinci_spi->cs_held = NULL;
 
-			for (i = 0; i < davinci_spi->count; i++) {
-				set_io_bits(davinci_spi->base + SPIINT,
-						SPIINT_BITERR_INTR
-						| SPIINT_OVRRUN_INTR
-						| SPIINT_RX_INTR);
+	davinci_spi_bufs_prep(spi, davinci_spi);
 
-				iowrite32(data1_reg_val,
-						davinci_spi->base + SPIDAT1);
+	iowrite32(0 | (pdata->c2tdelay << SPI_C2TDELAY_SHIFT) |
+			(pdata->t2cdelay << SPI_T2CDELAY_SHIFT),
+			davinci_spi->base + SPIDELAY);
 
-				while (ioread32(davinci_spi->base + SPIINT) &
-						SPIINT_RX_INTR)
-					cpu_relax();
-			}
-			iowrite32((data1_reg_val & 0x0ffcffff),
-					davinci_spi->base + SPIDAT1);
-		}
-	}
+	/* no interrupts:  PIO polls, and DMA completion comes from EDMA */
+	clear_io_bits(davinci_spi->base + SPIINT, SPIINT_MASKALL);
+	set_io_bits(davinci_spi->base + SPIGCR1, SPIGCR1_SPIENA_MASK);
 
-	/*
-	 * Check for bit error, desync error,parity error,timeout error and
-	 * receive overflow errors
-	 */
-	int_status = ioread32(davinci_spi->base + SPIFLG);
+	while ((ioread32(davinci_spi->base + SPIBUF)
+				& SPIBUF_RXEMPTY_MASK) == 0)
+		cpu_relax();
 
-	ret = davinci_spi_check_error(davinci_spi, int_status);
-	if (ret != 0)
-		return ret;
+	davinci_spi_cs_assert(davinci_spi, spi);
 
-	/* SPI Framework maintains the count only in bytes so convert back */
-	davinci_spi->count *= conv;
+	list_for_each_entry(t, &msg->transfers, transfer_list) {
+		u32 khz = davinci_spi_xfer_hz(spi, t) / 1000;
 
-	return t->len;
-}
+		len += t->len;
+		ms += DIV_ROUND_UP(t->len * 8, khz ? : 1) +
+			t->delay_usecs / 1000;
+	}
+	davinci_spi->pio = !davinci_spi->use_dma || len <= pio_threshold;
+	davinci_spi->dma_timeout = msecs_to_jiffies(ms);
 
-#define DAVINCI_DMA_DATA_TYPE_S8	0x01
-#define DAVINCI_DMA_DATA_TYPE_S16	0x02
-#define DAVINCI_DMA_DATA_TYPE_S32	0x04
+	davinci_spi->cur_xfer = list_first_entry(&msg->transfers,
+			struct spi_transfer, transfer_list);
+}
 
-static int davinci_spi_bufs_dma(struct spi_device *spi, struct spi_transfer *t)
+/*
+ * davinci_spi_bufs_pio - shift one transfer by polling
+ * @spi: spi device on which data transfer to be done
+ * @t: spi transfer in which transfer info is filled
+ *
+ * Each word is written to SPIDAT1 with the message's chipselect and
+ * CSHOLD, and its received word is read back before the next one.
+ * Returns zero or a negative errno from the error flags.
+ */
+static int davinci_spi_bufs_pio(struct spi_device *spi, struct spi_transfer *t)
 {
 	struct davinci_spi *davinci_spi;
-	int int_status = 0;
-	int count;
-	u8 conv = 1;
-	u8 tmp;
+	u32 tx_data, buf_val;
 	u32 data1_reg_val;
-	struct davinci_spi_dma *davinci_spi_dma;
-	int word_len, data_type, ret;
-	unsigned long tx_reg, rx_reg;
-	struct davinci_spi_platform_data *pdata;
-	struct device *sdev;
+	int count;
+	u8 conv;
 
 	davinci_spi = spi_master_get_devdata(spi->master);
-	pdata = davinci_spi->pdata;
-	sdev = davinci_spi->bitbang.master->dev.parent;
+	data1_reg_val = davinci_spi->data1_reg_val & ~0xffff;
 
-	BUG_ON(davinci_spi->dma_channels == NULL);
-
-	davinci_spi_dma = &davinci_spi->dma_channels[spi->chip_select];
-
-	tx_reg = (unsigned long)davinci_spi->pbase + SPIDAT1;
-	rx_reg = (unsigned long)davinci_spi->pbase + SPIBUF;
-
-	/* used for macro defs */
 	davinci_spi->tx = t->tx_buf;
 	davinci_spi->rx = t->rx_buf;
 
 	/* convert len to words based on bits_per_word */
 	conv = davinci_spi->slave[spi->chip_select].bytes_per_word;
-	davinci_spi->count = t->len / conv;
+	count = t->len / conv;
 
-	INIT_COMPLETION(davinci_spi->done);
+	while (count--) {
+		tx_data = t->tx_buf ? davinci_spi->get_tx(davinci_spi) : 0;
 
-	init_completion(&davinci_spi_dma->dma_rx_completion);
-	init_completion(&davinci_spi_dma->dma_tx_completion);
+		while (ioread32(davinci_spi->base + SPIBUF)
+				& SPIBUF_TXFULL_MASK)
+			cpu_relax();
+		iowrite32(data1_reg_val | (tx_data & 0xffff),
+				davinci_spi->base + SPIDAT1);
 
-	word_len = conv * 8;
+		do {
+			buf_val = ioread32(davinci_spi->base + SPIBUF);
+		} while (buf_val & SPIBUF_RXEMPTY_MASK);
 
-	if (word_len <= 8)
-		data_type = DAVINCI_DMA_DATA_TYPE_S8;
-	else if (word_len <= 16)
-		data_type = DAVINCI_DMA_DATA_TYPE_S16;
-	else if (word_len <= 32)
-		data_type = DAVINCI_DMA_DATA_TYPE_S32;
-	else
-		return -1;
+		if (t->rx_buf)
+			davinci_spi->get_rx(buf_val, davinci_spi);
+	}
 
-	ret = davinci_spi_bufs_prep(spi, davinci_spi);
-	if (ret)
-		return ret;
+	/*
+	 * Check for bit error, desync error,parity error,timeout error and
+	 * receive overflow errors
+	 */
+	return davinci_spi_check_error(davinci_spi,
+			ioread32(davinci_spi->base + SPIFLG));
+}
 
-	/* Put delay val if required */
-	iowrite32(0 | (pdata->c2tdelay << SPI_C2TDELAY_SHIFT) |
-			(pdata->t2cdelay << SPI_T2CDELAY_SHIFT),
-			davinci_spi->base + SPIDELAY);
+/* Run the rest of the current message by PIO, back to back */
+static void davinci_spi_msg_pio(struct davinci_spi *davinci_spi)
+{
+	struct spi_message *msg = davinci_spi->cur_msg;
+	struct spi_transfer *t = davinci_spi->cur_xfer;
+	int status = 0;
 
-	count = davinci_spi->count;	/* the number of elements */
-	data1_reg_val = pdata->cs_hold << SPIDAT1_CSHOLD_SHIFT;
+	list_for_each_entry_from(t, &msg->transfers, transfer_list) {
+		davinci_spi_xfer_gap(davinci_spi, t);
 
-	/* CD default = 0xFF */
-	tmp = ~(0x1 << spi->chip_select);
+		status = davinci_spi_prep_transfer(msg->spi, t);
+		if (status)
+			break;
 
-	clear_io_bits(davinci_spi->base + SPIDEF, ~tmp);
+		status = davinci_spi_bufs_pio(msg->spi, t);
+		if (status)
+			break;
 
-	data1_reg_val |= tmp << SPIDAT1_CSNR_SHIFT;
+		msg->actual_length += t->len;
+	}
 
-	/* disable all interrupts for dma transfers */
-	clear_io_bits(davinci_spi->base + SPIINT, SPIINT_MASKALL);
-	/* Disable SPI to write configuration bits in SPIDAT */
-	clear_io_bits(davinci_spi->base + SPIGCR1, SPIGCR1_SPIENA_MASK);
-	iowrite32(data1_reg_val, davinci_spi->base + SPIDAT1);
-	/* Enable SPI */
-	set_io_bits(davinci_spi->base + SPIGCR1, SPIGCR1_SPIENA_MASK);
+	davinci_spi_msg_done(davinci_spi, status);
+}
 
-	while ((ioread32(davinci_spi->base + SPIBUF)
-				& SPIBUF_RXEMPTY_MASK) == 0)
-		cpu_relax();
+static int davinci_spi_map_xfer(struct davinci_spi *davinci_spi,
+		struct spi_message *msg, struct spi_transfer *t)
+{
+	struct device *sdev = davinci_spi->master->dev.parent;
 
+	if (msg->is_dma_mapped || !t->len)
+		return 0;
 
-	if (t->tx_buf != NULL) {
-		t->tx_dma = dma_map_single(&spi->dev, (void *)t->tx_buf, count,
+	if (t->tx_buf) {
+		t->tx_dma = dma_map_single(sdev, (void *)t->tx_buf, t->len,
 				DMA_TO_DEVICE);
-		if (dma_mapping_error(&spi->dev, t->tx_dma)) {
+		if (dma_mapping_error(sdev, t->tx_dma)) {
 			dev_dbg(sdev, "Couldn't DMA map a %d bytes TX buffer\n",
-					count);
-			return -1;
+					t->len);
+			return -ENOMEM;
 		}
-		edma_set_transfer_params(davinci_spi_dma->dma_tx_channel, data_type,
-			count, 1, 0, ASYNC);
-		edma_set_dest(davinci_spi_dma->dma_tx_channel,
-				tx_reg, INCR, W8BIT);
-		edma_set_src(davinci_spi_dma->dma_tx_channel,
-				t->tx_dma, INCR, W8BIT);
-		edma_set_src_index(davinci_spi_dma->dma_tx_channel, data_type, 0);
-		edma_set_dest_index(davinci_spi_dma->dma_tx_channel, 0, 0);
-	} else {
-		/* We need TX clocking for RX transaction */
-		t->tx_dma = dma_map_single(&spi->dev,
-				(void *)davinci_spi->tmp_buf, count + 1,
-				DMA_TO_DEVICE);
-		if (dma_mapping_error(&spi->dev, t->tx_dma)) {
-			dev_dbg(sdev, "Couldn't DMA map a %d bytes TX tmp buffer\n",
-					count);
-			return -1;
-		}
-		edma_set_transfer_params(davinci_spi_dma->dma_tx_channel,
-				data_type, count + 1, 1, 0, ASYNC);
-		edma_set_dest(davinci_spi_dma->dma_tx_channel, tx_reg,
-				INCR, W8BIT);
-		edma_set_src(davinci_spi_dma->dma_tx_channel,
-				t->tx_dma, INCR, W8BIT);
-		edma_set_src_index(davinci_spi_dma->dma_tx_channel,
-				data_type, 0);
-		edma_set_dest_index(davinci_spi_dma->dma_tx_channel, 0, 0);
 	}
 
-	if (t->rx_buf != NULL) {
-		/* initiate transaction */
-		iowrite32(data1_reg_val, davinci_spi->base + SPIDAT1);
-
-		t->rx_dma = dma_map_single(&spi->dev, (void *)t->rx_buf, count,
+	if (t->rx_buf) {
+		t->rx_dma = dma_map_single(sdev, t->rx_buf, t->len,
 				DMA_FROM_DEVICE);
-		if (dma_mapping_error(&spi->dev, t->rx_dma)) {
+		if (dma_mapping_error(sdev, t->rx_dma)) {
 			dev_dbg(sdev, "Couldn't DMA map a %d bytes RX buffer\n",
-					count);
-			if (t->tx_buf != NULL)
-				dma_unmap_single(NULL, t->tx_dma,
-						 count, DMA_TO_DEVICE);
-			return -1;
+					t->len);
+			if (t->tx_buf)
+				dma_unmap_single(sdev, t->tx_dma, t->len,
+						DMA_TO_DEVICE);
+			return -ENOMEM;
 		}
-		edma_set_transfer_params(davinci_spi_dma->dma_rx_channel, data_type,
-				count, 1, 0, ASYNC);
-		edma_set_src(davinci_spi_dma->dma_rx_channel,
-				rx_reg, INCR, W8BIT);
-		edma_set_dest(davinci_spi_dma->dma_rx_channel,
-				t->rx_dma, INCR, W8BIT);
-		edma_set_src_index(davinci_spi_dma->dma_rx_channel, 0, 0);
-		edma_set_dest_index(davinci_spi_dma->dma_rx_channel, data_type, 0);
 	}
 
-	if ((t->tx_buf != NULL) || (t->rx_buf != NULL))
-		edma_start(davinci_spi_dma->dma_tx_channel);
+	return 0;
+}
+
+static void davinci_spi_unmap_xfer(struct davinci_spi *davinci_spi,
+		struct spi_message *msg, struct spi_transfer *t)
+{
+	struct device *sdev = davinci_spi->master->dev.parent;
 
-	if (t->rx_buf != NULL)
-		edma_start(davinci_spi_dma->dma_rx_channel);
+	if (msg->is_dma_mapped || !t->len)
+		return;
 
-	if ((t->rx_buf != NULL) || (t->tx_buf != NULL))
-		davinci_spi_set_dma_req(spi, 1);
+	if (t->tx_buf)
+		dma_unmap_single(sdev, t->tx_dma, t->len, DMA_TO_DEVICE);
+	if (t->rx_buf)
+		dma_unmap_single(sdev, t->rx_dma, t->len, DMA_FROM_DEVICE);
+}
 
-	if (t->tx_buf != NULL)
-		wait_for_completion_interruptible(
-				&davinci_spi_dma->dma_tx_completion);
+/* Unmap the transfers of the chain that just ran */
+static void davinci_spi_unmap_chain(struct davinci_spi *davinci_spi)
+{
+	struct spi_message *msg = davinci_spi->cur_msg;
+	struct spi_transfer *t = davinci_spi->cur_xfer;
 
-	if (t->rx_buf != NULL)
-		wait_for_completion_interruptible(
-				&davinci_spi_dma->dma_rx_completion);
+	list_for_each_entry_from(t, &msg->transfers, transfer_list) {
+		if (t == davinci_spi->chain_end)
+			break;
+		davinci_spi_unmap_xfer(davinci_spi, msg, t);
+	}
+}
 
-	if (t->tx_buf != NULL)
-		dma_unmap_single(NULL, t->tx_dma, count, DMA_TO_DEVICE);
-	else
-		dma_unmap_single(NULL, t->tx_dma, count + 1, DMA_TO_DEVICE);
+/*
+ * Fill in the TX and RX parameter sets for one transfer:  a set of
+ * CCNT frames of SPI_DMA_BCNT words, then one for the rest.  Both are
+ * A-synchronized, one word per SPI event; the side without a buffer
+ * stays on its dummy word.  Returns the number of sets used per side.
+ */
+static unsigned davinci_spi_dma_sets(struct davinci_spi *davinci_spi,
+		struct spi_transfer *t, unsigned conv,
+		struct edmacc_param *tx, struct edmacc_param *rx)
+{
+	struct davinci_spi_dma *dma = &davinci_spi->dma;
+	unsigned words = t->len / conv;
+	unsigned frames = words / SPI_DMA_BCNT;
+	dma_addr_t src, dst;
+	u16 src_bidx, dst_bidx;
+	unsigned n;
+
+	src = t->tx_buf ? t->tx_dma : dma->dummy_dma;
+	dst = t->rx_buf ? t->rx_dma : dma->dummy_dma + sizeof(u32);
+	src_bidx = t->tx_buf ? conv : 0;
+	dst_bidx = t->rx_buf ? conv : 0;
+
+	for (n = 0; words; n++) {
+		unsigned bcnt = frames ? SPI_DMA_BCNT : words;
+		unsigned ccnt = frames ? frames : 1;
+
+		/* for A-sync frames CIDX counts from the last word's address */
+		tx[n].opt = EDMA_TCC(EDMA_CHAN_SLOT(dma->dma_tx_channel));
+		tx[n].src = src;
+		tx[n].a_b_cnt = bcnt << 16 | conv;
+		tx[n].dst = davinci_spi->pbase + SPIDAT1;
+		tx[n].src_dst_bidx = src_bidx;
+		tx[n].link_bcntrld = bcnt << 16;
+		tx[n].src_dst_cidx = src_bidx;
+		tx[n].ccnt = ccnt;
+
+		rx[n].opt = EDMA_TCC(EDMA_CHAN_SLOT(dma->dma_rx_channel));
+		rx[n].src = davinci_spi->pbase + SPIBUF;
+		rx[n].a_b_cnt = bcnt << 16 | conv;
+		rx[n].dst = dst;
+		rx[n].src_dst_bidx = dst_bidx << 16;
+		rx[n].link_bcntrld = bcnt << 16;
+		rx[n].src_dst_cidx = dst_bidx << 16;
+		rx[n].ccnt = ccnt;
+
+		src += src_bidx * bcnt * ccnt;
+		dst += dst_bidx * bcnt * ccnt;
+		words -= bcnt * ccnt;
+		frames = 0;
+	}
 
-	if (t->rx_buf != NULL)
-		dma_unmap_single(NULL, t->rx_dma, count, DMA_FROM_DEVICE);
+	return n;
+}
 
-	/*
-	 * Check for bit error, desync error,parity error,timeout error and
-	 * receive overflow errors
-	 */
-	int_status = ioread32(davinci_spi->base + SPIFLG);
+/*
+ * Build and start one EDMA chain from cur_xfer on.  A chain ends with the
+ * message, after a transfer asking for a delay or a chipselect change,
+ * before one needing another word size or clock, or when the parameter
+ * sets run out.  Only the last RX set interrupts:  every word sent is
+ * also received, so it marks the end of the chain.
+ *
+ * Returns zero once a chain runs, one if the message turned out to have
+ * nothing left to move, else a negative errno.
+ */
+static int davinci_spi_dma_chain(struct davinci_spi *davinci_spi)
+{
+	struct davinci_spi_dma *dma = &davinci_spi->dma;
+	struct spi_message *msg = davinci_spi->cur_msg;
+	struct spi_device *spi = msg->spi;
+	struct spi_transfer *first, *t;
+	unsigned bits, conv, n;
+	u32 hz;
+	int ret;
+
+	/* skip over transfers that only carry a delay or cs_change */
+	for (;;) {
+		first = davinci_spi->cur_xfer;
+		if (!first)
+			return 1;
+
+		davinci_spi_xfer_gap(davinci_spi, first);
+		if (first->len)
+			break;
 
-	ret = davinci_spi_check_error(davinci_spi, int_status);
-	if (ret != 0)
+		davinci_spi->cur_xfer = davinci_spi_next_xfer(msg, first);
+	}
+
+	ret = davinci_spi_prep_transfer(spi, first);
+	if (ret)
 		return ret;
 
-	/* SPI Framework maintains the count only in bytes so convert back */
-	davinci_spi->count *= conv;
+	bits = davinci_spi_xfer_bits(spi, first);
+	hz = davinci_spi_xfer_hz(spi, first);
+	conv = davinci_spi->slave[spi->chip_select].bytes_per_word;
+
+	n = 0;
+	davinci_spi->chain_len = 0;
+	for (t = first; t; ) {
+		struct spi_transfer *next = davinci_spi_next_xfer(msg, t);
+
+		if (t->len) {
+			if (davinci_spi_xfer_bits(spi, t) != bits
+					|| davinci_spi_xfer_hz(spi, t) != hz)
+				break;
+			if (n + 2 > SPI_DMA_NR_SETS)
+				break;
+
+			ret = davinci_spi_map_xfer(davinci_spi, msg, t);
+			if (ret) {
+				davinci_spi->chain_end = t;
+				davinci_spi_unmap_chain(davinci_spi);
+				return ret;
+			}
+
+			n += davinci_spi_dma_sets(davinci_spi, t, conv,
+					&dma->tx_params[n], &dma->rx_params[n]);
+			davinci_spi->chain_len += t->len;
+		}
+
+		t = next;
+		if (t && t->transfer_list.prev != &msg->transfers) {
+			struct spi_transfer *prev = list_entry(
+					t->transfer_list.prev,
+					struct spi_transfer, transfer_list);
+
+			if (prev->cs_change || prev->delay_usecs)
+				break;
+		}
+	}
+	davinci_spi->chain_end = t;
+
+	dma->rx_params[n - 1].opt |= TCINTEN;
+	edma_write_slot_chain(dma->tx_slots, dma->tx_params, n, false);
+	edma_write_slot_chain(dma->rx_slots, dma->rx_params, n, false);
+
+	davinci_spi->dma_running = true;
+	edma_start(dma->dma_rx_channel);
+	edma_start(dma->dma_tx_channel);
+	davinci_spi_set_dma_req(davinci_spi, 1);
+
+	return 0;
+}
+
+/* Stop the channels of the running chain; called with the lock held */
+static void davinci_spi_dma_stop(struct davinci_spi *davinci_spi)
+{
+	struct davinci_spi_dma *dma = &davinci_spi->dma;
 
-	return t->len;
+	/* We must disable the DMA requests */
+	davinci_spi_set_dma_req(davinci_spi, 0);
+	edma_stop(dma->dma_tx_channel);
+	edma_stop(dma->dma_rx_channel);
+	davinci_spi->dma_running = false;
 }
 
 /*
- * davinci_spi_irq - probe function for SPI Master Controller
- * @irq: IRQ number for this SPI Master
- * @context_data: structure for SPI Master controller davinci_spi
- *
- * ISR will determine that interrupt arrives either for READ or WRITE command.
- * According to command it will do the appropriate action. It will check
- * transfer length and if it is not zero then dispatch transfer command again.
- * If transfer length is zero then it will indicate the COMPLETION so that
- * davinci_spi_bufs function can go ahead.
+ * Runs with the lock held so that it can't race the worker giving up on
+ * the chain.  It starts the next chain itself when nothing is to be done
+ * in between, else it wakes the worker.
  */
-static irqreturn_t davinci_spi_irq(s32 irq, void *context_data)
+static void davinci_spi_dma_rx_callback(unsigned lch, u16 ch_status, void *data)
 {
-	struct davinci_spi *davinci_spi = context_data;
-	u32 int_status, rx_data = 0;
-	irqreturn_t ret = IRQ_NONE;
+	struct davinci_spi *davinci_spi = data;
+	struct davinci_spi_dma *dma = &davinci_spi->dma;
+	struct spi_message *msg;
+	struct spi_transfer *next, *last;
+	unsigned long flags;
+	int status;
+
+	spin_lock_irqsave(&davinci_spi->lock, flags);
+	if (!davinci_spi->dma_running) {
+		/* the worker timed it out already */
+		spin_unlock_irqrestore(&davinci_spi->lock, flags);
+		return;
+	}
+	davinci_spi_dma_stop(davinci_spi);
+	msg = davinci_spi->cur_msg;
+
+	if (ch_status == DMA_COMPLETE) {
+		status = davinci_spi_check_error(davinci_spi,
+				ioread32(davinci_spi->base + SPIFLG));
+	} else {
+		edma_clean_channel(dma->dma_tx_channel);
+		edma_clean_channel(dma->dma_rx_channel);
+		status = -EIO;
+	}
+
+	davinci_spi_unmap_chain(davinci_spi);
+	if (status == 0)
+		msg->actual_length += davinci_spi->chain_len;
+
+	next = davinci_spi->chain_end;
+	davinci_spi->cur_xfer = next;
+
+	/* carry on from here, unless there is a delay to spend first */
+	if (!status && next) {
+		last = list_entry(next->transfer_list.prev,
+				struct spi_transfer, transfer_list);
+		if (!last->delay_usecs && next->len) {
+			status = davinci_spi_dma_chain(davinci_spi);
+			if (status == 0)
+				goto out;
+			if (status > 0) {
+				status = 0;
+				davinci_spi->cur_xfer = NULL;
+			}
+		}
+	}
 
-	int_status = ioread32(davinci_spi->base + SPIFLG);
+	davinci_spi->dma_status = status;
+	complete(&davinci_spi->dma_done);
+out:
+	spin_unlock_irqrestore(&davinci_spi->lock, flags);
+}
 
-	while ((int_status & SPIFLG_RX_INTR_MASK)) {
-		if (likely(int_status & SPIFLG_RX_INTR_MASK)) {
-			ret = IRQ_HANDLED;
+/*
+ * Run the current message as EDMA chains.  If the DMA doesn't finish in
+ * time the channels are stopped and the message fails with -ETIMEDOUT,
+ * so one stuck transfer can't hold up the bus for good.
+ */
+static void davinci_spi_msg_dma(struct davinci_spi *davinci_spi)
+{
+	struct davinci_spi_dma *dma = &davinci_spi->dma;
+	unsigned long flags;
+	int status;
+
+	for (;;) {
+		INIT_COMPLETION(davinci_spi->dma_done);
+
+		status = davinci_spi_dma_chain(davinci_spi);
+		if (status) {
+			/* nothing left to move, or no chain could be set up */
+			davinci_spi_msg_done(davinci_spi,
+					status < 0 ? status : 0);
+			return;
+		}
 
-			rx_data = ioread32(davinci_spi->base + SPIBUF);
-			davinci_spi->get_rx(rx_data, davinci_spi);
+		wait_for_completion_timeout(&davinci_spi->dma_done,
+				davinci_spi->dma_timeout);
 
-			/* Disable Receive Interrupt */
-			iowrite32(~(SPIINT_RX_INTR | SPIINT_TX_INTR),
-					davinci_spi->base + SPIINT);
+		spin_lock_irqsave(&davinci_spi->lock, flags);
+		if (davinci_spi->dma_running) {
+			davinci_spi_dma_stop(davinci_spi);
+			edma_clean_channel(dma->dma_tx_channel);
+			edma_clean_channel(dma->dma_rx_channel);
+			davinci_spi_unmap_chain(davinci_spi);
+			status = -ETIMEDOUT;
 		} else
-			(void)davinci_spi_check_error(davinci_spi, int_status);
+			status = davinci_spi->dma_status;
+		spin_unlock_irqrestore(&davinci_spi->lock, flags);
 
-		int_status = ioread32(davinci_spi->base + SPIFLG);
+		if (status == -ETIMEDOUT)
+			dev_err(davinci_spi->master->dev.parent,
+					"DMA transfer timed out\n");
+
+		if (status || !davinci_spi->cur_xfer) {
+			davinci_spi_msg_done(davinci_spi, status);
+			return;
+		}
 	}
+}
 
-	return ret;
+static void davinci_spi_work(struct work_struct *work)
+{
+	struct davinci_spi *davinci_spi =
+		container_of(work, struct davinci_spi, work);
+	struct spi_message *msg;
+
+	spin_lock_irq(&davinci_spi->lock);
+	while (!list_empty(&davinci_spi->queue)) {
+		msg = list_first_entry(&davinci_spi->queue,
+				struct spi_message, queue);
+		list_del_init(&msg->queue);
+		davinci_spi->cur_msg = msg;
+		spin_unlock_irq(&davinci_spi->lock);
+
+		davinci_spi_msg_start(davinci_spi);
+
+		if (davinci_spi->pio)
+			davinci_spi_msg_pio(davinci_spi);
+		else
+			davinci_spi_msg_dma(davinci_spi);
+
+		spin_lock_irq(&davinci_spi->lock);
+	}
+	spin_unlock_irq(&davinci_spi->lock);
+}
+
+static int davinci_spi_transfer(struct spi_device *spi,
+		struct spi_message *msg)
+{
+	struct davinci_spi *davinci_spi = spi_master_get_devdata(spi->master);
+	struct spi_transfer *t;
+	unsigned long flags;
+	unsigned bits;
+
+	if (list_empty(&msg->transfers))
+		return -EINVAL;
+
+	list_for_each_entry(t, &msg->transfers, transfer_list) {
+		bits = davinci_spi_xfer_bits(spi, t);
+		if (bits < 2 || bits > 16)
+			return -EINVAL;
+		if (t->len && !t->tx_buf && !t->rx_buf)
+			return -EINVAL;
+		if (bits > 8 && (t->len & 1))
+			return -EINVAL;
+	}
+
+	msg->actual_length = 0;
+	msg->status = -EINPROGRESS;
+
+	spin_lock_irqsave(&davinci_spi->lock, flags);
+	if (davinci_spi->stopping) {
+		spin_unlock_irqrestore(&davinci_spi->lock, flags);
+		return -ESHUTDOWN;
+	}
+	list_add_tail(&msg->queue, &davinci_spi->queue);
+	if (!davinci_spi->cur_msg)
+		queue_work(davinci_spi->workqueue, &davinci_spi->work);
+	spin_unlock_irqrestore(&davinci_spi->lock, flags);
+
+	return 0;
 }
 
 resource_size_t davinci_spi_get_dma_by_flag(struct platform_device *dev,
@@ -885,16 +1034,88 @@ resource_size_t davinci_spi_get_dma_by_flag(struct platform_device *dev,
 	return DAVINCI_SPI_NO_RESOURCE;
 }
 
+/*
+ * Claim the RX and TX channels, the parameter sets linked behind them and
+ * the dummy words.  Only the RX channel interrupts.
+ */
+static int davinci_spi_request_dma(struct davinci_spi *davinci_spi)
+{
+	struct davinci_spi_dma *dma = &davinci_spi->dma;
+	struct device *sdev = davinci_spi->master->dev.parent;
+	int r;
+
+	r = edma_alloc_channel(dma->dma_rx_sync_dev,
+				davinci_spi_dma_rx_callback, davinci_spi,
+				dma->eventq);
+	if (r < 0) {
+		dev_dbg(sdev, "Unable to request DMA channel for MibSPI RX\n");
+		return -EAGAIN;
+	}
+	dma->dma_rx_channel = r;
+
+	r = edma_alloc_channel(dma->dma_tx_sync_dev, NULL, NULL, dma->eventq);
+	if (r < 0) {
+		dev_dbg(sdev, "Unable to request DMA channel for MibSPI TX\n");
+		r = -EAGAIN;
+		goto free_rx;
+	}
+	dma->dma_tx_channel = r;
+
+	dma->rx_slots[0] = dma->dma_rx_channel;
+	r = edma_alloc_slot_chain(EDMA_CTLR(dma->dma_rx_channel),
+			&dma->rx_slots[1], SPI_DMA_NR_SETS - 1, false);
+	if (r < 0)
+		goto free_tx;
+
+	dma->tx_slots[0] = dma->dma_tx_channel;
+	r = edma_alloc_slot_chain(EDMA_CTLR(dma->dma_tx_channel),
+			&dma->tx_slots[1], SPI_DMA_NR_SETS - 1, false);
+	if (r < 0)
+		goto free_rx_slots;
+
+	dma->dummy = dma_alloc_coherent(sdev, 2 * sizeof(u32),
+			&dma->dummy_dma, GFP_KERNEL);
+	if (dma->dummy == NULL) {
+		r = -ENOMEM;
+		goto free_tx_slots;
+	}
+	dma->dummy[0] = 0;
+
+	return 0;
+
+free_tx_slots:
+	edma_free_slot_chain(&dma->tx_slots[1], SPI_DMA_NR_SETS - 1);
+free_rx_slots:
+	edma_free_slot_chain(&dma->rx_slots[1], SPI_DMA_NR_SETS - 1);
+free_tx:
+	edma_free_channel(dma->dma_tx_channel);
+free_rx:
+	edma_free_channel(dma->dma_rx_channel);
+	return r;
+}
+
+static void davinci_spi_free_dma(struct davinci_spi *davinci_spi)
+{
+	struct davinci_spi_dma *dma = &davinci_spi->dma;
+
+	dma_free_coherent(davinci_spi->master->dev.parent, 2 * sizeof(u32),
+			dma->dummy, dma->dummy_dma);
+	edma_free_slot_chain(&dma->tx_slots[1], SPI_DMA_NR_SETS - 1);
+	edma_free_slot_chain(&dma->rx_slots[1], SPI_DMA_NR_SETS - 1);
+	edma_free_channel(dma->dma_tx_channel);
+	edma_free_channel(dma->dma_rx_channel);
+}
+
 /*
  * davinci_spi_probe - probe function for SPI Master Controller
  * @pdev: platform_device structure which contains plateform specific data
  *
  * According to Linux Device Model this function will be invoked by Linux
  * with plateform_device struct which contains the device specific info.
- * This function will map the SPI controller's memory, register IRQ,
- * Reset SPI controller and setting its registers to default value.
- * It will invoke spi_bitbang_start to create work queue so that client driver
- * can register transfer method to work queue.
+ * This function will map the SPI controller's memory, claim its DMA
+ * channels, reset the SPI controller and set its registers to default
+ * values.  It then creates the message queue's work queue and registers
+ * the master.
  */
 static int davinci_spi_probe(struct platform_device *pdev)
 {
@@ -905,7 +1126,7 @@ static int davinci_spi_probe(struct platform_device *pdev)
 	resource_size_t dma_rx_chan = DAVINCI_SPI_NO_RESOURCE;
 	resource_size_t	dma_tx_chan = DAVINCI_SPI_NO_RESOURCE;
 	resource_size_t	dma_eventq = DAVINCI_SPI_NO_RESOURCE;
-	int i = 0, ret = 0;
+	int ret = 0;
 
 	pdata = pdev->dev.platform_data;
 	if (pdata == NULL) {
@@ -951,30 +1172,10 @@ static int davinci_spi_probe(struct platform_device *pdev)
 		goto release_region;
 	}
 
-	davinci_spi->irq = platform_get_irq(pdev, 0);
-	if (davinci_spi->irq <= 0) {
-		ret = -EINVAL;
-		goto unmap_io;
-	}
-
-	ret = request_irq(davinci_spi->irq, davinci_spi_irq, IRQF_DISABLED,
-			  dev_name(&pdev->dev), davinci_spi);
-	if (ret != 0) {
-		ret = -EAGAIN;
-		goto unmap_io;
-	}
-
-	/* Allocate tmp_buf for tx_buf */
-	davinci_spi->tmp_buf = kzalloc(SPI_BUFSIZ, GFP_KERNEL);
-	if (davinci_spi->tmp_buf == NULL) {
-		ret = -ENOMEM;
-		goto err1;
-	}
-
-	davinci_spi->bitbang.master = spi_master_get(master);
-	if (davinci_spi->bitbang.master == NULL) {
+	davinci_spi->master = spi_master_get(master);
+	if (davinci_spi->master == NULL) {
 		ret = -ENODEV;
-		goto free_tmp_buf;
+		goto unmap_io;
 	}
 
 	davinci_spi->clk = clk_get(&pdev->dev, NULL);
@@ -988,19 +1189,22 @@ static int davinci_spi_probe(struct platform_device *pdev)
 	master->bus_num = pdev->id;
 	master->num_chipselect = pdata->num_chipselect;
 	master->setup = davinci_spi_setup;
-	master->cleanup = davinci_spi_cleanup;
-
-	davinci_spi->bitbang.chipselect = davinci_spi_chipselect;
-	davinci_spi->bitbang.setup_transfer = davinci_spi_setup_transfer;
+	master->transfer = davinci_spi_transfer;
 
 	davinci_spi->version = pdata->version;
-	use_dma = pdata->use_dma;
+	davinci_spi->use_dma = pdata->use_dma;
 
-	davinci_spi->bitbang.flags = SPI_NO_CS | SPI_LSB_FIRST | SPI_LOOP;
+	master->mode_bits = SPI_CPOL | SPI_CPHA | SPI_NO_CS | SPI_LSB_FIRST
+		| SPI_LOOP;
 	if (davinci_spi->version == SPI_VERSION_2)
-		davinci_spi->bitbang.flags |= SPI_READY;
+		master->mode_bits |= SPI_READY;
+
+	spin_lock_init(&davinci_spi->lock);
+	INIT_LIST_HEAD(&davinci_spi->queue);
+	INIT_WORK(&davinci_spi->work, davinci_spi_work);
+	init_completion(&davinci_spi->dma_done);
 
-	if (use_dma) {
+	if (davinci_spi->use_dma) {
 		dma_rx_chan = davinci_spi_get_dma_by_flag(pdev,
 						IORESOURCE_DMA_RX_CHAN);
 		dma_tx_chan = davinci_spi_get_dma_by_flag(pdev,
@@ -1009,31 +1213,21 @@ static int davinci_spi_probe(struct platform_device *pdev)
 						IORESOURCE_DMA_EVENT_Q);
 	}
 
-	if (!use_dma ||
+	if (!davinci_spi->use_dma ||
 	    dma_rx_chan == DAVINCI_SPI_NO_RESOURCE ||
 	    dma_tx_chan == DAVINCI_SPI_NO_RESOURCE ||
 	    dma_eventq	== DAVINCI_SPI_NO_RESOURCE) {
-		davinci_spi->bitbang.txrx_bufs = davinci_spi_bufs_pio;
-		use_dma = 0;
+		davinci_spi->use_dma = false;
 	} else {
-		davinci_spi->bitbang.txrx_bufs = davinci_spi_bufs_dma;
-		davinci_spi->dma_channels = kzalloc(master->num_chipselect
-				* sizeof(struct davinci_spi_dma), GFP_KERNEL);
-		if (davinci_spi->dma_channels == NULL) {
-			ret = -ENOMEM;
-			goto free_clk;
-		}
+		davinci_spi->dma.dma_rx_sync_dev = dma_rx_chan;
+		davinci_spi->dma.dma_tx_sync_dev = dma_tx_chan;
+		davinci_spi->dma.eventq = dma_eventq;
 
-		for (i = 0; i < master->num_chipselect; i++) {
-			davinci_spi->dma_channels[i].dma_rx_channel = -1;
-			davinci_spi->dma_channels[i].dma_rx_sync_dev =
-				dma_rx_chan;
-			davinci_spi->dma_channels[i].dma_tx_channel = -1;
-			davinci_spi->dma_channels[i].dma_tx_sync_dev =
-				dma_tx_chan;
-			davinci_spi->dma_channels[i].eventq = dma_eventq;
-		}
-		dev_info(&pdev->dev, "DaVinci SPI driver in EDMA mode\n"
+		if (davinci_spi_request_dma(davinci_spi) < 0) {
+			dev_warn(&pdev->dev, "no EDMA, using PIO\n");
+			davinci_spi->use_dma = false;
+		} else
+			dev_info(&pdev->dev, "DaVinci SPI driver in EDMA mode\n"
 				"Using RX channel = %d , TX channel = %d and "
 				"event queue = %d", dma_rx_chan, dma_tx_chan,
 				dma_eventq);
@@ -1042,8 +1236,6 @@ static int davinci_spi_probe(struct platform_device *pdev)
 	davinci_spi->get_rx = davinci_spi_rx_buf_u8;
 	davinci_spi->get_tx = davinci_spi_tx_buf_u8;
 
-	init_completion(&davinci_spi->done);
-
 	/* Reset In/OUT SPI module */
 	iowrite32(0, davinci_spi->base + SPIGCR0);
 	udelay(100);
@@ -1065,27 +1257,30 @@ static int davinci_spi_probe(struct platform_device *pdev)
 	else
 		iowrite32(SPI_INTLVL_0, davinci_spi->base + SPILVL);
 
-	ret = spi_bitbang_start(&davinci_spi->bitbang);
+	davinci_spi->workqueue = create_singlethread_workqueue(
+			dev_name(&pdev->dev));
+	if (davinci_spi->workqueue == NULL) {
+		ret = -EBUSY;
+		goto free_dma;
+	}
+
+	ret = spi_register_master(master);
 	if (ret != 0)
-		goto free_clk;
+		goto free_wq;
 
 	dev_info(&pdev->dev, "Controller at 0x%p \n", davinci_spi->base);
 
-	if (!pdata->poll_mode)
-		dev_info(&pdev->dev, "Operating in interrupt mode"
-			" using IRQ %d\n", davinci_spi->irq);
-
 	return ret;
 
-free_clk:
+free_wq:
+	destroy_workqueue(davinci_spi->workqueue);
+free_dma:
+	if (davinci_spi->use_dma)
+		davinci_spi_free_dma(davinci_spi);
 	clk_disable(davinci_spi->clk);
 	clk_put(davinci_spi->clk);
 put_master:
 	spi_master_put(master);
-free_tmp_buf:
-	kfree(davinci_spi->tmp_buf);
-err1:
-	free_irq(davinci_spi->irq, davinci_spi);
 unmap_io:
 	iounmap(davinci_spi->base);
 release_region:
@@ -1101,9 +1296,9 @@ err:
  * @pdev: platform_device structure which contains plateform specific data
  *
  * This function will do the reverse action of davinci_spi_probe function
- * It will free the IRQ and SPI controller's memory region.
- * It will also call spi_bitbang_stop to destroy the work queue which was
- * created by spi_bitbang_start.
+ * It will unregister the master, which no longer accepts messages once
+ * its devices are gone, then destroy the work queue and free the DMA
+ * resources and the SPI controller's memory region.
  */
 static int __exit davinci_spi_remove(struct platform_device *pdev)
 {
@@ -1113,13 +1308,25 @@ static int __exit davinci_spi_remove(struct platform_device *pdev)
 	master = dev_get_drvdata(&pdev->dev);
 	davinci_spi = spi_master_get_devdata(master);
 
-	spi_bitbang_stop(&davinci_spi->bitbang);
+	spi_unregister_master(master);
+
+	/* let anything already queued finish */
+	spin_lock_irq(&davinci_spi->lock);
+	davinci_spi->stopping = true;
+	while (davinci_spi->cur_msg || !list_empty(&davinci_spi->queue)) {
+		spin_unlock_irq(&davinci_spi->lock);
+		msleep(10);
+		spin_lock_irq(&davinci_spi->lock);
+	}
+	spin_unlock_irq(&davinci_spi->lock);
+	destroy_workqueue(davinci_spi->workqueue);
+
+	if (davinci_spi->use_dma)
+		davinci_spi_free_dma(davinci_spi);
 
 	clk_disable(davinci_spi->clk);
 	clk_put(davinci_spi->clk);
 	spi_master_put(master);
-	kfree(davinci_spi->tmp_buf);
-	free_irq(davinci_spi->irq, davinci_spi);
 	iounmap(davinci_spi->base);
 	release_mem_region(davinci_spi->pbase, davinci_spi->region_size);
 
@@ -137,9 +137,17 @@ struct davinci_spi_slave {
 	u8	active_cs;
 };
 
-#define SPI_BUFSIZ	(SMP_CACHE_BYTES + 1)
+/* Parameter RAM sets per direction in one chain, the channel's own
+ * included; each transfer takes one or two of them.
+ */
+#define SPI_DMA_NR_SETS		16
+
+/* Words per frame in a set; longer transfers repeat frames via CCNT */
+#define SPI_DMA_BCNT		0x8000
 
-/* We have 2 DMA channels per CS, one for RX and one for TX */
+/* One DMA channel each for RX and TX, shared by all chipselects since
+ * messages are run one at a time.
+ */
 struct davinci_spi_dma {
 	int			dma_tx_channel;
 	int			dma_rx_channel;
@@ -147,27 +155,60 @@ struct davinci_spi_dma {
 	int			dma_rx_sync_dev;
 	enum dma_event_q	eventq;
 
-	struct completion	dma_tx_completion;
-	struct completion	dma_rx_completion;
+	/* [0] is the channel's own slot, the rest are linked behind it */
+	unsigned		tx_slots[SPI_DMA_NR_SETS];
+	unsigned		rx_slots[SPI_DMA_NR_SETS];
+	struct edmacc_param	tx_params[SPI_DMA_NR_SETS];
+	struct edmacc_param	rx_params[SPI_DMA_NR_SETS];
+
+	/* zero word sent for RX-only transfers, then a word to receive
+	 * into for TX-only ones
+	 */
+	u32			*dummy;
+	dma_addr_t		dummy_dma;
 };
 
 /* SPI Controller driver's private data. */
 struct davinci_spi {
-	struct spi_bitbang	bitbang;
+	struct spi_master	*master;
 	struct clk		*clk;
 
 	u8			version;
 	resource_size_t		pbase;
 	void __iomem		*base;
 	size_t			region_size;
-	u32			irq;
-	struct completion	done;
+
+	/* message queue; cur_msg and the chain state below belong to the
+	 * worker, or to the DMA callback while dma_running is set
+	 */
+	spinlock_t		lock;
+	struct list_head	queue;
+	struct workqueue_struct	*workqueue;
+	struct work_struct	work;
+	struct spi_message	*cur_msg;
+	struct spi_transfer	*cur_xfer;	/* first one not yet done */
+	struct spi_transfer	*chain_end;	/* first one after the chain */
+	unsigned		chain_len;	/* bytes in the running chain */
+	bool			dma_running;
+	int			dma_status;	/* of the chains, when done */
+	struct completion	dma_done;
+	unsigned long		dma_timeout;	/* jiffies, for the message */
+	bool			pio;
+	bool			stopping;
+
+	/* left selected by cs_change on the last transfer of a message */
+	struct spi_device	*cs_held;
+	u32			data1_reg_val;
+
+	/* what the SPIFMTn of fmt_spi was last programmed with */
+	struct spi_device	*fmt_spi;
+	u8			fmt_bits;
+	u32			fmt_hz;
 
 	const void		*tx;
 	void			*rx;
-	u8			*tmp_buf;
-	int			count;
-	struct davinci_spi_dma	*dma_channels;
+	bool			use_dma;	/* got its EDMA channels */
+	struct davinci_spi_dma	dma;
 	struct			davinci_spi_platform_data *pdata;
 
 	void			(*get_rx)(u32 rx_data, struct davinci_spi *);
@@ -561,94 +561,56 @@ static int davincifb_wait_for_vsync(struct fb_info *info)
 	return 0;
 }
 
+/*
+ * Latch the next pending start address of a window into the display
+ * hardware.  Queued page flips take precedence over a pan request, one flip
+ * per vsync.  Called from the vsync callback in interrupt context.
+ */
+static void davincifb_latch_window(struct vpbe_dm_win_info *win)
+{
+	struct vpbe_dm_info *dm = win->dm;
+	unsigned long addr;
+
+	spin_lock(&dm->flip_lock);
+	if (win->flipq_count) {
+		addr = win->flipq[win->flipq_head];
+		win->flipq_head = (win->flipq_head + 1) % DAVINCIFB_FLIPQ_DEPTH;
+		--win->flipq_count;
+		++win->flip_completed;
+	} else
+		addr = win->sdram_address;
+	win->sdram_address = 0;
+	spin_unlock(&dm->flip_lock);
+
+	if (addr)
+		davinci_disp_start_layer(win->layer, addr, NULL);
+}
+
+static void davincifb_latch_windows(struct vpbe_dm_info *dm)
+{
+	davincifb_latch_window(&dm->win[WIN_OSD0]);
+	davincifb_latch_window(&dm->win[WIN_OSD1]);
+	davincifb_latch_window(&dm->win[WIN_VID0]);
+	davincifb_latch_window(&dm->win[WIN_VID1]);
+}
+
 static void davincifb_vsync_callback(unsigned event, void *arg)
 {
 	struct vpbe_dm_info *dm = (struct vpbe_dm_info *)arg;
-	unsigned long addr = 0;
 	static unsigned last_event;
 
 	event &= ~DAVINCI_DISP_END_OF_FRAME;
 	if (event == last_event) {
 		/* progressive */
-		xchg(&addr, dm->win[WIN_OSD0].sdram_address);
-		if (addr) {
-			davinci_disp_start_layer(dm->win[WIN_OSD0].layer,
-						 dm->win[WIN_OSD0].
-						 sdram_address,
-						 NULL);
-			dm->win[WIN_OSD0].sdram_address = 0;
-		}
-		addr = 0;
-		xchg(&addr, dm->win[WIN_OSD1].sdram_address);
-		if (addr) {
-			davinci_disp_start_layer(dm->win[WIN_OSD1].layer,
-						 dm->win[WIN_OSD1].
-						 sdram_address,
-						 NULL);
-			dm->win[WIN_OSD1].sdram_address = 0;
-		}
-		addr = 0;
-		xchg(&addr, dm->win[WIN_VID0].sdram_address);
-		if (addr) {
-			davinci_disp_start_layer(dm->win[WIN_VID0].layer,
-						 dm->win[WIN_VID0].
-						 sdram_address,
-						 NULL);
-			dm->win[WIN_VID0].sdram_address = 0;
-		}
-		addr = 0;
-		xchg(&addr, dm->win[WIN_VID1].sdram_address);
-		if (addr) {
-			davinci_disp_start_layer(dm->win[WIN_VID1].layer,
-						 dm->win[WIN_VID1].
-						 sdram_address,
-						 NULL);
-			dm->win[WIN_VID1].sdram_address = 0;
-		}
+		davincifb_latch_windows(dm);
 		++dm->vsync_cnt;
 		wake_up_interruptible(&dm->vsync_wait);
 	} else {
 		/* interlaced */
 		if (event & DAVINCI_DISP_SECOND_FIELD) {
-			xchg(&addr, dm->win[WIN_OSD0].sdram_address);
-			if (addr) {
-				davinci_disp_start_layer(dm->win[WIN_OSD0].
-							 layer,
-							 dm->win[WIN_OSD0].
-							 sdram_address,
-							 NULL);
-				dm->win[WIN_OSD0].sdram_address = 0;
-			}
-			addr = 0;
-			xchg(&addr, dm->win[WIN_OSD1].sdram_address);
-			if (addr) {
-				davinci_disp_start_layer(dm->win[WIN_OSD1].
-							 layer,
-							 dm->win[WIN_OSD1].
-							 sdram_address,
-							 NULL);
-				dm->win[WIN_OSD1].sdram_address = 0;
-			}
-			addr = 0;
-			xchg(&addr, dm->win[WIN_VID0].sdram_address);
-			if (addr) {
-				davinci_disp_start_layer(dm->win[WIN_VID0].
-							 layer,
-							 dm->win[WIN_VID0].
-							 sdram_address,
-							 NULL);
-				dm->win[WIN_VID0].sdram_address = 0;
-			}
-			addr = 0;
-			xchg(&addr, dm->win[WIN_VID1].sdram_address);
-			if (addr) {
-				davinci_disp_start_layer(dm->win[WIN_VID1].
-							 layer,
-							 dm->win[WIN_VID1].
-							 sdram_address,
-							 NULL);
-				dm->win[WIN_VID1].sdram_address = 0;
-			}
+			davincifb_latch_windows(dm);
+			/* let flip submitters waiting for queue space run */
+			wake_up_interruptible(&dm->vsync_wait);
 		} else {
 			++dm->vsync_cnt;
 			wake_up_interruptible(&dm->vsync_wait);
@@ -764,41 +726,36 @@ static int vpbe_setposy(struct fb_info *info, unsigned ypos)
 /*
  * FBIO_SETZOOM handler
  */
-static int vpbe_set_zoom(struct fb_info *info, struct zoom_params *zoom)
+static int vpbe_zoom_factor(u_int32_t zoom, enum davinci_zoom_factor *factor)
 {
-	struct vpbe_dm_win_info *win = info->par;
-	enum davinci_zoom_factor h_zoom, v_zoom;
-
-	if (!win->own_window)
-		return -ENODEV;
-
-	switch (zoom->zoom_h) {
+	switch (zoom) {
 	case 0:
-		h_zoom = ZOOM_X1;
+		*factor = ZOOM_X1;
 		break;
 	case 1:
-		h_zoom = ZOOM_X2;
+		*factor = ZOOM_X2;
 		break;
 	case 2:
-		h_zoom = ZOOM_X4;
+		*factor = ZOOM_X4;
 		break;
 	default:
 		return -EINVAL;
 	}
 
-	switch (zoom->zoom_v) {
-	case 0:
-		v_zoom = ZOOM_X1;
-		break;
-	case 1:
-		v_zoom = ZOOM_X2;
-		break;
-	case 2:
-		v_zoom = ZOOM_X4;
-		break;
-	default:
+	return 0;
+}
+
+static int vpbe_set_zoom(struct fb_info *info, struct zoom_params *zoom)
+{
+	struct vpbe_dm_win_info *win = info->par;
+	enum davinci_zoom_factor h_zoom, v_zoom;
+
+	if (!win->own_window)
+		return -ENODEV;
+
+	if (vpbe_zoom_factor(zoom->zoom_h, &h_zoom) ||
+	    vpbe_zoom_factor(zoom->zoom_v, &v_zoom))
 		return -EINVAL;
-	}
 
 	davinci_disp_set_zoom(win->layer, h_zoom, v_zoom);
 
@@ -1363,6 +1320,13 @@ static int vpbe_set_cursor_params(struct fb_info *info,
 	return 0;
 }
 
+static int davincifb_queue_flip(struct fb_info *info,
+				struct davincifb_flip *flip);
+static void davincifb_get_flip_status(struct fb_info *info,
+				      struct davincifb_flip_status *status);
+static int davincifb_commit(struct fb_info *info,
+			    struct davincifb_commit *uc);
+
 /*
  * fb_ioctl method
  */
@@ -1381,6 +1345,9 @@ davincifb_ioctl(struct fb_info *info, unsigned int cmd,	unsigned long arg)
 	struct vpbe_backg_color backg_color;
 	struct vpbe_window_position win_pos;
 	struct fb_cursor cursor;
+	struct davincifb_flip flip;
+	struct davincifb_flip_status flip_status;
+	struct davincifb_commit commit;
 
 	switch (cmd) {
 	case FBIO_WAITFORVSYNC:
@@ -1478,6 +1445,26 @@ davincifb_ioctl(struct fb_info *info, unsigned int cmd,	unsigned long arg)
 			return -EFAULT;
 		return vpbe_set_cursor_params(info, &cursor);
 
+	case FBIO_QUEUE_FLIP:
+		if (copy_from_user(&flip, argp, sizeof(flip)))
+			return -EFAULT;
+		if ((retval = davincifb_queue_flip(info, &flip)) < 0)
+			return retval;
+		if (copy_to_user(argp, &flip, sizeof(flip)))
+			return -EFAULT;
+		return 0;
+
+	case FBIO_GET_FLIP_STATUS:
+		davincifb_get_flip_status(info, &flip_status);
+		if (copy_to_user(argp, &flip_status, sizeof(flip_status)))
+			return -EFAULT;
+		return 0;
+
+	case FBIO_COMMIT:
+		if (copy_from_user(&commit, argp, sizeof(commit)))
+			return -EFAULT;
+		return davincifb_commit(info, &commit);
+
 	default:
 		return -EINVAL;
 	}
@@ -1758,27 +1745,21 @@ static int davincifb_setcolreg(unsigned regno, unsigned red, unsigned green,
 }
 
 /*
- * fb_pan_display method
- *
- * Pan the display using the `xoffset' and `yoffset' fields of the `var'
- * structure.  We don't support wrapping and ignore the FB_VMODE_YWRAP flag.
+ * Validate a pan offset and convert it to the SDRAM start address of the
+ * window.  Returns 0 and the address in *start, or a negative error code.
  */
-static int
-davincifb_pan_display(struct fb_var_screeninfo *var, struct fb_info *info)
+static int davincifb_pan_to_start(struct fb_info *info, unsigned xoffset,
+				  unsigned yoffset, unsigned *start)
 {
 	struct vpbe_dm_win_info *win = info->par;
-	unsigned start;
-
-	if (!win->own_window)
-		return -ENODEV;
 
-	if (var->xoffset > info->var.xres_virtual - info->var.xres)
+	if (xoffset > info->var.xres_virtual - info->var.xres)
 		return -EINVAL;
-	if (var->yoffset > info->var.yres_virtual - info->var.yres)
+	if (yoffset > info->var.yres_virtual - info->var.yres)
 		return -EINVAL;
 
 	/* xoffset must be a multiple of xpanstep */
-	if (var->xoffset & ~(info->fix.xpanstep - 1))
+	if (xoffset & ~(info->fix.xpanstep - 1))
 		return -EINVAL;
 
 	/* For DM365 video windows:
@@ -1792,24 +1773,305 @@ davincifb_pan_display(struct fb_var_screeninfo *var, struct fb_info *info)
 			info->var.bits_per_pixel == 8 &&
 			(win->layer == WIN_VID0 || win->layer == WIN_VID1)
 			) {
-		start =
+		*start =
 	    info->fix.smem_start +
-	    (var->xoffset * 12) / 8 +
-	    var->yoffset * 3 / 2 * info->fix.line_length;
+	    (xoffset * 12) / 8 +
+	    yoffset * 3 / 2 * info->fix.line_length;
 	} else {
-		start =
+		*start =
 	    info->fix.smem_start +
-	    (var->xoffset * info->var.bits_per_pixel) / 8 +
-	    var->yoffset * info->fix.line_length;
+	    (xoffset * info->var.bits_per_pixel) / 8 +
+	    yoffset * info->fix.line_length;
 	}
+
+	return 0;
+}
+
+/*
+ * fb_pan_display method
+ *
+ * Pan the display using the `xoffset' and `yoffset' fields of the `var'
+ * structure.  We don't support wrapping and ignore the FB_VMODE_YWRAP flag.
+ * A pan request discards any page flips still queued on the window.
+ */
+static int
+davincifb_pan_display(struct fb_var_screeninfo *var, struct fb_info *info)
+{
+	struct vpbe_dm_win_info *win = info->par;
+	unsigned long flags;
+	unsigned start;
+	int ret;
+
+	if (!win->own_window)
+		return -ENODEV;
+
+	ret = davincifb_pan_to_start(info, var->xoffset, var->yoffset, &start);
+	if (ret)
+		return ret;
+
+	spin_lock_irqsave(&win->dm->flip_lock, flags);
+	win->flip_completed += win->flipq_count;
+	win->flipq_count = 0;
 	if (davinci_disp_is_second_field()) {
+		win->sdram_address = 0;
 		davinci_disp_start_layer(win->layer, start, NULL);
 	} else
 		win->sdram_address = start;
+	spin_unlock_irqrestore(&win->dm->flip_lock, flags);
+
+	return 0;
+}
+
+/*
+ * FBIO_QUEUE_FLIP handler
+ *
+ * Queue a page flip to be latched at a following vsync.  Flips are applied in
+ * order, one per vsync.  If the queue is full the caller either waits for a
+ * free slot or, with DAVINCIFB_FLIP_NONBLOCK, gets -EAGAIN.  Completion can
+ * be tracked with poll() or FBIO_GET_FLIP_STATUS.
+ */
+static int davincifb_queue_flip(struct fb_info *info,
+				struct davincifb_flip *flip)
+{
+	struct vpbe_dm_win_info *win = info->par;
+	struct vpbe_dm_info *dm = win->dm;
+	unsigned long flags;
+	unsigned start;
+	int ret;
+
+	if (!win->own_window)
+		return -ENODEV;
+
+	ret = davincifb_pan_to_start(info, flip->xoffset, flip->yoffset,
+				     &start);
+	if (ret)
+		return ret;
+
+	for (;;) {
+		spin_lock_irqsave(&dm->flip_lock, flags);
+		if (win->flipq_count < DAVINCIFB_FLIPQ_DEPTH)
+			break;
+		spin_unlock_irqrestore(&dm->flip_lock, flags);
+
+		if (flip->flags & DAVINCIFB_FLIP_NONBLOCK)
+			return -EAGAIN;
+
+		ret = wait_event_interruptible_timeout(dm->vsync_wait,
+				win->flipq_count < DAVINCIFB_FLIPQ_DEPTH,
+				dm->timeout);
+		if (ret < 0)
+			return ret;
+		if (ret == 0)
+			return -ETIMEDOUT;
+	}
+
+	win->flipq[(win->flipq_head + win->flipq_count) %
+		   DAVINCIFB_FLIPQ_DEPTH] = start;
+	++win->flipq_count;
+	flip->sequence = ++win->flip_submitted;
+	/* a queued flip supersedes any pending pan */
+	win->sdram_address = 0;
+	spin_unlock_irqrestore(&dm->flip_lock, flags);
+
+	info->var.xoffset = flip->xoffset;
+	info->var.yoffset = flip->yoffset;
 
 	return 0;
 }
 
+/*
+ * FBIO_GET_FLIP_STATUS handler
+ */
+static void davincifb_get_flip_status(struct fb_info *info,
+				      struct davincifb_flip_status *status)
+{
+	struct vpbe_dm_win_info *win = info->par;
+	unsigned long flags;
+
+	spin_lock_irqsave(&win->dm->flip_lock, flags);
+	status->submitted = win->flip_submitted;
+	status->completed = win->flip_completed;
+	status->pending = win->flipq_count;
+	status->vsync_cnt = win->dm->vsync_cnt;
+	spin_unlock_irqrestore(&win->dm->flip_lock, flags);
+}
+
+#define DAVINCIFB_COMMIT_ALL	(DAVINCIFB_COMMIT_ENABLE | \
+				 DAVINCIFB_COMMIT_POS | \
+				 DAVINCIFB_COMMIT_PAN | \
+				 DAVINCIFB_COMMIT_ZOOM | \
+				 DAVINCIFB_COMMIT_BLEND | \
+				 DAVINCIFB_COMMIT_COLORKEY)
+
+/*
+ * Translate the new state of one window into its part of an OSD commit.
+ */
+static int davincifb_win_commit(struct vpbe_dm_win_info *win,
+				struct davincifb_win_commit *u,
+				struct davinci_disp_win_commit *wc)
+{
+	struct fb_info *info = win->info;
+	struct fb_videomode *mode = &win->dm->mode;
+	unsigned start;
+	int ret;
+
+	if (u->flags & ~DAVINCIFB_COMMIT_ALL)
+		return -EINVAL;
+	if (!info || !win->own_window)
+		return -ENODEV;
+
+	if (u->flags & DAVINCIFB_COMMIT_ENABLE) {
+		wc->flags |= DAVINCI_DISP_COMMIT_ENABLE;
+		wc->enable = u->enable != 0;
+	}
+
+	if (u->flags & DAVINCIFB_COMMIT_POS) {
+		if (u->xpos > mode->xres - info->var.xres ||
+		    u->ypos > mode->yres - info->var.yres)
+			return -EINVAL;
+		wc->flags |= DAVINCI_DISP_COMMIT_CONFIG;
+		convert_fb_info_to_osd(info, &wc->lconfig);
+		wc->lconfig.xpos = u->xpos;
+		wc->lconfig.ypos = u->ypos;
+	}
+
+	if (u->flags & DAVINCIFB_COMMIT_PAN) {
+		ret = davincifb_pan_to_start(info, u->xoffset, u->yoffset,
+					     &start);
+		if (ret)
+			return ret;
+		wc->flags |= DAVINCI_DISP_COMMIT_START;
+		wc->fb_base_phys = start;
+	}
+
+	if (u->flags & DAVINCIFB_COMMIT_ZOOM) {
+		if (vpbe_zoom_factor(u->zoom_h, &wc->h_zoom) ||
+		    vpbe_zoom_factor(u->zoom_v, &wc->v_zoom))
+			return -EINVAL;
+		wc->flags |= DAVINCI_DISP_COMMIT_ZOOM;
+	}
+
+	if (u->flags & (DAVINCIFB_COMMIT_BLEND | DAVINCIFB_COMMIT_COLORKEY)) {
+		if (!is_osd_win(info))
+			return -EINVAL;
+		if (u->flags & DAVINCIFB_COMMIT_BLEND) {
+			if (u->bf > OSD_8_VID_0)
+				return -EINVAL;
+			wc->flags |= DAVINCI_DISP_COMMIT_BLEND;
+			wc->blend = u->bf;
+		}
+		if (u->flags & DAVINCIFB_COMMIT_COLORKEY) {
+			wc->flags |= DAVINCI_DISP_COMMIT_COLORKEY;
+			wc->colorkey_enable = u->enable_colorkeying != 0;
+			wc->colorkey = u->colorkey;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * FBIO_COMMIT handler
+ *
+ * Change position, page, zoom, blending and visibility of several windows
+ * in the same vertical blanking interval, so that a layout change never
+ * shows half done.  Any window the driver owns can be changed through any
+ * of the framebuffer devices.  Page flips still queued on a panned window
+ * are discarded, as for a pan.
+ */
+static int davincifb_commit(struct fb_info *info, struct davincifb_commit *uc)
+{
+	struct vpbe_dm_info *dm = ((struct vpbe_dm_win_info *)info->par)->dm;
+	struct davinci_disp_commit commit;
+	struct davincifb_win_commit *u;
+	struct vpbe_dm_win_info *win;
+	unsigned long flags;
+	int layer, ret;
+
+	if (uc->flags & ~DAVINCIFB_COMMIT_NONBLOCK)
+		return -EINVAL;
+
+	/* in case the display has been switched */
+	get_video_mode(&dm->mode);
+
+	memset(&commit, 0, sizeof(commit));
+	for (layer = 0; layer < ARRAY_SIZE(dm->win); layer++) {
+		if (!uc->win[layer].flags)
+			continue;
+		ret = davincifb_win_commit(&dm->win[layer], &uc->win[layer],
+					   &commit.win[layer]);
+		if (ret)
+			return ret;
+	}
+
+	/* as with fb_check_var, refuse positions the OSD would change */
+	ret = davinci_disp_try_commit(&commit);
+	if (ret)
+		return ret;
+	for (layer = 0; layer < ARRAY_SIZE(dm->win); layer++) {
+		u = &uc->win[layer];
+		if ((u->flags & DAVINCIFB_COMMIT_POS) &&
+		    (commit.win[layer].lconfig.xpos != u->xpos ||
+		     commit.win[layer].lconfig.ypos != u->ypos))
+			return -EINVAL;
+	}
+
+	spin_lock_irqsave(&dm->flip_lock, flags);
+	for (layer = 0; layer < ARRAY_SIZE(dm->win); layer++) {
+		win = &dm->win[layer];
+		if (!(uc->win[layer].flags & DAVINCIFB_COMMIT_PAN))
+			continue;
+		win->flip_completed += win->flipq_count;
+		win->flipq_count = 0;
+		win->sdram_address = 0;
+	}
+	spin_unlock_irqrestore(&dm->flip_lock, flags);
+
+	ret = davinci_disp_commit(&commit,
+				  !(uc->flags & DAVINCIFB_COMMIT_NONBLOCK));
+	if (ret)
+		return ret;
+
+	for (layer = 0; layer < ARRAY_SIZE(dm->win); layer++) {
+		u = &uc->win[layer];
+		win = &dm->win[layer];
+		if (u->flags & DAVINCIFB_COMMIT_ENABLE)
+			win->display_window = u->enable != 0;
+		if (u->flags & DAVINCIFB_COMMIT_POS) {
+			win->xpos = u->xpos;
+			win->ypos = u->ypos;
+		}
+		if (u->flags & DAVINCIFB_COMMIT_PAN) {
+			win->info->var.xoffset = u->xoffset;
+			win->info->var.yoffset = u->yoffset;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * fb_poll method
+ *
+ * The window is writable while there is room in its flip queue and readable
+ * once every queued flip has been latched by the hardware.
+ */
+static unsigned int davincifb_poll(struct fb_info *info, struct file *file,
+				   poll_table *wait)
+{
+	struct vpbe_dm_win_info *win = info->par;
+	unsigned int mask = 0;
+
+	poll_wait(file, &win->dm->vsync_wait, wait);
+
+	if (win->flipq_count < DAVINCIFB_FLIPQ_DEPTH)
+		mask |= POLLOUT | POLLWRNORM;
+	if (!win->flipq_count)
+		mask |= POLLIN | POLLRDNORM;
+
+	return mask;
+}
+
 /*
  * fb_blank method
  *
@@ -1855,6 +2117,7 @@ static struct fb_ops davincifb_ops = {
 	.fb_rotate = NULL,
 	.fb_sync = NULL,
 	.fb_ioctl = davincifb_ioctl,
+	.fb_poll = davincifb_poll,
 };
 
 static void davincifb_release_window(struct device *dev,
@@ -1946,7 +2209,9 @@ static int davincifb_init_window(struct device *dev,
 	win->xpos = lconfig->xpos;
 	win->ypos = lconfig->ypos;
 	info->var.xres_virtual = info->var.xres;
-	info->var.yres_virtual = info->var.yres;
+	info->var.yres_virtual = info->var.yres * win->num_pages;
+	if (!window_will_fit_framebuffer(&info->var, info->fix.smem_len))
+		info->var.yres_virtual = info->var.yres;
 
 	/* update the fix info to be consistent with the var */
 	update_fix_info(&info->var, &info->fix);
@@ -2197,6 +2462,28 @@ static void parse_win_params(struct vpbe_dm_win_info *win,
 	return;
 }
 
+/*
+ * Return the number of pages per window requested with the "pages=N" option.
+ */
+static unsigned davincifb_get_num_pages(const char *options)
+{
+	const char *this_opt = options;
+	unsigned pages = 1;
+
+	while (this_opt && *this_opt) {
+		if (!strncmp(this_opt, "pages=", strlen("pages="))) {
+			pages = simple_strtoul(this_opt + strlen("pages="),
+					       NULL, 0);
+			break;
+		}
+		this_opt = strpbrk(this_opt, ":");
+		if (this_opt)
+			++this_opt;
+	}
+
+	return clamp_t(unsigned, pages, 1, DAVINCIFB_MAX_PAGES);
+}
+
 /*
  * Pass boot-time options by adding the following string to the boot params:
  *	video=davincifb:options
@@ -2210,6 +2497,11 @@ static void parse_win_params(struct vpbe_dm_win_info *win,
  *		S is the framebuffer size with a size suffix such as 'K' or 'M'
  *		X,Y are the window position
  *
+ *	pages=N
+ *		N is the number of screen pages (1 to 3) to allocate for each
+ *		window, e.g. 3 for triple buffering with FBIO_QUEUE_FLIP.
+ *		The default is 1.
+ *
  * Only video windows can be turned off.  Turning off a video window means that
  * no framebuffer device will be registered for it,
  *
@@ -2218,6 +2510,7 @@ static void parse_win_params(struct vpbe_dm_win_info *win,
  *
  * For example:
  *      video=davincifb:osd0=720x480x16@0,0:osd1=720x480:vid0=off:vid1=off
+ *      video=davincifb:pages=3:osd1=0x0:vid0=off:vid1=off
  *
  * This routine returns 1 if the window is to be turned off, or 0 otherwise.
  */
@@ -2255,7 +2548,8 @@ static int davincifb_get_default_win_config(struct device *dev,
 	lconfig->ypos = 0;
 
 	lconfig->interlaced = is_display_interlaced(&win->dm->mode);
-	*fb_size = davincifb_max_screen_size(win->layer, &win->dm->mode);
+	*fb_size = davincifb_max_screen_size(win->layer, &win->dm->mode) *
+	    win->num_pages;
 
 	next_opt = options;
 	while ((this_opt = next_opt)) {
@@ -2299,6 +2593,7 @@ static int davincifb_probe(struct device *dev)
 	struct vpbe_dm_info *dm;
 	struct davinci_layer_config lconfig;
 	unsigned fb_size;
+	unsigned num_pages;
 	int err;
 	struct davincifb_platform_data *pdata = dev->platform_data;
 
@@ -2311,6 +2606,7 @@ static int davincifb_probe(struct device *dev)
 		return -ENOMEM;
 	}
 	dev_set_drvdata(dev, dm);
+	spin_lock_init(&dm->flip_lock);
 
 	/* get the video mode from the encoder manager */
 	get_video_mode(&dm->mode);
@@ -2318,10 +2614,13 @@ static int davincifb_probe(struct device *dev)
 	/* set the default Cb/Cr order */
 	dm->yc_pixfmt = PIXFMT_YCbCrI;
 
+	num_pages = davincifb_get_num_pages(options);
+
 	/* initialize OSD0 */
 	dm->win[WIN_OSD0].layer = WIN_OSD0;
 	dm->win[WIN_OSD0].dm = dm;
 	dm->win[WIN_OSD0].sdram_address = 0;
+	dm->win[WIN_OSD0].num_pages = num_pages;
 	davincifb_get_default_win_config(dev, &dm->win[WIN_OSD0], &lconfig,
 					 &fb_size, options);
 	err =
@@ -2334,6 +2633,7 @@ static int davincifb_probe(struct device *dev)
 	dm->win[WIN_VID0].layer = WIN_VID0;
 	dm->win[WIN_VID0].dm = dm;
 	dm->win[WIN_VID0].sdram_address = 0;
+	dm->win[WIN_VID0].num_pages = num_pages;
 	if (!davincifb_get_default_win_config
 	    (dev, &dm->win[WIN_VID0], &lconfig, &fb_size, options)) {
 		err =
@@ -2347,6 +2647,7 @@ static int davincifb_probe(struct device *dev)
 	dm->win[WIN_OSD1].layer = WIN_OSD1;
 	dm->win[WIN_OSD1].dm = dm;
 	dm->win[WIN_OSD1].sdram_address = 0;
+	dm->win[WIN_OSD1].num_pages = num_pages;
 	davincifb_get_default_win_config(dev, &dm->win[WIN_OSD1], &lconfig,
 					 &fb_size, options);
 	err =
@@ -2359,6 +2660,7 @@ static int davincifb_probe(struct device *dev)
 	dm->win[WIN_VID1].layer = WIN_VID1;
 	dm->win[WIN_VID1].dm = dm;
 	dm->win[WIN_VID1].sdram_address = 0;
+	dm->win[WIN_VID1].num_pages = num_pages;
 	if (!davincifb_get_default_win_config
 	    (dev, &dm->win[WIN_VID1], &lconfig, &fb_size, options)) {
 		err =
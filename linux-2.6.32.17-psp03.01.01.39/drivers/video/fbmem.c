@@ -32,6 +32,7 @@
 #include <linux/device.h>
 #include <linux/efi.h>
 #include <linux/fb.h>
+#include <linux/poll.h>
 
 #include <asm/fb.h>
 
@@ -1434,6 +1435,22 @@ __releases(&info->lock)
 	return 0;
 }
 
+static unsigned int
+fb_poll(struct file *file, poll_table *wait)
+{
+	struct inode *inode = file->f_path.dentry->d_inode;
+	int fbidx = iminor(inode);
+	struct fb_info *info = registered_fb[fbidx];
+
+	if (!info)
+		return POLLERR;
+
+	if (info->fbops->fb_poll)
+		return info->fbops->fb_poll(info, file, wait);
+
+	return DEFAULT_POLLMASK;
+}
+
 static const struct file_operations fb_fops = {
 	.owner =	THIS_MODULE,
 	.read =		fb_read,
@@ -1443,6 +1460,7 @@ static const struct file_operations fb_fops = {
 	.compat_ioctl = fb_compat_ioctl,
 #endif
 	.mmap =		fb_mmap,
+	.poll =		fb_poll,
 	.open =		fb_open,
 	.release =	fb_release,
 #ifdef HAVE_ARCH_FB_UNMAPPED_AREA
@@ -385,7 +385,6 @@ typedef struct device_params {
 	spinlock_t irqlock;
 	void *inter_buffer;	/* Address for inter buffer */
 	unsigned int inter_size; /* Size of intermediate buffer */
-	struct completion edma_sem;
 	struct completion device_access;
 } device_params_t;
 typedef struct vdce_buffer_info {
@@ -82,6 +82,14 @@ struct mmc_host_ops {
 	int (*enable)(struct mmc_host *host);
 	int (*disable)(struct mmc_host *host, int lazy);
 	void	(*request)(struct mmc_host *host, struct mmc_request *req);
+	/*
+	 * 'pre_req' lets the host map the data of a request and build its
+	 * DMA descriptors while the previous request is still running.  It
+	 * is called from process context with the host claimed, and the
+	 * prepared request is always the next one passed to 'request'.
+	 * Hosts mark prepared data with a non-zero data->host_cookie.
+	 */
+	void	(*pre_req)(struct mmc_host *host, struct mmc_request *req);
 	/*
 	 * Avoid calling these three functions too often or in a "fast path",
 	 * since underlaying controller might implement them in an expensive
@@ -151,6 +159,7 @@ struct mmc_host {
 #define MMC_CAP_DISABLE		(1 << 7)	/* Can the host be disabled */
 #define MMC_CAP_NONREMOVABLE	(1 << 8)	/* Nonremovable e.g. eMMC */
 #define MMC_CAP_WAIT_WHILE_BUSY	(1 << 9)	/* Waits while card is busy */
+#define MMC_CAP_CMD23		(1 << 10)	/* Can do transfers without stop */
 
 	/* host specific block data */
 	unsigned int		max_seg_size;	/* see blk_queue_max_segment_size */
@@ -84,6 +84,11 @@ extern void nand_wait_ready(struct mtd_info *mtd);
 #define NAND_CMD_READSTART	0x30
 #define NAND_CMD_RNDOUTSTART	0xE0
 #define NAND_CMD_CACHEDPROG	0x15
+#define NAND_CMD_READCACHESEQ	0x31
+#define NAND_CMD_READCACHEEND	0x3f
+
+/* ONFI parameter page */
+#define NAND_CMD_PARAM		0xec
 
 /* Extended commands for AG-AND device */
 /*
@@ -158,6 +158,8 @@ struct display_obj {
 	u32 field_id;
 	/* Indicates whether streaming started */
 	u8 started;
+	/* Set until the first vsync after streamon has been skipped */
+	u8 first_int;
 	/* Identifies device object */
 	enum davinci_display_device_id device_id;
 	/* Frame rate information */
@@ -186,6 +188,9 @@ struct davinci_display {
 	/* interrupt callback */
 	struct davinci_disp_callback event_callback;
 	struct display_obj *dev[DAVINCI_DISPLAY_MAX_DEVICES];
+	/* Woken at every end of frame, used to wait for scan out */
+	wait_queue_head_t vsync_wait;
+	u32 vsync_cnt;
 };
 
 struct buf_config_params {
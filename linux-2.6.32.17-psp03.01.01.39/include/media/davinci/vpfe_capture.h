@@ -28,6 +28,7 @@
 #include <linux/i2c.h>
 #include <media/v4l2-ioctl.h>
 #include <media/v4l2-device.h>
+#include <media/v4l2-fh.h>
 #include <media/videobuf-dma-contig.h>
 #include <media/davinci/vpfe_types.h>
 
@@ -229,6 +230,8 @@ struct vpfe_device {
 
 /* File handle structure */
 struct vpfe_fh {
+	/* v4l2 file handle, carries the events; must be first */
+	struct v4l2_fh fh;
 	struct vpfe_device *vpfe_dev;
 	/* Indicates whether this file handle is doing IO */
 	u8 io_allowed;
@@ -245,6 +248,21 @@ struct vpfe_config_params {
 };
 
 #endif				/* End of __KERNEL__ */
+
+/*
+ * Event sent when the decoder of the selected input gains or loses lock,
+ * or sees another standard.  Its data is a struct vpfe_std_event.
+ */
+#define VPFE_EVENT_STD_CHANGE	(V4L2_EVENT_PRIVATE_START + 1)
+
+struct vpfe_std_event {
+	/* input index, as used by VIDIOC_S_INPUT */
+	__u32 input;
+	__u32 reserved;
+	/* detected standard, 0 if there is no signal */
+	v4l2_std_id std_id;
+};
+
 /**
  * VPFE_CMD_S_CCDC_RAW_PARAMS - EXPERIMENTAL IOCTL to set raw capture params
  * This can be used to configure modules such as defect pixel correction,
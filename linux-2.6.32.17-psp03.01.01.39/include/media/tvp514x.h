@@ -29,6 +29,8 @@
 #ifndef _TVP514X_H
 #define _TVP514X_H
 
+#include <linux/videodev2.h>
+
 /*
  * Other macros
  */
@@ -110,5 +112,24 @@ struct tvp514x_platform_data {
 	bool vs_polarity;
 };
 
+/**
+ * struct tvp514x_std_status - Detection result for the selected input
+ * @input: Input routing, as passed to s_routing
+ * @std_id: Detected standard, zero if the decoder isn't locked
+ */
+struct tvp514x_std_status {
+	u32 input;
+	v4l2_std_id std_id;
+};
+
+/*
+ * v4l2_subdev_notify() code, sent from the background detection when the
+ * signal on the selected input locks, unlocks or changes standard.  The
+ * argument is a struct tvp514x_std_status.  It is sent from a work item
+ * holding the decoder lock, so the handler must not call back into the
+ * decoder or wait for anything that does.
+ */
+#define TVP514X_NOTIFY_STD_CHANGE	_IOR('t', 0, struct tvp514x_std_status)
+
 
 #endif				/* ifndef _TVP514X_H */
@@ -0,0 +1,65 @@
+/*
+ * v4l2-regcache.h
+ *
+ * Cached, batched register access for I2C video subdevices.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ */
+
+#ifndef V4L2_REGCACHE_H
+#define V4L2_REGCACHE_H
+
+#include <linux/types.h>
+
+struct i2c_client;
+struct v4l2_regcache;
+
+/**
+ * struct v4l2_regcache_config - register map description
+ * @max_reg: highest register address; addresses are one byte on the bus
+ * @val_bytes: register width, 1 or 2 (16-bit values go MSB first)
+ * @max_burst: most registers written by one auto-incrementing message;
+ *	0 or 1 if the chip doesn't auto-increment its subaddress
+ * @retries: how often a failed transfer is repeated, 10 ms apart
+ * @volatile_reg: optional; registers for which it returns true (status,
+ *	strobes, indirect access windows) are never cached, so every
+ *	read and every write goes to the chip
+ */
+struct v4l2_regcache_config {
+	unsigned int max_reg;
+	unsigned int val_bytes;
+	unsigned int max_burst;
+	unsigned int retries;
+	bool (*volatile_reg)(unsigned int reg);
+};
+
+struct v4l2_regcache *v4l2_regcache_init(struct i2c_client *client,
+		const struct v4l2_regcache_config *config);
+void v4l2_regcache_exit(struct v4l2_regcache *rc);
+
+int v4l2_regcache_read(struct v4l2_regcache *rc, unsigned int reg,
+		unsigned int *val);
+int v4l2_regcache_write(struct v4l2_regcache *rc, unsigned int reg,
+		unsigned int val);
+int v4l2_regcache_update_bits(struct v4l2_regcache *rc, unsigned int reg,
+		unsigned int mask, unsigned int val);
+
+/*
+ * Writes between v4l2_regcache_batch_begin() and the matching
+ * v4l2_regcache_batch_end() are queued in order and sent as one I2C
+ * transfer when the outermost batch ends; its result is returned.
+ */
+void v4l2_regcache_batch_begin(struct v4l2_regcache *rc);
+int v4l2_regcache_batch_end(struct v4l2_regcache *rc);
+
+/* forget everything cached, e.g. after the chip was reset */
+void v4l2_regcache_invalidate(struct v4l2_regcache *rc);
+
+#endif /* V4L2_REGCACHE_H */
@@ -899,6 +899,90 @@ int davinci_disp_register_callback(struct davinci_disp_callback *callback);
  */
 int davinci_disp_unregister_callback(struct davinci_disp_callback *callback);
 
+/* davinci_disp_win_commit members to apply */
+#define DAVINCI_DISP_COMMIT_ENABLE	(1 << 0)
+#define DAVINCI_DISP_COMMIT_CONFIG	(1 << 1)
+#define DAVINCI_DISP_COMMIT_START	(1 << 2)
+#define DAVINCI_DISP_COMMIT_ZOOM	(1 << 3)
+#define DAVINCI_DISP_COMMIT_BLEND	(1 << 4)
+#define DAVINCI_DISP_COMMIT_COLORKEY	(1 << 5)
+
+/**
+ * struct davinci_disp_win_commit
+ * @flags: bitmask of DAVINCI_DISP_COMMIT_* flags selecting which of the
+ *         following members are applied; the rest of the layer state is
+ *         left unchanged
+ * @enable: non-zero to enable the layer, or zero to disable it
+ * @lconfig: layer configuration, as for davinci_disp_set_layer_config()
+ * @fb_base_phys: physical base address of the framebuffer
+ * @fb_desc: framebuffer layout, as for davinci_disp_start_layer()
+ * @h_zoom: horizontal zoom factor
+ * @v_zoom: vertical zoom factor
+ * @blend: blending factor (OSD layers only)
+ * @colorkey_enable: non-zero to enable color keying (OSD layers only)
+ * @colorkey: transparency color key (OSD layers only)
+ *
+ * Description:
+ * The new state of one display layer within a davinci_disp_commit.
+ */
+struct davinci_disp_win_commit {
+	unsigned flags;
+	int enable;
+	struct davinci_layer_config lconfig;
+	unsigned long fb_base_phys;
+	struct davinci_fb_desc fb_desc;
+	enum davinci_zoom_factor h_zoom;
+	enum davinci_zoom_factor v_zoom;
+	enum davinci_blending_factor blend;
+	int colorkey_enable;
+	unsigned colorkey;
+};
+
+/**
+ * struct davinci_disp_commit
+ * @win: new state of each layer, indexed by enum davinci_disp_layer
+ *
+ * Description:
+ * A complete description of a change to the OSD and video layers that is
+ * applied atomically by davinci_disp_commit().
+ */
+struct davinci_disp_commit {
+	struct davinci_disp_win_commit win[4];
+};
+
+/**
+ * davinci_disp_try_commit
+ * @commit: a pointer to a davinci_disp_commit struct
+ * Returns: zero if the commit is valid, or a negative error code otherwise
+ *
+ * Description:
+ * Validate a set of layer changes without applying them.  The layer
+ * configurations in @commit are checked together, so constraints between
+ * layers are evaluated against the new state of every layer in @commit.  On
+ * exit each selected @lconfig reflects the configuration that would actually
+ * be programmed.
+ */
+int davinci_disp_try_commit(struct davinci_disp_commit *commit);
+
+/**
+ * davinci_disp_commit
+ * @commit: a pointer to a davinci_disp_commit struct
+ * @wait: non-zero to wait until the changes have been applied
+ * Returns: zero if successful, or a negative error code otherwise
+ *
+ * Description:
+ * Validate a set of layer changes as davinci_disp_try_commit() does and
+ * apply all of them from the display interrupt at the next vertical blanking
+ * interval, so that the layers never show a partially updated layout.
+ * Returns -EBUSY if a previous commit is still pending and @wait is zero.
+ * When @wait is non-zero the call may sleep; if the display stops producing
+ * vsync interrupts the changes are applied directly after a timeout.  The
+ * commit is checked again when it is applied, against the layer state at
+ * that time, and dropped if it no longer fits; with @wait non-zero the
+ * error is returned.
+ */
+int davinci_disp_commit(struct davinci_disp_commit *commit, int wait);
+
 #ifdef __KERNEL__
 void osd_write_left_margin(u32 val);
 
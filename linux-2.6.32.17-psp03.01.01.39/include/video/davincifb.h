@@ -24,6 +24,7 @@
 #include <linux/fb.h>
 #include <linux/poll.h>
 #include <linux/wait.h>
+#include <linux/spinlock.h>
 
 #define DAVINCIFB_NAME "davincifb"
 
@@ -33,6 +34,12 @@
 #define VID0_FBNAME "dm_vid0_fb"
 #define VID1_FBNAME "dm_vid1_fb"
 
+/* Maximum number of pages that can be allocated per window */
+#define DAVINCIFB_MAX_PAGES	3
+
+/* Number of page flips that can be queued on a window ahead of vsync */
+#define DAVINCIFB_FLIPQ_DEPTH	(DAVINCIFB_MAX_PAGES - 1)
+
 struct davincifb_platform_data {
 	bool invert_field;
 };
@@ -47,6 +54,13 @@ struct vpbe_dm_win_info {
 	unsigned own_window; /* Does the framebuffer driver own this window? */
 	unsigned display_window;
 	unsigned sdram_address;
+	unsigned num_pages;
+	/* Page flips waiting to be latched by the vsync callback */
+	unsigned long flipq[DAVINCIFB_FLIPQ_DEPTH];
+	unsigned flipq_head;
+	unsigned flipq_count;
+	u32 flip_submitted;
+	u32 flip_completed;
 	unsigned int pseudo_palette[16];
 };
 
@@ -59,6 +73,7 @@ struct vpbe_dm_info {
 
 	wait_queue_head_t vsync_wait;
 	unsigned int vsync_cnt;
+	spinlock_t flip_lock;
 	int timeout;
 	struct davinci_disp_callback vsync_callback;
 
@@ -131,6 +131,56 @@ typedef struct vpbe_window_position {
 	unsigned int ypos;	/* Y position of the window */
 } vpbe_window_position_t;
 
+/* Structure for a queued page flip */
+typedef struct davincifb_flip {
+	u_int32_t xoffset;	/* Offset of the new page in the virtual fb */
+	u_int32_t yoffset;
+	u_int32_t flags;	/* DAVINCIFB_FLIP_* flags */
+	u_int32_t sequence;	/* Returned: sequence number of this flip */
+} davincifb_flip_t;
+
+/* Fail with EAGAIN instead of waiting when the flip queue is full */
+#define DAVINCIFB_FLIP_NONBLOCK	(1 << 0)
+
+/* Structure for querying the state of the flip queue */
+typedef struct davincifb_flip_status {
+	u_int32_t submitted;	/* Sequence number of the last queued flip */
+	u_int32_t completed;	/* Sequence number of the last latched flip */
+	u_int32_t pending;	/* Number of flips waiting for vsync */
+	u_int32_t vsync_cnt;	/* Number of vsyncs seen so far */
+} davincifb_flip_status_t;
+
+/* Structure for the new state of one window in an atomic commit */
+typedef struct davincifb_win_commit {
+	u_int32_t flags;	/* DAVINCIFB_COMMIT_* flags, 0: unchanged */
+	u_int32_t enable;	/* 1: show the window 0: hide it */
+	u_int32_t xpos;		/* Position of the window on the display */
+	u_int32_t ypos;
+	u_int32_t xoffset;	/* Offset of the page shown in the virtual fb */
+	u_int32_t yoffset;
+	u_int32_t zoom_h;	/* 0: x1 1: x2 2: x4 */
+	u_int32_t zoom_v;
+	u_int32_t bf;		/* Blend factor, bitmap windows only */
+	u_int32_t enable_colorkeying;	/* Bitmap windows only */
+	u_int32_t colorkey;
+} davincifb_win_commit_t;
+
+#define DAVINCIFB_COMMIT_ENABLE		(1 << 0)
+#define DAVINCIFB_COMMIT_POS		(1 << 1)
+#define DAVINCIFB_COMMIT_PAN		(1 << 2)
+#define DAVINCIFB_COMMIT_ZOOM		(1 << 3)
+#define DAVINCIFB_COMMIT_BLEND		(1 << 4)
+#define DAVINCIFB_COMMIT_COLORKEY	(1 << 5)
+
+/* Structure for changing several windows in the same vertical blanking */
+typedef struct davincifb_commit {
+	davincifb_win_commit_t win[4];	/* Indexed by OSD0, VID0, OSD1, VID1 */
+	u_int32_t flags;	/* DAVINCIFB_COMMIT_NONBLOCK */
+} davincifb_commit_t;
+
+/* Return once the commit is queued instead of when it is applied */
+#define DAVINCIFB_COMMIT_NONBLOCK	(1 << 0)
+
 #define	RAM_CLUT_SIZE	256*3
 
 /* custom ioctl definitions */
@@ -165,6 +215,12 @@ typedef struct vpbe_window_position {
 	_IOW('F', 0x49, u_int32_t)
 #define FBIO_SET_CURSOR			\
 	_IOW('F', 0x50, struct fb_cursor)
+#define FBIO_QUEUE_FLIP			\
+	_IOWR('F', 0x51, davincifb_flip_t)
+#define FBIO_GET_FLIP_STATUS		\
+	_IOR('F', 0x52, davincifb_flip_status_t)
+#define FBIO_COMMIT			\
+	_IOW('F', 0x53, davincifb_commit_t)
 
 /*  Window ID definitions */
 #define OSD0 0
@@ -540,6 +540,16 @@ static int davinci_i2s_probe(struct platform_device *pdev)
 	dev->dma_params[SNDRV_PCM_STREAM_PLAYBACK].channel = res->start;
 	dev->dma_params[SNDRV_PCM_STREAM_PLAYBACK].eventq_no =
 					pdata ? pdata->eventq_no : EVENTQ_0;
+	if (pdata) {
+		dev->dma_params[SNDRV_PCM_STREAM_PLAYBACK].sram_size =
+						pdata->sram_size_playback;
+		dev->dma_params[SNDRV_PCM_STREAM_CAPTURE].sram_size =
+						pdata->sram_size_capture;
+		dev->dma_params[SNDRV_PCM_STREAM_PLAYBACK].ram_chan_q =
+						pdata->ram_chan_q;
+		dev->dma_params[SNDRV_PCM_STREAM_CAPTURE].ram_chan_q =
+						pdata->ram_chan_q;
+	}
 
 	res = platform_get_resource(pdev, IORESOURCE_DMA, 1);
 	if (!res) {
@@ -14,6 +14,7 @@
 #include <linux/platform_device.h>
 #include <linux/slab.h>
 #include <linux/dma-mapping.h>
+#include <linux/dmaengine.h>
 #include <linux/kernel.h>
 
 #include <sound/core.h>
@@ -23,6 +24,8 @@
 
 #include <asm/dma.h>
 #include <mach/edma.h>
+#include <mach/edma-dmaengine.h>
+#include <mach/sram.h>
 
 #include "davinci-pcm.h"
 
@@ -43,128 +46,279 @@ static struct snd_pcm_hardware davinci_pcm_hardware = {
 	.buffer_bytes_max = 128 * 1024,
 	.period_bytes_min = 32,
 	.period_bytes_max = 8 * 1024,
-	.periods_min = 16,
-	.periods_max = 255,
+	.periods_min = 2,
+	.periods_max = DAVINCI_PCM_MAX_PERIODS,
 	.fifo_size = 0,
 };
 
+/*
+ * The EDMA runs the whole buffer on its own:  a cyclic transfer of the
+ * EDMA dmaengine driver, with one parameter RAM set per period linked
+ * into a ring, so nothing needs reprogramming from the completion IRQ
+ * and a late interrupt can't starve the serial port.
+ *
+ * Optionally the serial port is fed from (or drains into) a ping-pong
+ * pair of period sized buffers in on-chip SRAM instead.  The "asp"
+ * channel then moves words between the port and SRAM, and chains to a
+ * "ram" channel which copies each finished half from or to the DDR
+ * buffer, one period per chained event.  Only the ram channel raises
+ * period interrupts.  The dmaengine API has no way to chain two
+ * channels, so this mode programs the EDMA directly.
+ */
 struct davinci_runtime_data {
 	spinlock_t lock;
-	int period;		/* current DMA period */
-	int master_lch;		/* Master DMA channel */
-	int slave_lch;		/* linked parameter RAM reload slot */
+	struct dma_chan *chan;	/* DDR ring, or NULL */
+	struct edma_dma_slave slave;
+	int master_lch;		/* SRAM ping-pong port channel, or -1 */
+	int ram_lch;		/* SRAM <-> DDR channel, or -1 */
+	int ram_slot;		/* ram channel reload slot */
+	unsigned nr_slots;	/* entries used in slots[] */
+	unsigned slots[2];	/* master reload pair */
+	struct edmacc_param ring[2];
+	void *sram;		/* ping-pong buffers, or NULL */
+	dma_addr_t sram_dma;
+	unsigned sram_len;
 	struct davinci_pcm_dma_params *params;	/* DMA params */
 };
 
-static void davinci_pcm_enqueue_dma(struct snd_pcm_substream *substream)
+/* parameter set moving one period between memory at @buf and the port */
+static void davinci_pcm_period_param(struct snd_pcm_substream *substream,
+		struct edmacc_param *p, dma_addr_t buf, unsigned opt)
 {
 	struct davinci_runtime_data *prtd = substream->runtime->private_data;
-	struct snd_pcm_runtime *runtime = substream->runtime;
-	int lch = prtd->slave_lch;
-	unsigned int period_size;
-	unsigned int dma_offset;
-	dma_addr_t dma_pos;
-	dma_addr_t src, dst;
-	unsigned short src_bidx, dst_bidx;
-	unsigned int data_type;
-	unsigned short acnt;
+	struct davinci_pcm_dma_params *params = prtd->params;
 	unsigned int count;
 
-	period_size = snd_pcm_lib_period_bytes(substream);
-	dma_offset = prtd->period * period_size;
-	dma_pos = runtime->dma_addr + dma_offset;
-
-	pr_debug("davinci_pcm: audio_set_dma_params_play channel = %d "
-		"dma_ptr = %x period_size=%x\n", lch, dma_pos, period_size);
-
-	data_type = prtd->params->data_type;
-	count = period_size / data_type;
+	count = snd_pcm_lib_period_bytes(substream) / params->data_type;
 
+	p->opt = opt;
 	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK) {
-		src = dma_pos;
-		dst = prtd->params->dma_addr;
-		src_bidx = data_type;
-		dst_bidx = 0;
+		p->src = buf;
+		p->dst = params->dma_addr;
+		p->src_dst_bidx = params->data_type;
 	} else {
-		src = prtd->params->dma_addr;
-		dst = dma_pos;
-		src_bidx = 0;
-		dst_bidx = data_type;
+		p->src = params->dma_addr;
+		p->dst = buf;
+		p->src_dst_bidx = params->data_type << 16;
 	}
+	p->a_b_cnt = count << 16 | params->acnt;
+	p->link_bcntrld = 0;
+	p->src_dst_cidx = 0;
+	p->ccnt = 1;
+}
 
-	acnt = prtd->params->acnt;
-	edma_set_src(lch, src, INCR, W8BIT);
-	edma_set_dest(lch, dst, INCR, W8BIT);
-	edma_set_src_index(lch, src_bidx, 0);
-	edma_set_dest_index(lch, dst_bidx, 0);
-	edma_set_transfer_params(lch, acnt, count, 1, 0, ASYNC);
+/*
+ * Program the SRAM ping-pong:  the master channel alternates between
+ * the two halves and chains to the ram channel after each one.  The
+ * ram channel copies one period per chained event (A-synchronized, so
+ * ACNT is a whole period and each frame covers both halves) and
+ * interrupts after every period.
+ */
+static void davinci_pcm_setup_sram(struct snd_pcm_substream *substream)
+{
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	struct davinci_runtime_data *prtd = runtime->private_data;
+	unsigned int period_size = snd_pcm_lib_period_bytes(substream);
+	struct edmacc_param p;
+	unsigned opt;
+	u32 ddr_idx = period_size;
+	u32 sram_cidx = -period_size & 0xffff;
+
+	opt = TCCHEN | EDMA_TCC(EDMA_CHAN_SLOT(prtd->ram_lch));
+	davinci_pcm_period_param(substream, &prtd->ring[0],
+			prtd->sram_dma, opt);
+	davinci_pcm_period_param(substream, &prtd->ring[1],
+			prtd->sram_dma + period_size, opt);
+	edma_write_slot_chain(prtd->slots, prtd->ring, 2, true);
+
+	p.opt = ITCINTEN | TCINTEN | EDMA_TCC(EDMA_CHAN_SLOT(prtd->ram_lch));
+	p.a_b_cnt = 2 << 16 | period_size;
+	p.link_bcntrld = 2 << 16;
+	p.ccnt = runtime->periods / 2;
+	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK) {
+		p.src = runtime->dma_addr;
+		p.dst = prtd->sram_dma;
+		p.src_dst_bidx = ddr_idx << 16 | ddr_idx;
+		p.src_dst_cidx = sram_cidx << 16 | ddr_idx;
+	} else {
+		p.src = prtd->sram_dma;
+		p.dst = runtime->dma_addr;
+		p.src_dst_bidx = ddr_idx << 16 | ddr_idx;
+		p.src_dst_cidx = ddr_idx << 16 | sram_cidx;
+	}
+	edma_write_slot_chain(&prtd->ram_slot, &p, 1, true);
 
-	prtd->period++;
-	if (unlikely(prtd->period >= runtime->periods))
-		prtd->period = 0;
+	/*
+	 * Playback starts with both halves preloaded from periods 0 and 1
+	 * (see davinci_pcm_trigger), so the first copy is period 2.
+	 */
+	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK &&
+			runtime->periods > 2) {
+		p.src += 2 * period_size;
+		p.ccnt--;
+		p.link_bcntrld = 2 << 16 |
+			(EDMA_CHAN_SLOT(prtd->ram_slot) << 5);
+	} else {
+		edma_read_slot(prtd->ram_slot, &p);
+	}
+	edma_write_slot(prtd->ram_lch, &p);
 }
 
-static void davinci_pcm_dma_irq(unsigned lch, u16 ch_status, void *data)
+static void davinci_pcm_period_done(void *data)
 {
 	struct snd_pcm_substream *substream = data;
-	struct davinci_runtime_data *prtd = substream->runtime->private_data;
 
+	if (snd_pcm_running(substream))
+		snd_pcm_period_elapsed(substream);
+}
+
+static void davinci_pcm_dma_irq(unsigned lch, u16 ch_status, void *data)
+{
 	pr_debug("davinci_pcm: lch=%d, status=0x%x\n", lch, ch_status);
 
 	if (unlikely(ch_status != DMA_COMPLETE))
 		return;
 
-	if (snd_pcm_running(substream)) {
-		snd_pcm_period_elapsed(substream);
+	davinci_pcm_period_done(data);
+}
 
-		spin_lock(&prtd->lock);
-		davinci_pcm_enqueue_dma(substream);
-		spin_unlock(&prtd->lock);
+static void davinci_pcm_dma_release(struct snd_pcm_substream *substream)
+{
+	struct davinci_runtime_data *prtd = substream->runtime->private_data;
+
+	if (prtd->chan) {
+		edma_dma_cyclic_free(prtd->chan);
+		dma_release_channel(prtd->chan);
+		prtd->chan = NULL;
+	}
+	if (prtd->nr_slots) {
+		edma_free_slot_chain(prtd->slots, prtd->nr_slots);
+		prtd->nr_slots = 0;
+	}
+	if (prtd->ram_lch >= 0) {
+		edma_free_slot(prtd->ram_slot);
+		edma_free_channel(prtd->ram_lch);
+		prtd->ram_lch = -1;
+	}
+	if (prtd->master_lch >= 0) {
+		edma_free_channel(prtd->master_lch);
+		prtd->master_lch = -1;
+	}
+	if (prtd->sram) {
+		sram_free(prtd->sram, prtd->sram_len);
+		prtd->sram = NULL;
 	}
 }
 
-static int davinci_pcm_dma_request(struct snd_pcm_substream *substream)
+/*
+ * Claim the ping-pong buffers and both channels; on any failure the
+ * stream quietly falls back to running straight from DDR.
+ */
+static int davinci_pcm_sram_request(struct snd_pcm_substream *substream,
+		unsigned len)
 {
 	struct davinci_runtime_data *prtd = substream->runtime->private_data;
-	struct edmacc_param p_ram;
+	unsigned ctlr;
 	int ret;
 
-	/* Request master DMA channel */
-	ret = edma_alloc_channel(prtd->params->channel,
-				  davinci_pcm_dma_irq, substream,
-				  prtd->params->eventq_no);
+	if (len > prtd->params->sram_size)
+		return -EINVAL;
+
+	prtd->sram = sram_alloc(len, &prtd->sram_dma);
+	if (!prtd->sram)
+		return -ENOMEM;
+	prtd->sram_len = len;
+
+	ret = edma_alloc_channel(prtd->params->channel, davinci_pcm_dma_irq,
+				 substream, prtd->params->eventq_no);
 	if (ret < 0)
-		return ret;
+		goto fail;
 	prtd->master_lch = ret;
+	edma_set_channel_class(prtd->master_lch, EDMA_QOS_AUDIO);
+	ctlr = EDMA_CTLR(prtd->master_lch);
 
-	/* Request parameter RAM reload slot */
-	ret = edma_alloc_slot(EDMA_CTLR(prtd->master_lch), EDMA_SLOT_ANY);
+	ret = edma_alloc_channel(EDMA_CHANNEL_ANY, davinci_pcm_dma_irq,
+				 substream, prtd->params->ram_chan_q);
+	if (ret < 0)
+		goto fail;
+	prtd->ram_lch = ret;
+	edma_set_channel_class(prtd->ram_lch, EDMA_QOS_AUDIO);
+	if (EDMA_CTLR(prtd->ram_lch) != ctlr) {
+		ret = -EBUSY;
+		goto fail;
+	}
+
+	ret = edma_alloc_slot(ctlr, EDMA_SLOT_ANY);
+	if (ret < 0)
+		goto fail;
+	prtd->ram_slot = ret;
+
+	ret = edma_alloc_slot_chain(ctlr, prtd->slots, 2, true);
 	if (ret < 0) {
+		edma_free_slot(prtd->ram_slot);
+		goto fail;
+	}
+	prtd->nr_slots = 2;
+
+	return 0;
+
+fail:
+	if (prtd->ram_lch >= 0) {
+		edma_free_channel(prtd->ram_lch);
+		prtd->ram_lch = -1;
+	}
+	if (prtd->master_lch >= 0) {
 		edma_free_channel(prtd->master_lch);
-		return ret;
+		prtd->master_lch = -1;
+	}
+	sram_free(prtd->sram, prtd->sram_len);
+	prtd->sram = NULL;
+	return ret;
+}
+
+static int davinci_pcm_dma_request(struct snd_pcm_substream *substream,
+		struct snd_pcm_hw_params *hw_params)
+{
+	struct davinci_runtime_data *prtd = substream->runtime->private_data;
+	unsigned periods = params_periods(hw_params);
+	dma_cap_mask_t mask;
+	int ret;
+
+	if (prtd->params->sram_size && !(periods & 1)) {
+		ret = davinci_pcm_sram_request(substream,
+				2 * params_period_bytes(hw_params));
+		if (ret == 0)
+			return 0;
+		printk(KERN_WARNING "davinci_pcm: no SRAM ping-pong (%d), "
+		       "using DDR\n", ret);
 	}
-	prtd->slave_lch = ret;
-
-	/* Issue transfer completion IRQ when the channel completes a
-	 * transfer, then always reload from the same slot (by a kind
-	 * of loopback link).  The completion IRQ handler will update
-	 * the reload slot with a new buffer.
-	 *
-	 * REVISIT save p_ram here after setting up everything except
-	 * the buffer and its length (ccnt) ... use it as a template
-	 * so davinci_pcm_enqueue_dma() takes less time in IRQ.
-	 */
-	edma_read_slot(prtd->slave_lch, &p_ram);
-	p_ram.opt |= TCINTEN | EDMA_TCC(EDMA_CHAN_SLOT(prtd->master_lch));
-	p_ram.link_bcntrld = EDMA_CHAN_SLOT(prtd->slave_lch) << 5;
-	edma_write_slot(prtd->slave_lch, &p_ram);
+
+	/* one element of data_type bytes in memory per ACNT bytes moved */
+	prtd->slave.dma_ch = prtd->params->channel;
+	prtd->slave.eventq = prtd->params->eventq_no;
+	prtd->slave.tx_reg = prtd->params->dma_addr;
+	prtd->slave.rx_reg = prtd->params->dma_addr;
+	prtd->slave.reg_width = prtd->params->acnt;
+	prtd->slave.mem_stride = prtd->params->data_type;
+	prtd->slave.maxburst = 0;
+
+	dma_cap_zero(mask);
+	dma_cap_set(DMA_SLAVE, mask);
+	prtd->chan = dma_request_channel(mask, edma_dma_filter, &prtd->slave);
+	if (!prtd->chan) {
+		printk(KERN_ERR "davinci_pcm: Failed to get dma channels\n");
+		return -EBUSY;
+	}
+	/* the slave channel is the event channel itself */
+	edma_set_channel_class(prtd->params->channel, EDMA_QOS_AUDIO);
 
 	return 0;
 }
 
 static int davinci_pcm_trigger(struct snd_pcm_substream *substream, int cmd)
 {
-	struct davinci_runtime_data *prtd = substream->runtime->private_data;
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	struct davinci_runtime_data *prtd = runtime->private_data;
 	int ret = 0;
 
 	spin_lock(&prtd->lock);
@@ -172,13 +326,24 @@ static int davinci_pcm_trigger(struct snd_pcm_substream *substream, int cmd)
 	switch (cmd) {
 	case SNDRV_PCM_TRIGGER_START:
 	case SNDRV_PCM_TRIGGER_RESUME:
+		/* preload both halves; the ram channel continues from there */
+		if (prtd->sram &&
+				substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
+			memcpy(prtd->sram, runtime->dma_area, prtd->sram_len);
+		/* FALLTHROUGH */
 	case SNDRV_PCM_TRIGGER_PAUSE_RELEASE:
-		edma_start(prtd->master_lch);
+		if (prtd->chan)
+			ret = edma_dma_cyclic_start(prtd->chan);
+		else
+			edma_start(prtd->master_lch);
 		break;
 	case SNDRV_PCM_TRIGGER_STOP:
 	case SNDRV_PCM_TRIGGER_SUSPEND:
 	case SNDRV_PCM_TRIGGER_PAUSE_PUSH:
-		edma_stop(prtd->master_lch);
+		if (prtd->chan)
+			edma_dma_cyclic_stop(prtd->chan);
+		else
+			edma_stop(prtd->master_lch);
 		break;
 	default:
 		ret = -EINVAL;
@@ -193,19 +358,82 @@ static int davinci_pcm_trigger(struct snd_pcm_substream *substream, int cmd)
 static int davinci_pcm_prepare(struct snd_pcm_substream *substream)
 {
 	struct davinci_runtime_data *prtd = substream->runtime->private_data;
+	struct edma_cyclic_desc *cdesc;
 	struct edmacc_param temp;
 
-	prtd->period = 0;
-	davinci_pcm_enqueue_dma(substream);
+	substream->runtime->delay = 0;
+	if (prtd->chan) {
+		/* restart from the beginning of the buffer */
+		edma_dma_cyclic_free(prtd->chan);
+		cdesc = edma_dma_cyclic_prep(prtd->chan,
+				substream->runtime->dma_addr,
+				snd_pcm_lib_buffer_bytes(substream),
+				snd_pcm_lib_period_bytes(substream),
+				substream->stream == SNDRV_PCM_STREAM_PLAYBACK ?
+					DMA_TO_DEVICE : DMA_FROM_DEVICE);
+		if (IS_ERR(cdesc))
+			return PTR_ERR(cdesc);
+		cdesc->period_callback = davinci_pcm_period_done;
+		cdesc->period_callback_param = substream;
+		return 0;
+	}
 
-	/* Copy self-linked parameter RAM entry into master channel */
-	edma_read_slot(prtd->slave_lch, &temp);
+	davinci_pcm_setup_sram(substream);
+
+	/* Copy the first linked parameter RAM entry into master channel */
+	edma_read_slot(prtd->slots[0], &temp);
 	edma_write_slot(prtd->master_lch, &temp);
-	davinci_pcm_enqueue_dma(substream);
 
 	return 0;
 }
 
+/*
+ * Bytes held in the SRAM halves on their way to (playback) or from
+ * (capture) the port, given that the ram channel has moved @count
+ * bytes of the DDR buffer.  Period j always goes through half j % 2,
+ * so the half the master channel is in tells which period the port
+ * is on:  one or two periods behind the ram channel for playback, the
+ * one it copies next or the one after for capture.
+ *
+ * Sample the ram channel first; if it moves on before the master
+ * channel is read the result is still consistent.
+ */
+static unsigned davinci_pcm_sram_fill(struct snd_pcm_substream *substream,
+		unsigned count)
+{
+	struct davinci_runtime_data *prtd = substream->runtime->private_data;
+	unsigned int period_size = snd_pcm_lib_period_bytes(substream);
+	unsigned period = count / period_size;
+	unsigned offset;
+	unsigned half;
+	dma_addr_t src, dst;
+
+	edma_get_position(prtd->master_lch, &src, &dst);
+	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
+		offset = src - prtd->sram_dma;
+	else
+		offset = dst - prtd->sram_dma;
+	if (offset >= 2 * period_size)
+		offset = 0;
+
+	half = offset / period_size;
+	offset %= period_size;
+
+	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
+		return ((period & 1) == half ? 2 : 1) * period_size - offset;
+	return ((period & 1) == half ? 0 : 1) * period_size + offset;
+}
+
+/*
+ * The position is read live from the parameter RAM, so it is accurate
+ * to the sample.  With the SRAM stage it only covers the DDR buffer,
+ * which moves a period at a time; what is in flight through SRAM is
+ * reported as runtime->delay, which the core adds to the delay it
+ * returns.  The core only refreshes the status timestamp when the
+ * position moves, which leaves it up to a period older than that delay,
+ * so it is refreshed here on every read; with the default gettimeofday
+ * type it is the clock vpfe stamps captured frames with.
+ */
 static snd_pcm_uframes_t
 davinci_pcm_pointer(struct snd_pcm_substream *substream)
 {
@@ -217,11 +445,23 @@ davinci_pcm_pointer(struct snd_pcm_substream *substream)
 
 	spin_lock(&prtd->lock);
 
-	edma_get_position(prtd->master_lch, &src, &dst);
-	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
-		count = src - runtime->dma_addr;
-	else
-		count = dst - runtime->dma_addr;
+	if (prtd->chan) {
+		count = edma_dma_cyclic_position(prtd->chan);
+	} else {
+		/* with the SRAM stage, the DDR buffer is only touched by
+		 * ram_lch */
+		edma_get_position(prtd->ram_lch, &src, &dst);
+		if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
+			count = src - runtime->dma_addr;
+		else
+			count = dst - runtime->dma_addr;
+
+		runtime->delay = bytes_to_frames(runtime,
+				davinci_pcm_sram_fill(substream, count));
+	}
+	if (runtime->tstamp_mode == SNDRV_PCM_TSTAMP_ENABLE)
+		snd_pcm_gettime(runtime,
+				(struct timespec *)&runtime->status->tstamp);
 
 	spin_unlock(&prtd->lock);
 
@@ -250,22 +490,45 @@ static int davinci_pcm_open(struct snd_pcm_substream *substream)
 	if (ret < 0)
 		return ret;
 
+	/*
+	 * The SRAM ping-pong needs two periods per pass, both in SRAM.
+	 * Playback preloads two periods at start, which the pointer can
+	 * only show if the buffer is longer than that.
+	 */
+	if (params->sram_size) {
+		ret = snd_pcm_hw_constraint_step(runtime, 0,
+						 SNDRV_PCM_HW_PARAM_PERIODS, 2);
+		if (ret < 0)
+			return ret;
+		if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK) {
+			ret = snd_pcm_hw_constraint_minmax(runtime,
+					SNDRV_PCM_HW_PARAM_PERIODS,
+					4, DAVINCI_PCM_MAX_PERIODS);
+			if (ret < 0)
+				return ret;
+		}
+		ret = snd_pcm_hw_constraint_minmax(runtime,
+				SNDRV_PCM_HW_PARAM_PERIOD_BYTES,
+				davinci_pcm_hardware.period_bytes_min,
+				min_t(unsigned, params->sram_size / 2,
+				      davinci_pcm_hardware.period_bytes_max));
+		if (ret < 0)
+			return ret;
+	}
+
 	prtd = kzalloc(sizeof(struct davinci_runtime_data), GFP_KERNEL);
 	if (prtd == NULL)
 		return -ENOMEM;
 
 	spin_lock_init(&prtd->lock);
 	prtd->params = params;
+	prtd->master_lch = -1;
+	prtd->ram_lch = -1;
 
+	/* the DMA channels depend on the period layout, see hw_params */
 	runtime->private_data = prtd;
 
-	ret = davinci_pcm_dma_request(substream);
-	if (ret) {
-		printk(KERN_ERR "davinci_pcm: Failed to get dma channels\n");
-		kfree(prtd);
-	}
-
-	return ret;
+	return 0;
 }
 
 static int davinci_pcm_close(struct snd_pcm_substream *substream)
@@ -273,10 +536,7 @@ static int davinci_pcm_close(struct snd_pcm_substream *substream)
 	struct snd_pcm_runtime *runtime = substream->runtime;
 	struct davinci_runtime_data *prtd = runtime->private_data;
 
-	edma_unlink(prtd->slave_lch);
-
-	edma_free_slot(prtd->slave_lch);
-	edma_free_channel(prtd->master_lch);
+	davinci_pcm_dma_release(substream);
 
 	kfree(prtd);
 
@@ -286,12 +546,21 @@ static int davinci_pcm_close(struct snd_pcm_substream *substream)
 static int davinci_pcm_hw_params(struct snd_pcm_substream *substream,
 				 struct snd_pcm_hw_params *hw_params)
 {
-	return snd_pcm_lib_malloc_pages(substream,
-					params_buffer_bytes(hw_params));
+	int ret;
+
+	ret = snd_pcm_lib_malloc_pages(substream,
+				       params_buffer_bytes(hw_params));
+	if (ret < 0)
+		return ret;
+
+	/* slots and SRAM depend on the period layout; redo them */
+	davinci_pcm_dma_release(substream);
+	return davinci_pcm_dma_request(substream, hw_params);
 }
 
 static int davinci_pcm_hw_free(struct snd_pcm_substream *substream)
 {
+	davinci_pcm_dma_release(substream);
 	return snd_pcm_lib_free_pages(substream);
 }
 
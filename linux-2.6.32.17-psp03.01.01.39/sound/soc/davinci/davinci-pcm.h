@@ -15,6 +15,8 @@
 #include <mach/edma.h>
 #include <mach/asp.h>
 
+/* upper bound on periods, one parameter RAM slot each */
+#define DAVINCI_PCM_MAX_PERIODS	32
 
 struct davinci_pcm_dma_params {
 	int channel;			/* sync dma channel ID */
@@ -23,6 +25,8 @@ struct davinci_pcm_dma_params {
 	enum dma_event_q eventq_no;	/* event queue number */
 	unsigned char data_type;	/* xfer data type */
 	unsigned char convert_mono_stereo;
+	unsigned int sram_size;		/* SRAM ping-pong bytes, 0 = none */
+	enum dma_event_q ram_chan_q;	/* event queue for SRAM <-> DDR */
 };
 
 